@@ -35,13 +35,16 @@ G_BEGIN_DECLS
 # include "mks-device.h"
 # include "mks-display.h"
 # include "mks-enums.h"
+# include "mks-frame-stats.h"
 # include "mks-init.h"
 # include "mks-keyboard.h"
 # include "mks-microphone.h"
 # include "mks-mouse.h"
 # include "mks-screen.h"
 # include "mks-screen-attributes.h"
+# include "mks-screen-capture.h"
 # include "mks-session.h"
+# include "mks-shared-paintable.h"
 # include "mks-speaker.h"
 # include "mks-touchable.h"
 # include "mks-types.h"
@@ -23,32 +23,53 @@
 #include <cairo.h>
 #include <gtk/gtk.h>
 
+#include "mks-shm-publisher-private.h"
+#include "mks-surface-pool-private.h"
+
 G_BEGIN_DECLS
 
 #define MKS_TYPE_CAIRO_FRAMEBUFFER (mks_cairo_framebuffer_get_type())
 
 G_DECLARE_FINAL_TYPE (MksCairoFramebuffer, mks_cairo_framebuffer, MKS, CAIRO_FRAMEBUFFER, GObject)
 
-MksCairoFramebuffer *mks_cairo_framebuffer_new        (cairo_format_t       format,
-                                                       guint                width,
-                                                       guint                height);
-cairo_format_t       mks_cairo_framebuffer_get_format (MksCairoFramebuffer *self);
-guint                mks_cairo_framebuffer_get_width  (MksCairoFramebuffer *self);
-guint                mks_cairo_framebuffer_get_height (MksCairoFramebuffer *self);
-cairo_t             *mks_cairo_framebuffer_update     (MksCairoFramebuffer *self,
-                                                       guint                x,
-                                                       guint                y,
-                                                       guint                width,
-                                                       guint                height);
-void                 mks_cairo_framebuffer_copy_to    (MksCairoFramebuffer *self,
-                                                       MksCairoFramebuffer *dest);
-void                 mks_cairo_framebuffer_clear      (MksCairoFramebuffer *self);
-void                 mks_cairo_framebuffer_snapshot   (MksCairoFramebuffer *self,
-                                                       GtkSnapshot         *snapshot,
-                                                       double               width,
-                                                       double               height,
-                                                       double               surface_x,
-                                                       double               surface_y,
-                                                       int                  scale);
+MksCairoFramebuffer *mks_cairo_framebuffer_new          (cairo_format_t               format,
+                                                         guint                        width,
+                                                         guint                        height);
+MksCairoFramebuffer *mks_cairo_framebuffer_new_for_pool (MksSurfacePool              *pool,
+                                                         cairo_format_t               format,
+                                                         guint                        width,
+                                                         guint                        height);
+MksCairoFramebuffer *mks_cairo_framebuffer_new_resized  (MksCairoFramebuffer         *self,
+                                                         guint                        width,
+                                                         guint                        height);
+cairo_format_t       mks_cairo_framebuffer_get_format   (MksCairoFramebuffer         *self);
+guint                mks_cairo_framebuffer_get_width    (MksCairoFramebuffer         *self);
+guint                mks_cairo_framebuffer_get_height   (MksCairoFramebuffer         *self);
+cairo_t             *mks_cairo_framebuffer_update       (MksCairoFramebuffer         *self,
+                                                         guint                        x,
+                                                         guint                        y,
+                                                         guint                        width,
+                                                         guint                        height);
+void                 mks_cairo_framebuffer_blit         (MksCairoFramebuffer         *self,
+                                                         guint                        x,
+                                                         guint                        y,
+                                                         guint                        width,
+                                                         guint                        height,
+                                                         guint                        pixman_format,
+                                                         const guint8                *data,
+                                                         guint                        stride);
+void                 mks_cairo_framebuffer_copy_to      (MksCairoFramebuffer         *self,
+                                                         MksCairoFramebuffer         *dest);
+void                 mks_cairo_framebuffer_clear        (MksCairoFramebuffer         *self);
+void                 mks_cairo_framebuffer_publish      (MksCairoFramebuffer         *self,
+                                                         MksShmPublisher             *publisher,
+                                                         const cairo_rectangle_int_t *area);
+void                 mks_cairo_framebuffer_snapshot     (MksCairoFramebuffer         *self,
+                                                         GtkSnapshot                 *snapshot,
+                                                         double                       width,
+                                                         double                       height,
+                                                         double                       surface_x,
+                                                         double                       surface_y,
+                                                         int                          scale);
 
 G_END_DECLS
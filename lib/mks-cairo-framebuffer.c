@@ -20,12 +20,39 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <cairo-gobject.h>
 #include <gtk/gtk.h>
+#include <pixman.h>
 
 #include "mks-cairo-framebuffer-private.h"
+#include "mks-damage-private.h"
+#include "mks-pixels-private.h"
+#include "mks-shm-publisher-private.h"
+#include "mks-surface-pool-private.h"
+#include "mks-tile-hash-private.h"
+#include "mks-trace-private.h"
 #include "mks-util-private.h"
 
+/* Textures are split into tiles of at most this many pixels on each side.
+ * That keeps large guests and multi-head layouts below the maximum texture
+ * size of the GPU and lets the renderer only revisit the damaged tiles.
+ */
+#define TILE_SIZE 2048
+
+typedef struct _MksFramebufferTile
+{
+  /* The area of the framebuffer covered by the tile */
+  cairo_rectangle_int_t  area;
+
+  /* A slice of @content starting at the first pixel of @area */
+  GBytes                *content;
+
+  /* A GdkMemoryTexture we export and refresh with update regions */
+  GdkTexture            *texture;
+} MksFramebufferTile;
+
 struct _MksCairoFramebuffer
 {
   GObject parent_instance;
@@ -45,8 +72,9 @@ struct _MksCairoFramebuffer
    */
   GBytes *content;
 
-  /* A GdkMemoryTexture we export and refresh with update regions. */
-  GdkTexture *texture;
+  /* The tiles covering the framebuffer, in rows from the top-left */
+  MksFramebufferTile *tiles;
+  guint               n_tiles;
 
   /* The format our framebuffer uses and corresponding format
    * the uploaded textures will use.
@@ -66,23 +94,197 @@ struct _MksCairoFramebuffer
   guint height;
   guint width;
 
-  /* The real width and height when tiling is taken into account */
+  /* The real width and height of @surface. This may be larger than the
+   * framebuffer when the surface came from @pool or was over-allocated to
+   * leave room for the guest growing the display.
+   */
   guint real_height;
   guint real_width;
 
-  cairo_region_t *update_region;
+  /* Where @surface came from and returns to once @content is released */
+  MksSurfacePool *pool;
+
+  /* A framebuffer to take contents from while constructing */
+  MksCairoFramebuffer *source;
+
+  /* Protects @damage and @invalidate_queued which may be modified
+   * from the display worker thread while the main thread rebuilds the
+   * texture.
+   *
+   * Damage accumulates in @damage and the texture is rebuilt at most
+   * once per frame, when the framebuffer is next snapshot. We only emit
+   * invalidate-contents for the first damage after a snapshot so that
+   * many small updates within a frame cost a single rebuild.
+   */
+  GMutex mutex;
+  MksDamage damage;
+
+  /* The main context where textures are published and invalidations
+   * are emitted. GTK only renders from the default main context so
+   * updates drawn from another thread are marshalled there.
+   */
+  GMainContext *main_context;
+
+  /* When MKS_DEBUG=tile-hash is set, damage is reduced to the tiles
+   * whose contents changed since the previous upload.
+   */
+  MksTileHash *tile_hash;
+
+  guint invalidate_queued : 1;
 };
 
+typedef struct _MksCairoFramebufferUpdate
+{
+  MksCairoFramebuffer   *self;
+  cairo_rectangle_int_t  area;
+} MksCairoFramebufferUpdate;
+
+typedef struct _MksPooledContent
+{
+  MksSurfacePool  *pool;
+  cairo_surface_t *surface;
+} MksPooledContent;
+
 enum {
   PROP_0,
   PROP_FORMAT,
   PROP_HEIGHT,
+  PROP_POOL,
+  PROP_SOURCE,
   PROP_WIDTH,
   N_PROPS
 };
 
 static cairo_user_data_key_t invalidate_key;
 
+static void
+mks_pooled_content_free (gpointer data)
+{
+  MksPooledContent *content = data;
+
+  /* Only now that no texture references the pixels can they be reused */
+  mks_surface_pool_release (content->pool, g_steal_pointer (&content->surface));
+  mks_surface_pool_unref (content->pool);
+  g_free (content);
+}
+
+static void
+mks_cairo_framebuffer_clear_area (MksCairoFramebuffer *self,
+                                  guint                x,
+                                  guint                y,
+                                  guint                width,
+                                  guint                height)
+{
+  guint8 *data;
+
+  g_assert (MKS_IS_CAIRO_FRAMEBUFFER (self));
+  g_assert (x + width <= self->real_width);
+  g_assert (y + height <= self->real_height);
+
+  if (width == 0 || height == 0)
+    return;
+
+  data = cairo_image_surface_get_data (self->surface);
+
+  for (guint i = 0; i < height; i++)
+    memset (&data[(gsize)(y + i) * self->stride + (gsize)x * self->bpp], 0, (gsize)width * self->bpp);
+
+  cairo_surface_mark_dirty_rectangle (self->surface, x, y, width, height);
+}
+
+static void
+mks_cairo_framebuffer_share_source (MksCairoFramebuffer *self)
+{
+  MksCairoFramebuffer *source = self->source;
+  guint source_width = MIN (source->width, self->width);
+  guint source_height = MIN (source->height, self->height);
+
+  g_assert (MKS_IS_CAIRO_FRAMEBUFFER (self));
+  g_assert (MKS_IS_CAIRO_FRAMEBUFFER (source));
+
+  self->surface = cairo_surface_reference (source->surface);
+  self->content = g_bytes_ref (source->content);
+  self->real_width = source->real_width;
+  self->real_height = source->real_height;
+  self->stride = source->stride;
+  self->bpp = source->bpp;
+
+  /* Spare capacity may hold pixels from a previous user of the surface */
+  cairo_surface_flush (self->surface);
+  mks_cairo_framebuffer_clear_area (self,
+                                    source_width, 0,
+                                    self->width - source_width, source_height);
+  mks_cairo_framebuffer_clear_area (self,
+                                    0, source_height,
+                                    self->width, self->height - source_height);
+}
+
+static void
+mks_cairo_framebuffer_allocate (MksCairoFramebuffer *self)
+{
+  guint capacity_width = self->width;
+  guint capacity_height = self->height;
+  gboolean recycled = FALSE;
+
+  g_assert (MKS_IS_CAIRO_FRAMEBUFFER (self));
+
+  /* Guests probing resolutions tend to grow step by step, so leave room
+   * to grow into without another allocation and copy.
+   */
+  if (self->source != NULL)
+    {
+      if (self->width > self->source->real_width)
+        capacity_width = MAX (self->width, self->source->real_width + self->source->real_width / 2);
+
+      if (self->height > self->source->real_height)
+        capacity_height = MAX (self->height, self->source->real_height + self->source->real_height / 2);
+    }
+
+  if (self->pool != NULL)
+    self->surface = mks_surface_pool_acquire (self->pool,
+                                              self->format,
+                                              capacity_width,
+                                              capacity_height,
+                                              &recycled);
+  else
+    self->surface = cairo_image_surface_create (self->format, capacity_width, capacity_height);
+
+  self->real_width = cairo_image_surface_get_width (self->surface);
+  self->real_height = cairo_image_surface_get_height (self->surface);
+  self->stride = cairo_image_surface_get_stride (self->surface);
+  self->bpp = self->stride / self->real_width;
+
+  if (self->pool != NULL)
+    {
+      MksPooledContent *content;
+
+      content = g_new0 (MksPooledContent, 1);
+      content->pool = mks_surface_pool_ref (self->pool);
+      content->surface = cairo_surface_reference (self->surface);
+
+      self->content = g_bytes_new_with_free_func (cairo_image_surface_get_data (self->surface),
+                                                  self->stride * self->real_height,
+                                                  mks_pooled_content_free,
+                                                  content);
+    }
+  else
+    {
+      self->content = g_bytes_new_with_free_func (cairo_image_surface_get_data (self->surface),
+                                                  self->stride * self->real_height,
+                                                  (GDestroyNotify) cairo_surface_destroy,
+                                                  cairo_surface_reference (self->surface));
+    }
+
+  if (recycled)
+    {
+      cairo_surface_flush (self->surface);
+      mks_cairo_framebuffer_clear_area (self, 0, 0, self->width, self->height);
+    }
+
+  if (self->source != NULL)
+    mks_cairo_framebuffer_copy_to (self->source, self);
+}
+
 static int
 mks_cairo_framebuffer_get_intrinsic_width (GdkPaintable *paintable)
 {
@@ -105,30 +307,106 @@ mks_cairo_framebuffer_get_intrinsic_aspect_ratio (GdkPaintable *paintable)
 }
 
 static void
-mks_cairo_framebuffer_rebuild_texture (MksCairoFramebuffer *self)
+mks_cairo_framebuffer_init_tiles (MksCairoFramebuffer *self)
+{
+  guint n_columns;
+  guint n_rows;
+
+  g_assert (MKS_IS_CAIRO_FRAMEBUFFER (self));
+  g_assert (self->content != NULL);
+  g_assert (self->tiles == NULL);
+
+  n_columns = (self->width + TILE_SIZE - 1) / TILE_SIZE;
+  n_rows = (self->height + TILE_SIZE - 1) / TILE_SIZE;
+
+  self->n_tiles = n_columns * n_rows;
+  self->tiles = g_new0 (MksFramebufferTile, self->n_tiles);
+
+  for (guint row = 0; row < n_rows; row++)
+    {
+      for (guint column = 0; column < n_columns; column++)
+        {
+          MksFramebufferTile *tile = &self->tiles[row * n_columns + column];
+          guint x = column * TILE_SIZE;
+          guint y = row * TILE_SIZE;
+          guint width = MIN (TILE_SIZE, self->width - x);
+          guint height = MIN (TILE_SIZE, self->height - y);
+
+          tile->area = (cairo_rectangle_int_t) { x, y, width, height };
+
+          /* Rows of the tile keep the stride of the framebuffer so the
+           * slice only needs to reach the end of its last row.
+           */
+          tile->content = g_bytes_new_from_bytes (self->content,
+                                                  ((gsize)y * self->stride) + ((gsize)x * self->bpp),
+                                                  ((gsize)(height - 1) * self->stride) + ((gsize)width * self->bpp));
+        }
+    }
+}
+
+static void
+mks_cairo_framebuffer_clear_tiles (MksCairoFramebuffer *self)
+{
+  g_assert (MKS_IS_CAIRO_FRAMEBUFFER (self));
+
+  for (guint i = 0; i < self->n_tiles; i++)
+    {
+      g_clear_object (&self->tiles[i].texture);
+      g_clear_pointer (&self->tiles[i].content, g_bytes_unref);
+    }
+
+  g_clear_pointer (&self->tiles, g_free);
+  self->n_tiles = 0;
+}
+
+static void
+mks_cairo_framebuffer_rebuild_tile (MksCairoFramebuffer *self,
+                                    MksFramebufferTile  *tile,
+                                    cairo_region_t      *update_region)
 {
   g_autoptr(GdkMemoryTextureBuilder) builder = NULL;
   g_autoptr(GdkTexture) texture = NULL;
+  cairo_region_t *tile_region = NULL;
 
   g_assert (MKS_IS_CAIRO_FRAMEBUFFER (self));
-  g_assert (self->content != NULL);
+  g_assert (tile != NULL);
+  g_assert (tile->content != NULL);
+
+  if (tile->texture != NULL)
+    {
+      /* Tiles outside of the damage keep their previous texture */
+      if (update_region == NULL)
+        return;
+
+      tile_region = cairo_region_copy (update_region);
+      cairo_region_intersect_rectangle (tile_region, &tile->area);
+
+      if (cairo_region_is_empty (tile_region))
+        {
+          cairo_region_destroy (tile_region);
+          return;
+        }
+
+      cairo_region_translate (tile_region, -tile->area.x, -tile->area.y);
+    }
 
   builder = gdk_memory_texture_builder_new ();
-  gdk_memory_texture_builder_set_bytes (builder, self->content);
+  gdk_memory_texture_builder_set_bytes (builder, tile->content);
   gdk_memory_texture_builder_set_format (builder, self->memory_format);
-  gdk_memory_texture_builder_set_width (builder, self->width);
-  gdk_memory_texture_builder_set_height (builder, self->height);
+  gdk_memory_texture_builder_set_width (builder, tile->area.width);
+  gdk_memory_texture_builder_set_height (builder, tile->area.height);
   gdk_memory_texture_builder_set_stride_for_plane (builder, 0, self->stride);
 
-  if (self->texture != NULL)
-    gdk_memory_texture_builder_set_update_texture (builder, self->texture);
+  if (tile->texture != NULL)
+    gdk_memory_texture_builder_set_update_texture (builder, tile->texture);
 
-  if (self->update_region != NULL)
-    gdk_memory_texture_builder_set_update_region (builder, self->update_region);
+  if (tile_region != NULL)
+    gdk_memory_texture_builder_set_update_region (builder, tile_region);
 
   texture = gdk_memory_texture_builder_build (builder);
-  g_set_object (&self->texture, texture);
-  g_clear_pointer (&self->update_region, cairo_region_destroy);
+  g_set_object (&tile->texture, texture);
+
+  g_clear_pointer (&tile_region, cairo_region_destroy);
 }
 
 static void
@@ -140,14 +418,60 @@ mks_cairo_framebuffer_snapshot_internal (MksCairoFramebuffer *self,
                                          double               surface_y,
                                          int                  scale)
 {
+  cairo_region_t *update_region = NULL;
   graphene_rect_t bounds;
+  double x_scale;
+  double y_scale;
 
   g_assert (MKS_IS_CAIRO_FRAMEBUFFER (self));
   g_assert (GTK_IS_SNAPSHOT (snapshot));
   g_assert (scale > 0);
 
-  if (self->texture == NULL)
-    mks_cairo_framebuffer_rebuild_texture (self);
+  if (self->n_tiles == 0)
+    return;
+
+  /* Only hold the lock long enough to take the damage so the display
+   * worker is not blocked while we upload.
+   */
+  g_mutex_lock (&self->mutex);
+  if (!mks_damage_is_empty (&self->damage))
+    {
+      mks_damage_clip (&self->damage, &(cairo_rectangle_int_t) { 0, 0, self->width, self->height });
+      update_region = mks_damage_to_region (&self->damage);
+      mks_damage_clear (&self->damage);
+    }
+  self->invalidate_queued = FALSE;
+  g_mutex_unlock (&self->mutex);
+
+  if (self->tile_hash != NULL && update_region != NULL)
+    {
+      cairo_region_t *changed;
+
+      changed = mks_tile_hash_filter (self->tile_hash,
+                                      cairo_image_surface_get_data (self->surface),
+                                      self->stride,
+                                      self->width,
+                                      self->height,
+                                      self->bpp,
+                                      update_region);
+      g_clear_pointer (&update_region, cairo_region_destroy);
+
+      if (cairo_region_is_empty (changed))
+        cairo_region_destroy (changed);
+      else
+        update_region = changed;
+    }
+
+  if (self->tiles[0].texture == NULL || update_region != NULL)
+    {
+      MKS_TRACE_SCOPE ("framebuffer.rebuild", "width=%u height=%u tiles=%u",
+                       self->width, self->height, self->n_tiles);
+
+      for (guint i = 0; i < self->n_tiles; i++)
+        mks_cairo_framebuffer_rebuild_tile (self, &self->tiles[i], update_region);
+    }
+
+  g_clear_pointer (&update_region, cairo_region_destroy);
 
   bounds = GRAPHENE_RECT_INIT (0, 0, width, height);
   bounds.origin.x = floor ((bounds.origin.x + surface_x) * scale) / scale - surface_x;
@@ -155,10 +479,25 @@ mks_cairo_framebuffer_snapshot_internal (MksCairoFramebuffer *self,
   bounds.size.width = ceil ((width + surface_x) * scale) / scale - surface_x - bounds.origin.x;
   bounds.size.height = ceil ((height + surface_y) * scale) / scale - surface_y - bounds.origin.y;
 
-  gtk_snapshot_append_scaled_texture (snapshot,
-                                      self->texture,
-                                      GSK_SCALING_FILTER_NEAREST,
-                                      &bounds);
+  x_scale = bounds.size.width / self->width;
+  y_scale = bounds.size.height / self->height;
+
+  for (guint i = 0; i < self->n_tiles; i++)
+    {
+      const MksFramebufferTile *tile = &self->tiles[i];
+      double x0 = bounds.origin.x + tile->area.x * x_scale;
+      double y0 = bounds.origin.y + tile->area.y * y_scale;
+      double x1 = bounds.origin.x + (tile->area.x + tile->area.width) * x_scale;
+      double y1 = bounds.origin.y + (tile->area.y + tile->area.height) * y_scale;
+
+      /* Edges are computed the same way for neighboring tiles so that
+       * no seam opens up between them when scaled.
+       */
+      gtk_snapshot_append_scaled_texture (snapshot,
+                                          tile->texture,
+                                          GSK_SCALING_FILTER_NEAREST,
+                                          &GRAPHENE_RECT_INIT (x0, y0, x1 - x0, y1 - y0));
+    }
 }
 
 static void
@@ -223,30 +562,34 @@ mks_cairo_framebuffer_constructed (GObject *object)
       return;
     }
 
-  self->real_width = self->width;
-  self->real_height = self->height;
+  /* Grow into the spare capacity of @source when possible so that
+   * neither an allocation nor a copy is necessary.
+   */
+  if (self->source != NULL &&
+      self->source->surface != NULL &&
+      self->source->format == self->format &&
+      self->width <= self->source->real_width &&
+      self->height <= self->source->real_height)
+    mks_cairo_framebuffer_share_source (self);
+  else
+    mks_cairo_framebuffer_allocate (self);
 
-  self->surface = cairo_image_surface_create (self->format, self->real_width, self->real_height);
+  g_clear_object (&self->source);
 
-  if (self->surface == NULL)
+  if (cairo_surface_status (self->surface) != CAIRO_STATUS_SUCCESS)
     {
       g_warning ("Cairo surface creation failed: format=0x%x width=%u height=%u",
                  self->format, self->real_width, self->real_height);
       return;
     }
 
-  self->stride = cairo_format_stride_for_width (self->format, self->real_width);
-  self->bpp = self->stride / self->real_width;
-
   /* Currently only 4bbp are supported */
   g_assert (self->bpp == 4);
 
-  self->content = g_bytes_new_with_free_func (cairo_image_surface_get_data (self->surface),
-                                              self->stride * self->real_height,
-                                              (GDestroyNotify) cairo_surface_destroy,
-                                              cairo_surface_reference (self->surface));
+  mks_cairo_framebuffer_init_tiles (self);
 
-  self->texture = NULL;
+  if (mks_get_debug_flags () & MKS_DEBUG_TILE_HASH)
+    self->tile_hash = mks_tile_hash_new ();
 }
 
 static void
@@ -254,14 +597,31 @@ mks_cairo_framebuffer_dispose (GObject *object)
 {
   MksCairoFramebuffer *self = (MksCairoFramebuffer *)object;
 
-  g_clear_pointer (&self->content, g_bytes_unref);
+  /* Drop @content last so a pooled surface has no other users when it
+   * is returned to the pool.
+   */
+  g_clear_object (&self->source);
+  mks_cairo_framebuffer_clear_tiles (self);
   g_clear_pointer (&self->surface, cairo_surface_destroy);
-  g_clear_object (&self->texture);
-  g_clear_pointer (&self->update_region, cairo_region_destroy);
+  g_clear_pointer (&self->content, g_bytes_unref);
+  mks_damage_clear (&self->damage);
 
   G_OBJECT_CLASS (mks_cairo_framebuffer_parent_class)->dispose (object);
 }
 
+static void
+mks_cairo_framebuffer_finalize (GObject *object)
+{
+  MksCairoFramebuffer *self = (MksCairoFramebuffer *)object;
+
+  g_clear_pointer (&self->main_context, g_main_context_unref);
+  g_clear_pointer (&self->tile_hash, mks_tile_hash_free);
+  g_clear_pointer (&self->pool, mks_surface_pool_unref);
+  g_mutex_clear (&self->mutex);
+
+  G_OBJECT_CLASS (mks_cairo_framebuffer_parent_class)->finalize (object);
+}
+
 static void
 mks_cairo_framebuffer_get_property (GObject    *object,
                                     guint       prop_id,
@@ -307,6 +667,15 @@ mks_cairo_framebuffer_set_property (GObject      *object,
       self->height = g_value_get_uint (value);
       break;
 
+    case PROP_POOL:
+      if (g_value_get_pointer (value) != NULL)
+        self->pool = mks_surface_pool_ref (g_value_get_pointer (value));
+      break;
+
+    case PROP_SOURCE:
+      self->source = g_value_dup_object (value);
+      break;
+
     case PROP_WIDTH:
       self->width = g_value_get_uint (value);
       break;
@@ -323,6 +692,7 @@ mks_cairo_framebuffer_class_init (MksCairoFramebufferClass *klass)
 
   object_class->constructed = mks_cairo_framebuffer_constructed;
   object_class->dispose = mks_cairo_framebuffer_dispose;
+  object_class->finalize = mks_cairo_framebuffer_finalize;
   object_class->get_property = mks_cairo_framebuffer_get_property;
   object_class->set_property = mks_cairo_framebuffer_set_property;
 
@@ -336,6 +706,15 @@ mks_cairo_framebuffer_class_init (MksCairoFramebufferClass *klass)
                        0, G_MAXUINT, 0,
                        (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
 
+  properties[PROP_POOL] =
+    g_param_spec_pointer ("pool", NULL, NULL,
+                          (G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
+  properties[PROP_SOURCE] =
+    g_param_spec_object ("source", NULL, NULL,
+                         MKS_TYPE_CAIRO_FRAMEBUFFER,
+                         (G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
   properties[PROP_WIDTH] =
     g_param_spec_uint ("width", NULL, NULL,
                        0, G_MAXUINT, 0,
@@ -348,6 +727,9 @@ static void
 mks_cairo_framebuffer_init (MksCairoFramebuffer *self)
 {
   self->format = CAIRO_FORMAT_RGB24;
+  self->main_context = g_main_context_ref (g_main_context_default ());
+  mks_damage_init (&self->damage);
+  g_mutex_init (&self->mutex);
 }
 
 MksCairoFramebuffer *
@@ -365,14 +747,123 @@ mks_cairo_framebuffer_new (cairo_format_t format,
                        NULL);
 }
 
+/**
+ * mks_cairo_framebuffer_new_for_pool:
+ * @pool: a #MksSurfacePool
+ *
+ * Like mks_cairo_framebuffer_new() but the surface is taken from @pool
+ * and returned to it once the framebuffer and its textures are released.
+ */
+MksCairoFramebuffer *
+mks_cairo_framebuffer_new_for_pool (MksSurfacePool *pool,
+                                    cairo_format_t  format,
+                                    guint           width,
+                                    guint           height)
+{
+  g_return_val_if_fail (pool != NULL, NULL);
+  g_return_val_if_fail (width > 0, NULL);
+  g_return_val_if_fail (height > 0, NULL);
+
+  return g_object_new (MKS_TYPE_CAIRO_FRAMEBUFFER,
+                       "format", format,
+                       "height", height,
+                       "pool", pool,
+                       "width", width,
+                       NULL);
+}
+
+/**
+ * mks_cairo_framebuffer_new_resized:
+ * @self: a #MksCairoFramebuffer
+ *
+ * Creates a new framebuffer of @width and @height with the contents
+ * of @self.
+ *
+ * If @self has spare capacity the new framebuffer shares its surface.
+ * Otherwise a larger surface is allocated with room to grow further.
+ */
+MksCairoFramebuffer *
+mks_cairo_framebuffer_new_resized (MksCairoFramebuffer *self,
+                                   guint                width,
+                                   guint                height)
+{
+  g_return_val_if_fail (MKS_IS_CAIRO_FRAMEBUFFER (self), NULL);
+  g_return_val_if_fail (width > 0, NULL);
+  g_return_val_if_fail (height > 0, NULL);
+
+  return g_object_new (MKS_TYPE_CAIRO_FRAMEBUFFER,
+                       "format", self->format,
+                       "height", height,
+                       "pool", self->pool,
+                       "source", self,
+                       "width", width,
+                       NULL);
+}
+
+static gboolean
+mks_cairo_framebuffer_invalidate_cb (gpointer data)
+{
+  MksCairoFramebuffer *self = data;
+
+  g_assert (MKS_IS_CAIRO_FRAMEBUFFER (self));
+
+  gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+mks_cairo_framebuffer_queue_invalidate (MksCairoFramebuffer *self)
+{
+  gboolean needs_invalidate;
+
+  g_assert (MKS_IS_CAIRO_FRAMEBUFFER (self));
+
+  g_mutex_lock (&self->mutex);
+  needs_invalidate = !self->invalidate_queued;
+  self->invalidate_queued = TRUE;
+  g_mutex_unlock (&self->mutex);
+
+  if (!needs_invalidate)
+    return;
+
+  if (g_main_context_is_owner (self->main_context))
+    gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
+  else
+    g_main_context_invoke_full (self->main_context,
+                                G_PRIORITY_DEFAULT,
+                                mks_cairo_framebuffer_invalidate_cb,
+                                g_object_ref (self),
+                                g_object_unref);
+}
+
+static void
+mks_cairo_framebuffer_add_damage (MksCairoFramebuffer         *self,
+                                  const cairo_rectangle_int_t *area)
+{
+  g_assert (MKS_IS_CAIRO_FRAMEBUFFER (self));
+  g_assert (area != NULL);
+
+  g_mutex_lock (&self->mutex);
+  mks_damage_add (&self->damage, area);
+  g_mutex_unlock (&self->mutex);
+}
+
 static void
 flush_and_invalidate_on_destroy (gpointer data)
 {
-  g_autoptr(MksCairoFramebuffer) self = data;
+  MksCairoFramebufferUpdate *update = data;
+  g_autoptr(MksCairoFramebuffer) self = update->self;
 
+  /* Damage is only recorded once drawing completes so that a snapshot
+   * from the main thread cannot consume it while the display worker is
+   * still painting.
+   */
   cairo_surface_flush (self->surface);
-  mks_cairo_framebuffer_rebuild_texture (self);
-  gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
+  mks_cairo_framebuffer_add_damage (self, &update->area);
+  mks_cairo_framebuffer_queue_invalidate (self);
+
+  g_free (update);
 }
 
 cairo_t *
@@ -382,18 +873,15 @@ mks_cairo_framebuffer_update (MksCairoFramebuffer *self,
                               guint                width,
                               guint                height)
 {
+  MksCairoFramebufferUpdate *update;
   cairo_t *cr;
-  cairo_rectangle_int_t update_area;
 
   g_return_val_if_fail (MKS_IS_CAIRO_FRAMEBUFFER (self), NULL);
   g_return_val_if_fail (self->surface != NULL, NULL);
 
-  update_area = (cairo_rectangle_int_t) { x, y, width, height };
-
-  if (self->update_region == NULL)
-    self->update_region = cairo_region_create_rectangle (&update_area);
-  else
-    cairo_region_union_rectangle (self->update_region, &update_area);
+  update = g_new0 (MksCairoFramebufferUpdate, 1);
+  update->self = g_object_ref (self);
+  update->area = (cairo_rectangle_int_t) { x, y, width, height };
 
   cr = cairo_create (self->surface);
   cairo_translate (cr, x, y);
@@ -402,12 +890,90 @@ mks_cairo_framebuffer_update (MksCairoFramebuffer *self,
 
   cairo_set_user_data (cr,
                        &invalidate_key,
-                       g_object_ref (self),
+                       update,
                        flush_and_invalidate_on_destroy);
 
   return cr;
 }
 
+/**
+ * mks_cairo_framebuffer_blit:
+ * @self: a #MksCairoFramebuffer
+ * @pixman_format: the pixman format of @data
+ * @data: the source pixels
+ * @stride: the stride of @data
+ *
+ * Copies pixels from @data into the framebuffer at @x,@y.
+ *
+ * Formats supported by mks_pixels_convert_rows() are copied or converted
+ * directly into the surface data, touching only the updated area.
+ * Otherwise cairo is used to composite the pixels.
+ */
+void
+mks_cairo_framebuffer_blit (MksCairoFramebuffer *self,
+                            guint                x,
+                            guint                y,
+                            guint                width,
+                            guint                height,
+                            guint                pixman_format,
+                            const guint8        *data,
+                            guint                stride)
+{
+  cairo_rectangle_int_t update_area;
+  cairo_format_t format;
+  guint8 *dst;
+
+  g_return_if_fail (MKS_IS_CAIRO_FRAMEBUFFER (self));
+  g_return_if_fail (self->surface != NULL);
+  g_return_if_fail (data != NULL);
+  g_return_if_fail (x + width <= self->real_width);
+  g_return_if_fail (y + height <= self->real_height);
+
+  if (width == 0 || height == 0)
+    return;
+
+  /* Alpha is not meaningful in an RGB24 framebuffer, let cairo drop it */
+  if (!mks_pixels_can_convert (pixman_format) ||
+      (self->format == CAIRO_FORMAT_RGB24 && PIXMAN_FORMAT_A (pixman_format) != 0))
+    {
+      cairo_surface_t *source;
+      cairo_t *cr;
+
+      format = mks_pixman_format_to_cairo_format (pixman_format);
+
+      if (format == CAIRO_FORMAT_INVALID)
+        {
+          g_warning ("Unsupported pixman format 0x%x", pixman_format);
+          return;
+        }
+
+      source = cairo_image_surface_create_for_data ((guint8 *)data, format, width, height, stride);
+      cr = mks_cairo_framebuffer_update (self, x, y, width, height);
+      cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+      cairo_set_source_surface (cr, source, 0, 0);
+      cairo_rectangle (cr, 0, 0, width, height);
+      cairo_paint (cr);
+      cairo_destroy (cr);
+      cairo_surface_destroy (source);
+
+      return;
+    }
+
+  cairo_surface_flush (self->surface);
+
+  dst = cairo_image_surface_get_data (self->surface)
+      + ((gsize)y * self->stride)
+      + ((gsize)x * self->bpp);
+
+  mks_pixels_convert_rows (pixman_format, dst, self->stride, data, stride, width, height);
+
+  cairo_surface_mark_dirty_rectangle (self->surface, x, y, width, height);
+
+  update_area = (cairo_rectangle_int_t) { x, y, width, height };
+  mks_cairo_framebuffer_add_damage (self, &update_area);
+  mks_cairo_framebuffer_queue_invalidate (self);
+}
+
 void
 mks_cairo_framebuffer_clear (MksCairoFramebuffer *self)
 {
@@ -428,12 +994,8 @@ mks_cairo_framebuffer_clear (MksCairoFramebuffer *self)
   cairo_surface_flush (self->surface);
 
   update_area = (cairo_rectangle_int_t) { 0, 0, self->width, self->height };
-  if (self->update_region == NULL)
-    self->update_region = cairo_region_create_rectangle (&update_area);
-  else
-    cairo_region_union_rectangle (self->update_region, &update_area);
-
-  mks_cairo_framebuffer_rebuild_texture (self);
+  mks_cairo_framebuffer_add_damage (self, &update_area);
+  mks_cairo_framebuffer_queue_invalidate (self);
 }
 
 void
@@ -466,6 +1028,46 @@ mks_cairo_framebuffer_get_format (MksCairoFramebuffer *self)
   return self->format;
 }
 
+/**
+ * mks_cairo_framebuffer_publish:
+ * @self: a #MksCairoFramebuffer
+ * @publisher: a #MksShmPublisher
+ * @area: (nullable): the area to publish, or %NULL for everything
+ *
+ * Copies @area of the framebuffer to the readers of @publisher.
+ */
+void
+mks_cairo_framebuffer_publish (MksCairoFramebuffer         *self,
+                               MksShmPublisher             *publisher,
+                               const cairo_rectangle_int_t *area)
+{
+  guint pixman_format;
+
+  g_return_if_fail (MKS_IS_CAIRO_FRAMEBUFFER (self));
+  g_return_if_fail (publisher != NULL);
+
+  if (self->surface == NULL)
+    return;
+
+  /* Cairo image formats use native endian like pixman */
+  if (self->format == CAIRO_FORMAT_ARGB32)
+    pixman_format = PIXMAN_a8r8g8b8;
+  else if (self->format == CAIRO_FORMAT_RGB24)
+    pixman_format = PIXMAN_x8r8g8b8;
+  else
+    return;
+
+  cairo_surface_flush (self->surface);
+
+  mks_shm_publisher_publish (publisher,
+                             cairo_image_surface_get_data (self->surface),
+                             self->stride,
+                             self->width,
+                             self->height,
+                             pixman_format,
+                             area);
+}
+
 guint
 mks_cairo_framebuffer_get_height (MksCairoFramebuffer *self)
 {
@@ -0,0 +1,53 @@
+/* mks-cpu-listener-private.h
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+#pragma once
+
+#include <gio/gio.h>
+
+#include "mks-dmabuf-map-private.h"
+
+G_BEGIN_DECLS
+
+#define MKS_TYPE_CPU_LISTENER (mks_cpu_listener_get_type())
+
+typedef enum _MksCpuListenerSource
+{
+  MKS_CPU_LISTENER_SOURCE_NONE,
+  MKS_CPU_LISTENER_SOURCE_PAYLOAD,
+  MKS_CPU_LISTENER_SOURCE_MAP,
+  MKS_CPU_LISTENER_SOURCE_DMABUF,
+} MksCpuListenerSource;
+
+G_DECLARE_FINAL_TYPE (MksCpuListener, mks_cpu_listener, MKS, CPU_LISTENER, GObject)
+
+MksCpuListener         *mks_cpu_listener_new         (int             *peer_fd,
+                                                      GError         **error);
+MksCpuListenerSource    mks_cpu_listener_get_source  (MksCpuListener  *self);
+guint                   mks_cpu_listener_get_width   (MksCpuListener  *self);
+guint                   mks_cpu_listener_get_height  (MksCpuListener  *self);
+const guint8           *mks_cpu_listener_get_payload (MksCpuListener  *self,
+                                                      guint           *stride,
+                                                      guint           *pixman_format);
+const guint8           *mks_cpu_listener_get_map     (MksCpuListener  *self,
+                                                      guint           *stride,
+                                                      guint           *pixman_format);
+const MksDmabufScanout *mks_cpu_listener_get_dmabuf  (MksCpuListener  *self);
+
+G_END_DECLS
@@ -0,0 +1,861 @@
+/* mks-cpu-listener.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+#include "config.h"
+
+#include <glib/gstdio.h>
+#include <gio/gunixfdlist.h>
+#include <pixman.h>
+
+#include "mks-cpu-listener-private.h"
+#include "mks-map-cache-private.h"
+#include "mks-pixels-private.h"
+#include "mks-qemu.h"
+#include "mks-util-private.h"
+
+#include "mks-marshal.h"
+
+/* A listener for consumers which read the screen contents with the CPU,
+ * such as thumbnails and captures. Scanouts are validated and kept as
+ * the current source, which consumers read from when notified through
+ * the "scanout" and "update" signals. Payloads of Scanout and Update are
+ * only available while those signals are emitted.
+ */
+struct _MksCpuListener
+{
+  GObject                            parent_instance;
+
+  GDBusConnection                   *connection;
+  MksQemuListener                   *listener;
+  MksQemuListenerUnixScanoutDMABUF2 *listener_dmabuf2;
+  MksQemuListenerUnixMap            *listener_map;
+  MksMapCache                       *map_cache;
+
+  guint                              width;
+  guint                              height;
+
+  /* MKS_CPU_LISTENER_SOURCE_PAYLOAD, while emitting */
+  const guint8                      *payload;
+  guint                              payload_stride;
+  guint                              payload_format;
+
+  /* MKS_CPU_LISTENER_SOURCE_MAP */
+  GBytes                            *map;
+  guint                              map_stride;
+  guint                              map_format;
+
+  /* MKS_CPU_LISTENER_SOURCE_DMABUF */
+  MksDmabufScanout                   dmabuf;
+
+  MksCpuListenerSource               source : 2;
+};
+
+enum {
+  SCANOUT,
+  UPDATE,
+  DISABLE,
+  N_SIGNALS
+};
+
+static guint signals [N_SIGNALS];
+
+G_DEFINE_FINAL_TYPE (MksCpuListener, mks_cpu_listener, G_TYPE_OBJECT)
+
+static void
+mks_cpu_listener_clear_source (MksCpuListener *self)
+{
+  g_assert (MKS_IS_CPU_LISTENER (self));
+
+  g_clear_pointer (&self->map, g_bytes_unref);
+  mks_dmabuf_scanout_clear (&self->dmabuf);
+
+  self->source = MKS_CPU_LISTENER_SOURCE_NONE;
+  self->width = 0;
+  self->height = 0;
+}
+
+/* Damage from QEMU is not trusted to stay within the screen */
+static void
+mks_cpu_listener_emit_damage (MksCpuListener *self,
+                              int             x,
+                              int             y,
+                              int             width,
+                              int             height)
+{
+  gint64 x1, y1, x2, y2;
+
+  g_assert (MKS_IS_CPU_LISTENER (self));
+
+  x1 = MAX (0, x);
+  y1 = MAX (0, y);
+  x2 = MIN ((gint64)self->width, (gint64)x + width);
+  y2 = MIN ((gint64)self->height, (gint64)y + height);
+
+  if (x2 > x1 && y2 > y1)
+    g_signal_emit (self, signals [UPDATE], 0, (int)x1, (int)y1, (int)(x2 - x1), (int)(y2 - y1));
+}
+
+static gboolean
+mks_cpu_listener_listener_scanout (MksCpuListener        *self,
+                                   GDBusMethodInvocation *invocation,
+                                   guint                  width,
+                                   guint                  height,
+                                   guint                  stride,
+                                   guint                  pixman_format,
+                                   GVariant              *bytestring,
+                                   MksQemuListener       *listener)
+{
+  const guint8 *data;
+  gsize data_len;
+
+  g_assert (MKS_IS_CPU_LISTENER (self));
+  g_assert (G_IS_DBUS_METHOD_INVOCATION (invocation));
+  g_assert (MKS_QEMU_IS_LISTENER (listener));
+
+  data = g_variant_get_fixed_array (bytestring, &data_len, 1);
+
+  if (!mks_pixels_can_convert (pixman_format) ||
+      width == 0 || height == 0 ||
+      stride < (gsize)width * PIXMAN_FORMAT_BPP (pixman_format) / 8 ||
+      data_len < (gsize)stride * height)
+    {
+      g_dbus_method_invocation_return_error_literal (invocation,
+                                                     G_IO_ERROR,
+                                                     G_IO_ERROR_INVALID_ARGUMENT,
+                                                     "Invalid scanout");
+      return TRUE;
+    }
+
+  mks_cpu_listener_clear_source (self);
+
+  self->source = MKS_CPU_LISTENER_SOURCE_PAYLOAD;
+  self->width = width;
+  self->height = height;
+
+  self->payload = data;
+  self->payload_stride = stride;
+  self->payload_format = pixman_format;
+  g_signal_emit (self, signals [SCANOUT], 0);
+  self->payload = NULL;
+
+  mks_qemu_listener_complete_scanout (listener, invocation);
+
+  return TRUE;
+}
+
+static gboolean
+mks_cpu_listener_listener_update (MksCpuListener        *self,
+                                  GDBusMethodInvocation *invocation,
+                                  int                    x,
+                                  int                    y,
+                                  int                    width,
+                                  int                    height,
+                                  guint                  stride,
+                                  guint                  pixman_format,
+                                  GVariant              *bytestring,
+                                  MksQemuListener       *listener)
+{
+  const guint8 *data;
+  gsize data_len;
+
+  g_assert (MKS_IS_CPU_LISTENER (self));
+  g_assert (G_IS_DBUS_METHOD_INVOCATION (invocation));
+  g_assert (MKS_QEMU_IS_LISTENER (listener));
+
+  if (self->source != MKS_CPU_LISTENER_SOURCE_PAYLOAD)
+    {
+      mks_qemu_listener_complete_update (listener, invocation);
+      return TRUE;
+    }
+
+  data = g_variant_get_fixed_array (bytestring, &data_len, 1);
+
+  if (!mks_pixels_can_convert (pixman_format) ||
+      x < 0 || y < 0 || width <= 0 || height <= 0 ||
+      (guint)(x + width) > self->width ||
+      (guint)(y + height) > self->height ||
+      stride < (gsize)width * PIXMAN_FORMAT_BPP (pixman_format) / 8 ||
+      data_len < (gsize)stride * (height - 1) + (gsize)width * PIXMAN_FORMAT_BPP (pixman_format) / 8)
+    {
+      g_dbus_method_invocation_return_error_literal (invocation,
+                                                     G_IO_ERROR,
+                                                     G_IO_ERROR_INVALID_ARGUMENT,
+                                                     "Invalid update");
+      return TRUE;
+    }
+
+  self->payload = data;
+  self->payload_stride = stride;
+  self->payload_format = pixman_format;
+  g_signal_emit (self, signals [UPDATE], 0, x, y, width, height);
+  self->payload = NULL;
+
+  mks_qemu_listener_complete_update (listener, invocation);
+
+  return TRUE;
+}
+
+static gboolean
+mks_cpu_listener_listener_scanout_map (MksCpuListener         *self,
+                                       GDBusMethodInvocation  *invocation,
+                                       GUnixFDList            *unix_fd_list,
+                                       GVariant               *handle,
+                                       guint                   offset,
+                                       guint                   width,
+                                       guint                   height,
+                                       guint                   stride,
+                                       guint                   pixman_format,
+                                       MksQemuListenerUnixMap *listener)
+{
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  int map_fd = -1;
+  guint fd_index;
+
+  g_assert (MKS_IS_CPU_LISTENER (self));
+  g_assert (G_IS_DBUS_METHOD_INVOCATION (invocation));
+  g_assert (MKS_QEMU_IS_LISTENER_UNIX_MAP (listener));
+  g_assert (g_variant_is_of_type (handle, G_VARIANT_TYPE_HANDLE));
+
+  fd_index = g_variant_get_handle (handle);
+
+  if (unix_fd_list == NULL ||
+      fd_index >= g_unix_fd_list_get_length (unix_fd_list) ||
+      !mks_pixels_can_convert (pixman_format) ||
+      width == 0 || height == 0 ||
+      stride < (gsize)width * PIXMAN_FORMAT_BPP (pixman_format) / 8)
+    {
+      g_dbus_method_invocation_return_error_literal (invocation,
+                                                     G_IO_ERROR,
+                                                     G_IO_ERROR_INVALID_ARGUMENT,
+                                                     "Invalid shared map");
+      return TRUE;
+    }
+
+  if (-1 == (map_fd = g_unix_fd_list_get (unix_fd_list, fd_index, &error)))
+    {
+      g_dbus_method_invocation_return_gerror (invocation, error);
+      return TRUE;
+    }
+
+  bytes = mks_map_cache_lookup (self->map_cache,
+                                map_fd,
+                                offset,
+                                (gsize)stride * height,
+                                &error);
+  g_clear_fd (&map_fd, NULL);
+
+  if (bytes == NULL)
+    {
+      g_dbus_method_invocation_return_gerror (invocation, error);
+      return TRUE;
+    }
+
+  mks_cpu_listener_clear_source (self);
+
+  self->source = MKS_CPU_LISTENER_SOURCE_MAP;
+  self->width = width;
+  self->height = height;
+  self->map = g_steal_pointer (&bytes);
+  self->map_stride = stride;
+  self->map_format = pixman_format;
+
+  g_signal_emit (self, signals [SCANOUT], 0);
+
+  mks_qemu_listener_unix_map_complete_scanout_map (listener, invocation, NULL);
+
+  return TRUE;
+}
+
+static gboolean
+mks_cpu_listener_listener_update_map (MksCpuListener         *self,
+                                      GDBusMethodInvocation  *invocation,
+                                      int                     x,
+                                      int                     y,
+                                      int                     width,
+                                      int                     height,
+                                      MksQemuListenerUnixMap *listener)
+{
+  g_assert (MKS_IS_CPU_LISTENER (self));
+  g_assert (G_IS_DBUS_METHOD_INVOCATION (invocation));
+  g_assert (MKS_QEMU_IS_LISTENER_UNIX_MAP (listener));
+
+  if (self->source == MKS_CPU_LISTENER_SOURCE_MAP)
+    mks_cpu_listener_emit_damage (self, x, y, width, height);
+
+  mks_qemu_listener_unix_map_complete_update_map (listener, invocation);
+
+  return TRUE;
+}
+
+/* Takes ownership of the file-descriptors of @dmabuf */
+static void
+mks_cpu_listener_set_dmabuf (MksCpuListener         *self,
+                             const MksDmabufScanout *dmabuf)
+{
+  g_assert (MKS_IS_CPU_LISTENER (self));
+  g_assert (dmabuf->n_planes > 0);
+  g_assert (dmabuf->width > 0 && dmabuf->height > 0);
+
+  mks_cpu_listener_clear_source (self);
+
+  self->source = MKS_CPU_LISTENER_SOURCE_DMABUF;
+  self->width = dmabuf->width;
+  self->height = dmabuf->height;
+  self->dmabuf = *dmabuf;
+
+  g_signal_emit (self, signals [SCANOUT], 0);
+}
+
+static gboolean
+mks_cpu_listener_listener_scanout_dmabuf (MksCpuListener        *self,
+                                          GDBusMethodInvocation *invocation,
+                                          GUnixFDList           *unix_fd_list,
+                                          GVariant              *dmabuf,
+                                          guint                  width,
+                                          guint                  height,
+                                          guint                  stride,
+                                          guint                  fourcc,
+                                          guint64                modifier,
+                                          gboolean               y0_top,
+                                          MksQemuListener       *listener)
+{
+  g_autoptr(GError) error = NULL;
+  int dmabuf_fd = -1;
+  guint handle;
+
+  g_assert (MKS_IS_CPU_LISTENER (self));
+  g_assert (G_IS_DBUS_METHOD_INVOCATION (invocation));
+  g_assert (MKS_QEMU_IS_LISTENER (listener));
+  g_assert (g_variant_is_of_type (dmabuf, G_VARIANT_TYPE_HANDLE));
+
+  handle = g_variant_get_handle (dmabuf);
+
+  if (unix_fd_list == NULL ||
+      handle >= g_unix_fd_list_get_length (unix_fd_list) ||
+      width == 0 || height == 0)
+    {
+      g_dbus_method_invocation_return_error_literal (invocation,
+                                                     G_IO_ERROR,
+                                                     G_IO_ERROR_INVALID_ARGUMENT,
+                                                     "Invalid handle to DMA-BUF");
+      return TRUE;
+    }
+
+  if (-1 == (dmabuf_fd = g_unix_fd_list_get (unix_fd_list, handle, &error)))
+    {
+      g_dbus_method_invocation_return_gerror (invocation, error);
+      return TRUE;
+    }
+
+  mks_cpu_listener_set_dmabuf (self,
+                               &(MksDmabufScanout) {
+                                 .fd = { dmabuf_fd },
+                                 .stride = { stride },
+                                 .n_planes = 1,
+                                 .width = width,
+                                 .height = height,
+                                 .fourcc = fourcc,
+                                 .backing_height = height,
+                                 .modifier = modifier,
+                                 .y0_top = !!y0_top,
+                               });
+
+  mks_qemu_listener_complete_scanout_dmabuf (listener, invocation, NULL);
+
+  return TRUE;
+}
+
+static gboolean
+mks_cpu_listener_listener_scanout_dmabuf2 (MksCpuListener                    *self,
+                                           GDBusMethodInvocation             *invocation,
+                                           GUnixFDList                       *unix_fd_list,
+                                           GVariant                          *dmabuf,
+                                           guint                              x,
+                                           guint                              y,
+                                           guint                              width,
+                                           guint                              height,
+                                           GVariant                          *offset,
+                                           GVariant                          *stride,
+                                           guint                              num_planes,
+                                           guint                              fourcc,
+                                           guint                              backing_width,
+                                           guint                              backing_height,
+                                           guint64                            modifier,
+                                           gboolean                           y0_top,
+                                           MksQemuListenerUnixScanoutDMABUF2 *listener)
+{
+  MksDmabufScanout scanout;
+  const guint *offsets;
+  const guint *strides;
+  gsize n_offsets;
+  gsize n_strides;
+  gsize n_handles;
+
+  g_assert (MKS_IS_CPU_LISTENER (self));
+  g_assert (G_IS_DBUS_METHOD_INVOCATION (invocation));
+  g_assert (MKS_QEMU_IS_LISTENER_UNIX_SCANOUT_DMABUF2 (listener));
+  g_assert (g_variant_is_of_type (dmabuf, G_VARIANT_TYPE ("ah")));
+  g_assert (g_variant_is_of_type (offset, G_VARIANT_TYPE ("au")));
+  g_assert (g_variant_is_of_type (stride, G_VARIANT_TYPE ("au")));
+
+  n_handles = g_variant_n_children (dmabuf);
+  offsets = g_variant_get_fixed_array (offset, &n_offsets, sizeof *offsets);
+  strides = g_variant_get_fixed_array (stride, &n_strides, sizeof *strides);
+
+  /* No format the CPU can read has more planes than YUV420 */
+  if (unix_fd_list == NULL ||
+      num_planes == 0 ||
+      num_planes > MKS_DMABUF_MAP_MAX_PLANES ||
+      width == 0 || height == 0 ||
+      n_handles < num_planes ||
+      n_offsets < num_planes ||
+      n_strides < num_planes)
+    {
+      g_dbus_method_invocation_return_error_literal (invocation,
+                                                     G_IO_ERROR,
+                                                     G_IO_ERROR_INVALID_ARGUMENT,
+                                                     "Invalid DMA-BUF plane data");
+      return TRUE;
+    }
+
+  scanout = (MksDmabufScanout) {
+    .x = x,
+    .y = y,
+    .width = width,
+    .height = height,
+    .fourcc = fourcc,
+    .backing_height = backing_height,
+    .modifier = modifier,
+    .y0_top = !!y0_top,
+  };
+
+  for (guint i = 0; i < num_planes; i++)
+    {
+      g_autoptr(GVariant) handle_variant = NULL;
+      g_autoptr(GError) error = NULL;
+      guint handle;
+
+      handle_variant = g_variant_get_child_value (dmabuf, i);
+      handle = g_variant_get_handle (handle_variant);
+
+      if (handle >= g_unix_fd_list_get_length (unix_fd_list) ||
+          -1 == (scanout.fd[i] = g_unix_fd_list_get (unix_fd_list, handle, &error)))
+        {
+          mks_dmabuf_scanout_clear (&scanout);
+          g_dbus_method_invocation_return_error (invocation,
+                                                 G_IO_ERROR,
+                                                 G_IO_ERROR_INVALID_ARGUMENT,
+                                                 "Invalid handle to DMA-BUF plane %u",
+                                                 i);
+          return TRUE;
+        }
+
+      scanout.offset[i] = offsets[i];
+      scanout.stride[i] = strides[i];
+      scanout.n_planes = i + 1;
+    }
+
+  mks_cpu_listener_set_dmabuf (self, &scanout);
+
+  mks_qemu_listener_unix_scanout_dmabuf2_complete_scanout_dmabuf2 (listener, invocation, NULL);
+
+  return TRUE;
+}
+
+static gboolean
+mks_cpu_listener_listener_update_dmabuf (MksCpuListener        *self,
+                                         GDBusMethodInvocation *invocation,
+                                         int                    x,
+                                         int                    y,
+                                         int                    width,
+                                         int                    height,
+                                         MksQemuListener       *listener)
+{
+  g_assert (MKS_IS_CPU_LISTENER (self));
+  g_assert (G_IS_DBUS_METHOD_INVOCATION (invocation));
+  g_assert (MKS_QEMU_IS_LISTENER (listener));
+
+  if (self->source == MKS_CPU_LISTENER_SOURCE_DMABUF)
+    mks_cpu_listener_emit_damage (self, x, y, width, height);
+
+  mks_qemu_listener_complete_update_dmabuf (listener, invocation);
+
+  return TRUE;
+}
+
+static gboolean
+mks_cpu_listener_listener_disable (MksCpuListener        *self,
+                                   GDBusMethodInvocation *invocation,
+                                   MksQemuListener       *listener)
+{
+  g_assert (MKS_IS_CPU_LISTENER (self));
+  g_assert (G_IS_DBUS_METHOD_INVOCATION (invocation));
+  g_assert (MKS_QEMU_IS_LISTENER (listener));
+
+  mks_cpu_listener_clear_source (self);
+  mks_map_cache_clear (self->map_cache);
+
+  g_signal_emit (self, signals [DISABLE], 0);
+
+  mks_qemu_listener_complete_disable (listener, invocation);
+
+  return TRUE;
+}
+
+static gboolean
+mks_cpu_listener_listener_cursor_define (MksCpuListener        *self,
+                                         GDBusMethodInvocation *invocation,
+                                         int                    width,
+                                         int                    height,
+                                         int                    hot_x,
+                                         int                    hot_y,
+                                         GVariant              *bytestring,
+                                         MksQemuListener       *listener)
+{
+  g_assert (MKS_IS_CPU_LISTENER (self));
+  g_assert (G_IS_DBUS_METHOD_INVOCATION (invocation));
+  g_assert (MKS_QEMU_IS_LISTENER (listener));
+
+  mks_qemu_listener_complete_cursor_define (listener, invocation);
+
+  return TRUE;
+}
+
+static gboolean
+mks_cpu_listener_listener_mouse_set (MksCpuListener        *self,
+                                     GDBusMethodInvocation *invocation,
+                                     int                    x,
+                                     int                    y,
+                                     int                    on,
+                                     MksQemuListener       *listener)
+{
+  g_assert (MKS_IS_CPU_LISTENER (self));
+  g_assert (G_IS_DBUS_METHOD_INVOCATION (invocation));
+  g_assert (MKS_QEMU_IS_LISTENER (listener));
+
+  mks_qemu_listener_complete_mouse_set (listener, invocation);
+
+  return TRUE;
+}
+
+static void
+mks_cpu_listener_dispose (GObject *object)
+{
+  MksCpuListener *self = (MksCpuListener *)object;
+
+  if (self->connection != NULL)
+    {
+      g_dbus_connection_close (self->connection, NULL, NULL, NULL);
+      g_clear_object (&self->connection);
+    }
+
+  g_clear_object (&self->listener);
+  g_clear_object (&self->listener_dmabuf2);
+  g_clear_object (&self->listener_map);
+
+  mks_cpu_listener_clear_source (self);
+
+  G_OBJECT_CLASS (mks_cpu_listener_parent_class)->dispose (object);
+}
+
+static void
+mks_cpu_listener_finalize (GObject *object)
+{
+  MksCpuListener *self = (MksCpuListener *)object;
+
+  g_clear_pointer (&self->map_cache, mks_map_cache_free);
+
+  G_OBJECT_CLASS (mks_cpu_listener_parent_class)->finalize (object);
+}
+
+static void
+mks_cpu_listener_class_init (MksCpuListenerClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = mks_cpu_listener_dispose;
+  object_class->finalize = mks_cpu_listener_finalize;
+
+  /* A new source of @width by @height replaced the previous one */
+  signals [SCANOUT] =
+    g_signal_new ("scanout",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL,
+                  NULL,
+                  G_TYPE_NONE, 0);
+
+  /* An area within the current source changed */
+  signals [UPDATE] =
+    g_signal_new ("update",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL,
+                  _mks_marshal_VOID__INT_INT_INT_INT,
+                  G_TYPE_NONE, 4, G_TYPE_INT, G_TYPE_INT, G_TYPE_INT, G_TYPE_INT);
+  g_signal_set_va_marshaller (signals [UPDATE],
+                              G_TYPE_FROM_CLASS (klass),
+                              _mks_marshal_VOID__INT_INT_INT_INTv);
+
+  /* There is no source until the next scanout */
+  signals [DISABLE] =
+    g_signal_new ("disable",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL,
+                  NULL,
+                  G_TYPE_NONE, 0);
+}
+
+static void
+mks_cpu_listener_init (MksCpuListener *self)
+{
+  self->map_cache = mks_map_cache_new ();
+}
+
+static gboolean
+mks_cpu_listener_export (MksCpuListener  *self,
+                         GError         **error)
+{
+  g_assert (MKS_IS_CPU_LISTENER (self));
+  g_assert (G_IS_DBUS_CONNECTION (self->connection));
+
+  return g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (self->listener),
+                                           self->connection,
+                                           "/org/qemu/Display1/Listener",
+                                           error) &&
+         g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (self->listener_dmabuf2),
+                                           self->connection,
+                                           "/org/qemu/Display1/Listener",
+                                           error) &&
+         g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (self->listener_map),
+                                           self->connection,
+                                           "/org/qemu/Display1/Listener",
+                                           error);
+}
+
+static DexFuture *
+mks_cpu_listener_connection_cb (DexFuture *future,
+                                gpointer   user_data)
+{
+  MksCpuListener *self = user_data;
+  g_autoptr(GError) error = NULL;
+  const GValue *value;
+
+  g_assert (MKS_IS_CPU_LISTENER (self));
+  g_assert (DEX_IS_FUTURE (future));
+
+  if (!(value = dex_future_get_value (future, &error)))
+    {
+      g_warning ("Failed to create D-Bus connection: %s", error->message);
+      return dex_future_new_true ();
+    }
+
+  g_set_object (&self->connection, g_value_get_object (value));
+
+  if (!mks_cpu_listener_export (self, &error))
+    {
+      g_warning ("Failed to export listener on bus: %s", error->message);
+      return dex_future_new_true ();
+    }
+
+  g_dbus_connection_start_message_processing (self->connection);
+
+  return dex_future_new_true ();
+}
+
+/*
+ * mks_cpu_listener_new:
+ * @peer_fd: (out): location for the peer to pass to RegisterListener
+ *
+ * Creates a listener which accepts every kind of scanout the CPU can
+ * read. Scanouts which are empty or cannot be read are rejected.
+ */
+MksCpuListener *
+mks_cpu_listener_new (int     *peer_fd,
+                      GError **error)
+{
+  g_autoptr(MksCpuListener) self = NULL;
+  g_autoptr(GSocketConnection) io_stream = NULL;
+  g_autoptr(GSocket) socket = NULL;
+  g_autofd int us = -1;
+  g_autofd int them = -1;
+  gint64 begin_time;
+
+  g_return_val_if_fail (peer_fd != NULL, NULL);
+
+  *peer_fd = -1;
+
+  self = g_object_new (MKS_TYPE_CPU_LISTENER, NULL);
+
+  if (!mks_socketpair_create (&us, &them, error))
+    return NULL;
+
+  if (!(socket = g_socket_new_from_fd (us, error)))
+    return NULL;
+  us = -1;
+
+  io_stream = g_socket_connection_factory_create_connection (socket);
+
+  self->listener = mks_qemu_listener_skeleton_new ();
+  self->listener_dmabuf2 = mks_qemu_listener_unix_scanout_dmabuf2_skeleton_new ();
+  self->listener_map = mks_qemu_listener_unix_map_skeleton_new ();
+  mks_qemu_listener_set_interfaces (self->listener,
+                                    (const char * const[]) {
+                                      "org.qemu.Display1.Listener.Unix.Map",
+                                      "org.qemu.Display1.Listener.Unix.ScanoutDMABUF2",
+                                      NULL
+                                    });
+
+  g_signal_connect_object (self->listener, "handle-scanout",
+                           G_CALLBACK (mks_cpu_listener_listener_scanout),
+                           self, G_CONNECT_SWAPPED);
+  g_signal_connect_object (self->listener, "handle-update",
+                           G_CALLBACK (mks_cpu_listener_listener_update),
+                           self, G_CONNECT_SWAPPED);
+  g_signal_connect_object (self->listener, "handle-scanout-dmabuf",
+                           G_CALLBACK (mks_cpu_listener_listener_scanout_dmabuf),
+                           self, G_CONNECT_SWAPPED);
+  g_signal_connect_object (self->listener, "handle-update-dmabuf",
+                           G_CALLBACK (mks_cpu_listener_listener_update_dmabuf),
+                           self, G_CONNECT_SWAPPED);
+  g_signal_connect_object (self->listener_dmabuf2, "handle-scanout-dmabuf2",
+                           G_CALLBACK (mks_cpu_listener_listener_scanout_dmabuf2),
+                           self, G_CONNECT_SWAPPED);
+  g_signal_connect_object (self->listener_map, "handle-scanout-map",
+                           G_CALLBACK (mks_cpu_listener_listener_scanout_map),
+                           self, G_CONNECT_SWAPPED);
+  g_signal_connect_object (self->listener_map, "handle-update-map",
+                           G_CALLBACK (mks_cpu_listener_listener_update_map),
+                           self, G_CONNECT_SWAPPED);
+  g_signal_connect_object (self->listener, "handle-disable",
+                           G_CALLBACK (mks_cpu_listener_listener_disable),
+                           self, G_CONNECT_SWAPPED);
+  g_signal_connect_object (self->listener, "handle-cursor-define",
+                           G_CALLBACK (mks_cpu_listener_listener_cursor_define),
+                           self, G_CONNECT_SWAPPED);
+  g_signal_connect_object (self->listener, "handle-mouse-set",
+                           G_CALLBACK (mks_cpu_listener_listener_mouse_set),
+                           self, G_CONNECT_SWAPPED);
+
+  begin_time = MKS_TRACE_BEGIN_MARK ();
+  dex_future_disown (dex_future_finally (mks_marked_future (mks_dbus_connection_new (G_IO_STREAM (io_stream),
+                                                                                     (G_DBUS_CONNECTION_FLAGS_DELAY_MESSAGE_PROCESSING |
+                                                                                      G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT),
+                                                                                     NULL),
+                                                                 begin_time,
+                                                                 "cpu-listener.dbus-connection"),
+                                         mks_cpu_listener_connection_cb,
+                                         g_object_ref (self),
+                                         g_object_unref));
+
+  *peer_fd = g_steal_fd (&them);
+
+  return g_steal_pointer (&self);
+}
+
+MksCpuListenerSource
+mks_cpu_listener_get_source (MksCpuListener *self)
+{
+  g_return_val_if_fail (MKS_IS_CPU_LISTENER (self), MKS_CPU_LISTENER_SOURCE_NONE);
+
+  return self->source;
+}
+
+guint
+mks_cpu_listener_get_width (MksCpuListener *self)
+{
+  g_return_val_if_fail (MKS_IS_CPU_LISTENER (self), 0);
+
+  return self->width;
+}
+
+guint
+mks_cpu_listener_get_height (MksCpuListener *self)
+{
+  g_return_val_if_fail (MKS_IS_CPU_LISTENER (self), 0);
+
+  return self->height;
+}
+
+/*
+ * mks_cpu_listener_get_payload:
+ *
+ * Gets the pixels sent with the Scanout or Update being emitted, starting
+ * at the top-left of the changed area.
+ *
+ * Returns: the pixels, or %NULL outside of emissions
+ */
+const guint8 *
+mks_cpu_listener_get_payload (MksCpuListener *self,
+                              guint          *stride,
+                              guint          *pixman_format)
+{
+  g_return_val_if_fail (MKS_IS_CPU_LISTENER (self), NULL);
+
+  if (stride != NULL)
+    *stride = self->payload_stride;
+
+  if (pixman_format != NULL)
+    *pixman_format = self->payload_format;
+
+  return self->payload;
+}
+
+/*
+ * mks_cpu_listener_get_map:
+ *
+ * Gets the shared memory of a %MKS_CPU_LISTENER_SOURCE_MAP source, which
+ * stays valid until the next scanout.
+ *
+ * Returns: the pixels of the whole screen, or %NULL
+ */
+const guint8 *
+mks_cpu_listener_get_map (MksCpuListener *self,
+                          guint          *stride,
+                          guint          *pixman_format)
+{
+  g_return_val_if_fail (MKS_IS_CPU_LISTENER (self), NULL);
+
+  if (self->source != MKS_CPU_LISTENER_SOURCE_MAP)
+    return NULL;
+
+  if (stride != NULL)
+    *stride = self->map_stride;
+
+  if (pixman_format != NULL)
+    *pixman_format = self->map_format;
+
+  return g_bytes_get_data (self->map, NULL);
+}
+
+const MksDmabufScanout *
+mks_cpu_listener_get_dmabuf (MksCpuListener *self)
+{
+  g_return_val_if_fail (MKS_IS_CPU_LISTENER (self), NULL);
+
+  if (self->source != MKS_CPU_LISTENER_SOURCE_DMABUF)
+    return NULL;
+
+  return &self->dmabuf;
+}
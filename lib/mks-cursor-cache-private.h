@@ -0,0 +1,41 @@
+/* mks-cursor-cache-private.h
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#pragma once
+
+#include <gdk/gdk.h>
+
+G_BEGIN_DECLS
+
+typedef struct _MksCursorCache MksCursorCache;
+
+MksCursorCache *mks_cursor_cache_new    (void);
+void            mks_cursor_cache_free   (MksCursorCache *self);
+void            mks_cursor_cache_clear  (MksCursorCache *self);
+GdkCursor      *mks_cursor_cache_lookup (MksCursorCache *self,
+                                         GBytes         *bytes,
+                                         int             width,
+                                         int             height,
+                                         int             hot_x,
+                                         int             hot_y);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MksCursorCache, mks_cursor_cache_free)
+
+G_END_DECLS
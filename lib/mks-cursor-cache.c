@@ -0,0 +1,203 @@
+/* mks-cursor-cache.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "config.h"
+
+#include "mks-cursor-cache-private.h"
+#include "mks-pixels-private.h"
+#include "mks-trace-private.h"
+
+/* Guests cycle through a handful of cursors (arrow, caret, resize and
+ * the frames of a busy spinner). Handing GDK the same GdkCursor again
+ * lets the compositor keep the cursor surface it already uploaded.
+ */
+#define MAX_ENTRIES 16
+
+typedef struct
+{
+  GList      link;
+  guint64    hash;
+  int        width;
+  int        height;
+  int        hot_x;
+  int        hot_y;
+  GBytes    *bytes;
+  GdkCursor *cursor;
+} MksCursorCacheEntry;
+
+struct _MksCursorCache
+{
+  GQueue  entries;
+  guint64 n_hits;
+  guint64 n_misses;
+};
+
+static void
+mks_cursor_cache_entry_free (MksCursorCacheEntry *entry)
+{
+  g_clear_pointer (&entry->bytes, g_bytes_unref);
+  g_clear_object (&entry->cursor);
+  g_free (entry);
+}
+
+MksCursorCache *
+mks_cursor_cache_new (void)
+{
+  return g_new0 (MksCursorCache, 1);
+}
+
+void
+mks_cursor_cache_clear (MksCursorCache *self)
+{
+  MksCursorCacheEntry *entry;
+
+  g_return_if_fail (self != NULL);
+
+  while ((entry = g_queue_peek_head (&self->entries)))
+    {
+      g_queue_unlink (&self->entries, &entry->link);
+      mks_cursor_cache_entry_free (entry);
+    }
+}
+
+void
+mks_cursor_cache_free (MksCursorCache *self)
+{
+  if (self == NULL)
+    return;
+
+  mks_cursor_cache_clear (self);
+  g_free (self);
+}
+
+static guint64
+mks_cursor_cache_hash (GBytes *bytes,
+                       int     width,
+                       int     height,
+                       int     hot_x,
+                       int     hot_y)
+{
+  guint64 hash;
+
+  hash = mks_pixels_hash_rows (g_bytes_get_data (bytes, NULL),
+                               (gsize)width * 4,
+                               (gsize)width * 4,
+                               height);
+
+  hash ^= ((guint64)(guint)width << 48) ^ ((guint64)(guint)height << 32);
+  hash ^= ((guint64)(guint)hot_x << 16) ^ (guint64)(guint)hot_y;
+
+  return hash;
+}
+
+/**
+ * mks_cursor_cache_lookup:
+ * @self: a #MksCursorCache
+ * @bytes: premultiplied ARGB32 pixels with a stride of @width * 4
+ * @width: the width of the cursor
+ * @height: the height of the cursor
+ * @hot_x: the X coordinate of the hotspot
+ * @hot_y: the Y coordinate of the hotspot
+ *
+ * Gets a cursor for the bitmap in @bytes, reusing a previously created
+ * cursor when the same shape and hotspot were seen recently.
+ *
+ * Returns: (transfer full): a #GdkCursor
+ */
+GdkCursor *
+mks_cursor_cache_lookup (MksCursorCache *self,
+                         GBytes         *bytes,
+                         int             width,
+                         int             height,
+                         int             hot_x,
+                         int             hot_y)
+{
+  g_autoptr(GdkTexture) texture = NULL;
+  MksCursorCacheEntry *entry;
+  guint64 hash;
+
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (bytes != NULL, NULL);
+  g_return_val_if_fail (width > 0 && height > 0, NULL);
+  g_return_val_if_fail (g_bytes_get_size (bytes) >= (gsize)width * height * 4, NULL);
+
+  hash = mks_cursor_cache_hash (bytes, width, height, hot_x, hot_y);
+
+  for (const GList *iter = self->entries.head; iter; iter = iter->next)
+    {
+      entry = iter->data;
+
+      if (entry->hash == hash &&
+          entry->width == width &&
+          entry->height == height &&
+          entry->hot_x == hot_x &&
+          entry->hot_y == hot_y &&
+          g_bytes_equal (entry->bytes, bytes))
+        {
+          self->n_hits++;
+
+          MKS_TRACE_MARK ("cursorcache.hit",
+                          "hits=%"G_GUINT64_FORMAT" misses=%"G_GUINT64_FORMAT,
+                          self->n_hits, self->n_misses);
+
+          g_queue_unlink (&self->entries, &entry->link);
+          g_queue_push_head_link (&self->entries, &entry->link);
+
+          return g_object_ref (entry->cursor);
+        }
+    }
+
+  self->n_misses++;
+
+  MKS_TRACE_MARK ("cursorcache.miss",
+                  "hits=%"G_GUINT64_FORMAT" misses=%"G_GUINT64_FORMAT,
+                  self->n_hits, self->n_misses);
+
+  texture = gdk_memory_texture_new (width,
+                                    height,
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+                                    GDK_MEMORY_B8G8R8A8_PREMULTIPLIED,
+#else
+                                    GDK_MEMORY_A8R8G8B8_PREMULTIPLIED,
+#endif
+                                    bytes,
+                                    width * 4);
+
+  entry = g_new0 (MksCursorCacheEntry, 1);
+  entry->link.data = entry;
+  entry->hash = hash;
+  entry->width = width;
+  entry->height = height;
+  entry->hot_x = hot_x;
+  entry->hot_y = hot_y;
+  entry->bytes = g_bytes_ref (bytes);
+  entry->cursor = gdk_cursor_new_from_texture (texture, hot_x, hot_y, NULL);
+  g_queue_push_head_link (&self->entries, &entry->link);
+
+  while (self->entries.length > MAX_ENTRIES)
+    {
+      MksCursorCacheEntry *tail = g_queue_peek_tail (&self->entries);
+
+      g_queue_unlink (&self->entries, &tail->link);
+      mks_cursor_cache_entry_free (tail);
+    }
+
+  return g_object_ref (entry->cursor);
+}
@@ -0,0 +1,63 @@
+/* mks-damage-private.h
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#pragma once
+
+#include <cairo.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define MKS_DAMAGE_MAX_RECTS 16
+
+/* The defaults used by mks_damage_init() */
+#define MKS_DAMAGE_DEFAULT_MAX_RECTS        8
+#define MKS_DAMAGE_DEFAULT_MERGE_OVERHEAD  25
+
+typedef struct _MksDamage
+{
+  cairo_rectangle_int_t rects[MKS_DAMAGE_MAX_RECTS];
+  guint                 n_rects;
+  guint                 max_rects;
+  guint                 merge_overhead;
+} MksDamage;
+
+void            mks_damage_init             (MksDamage                   *self);
+void            mks_damage_init_with_policy (MksDamage                   *self,
+                                             guint                        max_rects,
+                                             guint                        merge_overhead);
+void            mks_damage_clear            (MksDamage                   *self);
+void            mks_damage_add              (MksDamage                   *self,
+                                             const cairo_rectangle_int_t *rect);
+void            mks_damage_add_region       (MksDamage                   *self,
+                                             const cairo_region_t        *region);
+void            mks_damage_clip             (MksDamage                   *self,
+                                             const cairo_rectangle_int_t *bounds);
+void            mks_damage_get_extents      (const MksDamage             *self,
+                                             cairo_rectangle_int_t       *extents);
+cairo_region_t *mks_damage_to_region        (const MksDamage             *self);
+
+static inline gboolean
+mks_damage_is_empty (const MksDamage *self)
+{
+  return self->n_rects == 0;
+}
+
+G_END_DECLS
@@ -0,0 +1,257 @@
+/* mks-damage.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "config.h"
+
+#include "mks-damage-private.h"
+
+/* MksDamage accumulates damage between two texture uploads without
+ * touching the heap. Rather than tracking the exact union like a
+ * cairo_region_t, it keeps a few possibly overlapping rectangles and
+ * merges them when that costs little extra area, or when it runs out of
+ * room. Uploading a slightly larger area is much cheaper than uploading
+ * hundreds of tiny rectangles.
+ */
+
+static inline guint64
+rect_area (const cairo_rectangle_int_t *rect)
+{
+  return (guint64)rect->width * rect->height;
+}
+
+static inline gboolean
+rect_contains (const cairo_rectangle_int_t *outer,
+               const cairo_rectangle_int_t *inner)
+{
+  return inner->x >= outer->x &&
+         inner->y >= outer->y &&
+         inner->x + inner->width <= outer->x + outer->width &&
+         inner->y + inner->height <= outer->y + outer->height;
+}
+
+static inline void
+rect_union (const cairo_rectangle_int_t *a,
+            const cairo_rectangle_int_t *b,
+            cairo_rectangle_int_t       *dest)
+{
+  int x1 = MIN (a->x, b->x);
+  int y1 = MIN (a->y, b->y);
+  int x2 = MAX (a->x + a->width, b->x + b->width);
+  int y2 = MAX (a->y + a->height, b->y + b->height);
+
+  *dest = (cairo_rectangle_int_t) { x1, y1, x2 - x1, y2 - y1 };
+}
+
+void
+mks_damage_init_with_policy (MksDamage *self,
+                             guint      max_rects,
+                             guint      merge_overhead)
+{
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (max_rects > 0);
+
+  self->n_rects = 0;
+  self->max_rects = MIN (max_rects, MKS_DAMAGE_MAX_RECTS);
+  self->merge_overhead = merge_overhead;
+}
+
+/*
+ * mks_damage_init:
+ *
+ * Initializes @self with the default policy of keeping up to
+ * %MKS_DAMAGE_DEFAULT_MAX_RECTS rectangles and merging two rectangles
+ * when their bounding box is at most %MKS_DAMAGE_DEFAULT_MERGE_OVERHEAD
+ * percent larger than the two combined.
+ */
+void
+mks_damage_init (MksDamage *self)
+{
+  mks_damage_init_with_policy (self,
+                               MKS_DAMAGE_DEFAULT_MAX_RECTS,
+                               MKS_DAMAGE_DEFAULT_MERGE_OVERHEAD);
+}
+
+void
+mks_damage_clear (MksDamage *self)
+{
+  g_return_if_fail (self != NULL);
+
+  self->n_rects = 0;
+}
+
+static inline void
+mks_damage_remove_index (MksDamage *self,
+                         guint      index)
+{
+  g_assert (index < self->n_rects);
+
+  self->rects[index] = self->rects[--self->n_rects];
+}
+
+void
+mks_damage_add (MksDamage                   *self,
+                const cairo_rectangle_int_t *rect)
+{
+  cairo_rectangle_int_t pending;
+  gboolean merged;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (self->max_rects > 0);
+  g_return_if_fail (rect != NULL);
+
+  if (rect->width <= 0 || rect->height <= 0)
+    return;
+
+  pending = *rect;
+
+  /* Merging may make @pending large enough to cheaply merge with yet
+   * another rectangle, so repeat until nothing changes.
+   */
+  do
+    {
+      merged = FALSE;
+
+      for (guint i = 0; i < self->n_rects; i++)
+        {
+          const cairo_rectangle_int_t *existing = &self->rects[i];
+          cairo_rectangle_int_t bounds;
+
+          if (rect_contains (existing, &pending))
+            return;
+
+          rect_union (existing, &pending, &bounds);
+
+          if (rect_area (&bounds) * 100 <=
+              (rect_area (existing) + rect_area (&pending)) * (100 + self->merge_overhead))
+            {
+              pending = bounds;
+              mks_damage_remove_index (self, i);
+              merged = TRUE;
+              break;
+            }
+        }
+    }
+  while (merged);
+
+  if (self->n_rects == self->max_rects)
+    {
+      guint64 best_growth = G_MAXUINT64;
+      guint best = 0;
+
+      /* Out of room, merge with whichever rectangle grows the least */
+      for (guint i = 0; i < self->n_rects; i++)
+        {
+          cairo_rectangle_int_t bounds;
+          guint64 growth;
+
+          rect_union (&self->rects[i], &pending, &bounds);
+          growth = rect_area (&bounds) - rect_area (&self->rects[i]);
+
+          if (growth < best_growth)
+            {
+              best_growth = growth;
+              best = i;
+            }
+        }
+
+      rect_union (&self->rects[best], &pending, &pending);
+      mks_damage_remove_index (self, best);
+    }
+
+  self->rects[self->n_rects++] = pending;
+}
+
+void
+mks_damage_add_region (MksDamage            *self,
+                       const cairo_region_t *region)
+{
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (region != NULL);
+
+  for (int i = 0; i < cairo_region_num_rectangles (region); i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (region, i, &rect);
+      mks_damage_add (self, &rect);
+    }
+}
+
+/*
+ * mks_damage_clip:
+ *
+ * Restricts damage to @bounds, such as after the surface shrinks.
+ */
+void
+mks_damage_clip (MksDamage                   *self,
+                 const cairo_rectangle_int_t *bounds)
+{
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (bounds != NULL);
+
+  for (guint i = self->n_rects; i > 0; i--)
+    {
+      cairo_rectangle_int_t *rect = &self->rects[i - 1];
+      int x1 = MAX (rect->x, bounds->x);
+      int y1 = MAX (rect->y, bounds->y);
+      int x2 = MIN (rect->x + rect->width, bounds->x + bounds->width);
+      int y2 = MIN (rect->y + rect->height, bounds->y + bounds->height);
+
+      if (x2 <= x1 || y2 <= y1)
+        mks_damage_remove_index (self, i - 1);
+      else
+        *rect = (cairo_rectangle_int_t) { x1, y1, x2 - x1, y2 - y1 };
+    }
+}
+
+void
+mks_damage_get_extents (const MksDamage       *self,
+                        cairo_rectangle_int_t *extents)
+{
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (extents != NULL);
+
+  if (self->n_rects == 0)
+    {
+      *extents = (cairo_rectangle_int_t) { 0, 0, 0, 0 };
+      return;
+    }
+
+  *extents = self->rects[0];
+
+  for (guint i = 1; i < self->n_rects; i++)
+    rect_union (extents, &self->rects[i], extents);
+}
+
+/*
+ * mks_damage_to_region:
+ *
+ * Creates a region for APIs such as GdkMemoryTextureBuilder. This is
+ * meant to be called once per upload rather than once per update.
+ *
+ * Returns: (transfer full): a new #cairo_region_t
+ */
+cairo_region_t *
+mks_damage_to_region (const MksDamage *self)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+
+  return cairo_region_create_rectangles (self->rects, self->n_rects);
+}
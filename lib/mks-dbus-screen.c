@@ -33,6 +33,8 @@
 #include "mks-dbus-mouse-private.h"
 #include "mks-paintable-private.h"
 #include "mks-screen-attributes-private.h"
+#include "mks-screen-capture-private.h"
+#include "mks-thumbnail-paintable-private.h"
 #include "mks-dbus-screen-private.h"
 #include "mks-util-private.h"
 #include "mks-dbus-touchable-private.h"
@@ -51,6 +53,12 @@ struct _MksDBusScreen
   MksQemuListener                   *activity_listener;
   MksQemuListenerUnixScanoutDMABUF2 *activity_listener_dmabuf2;
   MksQemuListenerUnixMap            *activity_listener_map;
+  /* Paintables attached to this screen, not owned. While any of them is
+   * not in @suspended they report activity instead of the activity
+   * listener.
+   */
+  GPtrArray                         *viewers;
+  GPtrArray                         *suspended;
   MksKeyboard                       *keyboard;
   MksMouse                          *mouse;
   MksTouchable                      *touchable;
@@ -74,6 +82,15 @@ static DexFuture     *mks_dbus_screen_configure          (MksScreen           *s
                                                           MksScreenAttributes *attributes);
 static DexFuture     *mks_dbus_screen_attach             (MksScreen           *screen,
                                                           GdkDisplay          *display);
+static DexFuture     *mks_dbus_screen_create_capture     (MksScreen           *screen);
+static DexFuture     *mks_dbus_screen_create_thumbnail   (MksScreen           *screen,
+                                                          guint                max_width,
+                                                          guint                max_height,
+                                                          guint                max_fps);
+static void           mks_dbus_screen_suspend            (MksScreen           *screen,
+                                                          GdkPaintable        *paintable);
+static void           mks_dbus_screen_resume             (MksScreen           *screen,
+                                                          GdkPaintable        *paintable);
 
 
 static void
@@ -290,11 +307,26 @@ mks_dbus_screen_activity_listener_cursor_define (MksDBusScreen         *self,
   return TRUE;
 }
 
+typedef struct _MksDBusScreenActivity
+{
+  MksDBusScreen   *self;
+  MksQemuListener *listener;
+} MksDBusScreenActivity;
+
+static void
+mks_dbus_screen_activity_free (MksDBusScreenActivity *state)
+{
+  g_clear_object (&state->self);
+  g_clear_object (&state->listener);
+  g_free (state);
+}
+
 static DexFuture *
 mks_dbus_screen_activity_connection_cb (DexFuture *future,
                                         gpointer   user_data)
 {
-  MksDBusScreen *self = user_data;
+  MksDBusScreenActivity *state = user_data;
+  MksDBusScreen *self = state->self;
   GDBusInterfaceSkeleton *skeleton;
   g_autoptr(GError) error = NULL;
   const GValue *value;
@@ -308,6 +340,13 @@ mks_dbus_screen_activity_connection_cb (DexFuture *future,
       return dex_future_new_true ();
     }
 
+  /* The listener was stopped, or replaced, while we were connecting */
+  if (state->listener != self->activity_listener)
+    {
+      g_dbus_connection_close (g_value_get_object (value), NULL, NULL, NULL);
+      return dex_future_new_true ();
+    }
+
   g_set_object (&self->activity_connection, g_value_get_object (value));
 
   skeleton = G_DBUS_INTERFACE_SKELETON (self->activity_listener);
@@ -355,13 +394,16 @@ mks_dbus_screen_start_activity_listener (MksDBusScreen *self)
   g_autoptr(GUnixFDList) unix_fd_list = NULL;
   g_autoptr(GSocket) socket = NULL;
   g_autoptr(GError) error = NULL;
+  MksDBusScreenActivity *state;
   g_autofd int us = -1;
   g_autofd int them = -1;
   gint64 begin_time;
 
   g_assert (MKS_IS_DBUS_SCREEN (self));
 
-  if (self->console == NULL || self->activity_listener != NULL)
+  if (self->console == NULL ||
+      self->activity_listener != NULL ||
+      self->viewers->len > self->suspended->len)
     return;
 
   if (!mks_socketpair_create (&us, &them, &error) ||
@@ -434,6 +476,10 @@ mks_dbus_screen_start_activity_listener (MksDBusScreen *self)
                            self,
                            G_CONNECT_SWAPPED);
 
+  state = g_new0 (MksDBusScreenActivity, 1);
+  state->self = g_object_ref (self);
+  state->listener = g_object_ref (self->activity_listener);
+
   begin_time = MKS_TRACE_BEGIN_MARK ();
   dex_future_disown
     (dex_future_finally
@@ -445,8 +491,8 @@ mks_dbus_screen_start_activity_listener (MksDBusScreen *self)
            begin_time,
            "screen.activity.dbus-connection"),
         mks_dbus_screen_activity_connection_cb,
-        g_object_ref (self),
-        g_object_unref));
+        state,
+        (GDestroyNotify) mks_dbus_screen_activity_free));
 
   unix_fd_list = g_unix_fd_list_new_from_array (&them, 1), them = -1;
   begin_time = MKS_TRACE_BEGIN_MARK ();
@@ -471,6 +517,69 @@ mks_dbus_screen_start_activity_listener (MksDBusScreen *self)
         "Failed to register screen activity listener"));
 }
 
+static void
+mks_dbus_screen_stop_activity_listener (MksDBusScreen *self)
+{
+  g_assert (MKS_IS_DBUS_SCREEN (self));
+
+  mks_listener_connection_clear (&self->activity_connection);
+
+  g_clear_object (&self->activity_listener);
+  g_clear_object (&self->activity_listener_dmabuf2);
+  g_clear_object (&self->activity_listener_map);
+}
+
+static void
+mks_dbus_screen_viewer_finalized_cb (gpointer  data,
+                                     GObject  *where_the_object_was)
+{
+  MksDBusScreen *self = data;
+
+  g_assert (MKS_IS_DBUS_SCREEN (self));
+
+  g_ptr_array_remove_fast (self->viewers, where_the_object_was);
+  g_ptr_array_remove_fast (self->suspended, where_the_object_was);
+
+  mks_dbus_screen_start_activity_listener (self);
+}
+
+static void
+mks_dbus_screen_viewer_activity_cb (MksDBusScreen *self,
+                                    GdkPaintable  *paintable)
+{
+  g_assert (MKS_IS_DBUS_SCREEN (self));
+  g_assert (GDK_IS_PAINTABLE (paintable));
+
+  mks_dbus_screen_mark_active (self);
+}
+
+/* An attached paintable receives every update for the console already,
+ * so it is used to track activity. Otherwise QEMU would have to send all
+ * pixel data a second time to the activity listener.
+ *
+ * Both kinds of paintable we attach emit "activity" as messages arrive,
+ * as "invalidate-contents" is not emitted again until they are drawn.
+ */
+static void
+mks_dbus_screen_add_viewer (MksDBusScreen *self,
+                            GdkPaintable  *paintable)
+{
+  g_assert (MKS_IS_DBUS_SCREEN (self));
+  g_assert (GDK_IS_PAINTABLE (paintable));
+
+  g_signal_connect_object (paintable,
+                           "activity",
+                           G_CALLBACK (mks_dbus_screen_viewer_activity_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+  g_object_weak_ref (G_OBJECT (paintable),
+                     mks_dbus_screen_viewer_finalized_cb,
+                     self);
+  g_ptr_array_add (self->viewers, paintable);
+
+  mks_dbus_screen_stop_activity_listener (self);
+}
+
 static void
 mks_dbus_screen_set_width (MksDBusScreen *self,
                            guint          width)
@@ -646,14 +755,31 @@ mks_dbus_screen_dispose (GObject *object)
   g_clear_object (&self->keyboard);
   g_clear_object (&self->mouse);
   g_clear_object (&self->touchable);
-  g_clear_object (&self->activity_listener);
-  g_clear_object (&self->activity_listener_dmabuf2);
-  g_clear_object (&self->activity_listener_map);
-  g_clear_object (&self->activity_connection);
+
+  while (self->viewers->len > 0)
+    {
+      GObject *viewer = g_ptr_array_steal_index_fast (self->viewers, 0);
+      g_object_weak_unref (viewer, mks_dbus_screen_viewer_finalized_cb, self);
+    }
+
+  g_ptr_array_set_size (self->suspended, 0);
+
+  mks_dbus_screen_stop_activity_listener (self);
 
   G_OBJECT_CLASS (mks_dbus_screen_parent_class)->dispose (object);
 }
 
+static void
+mks_dbus_screen_finalize (GObject *object)
+{
+  MksDBusScreen *self = (MksDBusScreen *)object;
+
+  g_clear_pointer (&self->viewers, g_ptr_array_unref);
+  g_clear_pointer (&self->suspended, g_ptr_array_unref);
+
+  G_OBJECT_CLASS (mks_dbus_screen_parent_class)->finalize (object);
+}
+
 static void
 mks_dbus_screen_class_init (MksDBusScreenClass *klass)
 {
@@ -671,8 +797,13 @@ mks_dbus_screen_class_init (MksDBusScreenClass *klass)
   screen_class->get_device_address = mks_dbus_screen_get_device_address;
   screen_class->configure = mks_dbus_screen_configure;
   screen_class->attach = mks_dbus_screen_attach;
+  screen_class->create_capture = mks_dbus_screen_create_capture;
+  screen_class->create_thumbnail = mks_dbus_screen_create_thumbnail;
+  screen_class->suspend = mks_dbus_screen_suspend;
+  screen_class->resume = mks_dbus_screen_resume;
 
   object_class->dispose = mks_dbus_screen_dispose;
+  object_class->finalize = mks_dbus_screen_finalize;
 
   device_class->setup = mks_dbus_screen_setup;
 }
@@ -680,6 +811,8 @@ mks_dbus_screen_class_init (MksDBusScreenClass *klass)
 static void
 mks_dbus_screen_init (MksDBusScreen *self)
 {
+  self->viewers = g_ptr_array_new ();
+  self->suspended = g_ptr_array_new ();
 }
 
 static MksKeyboard *
@@ -814,14 +947,42 @@ mks_dbus_screen_configure (MksScreen           *screen,
   return ret;
 }
 
+/* Registers the listener at the other end of @fd with the console. Takes
+ * ownership of @fd.
+ */
+static DexFuture *
+mks_dbus_screen_register_listener (MksDBusScreen *self,
+                                   int            fd)
+{
+  g_autoptr(GUnixFDList) unix_fd_list = NULL;
+
+  g_assert (MKS_IS_DBUS_SCREEN (self));
+  g_assert (fd != -1);
+
+  unix_fd_list = g_unix_fd_list_new_from_array (&fd, 1);
+
+  return dex_dbus_connection_call_with_unix_fd_list (g_dbus_proxy_get_connection (G_DBUS_PROXY (self->console)),
+                                                     g_dbus_proxy_get_name (G_DBUS_PROXY (self->console)),
+                                                     g_dbus_proxy_get_object_path (G_DBUS_PROXY (self->console)),
+                                                     "org.qemu.Display1.Console",
+                                                     "RegisterListener",
+                                                     g_variant_new ("(h)", 0),
+                                                     G_VARIANT_TYPE ("()"),
+                                                     G_DBUS_CALL_FLAGS_NONE,
+                                                     -1,
+                                                     unix_fd_list);
+}
+
 typedef struct _MksDBusScreenAttach
 {
-  GdkPaintable *paintable;
+  MksDBusScreen *self;
+  GdkPaintable  *paintable;
 } MksDBusScreenAttach;
 
 static void
 mks_dbus_screen_attach_free (MksDBusScreenAttach *state)
 {
+  g_clear_object (&state->self);
   g_clear_object (&state->paintable);
   g_free (state);
 }
@@ -839,6 +1000,8 @@ mks_dbus_screen_attach_complete (DexFuture *future,
   if (!dex_future_get_value (future, &error))
     return dex_future_new_for_error (g_steal_pointer (&error));
 
+  mks_dbus_screen_add_viewer (state->self, state->paintable);
+
   return dex_future_new_for_object (state->paintable);
 }
 
@@ -848,7 +1011,6 @@ mks_dbus_screen_attach (MksScreen  *screen,
 {
   MksDBusScreen *self = MKS_DBUS_SCREEN (screen);
   MksDBusScreenAttach *state;
-  g_autoptr(GUnixFDList) unix_fd_list = NULL;
   g_autoptr(GdkPaintable) paintable = NULL;
   g_autoptr(GError) error = NULL;
   g_autofd int fd = -1;
@@ -862,24 +1024,156 @@ mks_dbus_screen_attach (MksScreen  *screen,
     return dex_future_new_for_error (g_steal_pointer (&error));
 
   state = g_new0 (MksDBusScreenAttach, 1);
+  state->self = g_object_ref (self);
   state->paintable = g_object_ref (paintable);
 
-  unix_fd_list = g_unix_fd_list_new_from_array (&fd, 1), fd = -1;
   begin_time = MKS_TRACE_BEGIN_MARK ();
 
-  return mks_marked_future (dex_future_then (dex_dbus_connection_call_with_unix_fd_list (g_dbus_proxy_get_connection (G_DBUS_PROXY (self->console)),
-                                                                                         g_dbus_proxy_get_name (G_DBUS_PROXY (self->console)),
-                                                                                         g_dbus_proxy_get_object_path (G_DBUS_PROXY (self->console)),
-                                                                                         "org.qemu.Display1.Console",
-                                                                                         "RegisterListener",
-                                                                                         g_variant_new ("(h)", 0),
-                                                                                         G_VARIANT_TYPE ("()"),
-                                                                                         G_DBUS_CALL_FLAGS_NONE,
-                                                                                         -1,
-                                                                                         unix_fd_list),
+  return mks_marked_future (dex_future_then (mks_dbus_screen_register_listener (self, g_steal_fd (&fd)),
                                              mks_dbus_screen_attach_complete,
                                              state,
                                              (GDestroyNotify) mks_dbus_screen_attach_free),
                             begin_time,
                             "screen.attach");
 }
+
+static DexFuture *
+mks_dbus_screen_create_capture_complete (DexFuture *future,
+                                         gpointer   user_data)
+{
+  MksScreenCapture *capture = user_data;
+  g_autoptr(GError) error = NULL;
+
+  g_assert (DEX_IS_FUTURE (future));
+  g_assert (MKS_IS_SCREEN_CAPTURE (capture));
+
+  if (!dex_future_get_value (future, &error))
+    return dex_future_new_for_error (g_steal_pointer (&error));
+
+  return dex_future_new_for_object (capture);
+}
+
+static DexFuture *
+mks_dbus_screen_create_capture (MksScreen *screen)
+{
+  MksDBusScreen *self = MKS_DBUS_SCREEN (screen);
+  g_autoptr(MksScreenCapture) capture = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofd int fd = -1;
+  gint64 begin_time;
+
+  dex_return_error_if_fail (MKS_IS_DBUS_SCREEN (self));
+
+  if (!check_console (self, &error) ||
+      !(capture = _mks_screen_capture_new (&fd, &error)))
+    return dex_future_new_for_error (g_steal_pointer (&error));
+
+  begin_time = MKS_TRACE_BEGIN_MARK ();
+
+  return mks_marked_future (dex_future_then (mks_dbus_screen_register_listener (self, g_steal_fd (&fd)),
+                                             mks_dbus_screen_create_capture_complete,
+                                             g_object_ref (capture),
+                                             g_object_unref),
+                            begin_time,
+                            "screen.create-capture");
+}
+
+static DexFuture *
+mks_dbus_screen_create_thumbnail (MksScreen *screen,
+                                  guint      max_width,
+                                  guint      max_height,
+                                  guint      max_fps)
+{
+  MksDBusScreen *self = MKS_DBUS_SCREEN (screen);
+  MksDBusScreenAttach *state;
+  g_autoptr(GdkPaintable) paintable = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofd int fd = -1;
+  gint64 begin_time;
+
+  dex_return_error_if_fail (MKS_IS_DBUS_SCREEN (self));
+
+  if (!check_console (self, &error) ||
+      !(paintable = _mks_thumbnail_paintable_new (max_width, max_height, max_fps, &fd, &error)))
+    return dex_future_new_for_error (g_steal_pointer (&error));
+
+  /* The thumbnail invalidates at a bounded rate which makes it as good
+   * as an attached paintable for tracking activity.
+   */
+  state = g_new0 (MksDBusScreenAttach, 1);
+  state->self = g_object_ref (self);
+  state->paintable = g_object_ref (paintable);
+
+  begin_time = MKS_TRACE_BEGIN_MARK ();
+
+  return mks_marked_future (dex_future_then (mks_dbus_screen_register_listener (self, g_steal_fd (&fd)),
+                                             mks_dbus_screen_attach_complete,
+                                             state,
+                                             (GDestroyNotify) mks_dbus_screen_attach_free),
+                            begin_time,
+                            "screen.create-thumbnail");
+}
+
+/* While every widget showing @paintable is hidden its connection is
+ * closed, which QEMU treats as the listener going away. The paintable
+ * keeps its last frame but no longer reports activity, so the activity
+ * listener takes over once every viewer is suspended.
+ */
+static void
+mks_dbus_screen_suspend (MksScreen    *screen,
+                         GdkPaintable *paintable)
+{
+  MksDBusScreen *self = MKS_DBUS_SCREEN (screen);
+
+  g_assert (MKS_IS_DBUS_SCREEN (self));
+  g_assert (GDK_IS_PAINTABLE (paintable));
+
+  if (!MKS_IS_PAINTABLE (paintable))
+    return;
+
+  _mks_paintable_suspend (MKS_PAINTABLE (paintable));
+
+  if (g_ptr_array_find (self->viewers, paintable, NULL) &&
+      !g_ptr_array_find (self->suspended, paintable, NULL))
+    {
+      g_ptr_array_add (self->suspended, paintable);
+      mks_dbus_screen_start_activity_listener (self);
+    }
+}
+
+/* QEMU sends the current contents to newly registered listeners, so the
+ * paintable is up to date again after the first Scanout.
+ */
+static void
+mks_dbus_screen_resume (MksScreen    *screen,
+                        GdkPaintable *paintable)
+{
+  MksDBusScreen *self = MKS_DBUS_SCREEN (screen);
+  g_autoptr(GError) error = NULL;
+  gint64 begin_time;
+  int fd;
+
+  g_assert (MKS_IS_DBUS_SCREEN (self));
+  g_assert (GDK_IS_PAINTABLE (paintable));
+
+  if (!MKS_IS_PAINTABLE (paintable))
+    return;
+
+  if (g_ptr_array_remove_fast (self->suspended, paintable))
+    mks_dbus_screen_stop_activity_listener (self);
+
+  if (!check_console (self, &error) ||
+      -1 == (fd = _mks_paintable_resume (MKS_PAINTABLE (paintable), &error)))
+    {
+      g_warning ("Failed to resume screen: %s", error->message);
+      return;
+    }
+
+  begin_time = MKS_TRACE_BEGIN_MARK ();
+  dex_future_disown (mks_logged_future (mks_marked_future (mks_dbus_screen_register_listener (self, fd),
+                                                           begin_time,
+                                                           "screen.resume"),
+                                        G_LOG_DOMAIN,
+                                        G_LOG_LEVEL_WARNING,
+                                        "Failed to register resumed screen listener"));
+}
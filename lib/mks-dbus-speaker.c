@@ -326,8 +326,6 @@ mks_dbus_speaker_handle_write (MksDBusSpeaker        *self,
 {
   MksDBusSpeakerStream *stream;
   g_autoptr(GBytes) bytes = NULL;
-  gconstpointer element_data;
-  gsize n_elements;
 
   g_assert (MKS_IS_DBUS_SPEAKER (self));
   g_assert (G_IS_DBUS_METHOD_INVOCATION (invocation));
@@ -336,8 +334,8 @@ mks_dbus_speaker_handle_write (MksDBusSpeaker        *self,
 
   if (!self->muted && (stream == NULL || !stream->muted))
     {
-      element_data = g_variant_get_fixed_array (data, &n_elements, sizeof (guchar));
-      bytes = g_bytes_new (element_data, n_elements);
+      /* Reference the samples within the message rather than copying */
+      bytes = g_variant_get_data_as_bytes (data);
       mks_dbus_speaker_emit_pcm (self, id, bytes);
     }
 
@@ -44,6 +44,13 @@ void          mks_display_picture_set_keyboard             (MksDisplayPicture *s
 MksTouchable *mks_display_picture_get_touchable            (MksDisplayPicture *self);
 void          mks_display_picture_set_touchable            (MksDisplayPicture *self,
                                                             MksTouchable      *touchable);
+guint         mks_display_picture_get_max_fps              (MksDisplayPicture *self);
+void          mks_display_picture_set_max_fps              (MksDisplayPicture *self,
+                                                            guint              max_fps);
+gboolean      mks_display_picture_get_adaptive_fps         (MksDisplayPicture *self);
+void          mks_display_picture_set_adaptive_fps         (MksDisplayPicture *self,
+                                                            gboolean           adaptive_fps);
+gboolean      mks_display_picture_get_shown                (MksDisplayPicture *self);
 gboolean      mks_display_picture_event_get_guest_position (MksDisplayPicture *self,
                                                             GdkEvent          *event,
                                                             double            *guest_x,
@@ -23,16 +23,25 @@
 #include "config.h"
 
 #include "mks-display-picture-private.h"
+#include "mks-frame-stats-private.h"
 #include "mks-keyboard.h"
 #include "mks-mouse.h"
 #include "mks-touchable.h"
+#include "mks-trace-private.h"
 #include "mks-util-private.h"
 
+/* Used by adaptive-fps when max-fps is unlimited */
+#define ADAPTIVE_DEFAULT_FPS        60
+#define ADAPTIVE_UNFOCUSED_DIVISOR   4
+#define ADAPTIVE_HIDDEN_FPS          1
+
 struct _MksDisplayPicture
 {
   GtkWidget parent_instance;
 
   GSignalGroup *paintable_signals;
+  GSignalGroup *window_signals;
+  GSignalGroup *toplevel_signals;
   MksPaintable *paintable;
   MksKeyboard  *keyboard;
   MksMouse     *mouse;
@@ -40,6 +49,23 @@ struct _MksDisplayPicture
 
   double last_mouse_x;
   double last_mouse_y;
+
+  /* Frame throttling. Paintables accumulate damage until they are
+   * snapshot, so deferring the redraw never loses content.
+   */
+  gint64 last_frame_time;
+  guint  throttle_source;
+  guint  n_coalesced;
+  guint  max_fps;
+  guint  adaptive_fps : 1;
+
+  /* Waits for frames with new content to be presented */
+  guint  presentation_tick;
+
+  /* Set while mapped in a toplevel which is neither minimized nor
+   * suspended by the compositor, such as when it is fully occluded.
+   */
+  guint  shown : 1;
 };
 
 enum {
@@ -48,6 +74,9 @@ enum {
   PROP_KEYBOARD,
   PROP_MOUSE,
   PROP_TOUCHABLE,
+  PROP_MAX_FPS,
+  PROP_ADAPTIVE_FPS,
+  PROP_SHOWN,
   N_PROPS
 };
 
@@ -352,14 +381,143 @@ mks_display_picture_legacy_event_cb (MksDisplayPicture        *self,
   return GDK_EVENT_PROPAGATE;
 }
 
+static guint
+mks_display_picture_get_frame_rate (MksDisplayPicture *self)
+{
+  GtkNative *native;
+  GtkRoot *root;
+
+  g_assert (MKS_IS_DISPLAY_PICTURE (self));
+
+  if (!self->adaptive_fps)
+    return self->max_fps;
+
+  if ((native = gtk_widget_get_native (GTK_WIDGET (self))))
+    {
+      GdkSurface *surface = gtk_native_get_surface (native);
+
+      if (GDK_IS_TOPLEVEL (surface) &&
+          (gdk_toplevel_get_state (GDK_TOPLEVEL (surface)) &
+           (GDK_TOPLEVEL_STATE_MINIMIZED | GDK_TOPLEVEL_STATE_SUSPENDED)) != 0)
+        return ADAPTIVE_HIDDEN_FPS;
+    }
+
+  if ((root = gtk_widget_get_root (GTK_WIDGET (self))) &&
+      GTK_IS_WINDOW (root) &&
+      !gtk_window_is_active (GTK_WINDOW (root)))
+    return MAX (1, (self->max_fps ? self->max_fps : ADAPTIVE_DEFAULT_FPS) / ADAPTIVE_UNFOCUSED_DIVISOR);
+
+  return self->max_fps;
+}
+
+static gboolean
+mks_display_picture_throttle_cb (gpointer data)
+{
+  MksDisplayPicture *self = data;
+
+  g_assert (MKS_IS_DISPLAY_PICTURE (self));
+
+  self->throttle_source = 0;
+  gtk_widget_queue_draw (GTK_WIDGET (self));
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Called when the frame rate may have changed so that a redraw
+ * deferred at the old rate is not held back any longer.
+ */
+static void
+mks_display_picture_reset_throttle (MksDisplayPicture *self)
+{
+  g_assert (MKS_IS_DISPLAY_PICTURE (self));
+
+  if (self->throttle_source != 0)
+    {
+      g_clear_handle_id (&self->throttle_source, g_source_remove);
+      gtk_widget_queue_draw (GTK_WIDGET (self));
+    }
+}
+
+static void
+mks_display_picture_frame_rate_changed_cb (MksDisplayPicture *self,
+                                           GParamSpec        *pspec,
+                                           GObject           *object)
+{
+  g_assert (MKS_IS_DISPLAY_PICTURE (self));
+
+  mks_display_picture_reset_throttle (self);
+}
+
+static void
+mks_display_picture_update_shown (MksDisplayPicture *self)
+{
+  GtkNative *native;
+  gboolean shown;
+
+  g_assert (MKS_IS_DISPLAY_PICTURE (self));
+
+  shown = gtk_widget_get_mapped (GTK_WIDGET (self));
+
+  if (shown && (native = gtk_widget_get_native (GTK_WIDGET (self))))
+    {
+      GdkSurface *surface = gtk_native_get_surface (native);
+
+      if (GDK_IS_TOPLEVEL (surface) &&
+          (gdk_toplevel_get_state (GDK_TOPLEVEL (surface)) &
+           (GDK_TOPLEVEL_STATE_MINIMIZED | GDK_TOPLEVEL_STATE_SUSPENDED)) != 0)
+        shown = FALSE;
+    }
+
+  if (self->shown != shown)
+    {
+      self->shown = shown;
+      g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_SHOWN]);
+    }
+}
+
+static void
+mks_display_picture_toplevel_state_cb (MksDisplayPicture *self,
+                                       GParamSpec        *pspec,
+                                       GdkSurface        *surface)
+{
+  g_assert (MKS_IS_DISPLAY_PICTURE (self));
+
+  mks_display_picture_update_shown (self);
+}
+
 static void
 mks_display_picture_invalidate_contents_cb (MksDisplayPicture *self,
                                             MksPaintable      *paintable)
 {
+  gint64 deadline;
+  gint64 now;
+  guint fps;
+
   g_assert (MKS_IS_DISPLAY_PICTURE (self));
   g_assert (MKS_IS_PAINTABLE (paintable));
 
-  gtk_widget_queue_draw (GTK_WIDGET (self));
+  if (self->throttle_source != 0)
+    {
+      self->n_coalesced++;
+      return;
+    }
+
+  fps = mks_display_picture_get_frame_rate (self);
+  now = g_get_monotonic_time ();
+  deadline = self->last_frame_time + G_USEC_PER_SEC / MAX (fps, 1);
+
+  if (fps == 0 || now >= deadline)
+    {
+      gtk_widget_queue_draw (GTK_WIDGET (self));
+      return;
+    }
+
+  self->n_coalesced++;
+  self->throttle_source = g_timeout_add_full (G_PRIORITY_DEFAULT,
+                                              (deadline - now + 999) / 1000,
+                                              mks_display_picture_throttle_cb,
+                                              self,
+                                              NULL);
 }
 
 static void
@@ -476,13 +634,59 @@ mks_display_picture_get_request_mode (GtkWidget *widget)
   return GTK_SIZE_REQUEST_HEIGHT_FOR_WIDTH;
 }
 
+static gboolean
+mks_display_picture_presentation_tick_cb (GtkWidget     *widget,
+                                          GdkFrameClock *frame_clock,
+                                          gpointer       user_data)
+{
+  MksDisplayPicture *self = (MksDisplayPicture *)widget;
+  MksFrameStats *frame_stats;
+  gint64 frame_counter;
+
+  g_assert (MKS_IS_DISPLAY_PICTURE (self));
+  g_assert (GDK_IS_FRAME_CLOCK (frame_clock));
+
+  if (self->paintable == NULL)
+    goto finished;
+
+  frame_stats = _mks_paintable_get_frame_stats (self->paintable);
+
+  while (mks_frame_stats_peek_frame (frame_stats, &frame_counter))
+    {
+      GdkFrameTimings *timings = gdk_frame_clock_get_timings (frame_clock, frame_counter);
+      gint64 presentation_time;
+
+      /* Fell out of the frame clock history without completing */
+      if (timings == NULL)
+        {
+          mks_frame_stats_record_presented (frame_stats, frame_counter, 0);
+          continue;
+        }
+
+      if (!gdk_frame_timings_get_complete (timings))
+        return G_SOURCE_CONTINUE;
+
+      if (!(presentation_time = gdk_frame_timings_get_presentation_time (timings)))
+        presentation_time = gdk_frame_timings_get_predicted_presentation_time (timings);
+
+      mks_frame_stats_record_presented (frame_stats, frame_counter, presentation_time);
+    }
+
+finished:
+  self->presentation_tick = 0;
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
 mks_display_picture_snapshot (GtkWidget   *widget,
                               GtkSnapshot *snapshot)
 {
   MksDisplayPicture *self = (MksDisplayPicture *)widget;
+  GdkFrameClock *frame_clock;
   GtkNative *native;
   graphene_rect_t bounds;
+  gint64 begin;
   double native_x = 0;
   double native_y = 0;
   double surface_x = 0;
@@ -491,6 +695,17 @@ mks_display_picture_snapshot (GtkWidget   *widget,
   if (self->paintable == NULL)
     return;
 
+  self->last_frame_time = g_get_monotonic_time ();
+
+  if (self->n_coalesced > 0)
+    {
+      MKS_TRACE_MARK ("display.frame",
+                      "fps=%u coalesced=%u",
+                      mks_display_picture_get_frame_rate (self),
+                      self->n_coalesced);
+      self->n_coalesced = 0;
+    }
+
   if ((native = gtk_widget_get_native (widget)) &&
       gtk_widget_compute_bounds (widget, GTK_WIDGET (native), &bounds))
     {
@@ -505,6 +720,7 @@ mks_display_picture_snapshot (GtkWidget   *widget,
                                                0,
                                                gtk_widget_get_width (widget),
                                                gtk_widget_get_height (widget)));
+  begin = g_get_monotonic_time ();
   _mks_paintable_snapshot (self->paintable,
                            snapshot,
                            gtk_widget_get_width (widget),
@@ -513,6 +729,72 @@ mks_display_picture_snapshot (GtkWidget   *widget,
                            surface_y,
                            gtk_widget_get_scale_factor (widget));
   gtk_snapshot_pop (snapshot);
+
+  if ((frame_clock = gtk_widget_get_frame_clock (widget)) &&
+      mks_frame_stats_record_frame (_mks_paintable_get_frame_stats (self->paintable),
+                                    gdk_frame_clock_get_frame_counter (frame_clock),
+                                    g_get_monotonic_time () - begin) &&
+      self->presentation_tick == 0)
+    self->presentation_tick = gtk_widget_add_tick_callback (widget,
+                                                            mks_display_picture_presentation_tick_cb,
+                                                            NULL,
+                                                            NULL);
+}
+
+static void
+mks_display_picture_realize (GtkWidget *widget)
+{
+  MksDisplayPicture *self = (MksDisplayPicture *)widget;
+  GtkRoot *root;
+
+  g_assert (MKS_IS_DISPLAY_PICTURE (self));
+
+  GTK_WIDGET_CLASS (mks_display_picture_parent_class)->realize (widget);
+
+  root = gtk_widget_get_root (widget);
+
+  g_signal_group_set_target (self->window_signals,
+                             GTK_IS_WINDOW (root) ? root : NULL);
+  g_signal_group_set_target (self->toplevel_signals,
+                             gtk_native_get_surface (gtk_widget_get_native (widget)));
+}
+
+static void
+mks_display_picture_unrealize (GtkWidget *widget)
+{
+  MksDisplayPicture *self = (MksDisplayPicture *)widget;
+
+  g_assert (MKS_IS_DISPLAY_PICTURE (self));
+
+  g_signal_group_set_target (self->window_signals, NULL);
+  g_signal_group_set_target (self->toplevel_signals, NULL);
+  g_clear_handle_id (&self->throttle_source, g_source_remove);
+
+  GTK_WIDGET_CLASS (mks_display_picture_parent_class)->unrealize (widget);
+}
+
+static void
+mks_display_picture_map (GtkWidget *widget)
+{
+  MksDisplayPicture *self = (MksDisplayPicture *)widget;
+
+  g_assert (MKS_IS_DISPLAY_PICTURE (self));
+
+  GTK_WIDGET_CLASS (mks_display_picture_parent_class)->map (widget);
+
+  mks_display_picture_update_shown (self);
+}
+
+static void
+mks_display_picture_unmap (GtkWidget *widget)
+{
+  MksDisplayPicture *self = (MksDisplayPicture *)widget;
+
+  g_assert (MKS_IS_DISPLAY_PICTURE (self));
+
+  GTK_WIDGET_CLASS (mks_display_picture_parent_class)->unmap (widget);
+
+  mks_display_picture_update_shown (self);
 }
 
 static void
@@ -520,6 +802,9 @@ mks_display_picture_dispose (GObject *object)
 {
   MksDisplayPicture *self = (MksDisplayPicture *)object;
 
+  g_clear_handle_id (&self->throttle_source, g_source_remove);
+  g_clear_object (&self->window_signals);
+  g_clear_object (&self->toplevel_signals);
   g_clear_object (&self->paintable);
   g_clear_object (&self->keyboard);
   g_clear_object (&self->mouse);
@@ -555,6 +840,18 @@ mks_display_picture_get_property (GObject    *object,
       g_value_set_object (value, mks_display_picture_get_paintable (self));
       break;
 
+    case PROP_MAX_FPS:
+      g_value_set_uint (value, mks_display_picture_get_max_fps (self));
+      break;
+
+    case PROP_ADAPTIVE_FPS:
+      g_value_set_boolean (value, mks_display_picture_get_adaptive_fps (self));
+      break;
+
+    case PROP_SHOWN:
+      g_value_set_boolean (value, mks_display_picture_get_shown (self));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -586,6 +883,14 @@ mks_display_picture_set_property (GObject      *object,
       mks_display_picture_set_paintable (self, g_value_get_object (value));
       break;
 
+    case PROP_MAX_FPS:
+      mks_display_picture_set_max_fps (self, g_value_get_uint (value));
+      break;
+
+    case PROP_ADAPTIVE_FPS:
+      mks_display_picture_set_adaptive_fps (self, g_value_get_boolean (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -604,6 +909,10 @@ mks_display_picture_class_init (MksDisplayPictureClass *klass)
   widget_class->measure = mks_display_picture_measure;
   widget_class->get_request_mode = mks_display_picture_get_request_mode;
   widget_class->snapshot = mks_display_picture_snapshot;
+  widget_class->realize = mks_display_picture_realize;
+  widget_class->unrealize = mks_display_picture_unrealize;
+  widget_class->map = mks_display_picture_map;
+  widget_class->unmap = mks_display_picture_unmap;
 
   properties[PROP_KEYBOARD] =
     g_param_spec_object ("keyboard", NULL, NULL,
@@ -625,6 +934,21 @@ mks_display_picture_class_init (MksDisplayPictureClass *klass)
                          MKS_TYPE_PAINTABLE,
                          (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
 
+  properties[PROP_MAX_FPS] =
+    g_param_spec_uint ("max-fps", NULL, NULL,
+                       0, 1000, 0,
+                       (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
+  properties[PROP_ADAPTIVE_FPS] =
+    g_param_spec_boolean ("adaptive-fps", NULL, NULL,
+                          FALSE,
+                          (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
+  properties[PROP_SHOWN] =
+    g_param_spec_boolean ("shown", NULL, NULL,
+                          FALSE,
+                          (G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_properties (object_class, N_PROPS, properties);
 }
 
@@ -665,6 +989,25 @@ mks_display_picture_init (MksDisplayPicture *self)
                                  self,
                                  G_CONNECT_SWAPPED);
 
+  self->window_signals = g_signal_group_new (GTK_TYPE_WINDOW);
+  g_signal_group_connect_object (self->window_signals,
+                                 "notify::is-active",
+                                 G_CALLBACK (mks_display_picture_frame_rate_changed_cb),
+                                 self,
+                                 G_CONNECT_SWAPPED);
+
+  self->toplevel_signals = g_signal_group_new (GDK_TYPE_SURFACE);
+  g_signal_group_connect_object (self->toplevel_signals,
+                                 "notify::state",
+                                 G_CALLBACK (mks_display_picture_frame_rate_changed_cb),
+                                 self,
+                                 G_CONNECT_SWAPPED);
+  g_signal_group_connect_object (self->toplevel_signals,
+                                 "notify::state",
+                                 G_CALLBACK (mks_display_picture_toplevel_state_cb),
+                                 self,
+                                 G_CONNECT_SWAPPED);
+
   gtk_widget_set_cursor (GTK_WIDGET (self), gdk_cursor);
   gtk_widget_set_focusable (GTK_WIDGET (self), TRUE);
 }
@@ -692,6 +1035,12 @@ mks_display_picture_set_paintable (MksDisplayPicture *self,
 
   if (g_set_object (&self->paintable, paintable))
     {
+      if (self->presentation_tick != 0)
+        {
+          gtk_widget_remove_tick_callback (GTK_WIDGET (self), self->presentation_tick);
+          self->presentation_tick = 0;
+        }
+
       g_signal_group_set_target (self->paintable_signals, paintable);
       mks_display_picture_sync_cursor (self);
       g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_PAINTABLE]);
@@ -755,3 +1104,64 @@ mks_display_picture_set_touchable (MksDisplayPicture *self,
   if (g_set_object (&self->touchable, touchable))
     g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_TOUCHABLE]);
 }
+
+guint
+mks_display_picture_get_max_fps (MksDisplayPicture *self)
+{
+  g_return_val_if_fail (MKS_IS_DISPLAY_PICTURE (self), 0);
+
+  return self->max_fps;
+}
+
+void
+mks_display_picture_set_max_fps (MksDisplayPicture *self,
+                                 guint              max_fps)
+{
+  g_return_if_fail (MKS_IS_DISPLAY_PICTURE (self));
+
+  if (self->max_fps != max_fps)
+    {
+      self->max_fps = max_fps;
+      mks_display_picture_reset_throttle (self);
+      g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_MAX_FPS]);
+    }
+}
+
+gboolean
+mks_display_picture_get_adaptive_fps (MksDisplayPicture *self)
+{
+  g_return_val_if_fail (MKS_IS_DISPLAY_PICTURE (self), FALSE);
+
+  return self->adaptive_fps;
+}
+
+void
+mks_display_picture_set_adaptive_fps (MksDisplayPicture *self,
+                                      gboolean           adaptive_fps)
+{
+  g_return_if_fail (MKS_IS_DISPLAY_PICTURE (self));
+
+  adaptive_fps = !!adaptive_fps;
+
+  if (self->adaptive_fps != adaptive_fps)
+    {
+      self->adaptive_fps = adaptive_fps;
+      mks_display_picture_reset_throttle (self);
+      g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_ADAPTIVE_FPS]);
+    }
+}
+
+/*
+ * mks_display_picture_get_shown:
+ *
+ * Gets whether @self may currently be seen by the user. This is %FALSE
+ * while unmapped, such as in a hidden tab, and while the toplevel is
+ * minimized or suspended by the compositor.
+ */
+gboolean
+mks_display_picture_get_shown (MksDisplayPicture *self)
+{
+  g_return_val_if_fail (MKS_IS_DISPLAY_PICTURE (self), FALSE);
+
+  return self->shown;
+}
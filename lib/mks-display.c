@@ -25,6 +25,7 @@
 #include "mks-css-private.h"
 #include "mks-display.h"
 #include "mks-display-picture-private.h"
+#include "mks-frame-stats.h"
 #include "mks-inhibitor-private.h"
 #include "mks-keyboard.h"
 #include "mks-mouse.h"
@@ -44,7 +45,16 @@ typedef struct
   MksInhibitor       *inhibitor;
   GtkWidget          *offload;
   GtkShortcutTrigger *ungrab_trigger;
+  GSignalGroup       *frame_stats_signals;
+
+  /* Reports to @screen whether @picture can be seen, along with the
+   * paintable it was added for.
+   */
+  MksScreenView      *view;
+  GdkPaintable       *viewed;
+
   guint               auto_resize : 1;
+  guint               show_frame_stats : 1;
 } MksDisplayPrivate;
 
 enum {
@@ -52,6 +62,9 @@ enum {
   PROP_SCREEN,
   PROP_UNGRAB_TRIGGER,
   PROP_AUTO_RESIZE,
+  PROP_MAX_FPS,
+  PROP_ADAPTIVE_FPS,
+  PROP_FRAME_STATS,
   N_PROPS
 };
 
@@ -99,6 +112,112 @@ mks_display_get_paintable_area (MksDisplay      *self,
   *area = GRAPHENE_RECT_INIT (x, y, w, h);
 }
 
+static void
+mks_display_snapshot_frame_stats (MksDisplay    *self,
+                                  GtkSnapshot   *snapshot,
+                                  MksFrameStats *frame_stats)
+{
+  g_autoptr(PangoLayout) layout = NULL;
+  g_autofree char *text = NULL;
+  PangoRectangle extents;
+
+  g_assert (MKS_IS_DISPLAY (self));
+  g_assert (GTK_IS_SNAPSHOT (snapshot));
+  g_assert (MKS_IS_FRAME_STATS (frame_stats));
+
+  text = g_strdup_printf ("%.1f fps, %.1f updates/s\n"
+                          "%u coalesced, %u dropped\n"
+                          "%.2f MiB/s, rebuild %.2f ms\n"
+                          "latency p50 %.2f ms, p99 %.2f ms",
+                          mks_frame_stats_get_fps (frame_stats),
+                          mks_frame_stats_get_updates_per_second (frame_stats),
+                          mks_frame_stats_get_coalesced_updates (frame_stats),
+                          mks_frame_stats_get_dropped_frames (frame_stats),
+                          mks_frame_stats_get_bytes_per_second (frame_stats) / (1024. * 1024.),
+                          mks_frame_stats_get_rebuild_time (frame_stats) / 1000.,
+                          mks_frame_stats_get_latency_p50 (frame_stats) / 1000.,
+                          mks_frame_stats_get_latency_p99 (frame_stats) / 1000.);
+
+  layout = gtk_widget_create_pango_layout (GTK_WIDGET (self), text);
+  pango_layout_get_pixel_extents (layout, NULL, &extents);
+
+  gtk_snapshot_append_color (snapshot,
+                             &(GdkRGBA) { 0, 0, 0, .6 },
+                             &GRAPHENE_RECT_INIT (0, 0, extents.width + 12, extents.height + 12));
+  gtk_snapshot_save (snapshot);
+  gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (6, 6));
+  gtk_snapshot_append_layout (snapshot, layout, &(GdkRGBA) { 1, 1, 1, 1 });
+  gtk_snapshot_restore (snapshot);
+}
+
+/* Keeps the screen informed of whether the paintable is visible so that
+ * it may stop receiving updates while the display is in a hidden tab or
+ * a minimized window.
+ */
+static void
+mks_display_update_view (MksDisplay *self)
+{
+  MksDisplayPrivate *priv = mks_display_get_instance_private (self);
+  GdkPaintable *paintable = NULL;
+  gboolean shown = FALSE;
+
+  g_assert (MKS_IS_DISPLAY (self));
+
+  if (priv->screen != NULL && priv->picture != NULL)
+    {
+      paintable = GDK_PAINTABLE (mks_display_picture_get_paintable (priv->picture));
+      shown = mks_display_picture_get_shown (priv->picture);
+    }
+
+  if (priv->viewed != paintable)
+    {
+      g_clear_pointer (&priv->view, mks_screen_view_unref);
+      priv->viewed = NULL;
+    }
+
+  /* Until the picture is shown once it is usually still being set up, so
+   * it is not reported before then to avoid suspending and resuming the
+   * screen right away.
+   */
+  if (priv->view != NULL)
+    mks_screen_view_set_shown (priv->view, shown);
+  else if (paintable != NULL && shown)
+    {
+      priv->view = mks_screen_add_view (priv->screen, paintable, TRUE);
+      priv->viewed = paintable;
+    }
+}
+
+static void
+mks_display_notify_shown_cb (MksDisplay        *self,
+                             GParamSpec        *pspec,
+                             MksDisplayPicture *picture)
+{
+  g_assert (MKS_IS_DISPLAY (self));
+  g_assert (MKS_IS_DISPLAY_PICTURE (picture));
+
+  mks_display_update_view (self);
+}
+
+static void
+mks_display_notify_paintable_cb (MksDisplay        *self,
+                                 GParamSpec        *pspec,
+                                 MksDisplayPicture *picture)
+{
+  MksDisplayPrivate *priv = mks_display_get_instance_private (self);
+
+  g_assert (MKS_IS_DISPLAY (self));
+  g_assert (MKS_IS_DISPLAY_PICTURE (picture));
+
+  mks_display_update_view (self);
+
+  if (priv->frame_stats_signals != NULL)
+    g_signal_group_set_target (priv->frame_stats_signals,
+                               mks_display_get_frame_stats (self));
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_FRAME_STATS]);
+}
+
 static DexFuture *
 mks_display_attach_cb (DexFuture *future,
                        gpointer   user_data)
@@ -155,6 +274,7 @@ mks_display_disconnect (MksDisplay *self)
   g_assert (MKS_IS_DISPLAY (self));
 
   g_clear_object (&priv->screen);
+  mks_display_update_view (self);
   mks_screen_resizer_set_screen (priv->resizer, NULL);
   g_clear_object (&priv->inhibitor);
 
@@ -226,6 +346,7 @@ mks_display_dispose (GObject *object)
 
   g_clear_pointer (&priv->offload, gtk_widget_unparent);
   g_clear_object (&priv->resizer);
+  g_clear_object (&priv->frame_stats_signals);
 
   G_OBJECT_CLASS (mks_display_parent_class)->dispose (object);
 }
@@ -240,6 +361,22 @@ mks_display_grab_focus (GtkWidget *widget)
   return gtk_widget_grab_focus (GTK_WIDGET (priv->picture));
 }
 
+static void
+mks_display_snapshot (GtkWidget   *widget,
+                      GtkSnapshot *snapshot)
+{
+  MksDisplay *self = (MksDisplay *)widget;
+  MksDisplayPrivate *priv = mks_display_get_instance_private (self);
+  MksFrameStats *frame_stats;
+
+  g_assert (MKS_IS_DISPLAY (self));
+
+  GTK_WIDGET_CLASS (mks_display_parent_class)->snapshot (widget, snapshot);
+
+  if (priv->show_frame_stats && (frame_stats = mks_display_get_frame_stats (self)))
+    mks_display_snapshot_frame_stats (self, snapshot, frame_stats);
+}
+
 static GtkSizeRequestMode
 mks_display_get_request_mode (GtkWidget *widget)
 {
@@ -324,6 +461,18 @@ mks_display_get_property (GObject    *object,
       g_value_set_boolean (value, mks_display_get_auto_resize (self));
       break;
 
+    case PROP_MAX_FPS:
+      g_value_set_uint (value, mks_display_get_max_fps (self));
+      break;
+
+    case PROP_ADAPTIVE_FPS:
+      g_value_set_boolean (value, mks_display_get_adaptive_fps (self));
+      break;
+
+    case PROP_FRAME_STATS:
+      g_value_set_object (value, mks_display_get_frame_stats (self));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -351,6 +500,14 @@ mks_display_set_property (GObject      *object,
       mks_display_set_auto_resize (self, g_value_get_boolean (value));
       break;
 
+    case PROP_MAX_FPS:
+      mks_display_set_max_fps (self, g_value_get_uint (value));
+      break;
+
+    case PROP_ADAPTIVE_FPS:
+      mks_display_set_adaptive_fps (self, g_value_get_boolean (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -369,6 +526,7 @@ mks_display_class_init (MksDisplayClass *klass)
   widget_class->get_request_mode = mks_display_get_request_mode;
   widget_class->measure = mks_display_measure;
   widget_class->size_allocate = mks_display_size_allocate;
+  widget_class->snapshot = mks_display_snapshot;
   widget_class->grab_focus = mks_display_grab_focus;
 
   properties[PROP_SCREEN] =
@@ -386,6 +544,42 @@ mks_display_class_init (MksDisplayClass *klass)
                           TRUE,
                           (G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * MksDisplay:max-fps:
+   *
+   * The maximum number of frames per second to draw, or 0 to draw
+   * every time the guest updates the screen.
+   *
+   * Updates arriving faster than this are coalesced into the next
+   * frame so no content is lost.
+   */
+  properties [PROP_MAX_FPS] =
+    g_param_spec_uint ("max-fps", NULL, NULL,
+                       0, 1000, 0,
+                       (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * MksDisplay:adaptive-fps:
+   *
+   * Whether to lower the frame rate while the window is not focused,
+   * and further while it is minimized or suspended by the compositor.
+   */
+  properties [PROP_ADAPTIVE_FPS] =
+    g_param_spec_boolean ("adaptive-fps", NULL, NULL,
+                          FALSE,
+                          (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * MksDisplay:frame-stats:
+   *
+   * Statistics for the screen being displayed, or %NULL until the
+   * screen has been attached.
+   */
+  properties [PROP_FRAME_STATS] =
+    g_param_spec_object ("frame-stats", NULL, NULL,
+                         MKS_TYPE_FRAME_STATS,
+                         (G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_properties (object_class, N_PROPS, properties);
 
   gtk_widget_class_set_css_name (widget_class, "MksDisplay");
@@ -402,6 +596,28 @@ mks_display_init (MksDisplay *self)
   priv->picture = g_object_new (MKS_TYPE_DISPLAY_PICTURE, NULL);
   priv->resizer = mks_screen_resizer_new ();
 
+  g_signal_connect_object (priv->picture,
+                           "notify::paintable",
+                           G_CALLBACK (mks_display_notify_paintable_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+  g_signal_connect_object (priv->picture,
+                           "notify::shown",
+                           G_CALLBACK (mks_display_notify_shown_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+
+  if (mks_get_debug_flags () & MKS_DEBUG_FRAME_STATS)
+    {
+      priv->show_frame_stats = TRUE;
+      priv->frame_stats_signals = g_signal_group_new (MKS_TYPE_FRAME_STATS);
+      g_signal_group_connect_object (priv->frame_stats_signals,
+                                     "notify",
+                                     G_CALLBACK (gtk_widget_queue_draw),
+                                     self,
+                                     G_CONNECT_SWAPPED);
+    }
+
   priv->offload = gtk_graphics_offload_new (GTK_WIDGET (priv->picture));
   gtk_widget_set_parent (priv->offload, GTK_WIDGET (self));
 
@@ -503,6 +719,110 @@ mks_display_set_auto_resize (MksDisplay *self,
     }
 }
 
+/**
+ * mks_display_get_max_fps:
+ * @self: A `MksDisplay`
+ *
+ * Gets the maximum frame rate, or 0 if unlimited.
+ */
+guint
+mks_display_get_max_fps (MksDisplay *self)
+{
+  MksDisplayPrivate *priv = mks_display_get_instance_private (self);
+
+  g_return_val_if_fail (MKS_IS_DISPLAY (self), 0);
+
+  return mks_display_picture_get_max_fps (priv->picture);
+}
+
+/**
+ * mks_display_set_max_fps:
+ * @self: A `MksDisplay`
+ * @max_fps: the maximum frames per second, or 0
+ *
+ * Limits how often the display is redrawn when the guest updates
+ * the screen. Use 0 to redraw for every update.
+ */
+void
+mks_display_set_max_fps (MksDisplay *self,
+                         guint       max_fps)
+{
+  MksDisplayPrivate *priv = mks_display_get_instance_private (self);
+
+  g_return_if_fail (MKS_IS_DISPLAY (self));
+
+  if (max_fps != mks_display_picture_get_max_fps (priv->picture))
+    {
+      mks_display_picture_set_max_fps (priv->picture, max_fps);
+      g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_MAX_FPS]);
+    }
+}
+
+/**
+ * mks_display_get_adaptive_fps:
+ * @self: A `MksDisplay`
+ *
+ * Gets whether the frame rate is lowered while the window is
+ * unfocused or hidden.
+ */
+gboolean
+mks_display_get_adaptive_fps (MksDisplay *self)
+{
+  MksDisplayPrivate *priv = mks_display_get_instance_private (self);
+
+  g_return_val_if_fail (MKS_IS_DISPLAY (self), FALSE);
+
+  return mks_display_picture_get_adaptive_fps (priv->picture);
+}
+
+/**
+ * mks_display_set_adaptive_fps:
+ * @self: A `MksDisplay`
+ * @adaptive_fps: Whether to adapt the frame rate
+ *
+ * Sets whether the frame rate should be lowered while the window
+ * is unfocused or hidden.
+ */
+void
+mks_display_set_adaptive_fps (MksDisplay *self,
+                              gboolean    adaptive_fps)
+{
+  MksDisplayPrivate *priv = mks_display_get_instance_private (self);
+
+  g_return_if_fail (MKS_IS_DISPLAY (self));
+
+  adaptive_fps = !!adaptive_fps;
+
+  if (adaptive_fps != mks_display_picture_get_adaptive_fps (priv->picture))
+    {
+      mks_display_picture_set_adaptive_fps (priv->picture, adaptive_fps);
+      g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_ADAPTIVE_FPS]);
+    }
+}
+
+/**
+ * mks_display_get_frame_stats:
+ * @self: A `MksDisplay`
+ *
+ * Gets the statistics for the screen being displayed.
+ *
+ * Returns: (transfer none) (nullable): a #MksFrameStats or %NULL
+ */
+MksFrameStats *
+mks_display_get_frame_stats (MksDisplay *self)
+{
+  MksDisplayPrivate *priv = mks_display_get_instance_private (self);
+  MksPaintable *paintable;
+
+  g_return_val_if_fail (MKS_IS_DISPLAY (self), NULL);
+
+  if (priv->picture == NULL ||
+      !(paintable = mks_display_picture_get_paintable (priv->picture)))
+    return NULL;
+
+  return _mks_paintable_get_frame_stats (paintable);
+}
+
 /**
  * mks_display_get_ungrab_trigger:
  * @self: a #MksDisplay
@@ -58,6 +58,18 @@ MKS_AVAILABLE_IN_ALL
 void                mks_display_set_auto_resize             (MksDisplay         *self,
                                                              gboolean            auto_resize);
 MKS_AVAILABLE_IN_ALL
+guint               mks_display_get_max_fps                 (MksDisplay         *self);
+MKS_AVAILABLE_IN_ALL
+void                mks_display_set_max_fps                 (MksDisplay         *self,
+                                                             guint               max_fps);
+MKS_AVAILABLE_IN_ALL
+gboolean            mks_display_get_adaptive_fps            (MksDisplay         *self);
+MKS_AVAILABLE_IN_ALL
+void                mks_display_set_adaptive_fps            (MksDisplay         *self,
+                                                             gboolean            adaptive_fps);
+MKS_AVAILABLE_IN_ALL
+MksFrameStats      *mks_display_get_frame_stats             (MksDisplay         *self);
+MKS_AVAILABLE_IN_ALL
 gboolean            mks_display_get_event_position_in_guest (MksDisplay         *self,
                                                              GdkEvent           *event,
                                                              double             *guest_x,
@@ -0,0 +1,96 @@
+/* mks-dmabuf-map-private.h
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+#pragma once
+
+#include <gio/gio.h>
+
+#include "mks-pixels-private.h"
+
+G_BEGIN_DECLS
+
+/* The most planes of any format mks_dmabuf_map_begin() can read */
+#define MKS_DMABUF_MAP_MAX_PLANES 3
+
+/* A DMA-BUF scanout as described by QEMU */
+typedef struct _MksDmabufScanout
+{
+  int     fd[MKS_DMABUF_MAP_MAX_PLANES];
+  guint   offset[MKS_DMABUF_MAP_MAX_PLANES];
+  guint   stride[MKS_DMABUF_MAP_MAX_PLANES];
+  guint   n_planes;
+  guint   x;
+  guint   y;
+  guint   width;
+  guint   height;
+  guint   fourcc;
+  guint   backing_height;
+  guint64 modifier;
+  guint   y0_top : 1;
+} MksDmabufScanout;
+
+/* A CPU mapping of a MksDmabufScanout, valid until mks_dmabuf_map_end().
+ * YUV formats have no pixman format and only the first plane in @data,
+ * use mks_dmabuf_map_convert() to read them.
+ */
+typedef struct _MksDmabufMap
+{
+  const guint8           *data;
+  gsize                   stride;
+  guint                   pixman_format;
+  guint                   bpp;
+
+  /*< private >*/
+  const MksDmabufScanout *scanout;
+  const guint8           *planes[MKS_DMABUF_MAP_MAX_PLANES];
+  gsize                   strides[MKS_DMABUF_MAP_MAX_PLANES];
+  void                   *map[MKS_DMABUF_MAP_MAX_PLANES];
+  gsize                   length[MKS_DMABUF_MAP_MAX_PLANES];
+  MksPixelsYuv            yuv_layout;
+} MksDmabufMap;
+
+guint     mks_dmabuf_fourcc_to_pixman_format (guint                    fourcc);
+gboolean  mks_dmabuf_map_begin               (MksDmabufMap            *map,
+                                              const MksDmabufScanout  *scanout,
+                                              GError                 **error);
+void      mks_dmabuf_map_convert             (const MksDmabufMap      *map,
+                                              guint                    x,
+                                              guint                    y,
+                                              guint                    width,
+                                              guint                    height,
+                                              guint8                  *dst,
+                                              gsize                    dst_stride);
+void      mks_dmabuf_map_end                 (MksDmabufMap            *map);
+void      mks_dmabuf_scanout_clear           (MksDmabufScanout        *scanout);
+
+/* Gets the row @y of the scanout, taking y0_top into account */
+static inline const guint8 *
+mks_dmabuf_map_get_row (const MksDmabufMap *map,
+                        guint               y)
+{
+  guint row = map->scanout->y + y;
+
+  /* Rows are stored bottom-up when y0 is at the top */
+  if (map->scanout->y0_top)
+    row = map->scanout->backing_height - 1 - row;
+
+  return map->data + (gsize)row * map->stride + (gsize)map->scanout->x * map->bpp;
+}
+
+G_END_DECLS
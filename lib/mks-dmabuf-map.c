@@ -0,0 +1,356 @@
+/* mks-dmabuf-map.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#ifdef __linux__
+# include <linux/dma-buf.h>
+#endif
+
+#include <glib/gstdio.h>
+#include <pixman.h>
+
+#include "mks-dmabuf-map-private.h"
+#include "mks-pixels-private.h"
+
+#define DRM_FOURCC(a, b, c, d) \
+  ((guint)(a) | ((guint)(b) << 8) | ((guint)(c) << 16) | ((guint)(d) << 24))
+#define DRM_FORMAT_MOD_LINEAR 0
+
+/*
+ * mks_dmabuf_fourcc_to_pixman_format:
+ * @fourcc: a DRM fourcc
+ *
+ * Returns: the matching pixman format, or 0 if there is none
+ */
+guint
+mks_dmabuf_fourcc_to_pixman_format (guint fourcc)
+{
+  switch (fourcc)
+    {
+    case DRM_FOURCC ('X', 'R', '2', '4'):
+      return PIXMAN_x8r8g8b8;
+
+    case DRM_FOURCC ('A', 'R', '2', '4'):
+      return PIXMAN_a8r8g8b8;
+
+    case DRM_FOURCC ('X', 'B', '2', '4'):
+      return PIXMAN_x8b8g8r8;
+
+    case DRM_FOURCC ('A', 'B', '2', '4'):
+      return PIXMAN_a8b8g8r8;
+
+    case DRM_FOURCC ('X', 'R', '3', '0'):
+      return PIXMAN_x2r10g10b10;
+
+    case DRM_FOURCC ('R', 'G', '1', '6'):
+      return PIXMAN_r5g6b5;
+
+    default:
+      return 0;
+    }
+}
+
+static gboolean
+mks_dmabuf_fourcc_to_yuv_layout (guint         fourcc,
+                                 MksPixelsYuv *layout,
+                                 gboolean     *swap_uv)
+{
+  switch (fourcc)
+    {
+    case DRM_FOURCC ('N', 'V', '1', '2'):
+      *layout = MKS_PIXELS_NV12;
+      *swap_uv = FALSE;
+      return TRUE;
+
+    case DRM_FOURCC ('Y', 'U', '1', '2'):
+      *layout = MKS_PIXELS_I420;
+      *swap_uv = FALSE;
+      return TRUE;
+
+    /* YVU420 only differs by the order of the chroma planes */
+    case DRM_FOURCC ('Y', 'V', '1', '2'):
+      *layout = MKS_PIXELS_I420;
+      *swap_uv = TRUE;
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
+#ifdef __linux__
+static void
+mks_dmabuf_sync (int   fd,
+                 guint flags)
+{
+  struct dma_buf_sync sync = { .flags = flags | DMA_BUF_SYNC_READ };
+
+  /* Failing to sync is not fatal, the buffer may not be backed by a
+   * device which requires it.
+   */
+  while (ioctl (fd, DMA_BUF_IOCTL_SYNC, &sync) == -1 && errno == EINTR) {}
+}
+#endif
+
+/*
+ * mks_dmabuf_map_begin:
+ * @map: (out caller-allocates): location for the mapping
+ * @scanout: the scanout to map
+ *
+ * Maps each plane of @scanout for reading by the CPU and starts a read
+ * access so that the contents are coherent with what the device wrote.
+ *
+ * Only linear buffers in a format mks_pixels_convert_rows() understands,
+ * or in NV12, YUV420 or YVU420, can be mapped.
+ *
+ * @scanout must remain valid until mks_dmabuf_map_end() is called.
+ */
+gboolean
+mks_dmabuf_map_begin (MksDmabufMap            *map,
+                      const MksDmabufScanout  *scanout,
+                      GError                 **error)
+{
+#ifdef __linux__
+  MksPixelsYuv yuv_layout = MKS_PIXELS_NV12;
+  gboolean swap_uv = FALSE;
+  guint pixman_format;
+  guint n_planes;
+  gsize chroma_bytes;
+  gsize bpp;
+
+  g_assert (map != NULL);
+  g_assert (scanout != NULL);
+
+  memset (map, 0, sizeof *map);
+
+  pixman_format = mks_dmabuf_fourcc_to_pixman_format (scanout->fourcc);
+
+  if (pixman_format != 0 && mks_pixels_can_convert (pixman_format))
+    n_planes = 1;
+  else if (mks_dmabuf_fourcc_to_yuv_layout (scanout->fourcc, &yuv_layout, &swap_uv))
+    n_planes = yuv_layout == MKS_PIXELS_NV12 ? 2 : 3;
+  else
+    n_planes = 0;
+
+  if (scanout->modifier != DRM_FORMAT_MOD_LINEAR || n_planes == 0)
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_NOT_SUPPORTED,
+                   "Cannot read DMA-BUF with fourcc=0x%x modifier=0x%" G_GINT64_MODIFIER "x",
+                   scanout->fourcc,
+                   scanout->modifier);
+      return FALSE;
+    }
+
+  if (scanout->n_planes != n_planes)
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_INVALID_DATA,
+                   "DMA-BUF with fourcc=0x%x has %u planes instead of %u",
+                   scanout->fourcc,
+                   scanout->n_planes,
+                   n_planes);
+      return FALSE;
+    }
+
+  /* YUV has a byte of luma per pixel and a chroma sample for every two,
+   * which NV12 interleaves into two bytes.
+   */
+  bpp = n_planes == 1 ? PIXMAN_FORMAT_BPP (pixman_format) / 8 : 1;
+  chroma_bytes = (gsize)(scanout->x + scanout->width + 1) / 2;
+  if (yuv_layout == MKS_PIXELS_NV12)
+    chroma_bytes *= 2;
+
+  if ((gsize)(scanout->x + scanout->width) * bpp > scanout->stride[0] ||
+      (n_planes > 1 && chroma_bytes > scanout->stride[1]) ||
+      (n_planes > 2 && chroma_bytes > scanout->stride[2]) ||
+      scanout->y + scanout->height > scanout->backing_height)
+    {
+      g_set_error_literal (error,
+                           G_IO_ERROR,
+                           G_IO_ERROR_INVALID_DATA,
+                           "DMA-BUF scanout is larger than its backing");
+      return FALSE;
+    }
+
+  map->scanout = scanout;
+
+  for (guint i = 0; i < n_planes; i++)
+    {
+      guint plane_height = i == 0 ? scanout->backing_height : (scanout->backing_height + 1) / 2;
+      gsize length = scanout->offset[i] + (gsize)scanout->stride[i] * plane_height;
+      void *data;
+
+      g_assert (scanout->fd[i] != -1);
+
+      data = mmap (NULL, length, PROT_READ, MAP_SHARED, scanout->fd[i], 0);
+
+      if (data == MAP_FAILED)
+        {
+          int errsv = errno;
+
+          mks_dmabuf_map_end (map);
+          g_set_error (error,
+                       G_IO_ERROR,
+                       g_io_error_from_errno (errsv),
+                       "Failed to map DMA-BUF: %s",
+                       g_strerror (errsv));
+          return FALSE;
+        }
+
+      mks_dmabuf_sync (scanout->fd[i], DMA_BUF_SYNC_START);
+
+      map->map[i] = data;
+      map->length[i] = length;
+      map->planes[i] = (const guint8 *)data + scanout->offset[i];
+      map->strides[i] = scanout->stride[i];
+    }
+
+  if (swap_uv)
+    {
+      const guint8 *plane = map->planes[1];
+      gsize stride = map->strides[1];
+
+      map->planes[1] = map->planes[2];
+      map->strides[1] = map->strides[2];
+      map->planes[2] = plane;
+      map->strides[2] = stride;
+    }
+
+  map->data = map->planes[0];
+  map->stride = map->strides[0];
+  map->pixman_format = n_planes == 1 ? pixman_format : 0;
+  map->bpp = n_planes == 1 ? bpp : 0;
+  map->yuv_layout = yuv_layout;
+
+  return TRUE;
+#else
+  g_set_error_literal (error,
+                       G_IO_ERROR,
+                       G_IO_ERROR_NOT_SUPPORTED,
+                       "Reading DMA-BUF is not supported on this platform");
+  return FALSE;
+#endif
+}
+
+/*
+ * mks_dmabuf_map_convert:
+ * @map: a mapping from mks_dmabuf_map_begin()
+ * @x: the X position within the scanout
+ * @y: the Y position within the scanout, with 0 at the top
+ * @dst: the destination for @width by @height ARGB32 pixels
+ *
+ * Converts an area of the scanout into native-endian ARGB32 the right
+ * way up, whatever the format and y0_top of the scanout. Only the rows
+ * and columns of the area are read, including for YUV formats.
+ */
+void
+mks_dmabuf_map_convert (const MksDmabufMap *map,
+                        guint               x,
+                        guint               y,
+                        guint               width,
+                        guint               height,
+                        guint8             *dst,
+                        gsize               dst_stride)
+{
+  const MksDmabufScanout *scanout;
+  const guint8 *planes[MKS_DMABUF_MAP_MAX_PLANES];
+  guint n_rows;
+
+  g_assert (map != NULL);
+  g_assert (map->scanout != NULL);
+  g_assert (x + width <= map->scanout->width);
+  g_assert (y + height <= map->scanout->height);
+
+  scanout = map->scanout;
+  memcpy (planes, map->planes, sizeof planes);
+
+  /* Upside down rows are converted one at a time */
+  n_rows = scanout->y0_top ? 1 : height;
+
+  for (guint i = 0; i < height; i += n_rows)
+    {
+      guint row = scanout->y + y + i;
+
+      if (scanout->y0_top)
+        row = scanout->backing_height - 1 - row;
+
+      if (map->pixman_format != 0)
+        mks_pixels_convert_rows (map->pixman_format,
+                                 &dst[i * dst_stride],
+                                 dst_stride,
+                                 map->data + (gsize)row * map->stride + (gsize)(scanout->x + x) * map->bpp,
+                                 map->stride,
+                                 width,
+                                 n_rows);
+      else
+        mks_pixels_convert_yuv_rows (map->yuv_layout,
+                                     &dst[i * dst_stride],
+                                     dst_stride,
+                                     planes,
+                                     map->strides,
+                                     scanout->x + x,
+                                     row,
+                                     width,
+                                     n_rows);
+    }
+}
+
+void
+mks_dmabuf_map_end (MksDmabufMap *map)
+{
+  g_assert (map != NULL);
+
+#ifdef __linux__
+  for (guint i = 0; i < G_N_ELEMENTS (map->map); i++)
+    {
+      if (map->map[i] != NULL)
+        {
+          mks_dmabuf_sync (map->scanout->fd[i], DMA_BUF_SYNC_END);
+          munmap (map->map[i], map->length[i]);
+        }
+    }
+#endif
+
+  memset (map, 0, sizeof *map);
+}
+
+/*
+ * mks_dmabuf_scanout_clear:
+ *
+ * Closes the file-descriptor of each plane of @scanout.
+ */
+void
+mks_dmabuf_scanout_clear (MksDmabufScanout *scanout)
+{
+  g_assert (scanout != NULL);
+
+  for (guint i = 0; i < scanout->n_planes; i++)
+    g_clear_fd (&scanout->fd[i], NULL);
+
+  scanout->n_planes = 0;
+}
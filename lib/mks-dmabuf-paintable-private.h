@@ -22,6 +22,8 @@
 
 #include <gdk/gdk.h>
 
+#include "mks-frame-stats.h"
+
 G_BEGIN_DECLS
 
 #define MKS_DMABUF_MAX_PLANES 4
@@ -40,6 +42,10 @@ typedef struct _MksDmabufScanoutData
   guint   stride[MKS_DMABUF_MAX_PLANES];
   guint64 modifier;
   int     dmabuf_fd[MKS_DMABUF_MAX_PLANES];
+  /* Changes with every ScanoutDMABUF so that UpdateDMABUF can tell
+   * whether the buffer is still the one the builder was set up for.
+   */
+  guint   generation;
 } MksDmabufScanoutData;
 
 void mks_dmabuf_scanout_data_free (MksDmabufScanoutData *data);
@@ -50,11 +56,12 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC (MksDmabufScanoutData, mks_dmabuf_scanout_data_fre
 
 G_DECLARE_FINAL_TYPE (MksDmabufPaintable, mks_dmabuf_paintable, MKS, DMABUF_PAINTABLE, GObject)
 
-MksDmabufPaintable *mks_dmabuf_paintable_new    (void);
-gboolean            mks_dmabuf_paintable_import (MksDmabufPaintable    *self,
-                                                 GdkDisplay            *display,
-                                                 MksDmabufScanoutData  *data,
-                                                 cairo_region_t        *region,
-                                                 GError               **error);
+MksDmabufPaintable *mks_dmabuf_paintable_new      (void);
+gboolean            mks_dmabuf_paintable_import   (MksDmabufPaintable           *self,
+                                                   GdkDisplay                   *display,
+                                                   MksDmabufScanoutData         *data,
+                                                   const cairo_rectangle_int_t  *area,
+                                                   GError                      **error);
+MksDmabufPath       mks_dmabuf_paintable_get_path (MksDmabufPaintable           *self);
 
 G_END_DECLS
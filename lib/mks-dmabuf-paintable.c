@@ -27,6 +27,8 @@
 #include <glib-unix.h>
 #include <gtk/gtk.h>
 
+#include "mks-damage-private.h"
+#include "mks-dmabuf-map-private.h"
 #include "mks-dmabuf-paintable-private.h"
 #include "mks-util-private.h"
 
@@ -36,6 +38,19 @@
  *
  * The scanout data is then stored until we receive a `UpdateDMABUF` call
  * so we can pass the damage region to `GdkDmabufTextureBuilder`.
+ *
+ * The builder and its duplicated fds are kept for as long as the scanout
+ * generation stays the same. Textures share the duplicated fds through a
+ * reference so that updates only need to change the update region.
+ *
+ * Damage from `UpdateDMABUF` is accumulated into a fixed-size
+ * rectangle list and only turned into a region once per texture.
+ *
+ * When the texture cannot be imported, such as with the software renderer
+ * or without a GPU, linear buffers are mapped instead and the damaged area
+ * is converted into a memory texture. That includes planar YUV from guest
+ * video. It lasts for the rest of the life of the paintable, or always
+ * when MKS_DEBUG=dmabuf-cpu is set.
  */
 
 struct _MksDmabufPaintable
@@ -44,12 +59,22 @@ struct _MksDmabufPaintable
   GdkTexture              *texture;
   GdkDmabufTextureBuilder *builder;
   MksDmabufScanoutData    *builder_data;
+  guint                    builder_generation;
+  MksDamage                damage;
+  gint64                   stats_begin;
+  guint                    stats_updates;
+  guint                    stats_fd_dups;
   guint                    x;
   guint                    y;
   guint                    width;
   guint                    height;
   guint                    backing_width;
   guint                    backing_height;
+
+  /* ARGB32 copy of the buffer used by MKS_DMABUF_PATH_CPU */
+  GBytes                  *cpu_pixels;
+
+  MksDmabufPath            path : 2;
   guint                    dmabuf_updated : 1;
 };
 
@@ -76,6 +101,175 @@ mks_dmabuf_paintable_get_intrinsic_aspect_ratio (GdkPaintable *paintable)
     return 0.;
 }
 
+static void
+mks_dmabuf_builder_data_clear (gpointer data)
+{
+  MksDmabufScanoutData *builder_data = data;
+
+  for (guint i = 0; i < builder_data->n_planes; i++)
+    g_clear_fd (&builder_data->dmabuf_fd[i], NULL);
+}
+
+static void
+mks_dmabuf_builder_data_release (gpointer data)
+{
+  g_atomic_rc_box_release_full (data, mks_dmabuf_builder_data_clear);
+}
+
+static const char *
+mks_dmabuf_path_to_string (MksDmabufPath path)
+{
+  return path == MKS_DMABUF_PATH_CPU ? "cpu" : "gpu";
+}
+
+static void
+mks_dmabuf_paintable_use_cpu (MksDmabufPaintable *self,
+                              const char         *reason)
+{
+  g_assert (MKS_IS_DMABUF_PAINTABLE (self));
+
+  if (self->path == MKS_DMABUF_PATH_CPU)
+    return;
+
+  g_debug ("Reading DMA-BUF with the CPU: %s", reason);
+  MKS_TRACE_MARK ("dmabuf.path", "path=cpu reason=%s", reason);
+
+  self->path = MKS_DMABUF_PATH_CPU;
+}
+
+static GdkTexture *
+mks_dmabuf_paintable_build_gpu (MksDmabufPaintable    *self,
+                                const cairo_region_t  *update_region,
+                                GError               **error)
+{
+  GdkTexture *texture;
+
+  g_assert (MKS_IS_DMABUF_PAINTABLE (self));
+  g_assert (GDK_IS_DMABUF_TEXTURE_BUILDER (self->builder));
+
+  gdk_dmabuf_texture_builder_set_update_texture (self->builder, self->texture);
+  gdk_dmabuf_texture_builder_set_update_region (self->builder, (cairo_region_t *)update_region);
+
+  texture = gdk_dmabuf_texture_builder_build (self->builder,
+                                              mks_dmabuf_builder_data_release,
+                                              g_atomic_rc_box_acquire (self->builder_data),
+                                              error);
+
+  if (texture == NULL)
+    mks_dmabuf_builder_data_release (self->builder_data);
+
+  return texture;
+}
+
+/* Copies @update_region of the buffer, or everything if %NULL, into
+ * @cpu_pixels and wraps that in a memory texture.
+ */
+static GdkTexture *
+mks_dmabuf_paintable_build_cpu (MksDmabufPaintable    *self,
+                                const cairo_region_t  *update_region,
+                                GError               **error)
+{
+  g_autoptr(GdkMemoryTextureBuilder) builder = NULL;
+  MksDmabufScanout scanout;
+  MksDmabufMap map;
+  guint8 *dst;
+  gsize dst_stride;
+  gsize size;
+
+  g_assert (MKS_IS_DMABUF_PAINTABLE (self));
+  g_assert (self->builder_data != NULL);
+
+  if (self->builder_data->n_planes > MKS_DMABUF_MAP_MAX_PLANES)
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_NOT_SUPPORTED,
+                   "Cannot read DMA-BUF with %u planes",
+                   self->builder_data->n_planes);
+      return NULL;
+    }
+
+  /* The whole backing is copied in memory order, flipping is left to
+   * the snapshot of the parent like for imported textures.
+   */
+  scanout = (MksDmabufScanout) {
+    .n_planes = self->builder_data->n_planes,
+    .width = self->backing_width,
+    .height = self->backing_height,
+    .fourcc = self->builder_data->fourcc,
+    .backing_height = self->backing_height,
+    .modifier = self->builder_data->modifier,
+  };
+
+  for (guint i = 0; i < scanout.n_planes; i++)
+    {
+      scanout.fd[i] = self->builder_data->dmabuf_fd[i];
+      scanout.offset[i] = self->builder_data->offset[i];
+      scanout.stride[i] = self->builder_data->stride[i];
+    }
+
+  if (!mks_dmabuf_map_begin (&map, &scanout, error))
+    return NULL;
+
+  dst_stride = (gsize)self->backing_width * 4;
+  size = dst_stride * self->backing_height;
+
+  /* The previous texture may not have come from @cpu_pixels */
+  if (self->texture == NULL || !GDK_IS_MEMORY_TEXTURE (self->texture))
+    update_region = NULL;
+
+  if (self->cpu_pixels == NULL || g_bytes_get_size (self->cpu_pixels) != size)
+    {
+      g_clear_pointer (&self->cpu_pixels, g_bytes_unref);
+      self->cpu_pixels = g_bytes_new_take (g_malloc (size), size);
+      update_region = NULL;
+    }
+
+  dst = (guint8 *)g_bytes_get_data (self->cpu_pixels, NULL);
+
+  if (update_region == NULL)
+    {
+      mks_dmabuf_map_convert (&map,
+                              0, 0, self->backing_width, self->backing_height,
+                              dst, dst_stride);
+    }
+  else
+    {
+      for (int i = cairo_region_num_rectangles (update_region) - 1; i >= 0; i--)
+        {
+          cairo_rectangle_int_t rect;
+
+          cairo_region_get_rectangle (update_region, i, &rect);
+
+          mks_dmabuf_map_convert (&map,
+                                  rect.x, rect.y, rect.width, rect.height,
+                                  &dst[(gsize)rect.y * dst_stride + (gsize)rect.x * 4],
+                                  dst_stride);
+        }
+    }
+
+  mks_dmabuf_map_end (&map);
+
+  builder = gdk_memory_texture_builder_new ();
+  gdk_memory_texture_builder_set_bytes (builder, self->cpu_pixels);
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+  gdk_memory_texture_builder_set_format (builder, GDK_MEMORY_B8G8R8A8_PREMULTIPLIED);
+#else
+  gdk_memory_texture_builder_set_format (builder, GDK_MEMORY_A8R8G8B8_PREMULTIPLIED);
+#endif
+  gdk_memory_texture_builder_set_width (builder, self->backing_width);
+  gdk_memory_texture_builder_set_height (builder, self->backing_height);
+  gdk_memory_texture_builder_set_stride (builder, dst_stride);
+
+  if (update_region != NULL)
+    {
+      gdk_memory_texture_builder_set_update_texture (builder, self->texture);
+      gdk_memory_texture_builder_set_update_region (builder, (cairo_region_t *)update_region);
+    }
+
+  return gdk_memory_texture_builder_build (builder);
+}
+
 static void
 mks_dmabuf_paintable_snapshot (GdkPaintable *paintable,
                                GdkSnapshot  *snapshot,
@@ -100,25 +294,41 @@ mks_dmabuf_paintable_snapshot (GdkPaintable *paintable,
    */
   if (self->dmabuf_updated)
     {
+      cairo_region_t *update_region = NULL;
+
       MKS_TRACE_SCOPE ("dmabuf.build-texture",
-                       "width=%u height=%u",
+                       "width=%u height=%u path=%s",
                        self->width,
-                       self->height);
-
-      gdk_dmabuf_texture_builder_set_update_texture (self->builder, self->texture);
-      texture = gdk_dmabuf_texture_builder_build (self->builder,
-                                                  (GDestroyNotify)mks_dmabuf_scanout_data_free,
-                                                  self->builder_data,
-                                                  &error);
-      if (error != NULL)
+                       self->height,
+                       mks_dmabuf_path_to_string (self->path));
+
+      mks_damage_clip (&self->damage,
+                       &(cairo_rectangle_int_t) { 0, 0, self->backing_width, self->backing_height });
+      if (!mks_damage_is_empty (&self->damage))
+        update_region = mks_damage_to_region (&self->damage);
+      mks_damage_clear (&self->damage);
+
+      if (self->path == MKS_DMABUF_PATH_GPU &&
+          !(texture = mks_dmabuf_paintable_build_gpu (self, update_region, &error)))
+        {
+          mks_dmabuf_paintable_use_cpu (self, error->message);
+          g_clear_error (&error);
+
+          /* Nothing was copied by the CPU yet */
+          g_clear_pointer (&update_region, cairo_region_destroy);
+        }
+
+      if (self->path == MKS_DMABUF_PATH_CPU)
+        texture = mks_dmabuf_paintable_build_cpu (self, update_region, &error);
+
+      g_clear_pointer (&update_region, cairo_region_destroy);
+
+      if (texture == NULL)
         {
           g_warning ("Failed to build texture: %s", error->message);
           return;
         }
-      g_assert (texture != NULL);
-      self->builder_data = NULL;
-      /* Clear the update region to avoid unioning it with the next UpdateDMABUF call. */
-      gdk_dmabuf_texture_builder_set_update_region (self->builder, NULL);
+
       g_set_object (&self->texture, texture);
       self->dmabuf_updated = FALSE;
     }
@@ -157,7 +367,8 @@ mks_dmabuf_paintable_dispose (GObject *object)
 
   g_clear_object (&self->texture);
   g_clear_object (&self->builder);
-  g_clear_pointer (&self->builder_data, mks_dmabuf_scanout_data_free);
+  g_clear_pointer (&self->builder_data, mks_dmabuf_builder_data_release);
+  g_clear_pointer (&self->cpu_pixels, g_bytes_unref);
 
   G_OBJECT_CLASS (mks_dmabuf_paintable_parent_class)->dispose (object);
 }
@@ -173,6 +384,12 @@ mks_dmabuf_paintable_class_init (MksDmabufPaintableClass *klass)
 static void
 mks_dmabuf_paintable_init (MksDmabufPaintable *self)
 {
+  mks_damage_init (&self->damage);
+
+  if (mks_get_debug_flags () & MKS_DEBUG_DMABUF_CPU)
+    self->path = MKS_DMABUF_PATH_CPU;
+  else
+    self->path = MKS_DMABUF_PATH_GPU;
 }
 
 void
@@ -188,6 +405,9 @@ mks_dmabuf_scanout_data_free (MksDmabufScanoutData *data)
   g_free (data);
 }
 
+/* Returns a reference counted copy, released with
+ * mks_dmabuf_builder_data_release().
+ */
 static MksDmabufScanoutData *
 mks_dmabuf_scanout_data_copy_fds (MksDmabufScanoutData  *data,
                                   GError               **error)
@@ -197,7 +417,7 @@ mks_dmabuf_scanout_data_copy_fds (MksDmabufScanoutData  *data,
 
   g_assert (data != NULL);
 
-  copy = g_new0 (MksDmabufScanoutData, 1);
+  copy = g_atomic_rc_box_new0 (MksDmabufScanoutData);
   *copy = *data;
 
   for (i = 0; i < MKS_DMABUF_MAX_PLANES; i++)
@@ -214,7 +434,7 @@ mks_dmabuf_scanout_data_copy_fds (MksDmabufScanoutData  *data,
                        g_io_error_from_errno (errno),
                        "Failed to duplicate DMA-BUF fd: %s",
                        g_strerror (errno));
-          mks_dmabuf_scanout_data_free (copy);
+          mks_dmabuf_builder_data_release (copy);
           return NULL;
         }
     }
@@ -223,20 +443,19 @@ mks_dmabuf_scanout_data_copy_fds (MksDmabufScanoutData  *data,
 }
 
 gboolean
-mks_dmabuf_paintable_import (MksDmabufPaintable    *self,
-                             GdkDisplay            *display,
-                             MksDmabufScanoutData  *data,
-                             cairo_region_t        *region,
-                             GError               **error)
+mks_dmabuf_paintable_import (MksDmabufPaintable           *self,
+                             GdkDisplay                   *display,
+                             MksDmabufScanoutData         *data,
+                             const cairo_rectangle_int_t  *area,
+                             GError                      **error)
 {
-  g_autoptr(MksDmabufScanoutData) builder_data = NULL;
-  cairo_region_t *accumulated_damages;
-  cairo_region_t *previous_region;
+  MksDmabufScanoutData *builder_data;
   g_autoptr(MksTraceScope) trace_scope = NULL;
+  gint64 now;
   guint i;
 
   g_return_val_if_fail (MKS_IS_DMABUF_PAINTABLE (self), FALSE);
-  g_return_val_if_fail (GDK_IS_DISPLAY (display), FALSE);
+  g_return_val_if_fail (!display || GDK_IS_DISPLAY (display), FALSE);
   g_return_val_if_fail (data != NULL, FALSE);
 
   if (data->n_planes == 0 || data->n_planes > MKS_DMABUF_MAX_PLANES)
@@ -278,9 +497,40 @@ mks_dmabuf_paintable_import (MksDmabufPaintable    *self,
         }
     }
 
+  now = g_get_monotonic_time ();
+  self->stats_updates++;
+
+  if (now - self->stats_begin >= G_USEC_PER_SEC)
+    {
+      MKS_TRACE_MARK ("dmabuf.stats",
+                      "updates=%u fd-dups=%u path=%s",
+                      self->stats_updates,
+                      self->stats_fd_dups,
+                      mks_dmabuf_path_to_string (self->path));
+      self->stats_begin = now;
+      self->stats_updates = 0;
+      self->stats_fd_dups = 0;
+    }
+
+  /* Damage is kept across builders until the next texture is built */
+  if (area != NULL)
+    mks_damage_add (&self->damage, area);
+
+  /* The buffer hasn't changed since the builder was set up so all we
+   * need to do is accumulate the damage for the next texture.
+   */
+  if (self->builder != NULL && data->generation == self->builder_generation)
+    {
+      self->dmabuf_updated = TRUE;
+      gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
+      return TRUE;
+    }
+
   if (!(builder_data = mks_dmabuf_scanout_data_copy_fds (data, error)))
     return FALSE;
 
+  self->stats_fd_dups += data->n_planes;
+
   trace_scope =
     mks_trace_scope_new ("dmabuf.import",
                          "width=%u height=%u backing_width=%u backing_height=%u "
@@ -304,28 +554,20 @@ mks_dmabuf_paintable_import (MksDmabufPaintable    *self,
   self->backing_width = data->backing_width;
   self->backing_height = data->backing_height;
 
-  accumulated_damages = cairo_region_create ();
-
-  if (region != NULL)
-    cairo_region_union (accumulated_damages, region);
-
-  if (self->builder != NULL)
-    {
-      previous_region = gdk_dmabuf_texture_builder_get_update_region (self->builder);
-      if (previous_region != NULL)
-        cairo_region_union (accumulated_damages, previous_region);
-    }
-
   g_clear_object (&self->builder);
-  g_clear_pointer (&self->builder_data, mks_dmabuf_scanout_data_free);
+  g_clear_pointer (&self->builder_data, mks_dmabuf_builder_data_release);
   self->builder_data = g_steal_pointer (&builder_data);
+  self->builder_generation = data->generation;
 
   self->builder = gdk_dmabuf_texture_builder_new ();
   gdk_dmabuf_texture_builder_set_modifier (self->builder, data->modifier);
   gdk_dmabuf_texture_builder_set_fourcc (self->builder, data->fourcc);
   gdk_dmabuf_texture_builder_set_width (self->builder, data->backing_width);
   gdk_dmabuf_texture_builder_set_height (self->builder, data->backing_height);
-  gdk_dmabuf_texture_builder_set_display (self->builder, display);
+  if (display != NULL)
+    gdk_dmabuf_texture_builder_set_display (self->builder, display);
+  else
+    mks_dmabuf_paintable_use_cpu (self, "no display to import into");
   gdk_dmabuf_texture_builder_set_n_planes (self->builder, data->n_planes);
 
   for (i = 0; i < data->n_planes; i++)
@@ -337,11 +579,6 @@ mks_dmabuf_paintable_import (MksDmabufPaintable    *self,
       gdk_dmabuf_texture_builder_set_stride (self->builder, i, data->stride[i]);
     }
 
-  if (cairo_region_num_rectangles (accumulated_damages) > 0)
-    gdk_dmabuf_texture_builder_set_update_region (self->builder,
-                                                  accumulated_damages);
-
-  g_clear_pointer (&accumulated_damages, cairo_region_destroy);
   self->dmabuf_updated = TRUE;
   gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
   return TRUE;
@@ -364,3 +601,18 @@ mks_dmabuf_paintable_new (void)
 
   return g_steal_pointer (&self);
 }
+
+/*
+ * mks_dmabuf_paintable_get_path:
+ *
+ * Gets how buffers are turned into textures, which changes from
+ * %MKS_DMABUF_PATH_GPU to %MKS_DMABUF_PATH_CPU the first time
+ * importing fails.
+ */
+MksDmabufPath
+mks_dmabuf_paintable_get_path (MksDmabufPaintable *self)
+{
+  g_return_val_if_fail (MKS_IS_DMABUF_PAINTABLE (self), MKS_DMABUF_PATH_GPU);
+
+  return self->path;
+}
@@ -0,0 +1,41 @@
+/* mks-frame-stats-private.h
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#pragma once
+
+#include "mks-frame-stats.h"
+
+G_BEGIN_DECLS
+
+MksFrameStats *mks_frame_stats_new              (void);
+void           mks_frame_stats_record_update    (MksFrameStats *self,
+                                                 gsize          n_bytes);
+gboolean       mks_frame_stats_record_frame     (MksFrameStats *self,
+                                                 gint64         frame_counter,
+                                                 gint64         rebuild_time);
+gboolean       mks_frame_stats_peek_frame       (MksFrameStats *self,
+                                                 gint64        *frame_counter);
+void           mks_frame_stats_record_presented (MksFrameStats *self,
+                                                 gint64         frame_counter,
+                                                 gint64         presentation_time);
+void           mks_frame_stats_set_dmabuf_path  (MksFrameStats *self,
+                                                 MksDmabufPath  dmabuf_path);
+
+G_END_DECLS
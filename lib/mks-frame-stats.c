@@ -0,0 +1,760 @@
+/* mks-frame-stats.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mks-enums.h"
+#include "mks-frame-stats-private.h"
+#include "mks-trace-private.h"
+
+/**
+ * MksFrameStats:
+ *
+ * Rolling statistics about how a screen is being displayed.
+ *
+ * `MksFrameStats` follows each update received from the guest until the
+ * frame containing it is presented by the compositor. The properties are
+ * recalculated once per second while the screen is being drawn and
+ * notified when they change.
+ *
+ * Latency is measured from when the oldest update contained in a frame
+ * was received to when that frame was presented. Presentation times come
+ * from [class@Gdk.FrameTimings] and fall back to the predicted
+ * presentation time when the compositor does not report one.
+ *
+ * [property@Mks.FrameStats:dmabuf-path] tells whether a screen shared
+ * as a DMA-BUF is imported by the GPU or copied by the CPU. It is
+ * updated when the screen is drawn.
+ *
+ * Use [method@Mks.Display.get_frame_stats] to get the statistics for the
+ * screen shown by a [class@Mks.Display], or
+ * [method@Mks.Screen.get_frame_stats] for a paintable from
+ * [method@Mks.Screen.attach].
+ */
+
+#define MAX_PENDING_FRAMES 8
+#define MAX_SAMPLES        256
+
+typedef struct _MksPendingFrame
+{
+  gint64 frame_counter;
+  gint64 first_received;
+} MksPendingFrame;
+
+struct _MksFrameStats
+{
+  GObject parent_instance;
+
+  /* Updates may be recorded from the display worker thread so these
+   * fields are protected by @mutex. Everything else is only used from
+   * the main thread.
+   */
+  GMutex  mutex;
+  gint64  first_received;
+  guint   n_received;
+  guint   window_updates;
+  guint64 window_bytes;
+  guint   publishing : 1;
+
+  /* Frames which were drawn with new content but not yet presented */
+  MksPendingFrame pending[MAX_PENDING_FRAMES];
+  guint           n_pending;
+
+  /* Accumulated until the next time properties are published */
+  gint64 window_begin;
+  gint64 window_rebuild_time;
+  guint  window_rebuilds;
+  guint  window_frames;
+  guint  window_coalesced;
+  guint  window_dropped;
+  guint  n_latencies;
+  gint64 latencies[MAX_SAMPLES];
+
+  guint publish_source;
+
+  double  fps;
+  double  updates_per_second;
+  guint64 bytes_per_second;
+  gint64  rebuild_time;
+  gint64  latency_p50;
+  gint64  latency_p99;
+  guint   coalesced_updates;
+  guint   dropped_frames;
+
+  MksDmabufPath dmabuf_path;
+};
+
+enum {
+  PROP_0,
+  PROP_FPS,
+  PROP_UPDATES_PER_SECOND,
+  PROP_COALESCED_UPDATES,
+  PROP_DROPPED_FRAMES,
+  PROP_BYTES_PER_SECOND,
+  PROP_REBUILD_TIME,
+  PROP_LATENCY_P50,
+  PROP_LATENCY_P99,
+  PROP_DMABUF_PATH,
+  N_PROPS
+};
+
+G_DEFINE_FINAL_TYPE (MksFrameStats, mks_frame_stats, G_TYPE_OBJECT)
+
+static GParamSpec *properties [N_PROPS];
+
+static int
+compare_gint64 (gconstpointer a,
+                gconstpointer b)
+{
+  gint64 av = *(const gint64 *)a;
+  gint64 bv = *(const gint64 *)b;
+
+  return av < bv ? -1 : av > bv;
+}
+
+#define SET_AND_NOTIFY(field, value, prop)                                   \
+  G_STMT_START {                                                             \
+    if (self->field != (value))                                              \
+      {                                                                      \
+        self->field = (value);                                               \
+        g_object_notify_by_pspec (G_OBJECT (self), properties[prop]);        \
+      }                                                                      \
+  } G_STMT_END
+
+static gboolean
+mks_frame_stats_publish_cb (gpointer data)
+{
+  MksFrameStats *self = data;
+  gint64 latency_p50 = 0;
+  gint64 latency_p99 = 0;
+  guint64 window_bytes;
+  guint window_updates;
+  gboolean idle;
+  double seconds;
+  gint64 now;
+
+  g_assert (MKS_IS_FRAME_STATS (self));
+
+  now = g_get_monotonic_time ();
+  seconds = MAX (1, now - self->window_begin) / (double)G_USEC_PER_SEC;
+  idle = self->window_frames == 0 && self->n_pending == 0;
+
+  /* Deciding to stop under the lock ensures the next update restarts
+   * publishing rather than being lost.
+   */
+  g_mutex_lock (&self->mutex);
+  window_updates = self->window_updates;
+  window_bytes = self->window_bytes;
+  self->window_updates = 0;
+  self->window_bytes = 0;
+  idle = idle && window_updates == 0;
+  if (idle)
+    self->publishing = FALSE;
+  g_mutex_unlock (&self->mutex);
+
+  if (self->n_latencies > 0)
+    {
+      qsort (self->latencies, self->n_latencies, sizeof (gint64), compare_gint64);
+      latency_p50 = self->latencies[self->n_latencies * 50 / 100];
+      latency_p99 = self->latencies[self->n_latencies * 99 / 100];
+    }
+
+  g_object_freeze_notify (G_OBJECT (self));
+  SET_AND_NOTIFY (fps, self->window_frames / seconds, PROP_FPS);
+  SET_AND_NOTIFY (updates_per_second, window_updates / seconds, PROP_UPDATES_PER_SECOND);
+  SET_AND_NOTIFY (bytes_per_second, (guint64)(window_bytes / seconds), PROP_BYTES_PER_SECOND);
+  SET_AND_NOTIFY (coalesced_updates, self->window_coalesced, PROP_COALESCED_UPDATES);
+  SET_AND_NOTIFY (dropped_frames, self->window_dropped, PROP_DROPPED_FRAMES);
+  SET_AND_NOTIFY (rebuild_time,
+                  self->window_rebuilds ? self->window_rebuild_time / self->window_rebuilds : 0,
+                  PROP_REBUILD_TIME);
+  SET_AND_NOTIFY (latency_p50, latency_p50, PROP_LATENCY_P50);
+  SET_AND_NOTIFY (latency_p99, latency_p99, PROP_LATENCY_P99);
+  g_object_thaw_notify (G_OBJECT (self));
+
+  MKS_TRACE_MARK ("framestats.publish",
+                  "fps=%.1f updates=%u coalesced=%u dropped=%u bytes=%" G_GUINT64_FORMAT " "
+                  "p50=%" G_GINT64_FORMAT " p99=%" G_GINT64_FORMAT,
+                  self->fps,
+                  window_updates,
+                  self->window_coalesced,
+                  self->window_dropped,
+                  window_bytes,
+                  latency_p50,
+                  latency_p99);
+
+  self->window_begin = now;
+  self->window_rebuild_time = 0;
+  self->window_rebuilds = 0;
+  self->window_frames = 0;
+  self->window_coalesced = 0;
+  self->window_dropped = 0;
+  self->n_latencies = 0;
+
+  /* Stop waking up once a whole window passed without activity. The
+   * zeroes published above describe that state.
+   */
+  if (idle)
+    {
+      self->publish_source = 0;
+      return G_SOURCE_REMOVE;
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+#undef SET_AND_NOTIFY
+
+static void
+mks_frame_stats_ensure_publishing (MksFrameStats *self)
+{
+  g_assert (MKS_IS_FRAME_STATS (self));
+
+  if (self->publish_source != 0)
+    return;
+
+  g_mutex_lock (&self->mutex);
+  self->publishing = TRUE;
+  g_mutex_unlock (&self->mutex);
+
+  self->window_begin = g_get_monotonic_time ();
+  self->publish_source = g_timeout_add_seconds (1, mks_frame_stats_publish_cb, self);
+}
+
+static void
+mks_frame_stats_weak_ref_free (GWeakRef *wr)
+{
+  g_weak_ref_clear (wr);
+  g_free (wr);
+}
+
+static gboolean
+mks_frame_stats_ensure_publishing_cb (gpointer data)
+{
+  g_autoptr(MksFrameStats) self = g_weak_ref_get (data);
+
+  if (self != NULL)
+    mks_frame_stats_ensure_publishing (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+mks_frame_stats_dispose (GObject *object)
+{
+  MksFrameStats *self = (MksFrameStats *)object;
+
+  g_clear_handle_id (&self->publish_source, g_source_remove);
+
+  G_OBJECT_CLASS (mks_frame_stats_parent_class)->dispose (object);
+}
+
+static void
+mks_frame_stats_finalize (GObject *object)
+{
+  MksFrameStats *self = (MksFrameStats *)object;
+
+  g_mutex_clear (&self->mutex);
+
+  G_OBJECT_CLASS (mks_frame_stats_parent_class)->finalize (object);
+}
+
+static void
+mks_frame_stats_get_property (GObject    *object,
+                              guint       prop_id,
+                              GValue     *value,
+                              GParamSpec *pspec)
+{
+  MksFrameStats *self = MKS_FRAME_STATS (object);
+
+  switch (prop_id)
+    {
+    case PROP_FPS:
+      g_value_set_double (value, self->fps);
+      break;
+
+    case PROP_UPDATES_PER_SECOND:
+      g_value_set_double (value, self->updates_per_second);
+      break;
+
+    case PROP_COALESCED_UPDATES:
+      g_value_set_uint (value, self->coalesced_updates);
+      break;
+
+    case PROP_DROPPED_FRAMES:
+      g_value_set_uint (value, self->dropped_frames);
+      break;
+
+    case PROP_BYTES_PER_SECOND:
+      g_value_set_uint64 (value, self->bytes_per_second);
+      break;
+
+    case PROP_REBUILD_TIME:
+      g_value_set_int64 (value, self->rebuild_time);
+      break;
+
+    case PROP_LATENCY_P50:
+      g_value_set_int64 (value, self->latency_p50);
+      break;
+
+    case PROP_LATENCY_P99:
+      g_value_set_int64 (value, self->latency_p99);
+      break;
+
+    case PROP_DMABUF_PATH:
+      g_value_set_enum (value, self->dmabuf_path);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+mks_frame_stats_class_init (MksFrameStatsClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = mks_frame_stats_dispose;
+  object_class->finalize = mks_frame_stats_finalize;
+  object_class->get_property = mks_frame_stats_get_property;
+
+  /**
+   * MksFrameStats:fps:
+   *
+   * The number of frames with new guest content presented per second.
+   */
+  properties [PROP_FPS] =
+    g_param_spec_double ("fps", NULL, NULL,
+                         0, G_MAXDOUBLE, 0,
+                         (G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * MksFrameStats:updates-per-second:
+   *
+   * The number of updates received from the guest per second.
+   */
+  properties [PROP_UPDATES_PER_SECOND] =
+    g_param_spec_double ("updates-per-second", NULL, NULL,
+                         0, G_MAXDOUBLE, 0,
+                         (G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * MksFrameStats:coalesced-updates:
+   *
+   * The number of updates within the last second which were drawn
+   * together with a later update instead of in a frame of their own.
+   */
+  properties [PROP_COALESCED_UPDATES] =
+    g_param_spec_uint ("coalesced-updates", NULL, NULL,
+                       0, G_MAXUINT, 0,
+                       (G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * MksFrameStats:dropped-frames:
+   *
+   * The number of frames within the last second which were drawn with
+   * new content but never reported as presented.
+   */
+  properties [PROP_DROPPED_FRAMES] =
+    g_param_spec_uint ("dropped-frames", NULL, NULL,
+                       0, G_MAXUINT, 0,
+                       (G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * MksFrameStats:bytes-per-second:
+   *
+   * The number of bytes of pixel data updated by the guest per second.
+   */
+  properties [PROP_BYTES_PER_SECOND] =
+    g_param_spec_uint64 ("bytes-per-second", NULL, NULL,
+                         0, G_MAXUINT64, 0,
+                         (G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * MksFrameStats:rebuild-time:
+   *
+   * The average time in microseconds spent building textures for a frame.
+   */
+  properties [PROP_REBUILD_TIME] =
+    g_param_spec_int64 ("rebuild-time", NULL, NULL,
+                        0, G_MAXINT64, 0,
+                        (G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * MksFrameStats:latency-p50:
+   *
+   * The median receive-to-present latency in microseconds.
+   */
+  properties [PROP_LATENCY_P50] =
+    g_param_spec_int64 ("latency-p50", NULL, NULL,
+                        0, G_MAXINT64, 0,
+                        (G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * MksFrameStats:latency-p99:
+   *
+   * The 99th percentile receive-to-present latency in microseconds.
+   */
+  properties [PROP_LATENCY_P99] =
+    g_param_spec_int64 ("latency-p99", NULL, NULL,
+                        0, G_MAXINT64, 0,
+                        (G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * MksFrameStats:dmabuf-path:
+   *
+   * How the DMA-BUF shared by the guest is turned into a texture, or
+   * %MKS_DMABUF_PATH_NONE if the screen is not shared as a DMA-BUF.
+   */
+  properties [PROP_DMABUF_PATH] =
+    g_param_spec_enum ("dmabuf-path", NULL, NULL,
+                       MKS_TYPE_DMABUF_PATH,
+                       MKS_DMABUF_PATH_NONE,
+                       (G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+}
+
+static void
+mks_frame_stats_init (MksFrameStats *self)
+{
+  g_mutex_init (&self->mutex);
+}
+
+MksFrameStats *
+mks_frame_stats_new (void)
+{
+  return g_object_new (MKS_TYPE_FRAME_STATS, NULL);
+}
+
+/*
+ * mks_frame_stats_record_update:
+ * @self: a #MksFrameStats
+ * @n_bytes: the number of bytes of pixel data updated
+ *
+ * Records that an update was received from the guest.
+ *
+ * This function is thread-safe.
+ */
+void
+mks_frame_stats_record_update (MksFrameStats *self,
+                               gsize          n_bytes)
+{
+  gboolean start_publishing;
+  gint64 now;
+
+  g_return_if_fail (MKS_IS_FRAME_STATS (self));
+
+  now = g_get_monotonic_time ();
+
+  g_mutex_lock (&self->mutex);
+  if (self->n_received++ == 0)
+    self->first_received = now;
+  self->window_updates++;
+  self->window_bytes += n_bytes;
+  start_publishing = !self->publishing;
+  self->publishing = TRUE;
+  g_mutex_unlock (&self->mutex);
+
+  /* Paintables drawn by other widgets than MksDisplay never record
+   * frames, so updates alone must keep the statistics published.
+   */
+  if (start_publishing)
+    {
+      GWeakRef *wr = g_new0 (GWeakRef, 1);
+
+      g_weak_ref_init (wr, self);
+      g_idle_add_full (G_PRIORITY_DEFAULT,
+                       mks_frame_stats_ensure_publishing_cb,
+                       wr,
+                       (GDestroyNotify)mks_frame_stats_weak_ref_free);
+    }
+}
+
+/*
+ * mks_frame_stats_record_frame:
+ * @self: a #MksFrameStats
+ * @frame_counter: the frame counter of the #GdkFrameClock
+ * @rebuild_time: the time in microseconds spent drawing the paintable
+ *
+ * Records that the paintable was drawn for @frame_counter, which takes
+ * all updates received since the previous frame.
+ *
+ * Returns: %TRUE if the frame contains new updates and its presentation
+ *   should be reported with mks_frame_stats_record_presented().
+ */
+gboolean
+mks_frame_stats_record_frame (MksFrameStats *self,
+                              gint64         frame_counter,
+                              gint64         rebuild_time)
+{
+  gint64 first_received;
+  guint n_received;
+
+  g_return_val_if_fail (MKS_IS_FRAME_STATS (self), FALSE);
+
+  g_mutex_lock (&self->mutex);
+  first_received = self->first_received;
+  n_received = self->n_received;
+  self->first_received = 0;
+  self->n_received = 0;
+  g_mutex_unlock (&self->mutex);
+
+  /* Redrawn without new content, such as when resizing */
+  if (n_received == 0)
+    return FALSE;
+
+  self->window_coalesced += n_received - 1;
+  self->window_rebuild_time += rebuild_time;
+  self->window_rebuilds++;
+
+  if (self->n_pending == MAX_PENDING_FRAMES)
+    {
+      memmove (&self->pending[0], &self->pending[1], sizeof self->pending[0] * (MAX_PENDING_FRAMES - 1));
+      self->n_pending--;
+      self->window_dropped++;
+    }
+
+  self->pending[self->n_pending].frame_counter = frame_counter;
+  self->pending[self->n_pending].first_received = first_received;
+  self->n_pending++;
+
+  mks_frame_stats_ensure_publishing (self);
+
+  return TRUE;
+}
+
+/*
+ * mks_frame_stats_peek_frame:
+ * @self: a #MksFrameStats
+ * @frame_counter: (out): location for the frame counter
+ *
+ * Gets the oldest frame waiting for mks_frame_stats_record_presented().
+ *
+ * Returns: %TRUE if a frame is waiting to be presented
+ */
+gboolean
+mks_frame_stats_peek_frame (MksFrameStats *self,
+                            gint64        *frame_counter)
+{
+  g_return_val_if_fail (MKS_IS_FRAME_STATS (self), FALSE);
+  g_return_val_if_fail (frame_counter != NULL, FALSE);
+
+  if (self->n_pending == 0)
+    return FALSE;
+
+  *frame_counter = self->pending[0].frame_counter;
+
+  return TRUE;
+}
+
+/*
+ * mks_frame_stats_record_presented:
+ * @self: a #MksFrameStats
+ * @frame_counter: the frame counter of the #GdkFrameClock
+ * @presentation_time: the time the frame was presented, or 0 if it
+ *   was not presented
+ *
+ * Completes frames up to and including @frame_counter.
+ */
+void
+mks_frame_stats_record_presented (MksFrameStats *self,
+                                  gint64         frame_counter,
+                                  gint64         presentation_time)
+{
+  guint n_done = 0;
+
+  g_return_if_fail (MKS_IS_FRAME_STATS (self));
+
+  while (n_done < self->n_pending &&
+         self->pending[n_done].frame_counter <= frame_counter)
+    {
+      const MksPendingFrame *frame = &self->pending[n_done++];
+
+      if (frame->frame_counter != frame_counter || presentation_time == 0)
+        {
+          self->window_dropped++;
+          continue;
+        }
+
+      self->window_frames++;
+
+      if (self->n_latencies < MAX_SAMPLES)
+        self->latencies[self->n_latencies++] = MAX (0, presentation_time - frame->first_received);
+    }
+
+  self->n_pending -= n_done;
+  memmove (&self->pending[0], &self->pending[n_done], sizeof self->pending[0] * self->n_pending);
+}
+
+/*
+ * mks_frame_stats_set_dmabuf_path:
+ * @self: a #MksFrameStats
+ * @dmabuf_path: how the screen was last drawn
+ *
+ * Sets #MksFrameStats:dmabuf-path. Must be called from the main thread.
+ */
+void
+mks_frame_stats_set_dmabuf_path (MksFrameStats *self,
+                                 MksDmabufPath  dmabuf_path)
+{
+  g_return_if_fail (MKS_IS_FRAME_STATS (self));
+
+  if (self->dmabuf_path == dmabuf_path)
+    return;
+
+  self->dmabuf_path = dmabuf_path;
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_DMABUF_PATH]);
+}
+
+/**
+ * mks_frame_stats_get_fps:
+ * @self: a #MksFrameStats
+ *
+ * Gets the number of frames with new content presented per second.
+ */
+double
+mks_frame_stats_get_fps (MksFrameStats *self)
+{
+  g_return_val_if_fail (MKS_IS_FRAME_STATS (self), 0);
+
+  return self->fps;
+}
+
+/**
+ * mks_frame_stats_get_updates_per_second:
+ * @self: a #MksFrameStats
+ *
+ * Gets the number of updates received from the guest per second.
+ */
+double
+mks_frame_stats_get_updates_per_second (MksFrameStats *self)
+{
+  g_return_val_if_fail (MKS_IS_FRAME_STATS (self), 0);
+
+  return self->updates_per_second;
+}
+
+/**
+ * mks_frame_stats_get_coalesced_updates:
+ * @self: a #MksFrameStats
+ *
+ * Gets the number of updates within the last second that shared a
+ * frame with a later update.
+ */
+guint
+mks_frame_stats_get_coalesced_updates (MksFrameStats *self)
+{
+  g_return_val_if_fail (MKS_IS_FRAME_STATS (self), 0);
+
+  return self->coalesced_updates;
+}
+
+/**
+ * mks_frame_stats_get_dropped_frames:
+ * @self: a #MksFrameStats
+ *
+ * Gets the number of frames within the last second that were drawn
+ * but not presented.
+ */
+guint
+mks_frame_stats_get_dropped_frames (MksFrameStats *self)
+{
+  g_return_val_if_fail (MKS_IS_FRAME_STATS (self), 0);
+
+  return self->dropped_frames;
+}
+
+/**
+ * mks_frame_stats_get_bytes_per_second:
+ * @self: a #MksFrameStats
+ *
+ * Gets the number of bytes of pixel data updated per second.
+ */
+guint64
+mks_frame_stats_get_bytes_per_second (MksFrameStats *self)
+{
+  g_return_val_if_fail (MKS_IS_FRAME_STATS (self), 0);
+
+  return self->bytes_per_second;
+}
+
+/**
+ * mks_frame_stats_get_rebuild_time:
+ * @self: a #MksFrameStats
+ *
+ * Gets the average time in microseconds spent building textures
+ * for a frame.
+ */
+gint64
+mks_frame_stats_get_rebuild_time (MksFrameStats *self)
+{
+  g_return_val_if_fail (MKS_IS_FRAME_STATS (self), 0);
+
+  return self->rebuild_time;
+}
+
+/**
+ * mks_frame_stats_get_latency_p50:
+ * @self: a #MksFrameStats
+ *
+ * Gets the median receive-to-present latency in microseconds.
+ */
+gint64
+mks_frame_stats_get_latency_p50 (MksFrameStats *self)
+{
+  g_return_val_if_fail (MKS_IS_FRAME_STATS (self), 0);
+
+  return self->latency_p50;
+}
+
+/**
+ * mks_frame_stats_get_latency_p99:
+ * @self: a #MksFrameStats
+ *
+ * Gets the 99th percentile receive-to-present latency in microseconds.
+ */
+gint64
+mks_frame_stats_get_latency_p99 (MksFrameStats *self)
+{
+  g_return_val_if_fail (MKS_IS_FRAME_STATS (self), 0);
+
+  return self->latency_p99;
+}
+
+/**
+ * mks_frame_stats_get_dmabuf_path:
+ * @self: a #MksFrameStats
+ *
+ * Gets how the DMA-BUF shared by the guest is turned into a texture.
+ *
+ * Returns: %MKS_DMABUF_PATH_NONE if the screen is not shared as a DMA-BUF
+ */
+MksDmabufPath
+mks_frame_stats_get_dmabuf_path (MksFrameStats *self)
+{
+  g_return_val_if_fail (MKS_IS_FRAME_STATS (self), MKS_DMABUF_PATH_NONE);
+
+  return self->dmabuf_path;
+}
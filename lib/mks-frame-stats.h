@@ -0,0 +1,74 @@
+/* mks-frame-stats.h
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#pragma once
+
+#if !defined(MKS_INSIDE) && !defined(MKS_COMPILATION)
+# error "Only <libmks.h> can be included directly."
+#endif
+
+#include <glib-object.h>
+
+#include "mks-types.h"
+#include "mks-version-macros.h"
+
+G_BEGIN_DECLS
+
+#define MKS_TYPE_FRAME_STATS (mks_frame_stats_get_type())
+
+/**
+ * MksDmabufPath:
+ * @MKS_DMABUF_PATH_NONE: The screen is not shown from a DMA-BUF.
+ * @MKS_DMABUF_PATH_GPU: The DMA-BUF is imported as a texture.
+ * @MKS_DMABUF_PATH_CPU: The DMA-BUF is mapped and copied into a
+ *   memory texture because it could not be imported.
+ *
+ * How the DMA-BUF shared by the guest is turned into a texture.
+ */
+typedef enum _MksDmabufPath
+{
+  MKS_DMABUF_PATH_NONE = 0,
+  MKS_DMABUF_PATH_GPU  = 1,
+  MKS_DMABUF_PATH_CPU  = 2,
+} MksDmabufPath;
+
+MKS_AVAILABLE_IN_ALL
+G_DECLARE_FINAL_TYPE (MksFrameStats, mks_frame_stats, MKS, FRAME_STATS, GObject)
+
+MKS_AVAILABLE_IN_ALL
+double        mks_frame_stats_get_fps                (MksFrameStats *self);
+MKS_AVAILABLE_IN_ALL
+double        mks_frame_stats_get_updates_per_second (MksFrameStats *self);
+MKS_AVAILABLE_IN_ALL
+guint         mks_frame_stats_get_coalesced_updates  (MksFrameStats *self);
+MKS_AVAILABLE_IN_ALL
+guint         mks_frame_stats_get_dropped_frames     (MksFrameStats *self);
+MKS_AVAILABLE_IN_ALL
+guint64       mks_frame_stats_get_bytes_per_second   (MksFrameStats *self);
+MKS_AVAILABLE_IN_ALL
+gint64        mks_frame_stats_get_rebuild_time       (MksFrameStats *self);
+MKS_AVAILABLE_IN_ALL
+gint64        mks_frame_stats_get_latency_p50        (MksFrameStats *self);
+MKS_AVAILABLE_IN_ALL
+gint64        mks_frame_stats_get_latency_p99        (MksFrameStats *self);
+MKS_AVAILABLE_IN_ALL
+MksDmabufPath mks_frame_stats_get_dmabuf_path        (MksFrameStats *self);
+
+G_END_DECLS
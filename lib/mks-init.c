@@ -78,6 +78,7 @@ mks_init_gtypes (void)
   g_type_ensure (MKS_TYPE_SCREEN);
   g_type_ensure (MKS_TYPE_SCREEN_ATTRIBUTES);
   g_type_ensure (MKS_TYPE_SESSION);
+  g_type_ensure (MKS_TYPE_SHARED_PAINTABLE);
   g_type_ensure (MKS_TYPE_SPEAKER);
   g_type_ensure (MKS_TYPE_TOUCHABLE);
 }
@@ -0,0 +1,40 @@
+/* mks-map-cache-private.h
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _MksMapCache MksMapCache;
+
+MksMapCache *mks_map_cache_new    (void);
+void         mks_map_cache_free   (MksMapCache  *self);
+void         mks_map_cache_clear  (MksMapCache  *self);
+GBytes      *mks_map_cache_lookup (MksMapCache  *self,
+                                   int           fd,
+                                   gsize         offset,
+                                   gsize         length,
+                                   GError      **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MksMapCache, mks_map_cache_free)
+
+G_END_DECLS
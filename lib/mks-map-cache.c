@@ -0,0 +1,243 @@
+/* mks-map-cache.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mks-map-cache-private.h"
+#include "mks-trace-private.h"
+
+/* QEMU resends ScanoutMap for the same shared memory on mode sets and
+ * console switches. Keeping a few recent mappings around lets us skip
+ * the mmap() and, more importantly, the page faults on the next upload.
+ */
+#define MAX_ENTRIES 4
+
+typedef struct
+{
+  GList   link;
+  dev_t   st_dev;
+  ino_t   st_ino;
+  off_t   st_size;
+  gsize   offset;
+  gsize   length;
+  GBytes *bytes;
+} MksMapCacheEntry;
+
+typedef struct
+{
+  gpointer data;
+  gsize    length;
+} MksMapping;
+
+struct _MksMapCache
+{
+  GQueue  entries;
+  guint64 n_hits;
+  guint64 n_misses;
+};
+
+static void
+mks_mapping_free (gpointer data)
+{
+  MksMapping *mapping = data;
+
+  munmap (mapping->data, mapping->length);
+  g_free (mapping);
+}
+
+static void
+mks_map_cache_entry_free (MksMapCacheEntry *entry)
+{
+  g_clear_pointer (&entry->bytes, g_bytes_unref);
+  g_free (entry);
+}
+
+MksMapCache *
+mks_map_cache_new (void)
+{
+  return g_new0 (MksMapCache, 1);
+}
+
+void
+mks_map_cache_clear (MksMapCache *self)
+{
+  MksMapCacheEntry *entry;
+
+  g_return_if_fail (self != NULL);
+
+  while ((entry = g_queue_peek_head (&self->entries)))
+    {
+      g_queue_unlink (&self->entries, &entry->link);
+      mks_map_cache_entry_free (entry);
+    }
+}
+
+void
+mks_map_cache_free (MksMapCache *self)
+{
+  if (self == NULL)
+    return;
+
+  mks_map_cache_clear (self);
+  g_free (self);
+}
+
+static GBytes *
+mks_map_cache_map (int     fd,
+                   gsize   offset,
+                   gsize   length,
+                   GError **error)
+{
+  MksMapping *mapping;
+  gpointer data;
+  int flags = MAP_SHARED;
+
+#ifdef MAP_POPULATE
+  /* Prefault so the first texture upload doesn't stall on page faults */
+  flags |= MAP_POPULATE;
+#endif
+
+  data = mmap (NULL, offset + length, PROT_READ, flags, fd, 0);
+
+  if (data == MAP_FAILED)
+    {
+      int errsv = errno;
+      g_set_error (error,
+                   G_IO_ERROR,
+                   g_io_error_from_errno (errsv),
+                   "Failed to mmap shared buffer: %s",
+                   g_strerror (errsv));
+      return NULL;
+    }
+
+  mapping = g_new0 (MksMapping, 1);
+  mapping->data = data;
+  mapping->length = offset + length;
+
+  return g_bytes_new_with_free_func ((guint8 *)data + offset,
+                                     length,
+                                     mks_mapping_free,
+                                     mapping);
+}
+
+/**
+ * mks_map_cache_lookup:
+ * @self: a #MksMapCache
+ * @fd: the shared memory fd, not consumed
+ * @offset: offset of the image within @fd
+ * @length: length of the image in bytes
+ * @error: a location for a #GError
+ *
+ * Gets a read-only mapping of @length bytes starting at @offset within
+ * @fd, reusing a previous mapping when @fd refers to the same file.
+ *
+ * Returns: (transfer full): a #GBytes or %NULL and @error is set
+ */
+GBytes *
+mks_map_cache_lookup (MksMapCache  *self,
+                      int           fd,
+                      gsize         offset,
+                      gsize         length,
+                      GError      **error)
+{
+  MksMapCacheEntry *entry;
+  struct stat st;
+  GBytes *bytes;
+
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (fd > -1, NULL);
+  g_return_val_if_fail (length > 0, NULL);
+
+  if (fstat (fd, &st) != 0)
+    {
+      int errsv = errno;
+      g_set_error (error,
+                   G_IO_ERROR,
+                   g_io_error_from_errno (errsv),
+                   "Failed to stat shared buffer: %s",
+                   g_strerror (errsv));
+      return NULL;
+    }
+
+  if (S_ISREG (st.st_mode) && (guint64)st.st_size < (guint64)offset + length)
+    {
+      g_set_error_literal (error,
+                           G_IO_ERROR,
+                           G_IO_ERROR_INVALID_ARGUMENT,
+                           "Shared buffer is smaller than the scanout");
+      return NULL;
+    }
+
+  for (const GList *iter = self->entries.head; iter; iter = iter->next)
+    {
+      entry = iter->data;
+
+      if (entry->st_dev == st.st_dev &&
+          entry->st_ino == st.st_ino &&
+          entry->st_size == st.st_size &&
+          entry->offset == offset &&
+          entry->length == length)
+        {
+          self->n_hits++;
+
+          MKS_TRACE_MARK ("mapcache.hit",
+                          "hits=%"G_GUINT64_FORMAT" misses=%"G_GUINT64_FORMAT,
+                          self->n_hits, self->n_misses);
+
+          g_queue_unlink (&self->entries, &entry->link);
+          g_queue_push_head_link (&self->entries, &entry->link);
+
+          return g_bytes_ref (entry->bytes);
+        }
+    }
+
+  self->n_misses++;
+
+  MKS_TRACE_MARK ("mapcache.miss",
+                  "hits=%"G_GUINT64_FORMAT" misses=%"G_GUINT64_FORMAT,
+                  self->n_hits, self->n_misses);
+
+  if (!(bytes = mks_map_cache_map (fd, offset, length, error)))
+    return NULL;
+
+  entry = g_new0 (MksMapCacheEntry, 1);
+  entry->link.data = entry;
+  entry->st_dev = st.st_dev;
+  entry->st_ino = st.st_ino;
+  entry->st_size = st.st_size;
+  entry->offset = offset;
+  entry->length = length;
+  entry->bytes = g_bytes_ref (bytes);
+  g_queue_push_head_link (&self->entries, &entry->link);
+
+  while (self->entries.length > MAX_ENTRIES)
+    {
+      MksMapCacheEntry *tail = g_queue_peek_tail (&self->entries);
+
+      g_queue_unlink (&self->entries, &tail->link);
+      mks_map_cache_entry_free (tail);
+    }
+
+  return bytes;
+}
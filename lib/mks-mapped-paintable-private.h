@@ -22,24 +22,28 @@
 
 #include <gtk/gtk.h>
 
+#include "mks-shm-publisher-private.h"
+
 G_BEGIN_DECLS
 
 #define MKS_TYPE_MAPPED_PAINTABLE (mks_mapped_paintable_get_type())
 
 G_DECLARE_FINAL_TYPE (MksMappedPaintable, mks_mapped_paintable, MKS, MAPPED_PAINTABLE, GObject)
 
-MksMappedPaintable *mks_mapped_paintable_new    (void);
-gboolean            mks_mapped_paintable_import (MksMappedPaintable  *self,
-                                                 int                  fd,
-                                                 guint                offset,
-                                                 guint                width,
-                                                 guint                height,
-                                                 guint                stride,
-                                                 guint                pixman_format,
-                                                 cairo_region_t      *region,
-                                                 GError             **error);
-void                mks_mapped_paintable_damage (MksMappedPaintable  *self,
-                                                 cairo_region_t      *region);
-void                mks_mapped_paintable_clear  (MksMappedPaintable  *self);
+MksMappedPaintable *mks_mapped_paintable_new     (void);
+gboolean            mks_mapped_paintable_import  (MksMappedPaintable          *self,
+                                                  GBytes                      *bytes,
+                                                  guint                        width,
+                                                  guint                        height,
+                                                  guint                        stride,
+                                                  guint                        pixman_format,
+                                                  cairo_region_t              *region,
+                                                  GError                     **error);
+void                mks_mapped_paintable_damage  (MksMappedPaintable          *self,
+                                                  const cairo_rectangle_int_t *area);
+void                mks_mapped_paintable_clear   (MksMappedPaintable          *self);
+void                mks_mapped_paintable_publish (MksMappedPaintable          *self,
+                                                  MksShmPublisher             *publisher,
+                                                  const cairo_rectangle_int_t *area);
 
 G_END_DECLS
@@ -20,31 +20,30 @@
 
 #include "config.h"
 
-#include <errno.h>
-#include <fcntl.h>
-#include <sys/mman.h>
-#include <unistd.h>
-
-#include <glib-unix.h>
 #include <gtk/gtk.h>
 #include <pixman.h>
 
+#include "mks-damage-private.h"
 #include "mks-mapped-paintable-private.h"
+#include "mks-pixels-private.h"
+#include "mks-tile-hash-private.h"
 #include "mks-util-private.h"
 
-typedef struct
-{
-  gpointer data;
-  gsize    length;
-  int      fd;
-} MksMappedBytes;
-
 struct _MksMappedPaintable
 {
   GObject         parent_instance;
   GBytes         *bytes;
   GdkTexture     *texture;
-  cairo_region_t *update_region;
+
+  /* Formats without a matching GdkMemoryFormat are converted into this
+   * ARGB32 copy of the shared map. Only damaged areas are converted.
+   */
+  GBytes         *converted;
+
+  /* Set with MKS_DEBUG=tile-hash to drop damage that did not change */
+  MksTileHash    *tile_hash;
+
+  MksDamage       damage;
   guint           width;
   guint           height;
   guint           stride;
@@ -52,20 +51,6 @@ struct _MksMappedPaintable
   guint           dirty : 1;
 };
 
-static void
-mks_mapped_bytes_free (gpointer data)
-{
-  MksMappedBytes *mapped = data;
-
-  if (mapped == NULL)
-    return;
-
-  if (mapped->data != NULL && mapped->length > 0)
-    munmap (mapped->data, mapped->length);
-  g_clear_fd (&mapped->fd, NULL);
-  g_free (mapped);
-}
-
 static GdkMemoryFormat
 pixman_to_memory_format (guint pixman_format)
 {
@@ -82,6 +67,18 @@ pixman_to_memory_format (guint pixman_format)
       return GDK_MEMORY_B8G8R8X8;
 #else
       return GDK_MEMORY_X8R8G8B8;
+#endif
+    case PIXMAN_a8b8g8r8:
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+      return GDK_MEMORY_R8G8B8A8_PREMULTIPLIED;
+#else
+      return GDK_MEMORY_A8B8G8R8_PREMULTIPLIED;
+#endif
+    case PIXMAN_x8b8g8r8:
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+      return GDK_MEMORY_R8G8B8X8;
+#else
+      return GDK_MEMORY_X8B8G8R8;
 #endif
     case PIXMAN_a8:
       return GDK_MEMORY_A8;
@@ -90,6 +87,13 @@ pixman_to_memory_format (guint pixman_format)
     }
 }
 
+static gboolean
+pixman_format_is_supported (guint pixman_format)
+{
+  return pixman_to_memory_format (pixman_format) != GDK_MEMORY_N_FORMATS ||
+         mks_pixels_can_convert (pixman_format);
+}
+
 static int
 mks_mapped_paintable_get_intrinsic_width (GdkPaintable *paintable)
 {
@@ -110,32 +114,162 @@ mks_mapped_paintable_get_intrinsic_aspect_ratio (GdkPaintable *paintable)
   return self->height ? (double) self->width / (double) self->height : 0.0;
 }
 
+/* Converts @region, or everything if %NULL, into @converted. Returns
+ * %FALSE if @converted had to be reallocated and everything was
+ * converted regardless of @region.
+ */
+static gboolean
+mks_mapped_paintable_convert (MksMappedPaintable   *self,
+                              const cairo_region_t *region)
+{
+  const guint8 *src;
+  guint8 *dst;
+  gsize dst_stride;
+  gsize size;
+  gboolean reused = TRUE;
+
+  g_assert (MKS_IS_MAPPED_PAINTABLE (self));
+  g_assert (self->bytes != NULL);
+
+  dst_stride = (gsize)self->width * 4;
+  size = dst_stride * self->height;
+
+  /* Start over with a full conversion when the size changes */
+  if (self->converted == NULL || g_bytes_get_size (self->converted) != size)
+    {
+      g_clear_pointer (&self->converted, g_bytes_unref);
+      self->converted = g_bytes_new_take (g_malloc (size), size);
+      region = NULL;
+      reused = FALSE;
+    }
+
+  src = g_bytes_get_data (self->bytes, NULL);
+  dst = (guint8 *)g_bytes_get_data (self->converted, NULL);
+
+  if (region == NULL)
+    {
+      mks_pixels_convert_rows (self->pixman_format,
+                               dst, dst_stride,
+                               src, self->stride,
+                               self->width, self->height);
+      return reused;
+    }
+
+  for (int i = cairo_region_num_rectangles (region) - 1; i >= 0; i--)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (region, i, &rect);
+
+      mks_pixels_convert_rows (self->pixman_format,
+                               &dst[(gsize)rect.y * dst_stride + (gsize)rect.x * 4],
+                               dst_stride,
+                               &src[(gsize)rect.y * self->stride + (gsize)rect.x * PIXMAN_FORMAT_BPP (self->pixman_format) / 8],
+                               self->stride,
+                               rect.width,
+                               rect.height);
+    }
+
+  return TRUE;
+}
+
 static void
 mks_mapped_paintable_rebuild_texture (MksMappedPaintable *self)
 {
   g_autoptr(GdkMemoryTextureBuilder) builder = NULL;
   g_autoptr(GdkTexture) texture = NULL;
+  cairo_region_t *update_region = NULL;
+  GdkMemoryFormat format;
+  GBytes *bytes;
+  gsize stride;
+
+  self->dirty = FALSE;
 
   if (self->bytes == NULL)
     return;
 
+  mks_damage_clip (&self->damage, &(cairo_rectangle_int_t) { 0, 0, self->width, self->height });
+
+  /* Without a texture everything is uploaded regardless of damage */
+  if (self->texture != NULL)
+    {
+      if (mks_damage_is_empty (&self->damage))
+        return;
+
+      update_region = mks_damage_to_region (&self->damage);
+    }
+
+  mks_damage_clear (&self->damage);
+
+  if (self->tile_hash != NULL)
+    {
+      cairo_region_t *damage;
+      cairo_region_t *changed;
+
+      if (update_region != NULL)
+        damage = g_steal_pointer (&update_region);
+      else
+        damage = cairo_region_create_rectangle (&(cairo_rectangle_int_t) { 0, 0, self->width, self->height });
+
+      changed = mks_tile_hash_filter (self->tile_hash,
+                                      g_bytes_get_data (self->bytes, NULL),
+                                      self->stride,
+                                      self->width,
+                                      self->height,
+                                      PIXMAN_FORMAT_BPP (self->pixman_format) / 8,
+                                      damage);
+      cairo_region_destroy (damage);
+
+      /* Nothing changed, keep the texture we already have */
+      if (self->texture != NULL && cairo_region_is_empty (changed))
+        {
+          cairo_region_destroy (changed);
+          return;
+        }
+
+      if (self->texture != NULL)
+        update_region = changed;
+      else
+        cairo_region_destroy (changed);
+    }
+
+  format = pixman_to_memory_format (self->pixman_format);
+  bytes = self->bytes;
+  stride = self->stride;
+
+  if (format == GDK_MEMORY_N_FORMATS)
+    {
+      if (!mks_mapped_paintable_convert (self, update_region))
+        {
+          g_clear_pointer (&update_region, cairo_region_destroy);
+          g_clear_object (&self->texture);
+        }
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+      format = GDK_MEMORY_B8G8R8A8_PREMULTIPLIED;
+#else
+      format = GDK_MEMORY_A8R8G8B8_PREMULTIPLIED;
+#endif
+      bytes = self->converted;
+      stride = (gsize)self->width * 4;
+    }
+
   builder = gdk_memory_texture_builder_new ();
-  gdk_memory_texture_builder_set_bytes (builder, self->bytes);
-  gdk_memory_texture_builder_set_format (builder, pixman_to_memory_format (self->pixman_format));
+  gdk_memory_texture_builder_set_bytes (builder, bytes);
+  gdk_memory_texture_builder_set_format (builder, format);
   gdk_memory_texture_builder_set_width (builder, self->width);
   gdk_memory_texture_builder_set_height (builder, self->height);
-  gdk_memory_texture_builder_set_stride (builder, self->stride);
+  gdk_memory_texture_builder_set_stride (builder, stride);
 
   if (self->texture != NULL)
     gdk_memory_texture_builder_set_update_texture (builder, self->texture);
 
-  if (self->update_region != NULL)
-    gdk_memory_texture_builder_set_update_region (builder, self->update_region);
+  if (update_region != NULL)
+    gdk_memory_texture_builder_set_update_region (builder, update_region);
 
   texture = gdk_memory_texture_builder_build (builder);
   g_set_object (&self->texture, texture);
-  g_clear_pointer (&self->update_region, cairo_region_destroy);
-  self->dirty = FALSE;
+  g_clear_pointer (&update_region, cairo_region_destroy);
 }
 
 static void
@@ -178,8 +312,9 @@ mks_mapped_paintable_dispose (GObject *object)
   MksMappedPaintable *self = MKS_MAPPED_PAINTABLE (object);
 
   g_clear_pointer (&self->bytes, g_bytes_unref);
+  g_clear_pointer (&self->converted, g_bytes_unref);
   g_clear_object (&self->texture);
-  g_clear_pointer (&self->update_region, cairo_region_destroy);
+  g_clear_pointer (&self->tile_hash, mks_tile_hash_free);
 
   G_OBJECT_CLASS (mks_mapped_paintable_parent_class)->dispose (object);
 }
@@ -194,6 +329,10 @@ mks_mapped_paintable_class_init (MksMappedPaintableClass *klass)
 static void
 mks_mapped_paintable_init (MksMappedPaintable *self)
 {
+  mks_damage_init (&self->damage);
+
+  if (mks_get_debug_flags () & MKS_DEBUG_TILE_HASH)
+    self->tile_hash = mks_tile_hash_new ();
 }
 
 MksMappedPaintable *
@@ -202,33 +341,9 @@ mks_mapped_paintable_new (void)
   return g_object_new (MKS_TYPE_MAPPED_PAINTABLE, NULL);
 }
 
-static gboolean
-map_fd (int        fd,
-        gsize      length,
-        gpointer  *data,
-        GError   **error)
-{
-  gpointer mapped;
-
-  mapped = mmap (NULL, length, PROT_READ, MAP_SHARED, fd, 0);
-  if (mapped == MAP_FAILED)
-    {
-      g_set_error (error,
-                   G_IO_ERROR,
-                   g_io_error_from_errno (errno),
-                   "Failed to mmap shared buffer: %s",
-                   g_strerror (errno));
-      return FALSE;
-    }
-
-  *data = mapped;
-  return TRUE;
-}
-
 gboolean
 mks_mapped_paintable_import (MksMappedPaintable  *self,
-                             int                  fd,
-                             guint                offset,
+                             GBytes              *bytes,
                              guint                width,
                              guint                height,
                              guint                stride,
@@ -236,15 +351,11 @@ mks_mapped_paintable_import (MksMappedPaintable  *self,
                              cairo_region_t      *region,
                              GError             **error)
 {
-  g_autoptr(GBytes) bytes = NULL;
-  g_autoptr(GError) local_error = NULL;
-  MksMappedBytes *mapped;
-  gsize length;
-  int dup_fd;
-
   g_return_val_if_fail (MKS_IS_MAPPED_PAINTABLE (self), FALSE);
+  g_return_val_if_fail (bytes != NULL, FALSE);
 
-  if (width == 0 || height == 0 || stride == 0 || fd < 0)
+  if (width == 0 || height == 0 || stride == 0 ||
+      g_bytes_get_size (bytes) < (gsize) stride * height)
     {
       g_set_error_literal (error,
                            G_IO_ERROR,
@@ -253,7 +364,7 @@ mks_mapped_paintable_import (MksMappedPaintable  *self,
       return FALSE;
     }
 
-  if (pixman_to_memory_format (pixman_format) == GDK_MEMORY_N_FORMATS)
+  if (!pixman_format_is_supported (pixman_format))
     {
       g_set_error_literal (error,
                            G_IO_ERROR,
@@ -262,35 +373,6 @@ mks_mapped_paintable_import (MksMappedPaintable  *self,
       return FALSE;
     }
 
-  length = (gsize) stride * height + offset;
-  dup_fd = fcntl (fd, F_DUPFD_CLOEXEC, 3);
-
-  if (dup_fd < 0)
-    {
-      g_set_error (error,
-                   G_IO_ERROR,
-                   g_io_error_from_errno (errno),
-                   "Failed to duplicate shared map fd: %s",
-                   g_strerror (errno));
-      return FALSE;
-    }
-
-  mapped = g_new0 (MksMappedBytes, 1);
-  mapped->fd = dup_fd;
-  mapped->length = length;
-
-  if (!map_fd (dup_fd, length, &mapped->data, &local_error))
-    {
-      g_propagate_error (error, g_steal_pointer (&local_error));
-      mks_mapped_bytes_free (mapped);
-      return FALSE;
-    }
-
-  bytes = g_bytes_new_with_free_func ((guint8 *) mapped->data + offset,
-                                      length - offset,
-                                      mks_mapped_bytes_free,
-                                      mapped);
-
   if (self->width != width || self->height != height)
     {
       self->width = width;
@@ -300,15 +382,21 @@ mks_mapped_paintable_import (MksMappedPaintable  *self,
 
   self->stride = stride;
   self->pixman_format = pixman_format;
-  g_clear_pointer (&self->bytes, g_bytes_unref);
-  self->bytes = g_steal_pointer (&bytes);
+  if (bytes != self->bytes)
+    {
+      g_clear_pointer (&self->bytes, g_bytes_unref);
+      self->bytes = g_bytes_ref (bytes);
+    }
 
-  if (region != NULL)
+  /* Without a region the whole map has new contents */
+  if (region == NULL)
     {
-      if (self->update_region == NULL)
-        self->update_region = cairo_region_copy (region);
-      else
-        cairo_region_union (self->update_region, region);
+      mks_damage_clear (&self->damage);
+      mks_damage_add (&self->damage, &(cairo_rectangle_int_t) { 0, 0, width, height });
+    }
+  else
+    {
+      mks_damage_add_region (&self->damage, region);
     }
 
   self->dirty = TRUE;
@@ -323,8 +411,11 @@ mks_mapped_paintable_clear (MksMappedPaintable *self)
   g_return_if_fail (MKS_IS_MAPPED_PAINTABLE (self));
 
   g_clear_pointer (&self->bytes, g_bytes_unref);
+  g_clear_pointer (&self->converted, g_bytes_unref);
   g_clear_object (&self->texture);
-  g_clear_pointer (&self->update_region, cairo_region_destroy);
+  mks_damage_clear (&self->damage);
+  if (self->tile_hash != NULL)
+    mks_tile_hash_reset (self->tile_hash);
   self->dirty = FALSE;
   self->width = 0;
   self->height = 0;
@@ -333,17 +424,51 @@ mks_mapped_paintable_clear (MksMappedPaintable *self)
 }
 
 void
-mks_mapped_paintable_damage (MksMappedPaintable *self,
-                             cairo_region_t     *region)
+mks_mapped_paintable_damage (MksMappedPaintable          *self,
+                             const cairo_rectangle_int_t *area)
 {
   g_return_if_fail (MKS_IS_MAPPED_PAINTABLE (self));
-  g_return_if_fail (region != NULL);
+  g_return_if_fail (area != NULL);
 
-  if (self->update_region == NULL)
-    self->update_region = cairo_region_copy (region);
-  else
-    cairo_region_union (self->update_region, region);
+  mks_damage_add (&self->damage, area);
 
-  self->dirty = TRUE;
-  gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
+  /* The texture is rebuilt lazily when snapshot so only the first damage
+   * since then needs to invalidate. Everything else joins that frame.
+   */
+  if (!self->dirty)
+    {
+      self->dirty = TRUE;
+      gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
+    }
+}
+
+/**
+ * mks_mapped_paintable_publish:
+ * @self: a #MksMappedPaintable
+ * @publisher: a #MksShmPublisher
+ * @area: (nullable): the area to publish, or %NULL for everything
+ *
+ * Copies @area of the shared map to the readers of @publisher.
+ */
+void
+mks_mapped_paintable_publish (MksMappedPaintable          *self,
+                              MksShmPublisher             *publisher,
+                              const cairo_rectangle_int_t *area)
+{
+  g_return_if_fail (MKS_IS_MAPPED_PAINTABLE (self));
+  g_return_if_fail (publisher != NULL);
+
+  if (self->bytes == NULL)
+    {
+      mks_shm_publisher_clear (publisher);
+      return;
+    }
+
+  mks_shm_publisher_publish (publisher,
+                             g_bytes_get_data (self->bytes, NULL),
+                             self->stride,
+                             self->width,
+                             self->height,
+                             self->pixman_format,
+                             area);
 }
@@ -22,26 +22,34 @@
 
 #include <gtk/gtk.h>
 
+#include "mks-frame-stats.h"
+
 G_BEGIN_DECLS
 
 #define MKS_TYPE_PAINTABLE (mks_paintable_get_type())
 
 G_DECLARE_FINAL_TYPE (MksPaintable, mks_paintable, MKS, PAINTABLE, GObject)
 
-GdkPaintable *_mks_paintable_new          (GdkDisplay    *display,
-                                           GCancellable  *cancellable,
-                                           int           *peer_fd,
-                                           GError       **error);
-GdkCursor    *_mks_paintable_get_cursor   (MksPaintable  *self);
-void          _mks_paintable_snapshot     (MksPaintable  *self,
-                                           GtkSnapshot   *snapshot,
-                                           double         width,
-                                           double         height,
-                                           double         surface_x,
-                                           double         surface_y,
-                                           int            scale);
-void          _mks_paintable_get_position (MksPaintable  *self,
-                                           int           *x,
-                                           int           *y);
+GdkPaintable  *_mks_paintable_new             (GdkDisplay    *display,
+                                               GCancellable  *cancellable,
+                                               int           *peer_fd,
+                                               GError       **error);
+GdkCursor     *_mks_paintable_get_cursor      (MksPaintable  *self);
+MksFrameStats *_mks_paintable_get_frame_stats (MksPaintable  *self);
+void           _mks_paintable_snapshot        (MksPaintable  *self,
+                                               GtkSnapshot   *snapshot,
+                                               double         width,
+                                               double         height,
+                                               double         surface_x,
+                                               double         surface_y,
+                                               int            scale);
+void           _mks_paintable_get_position    (MksPaintable  *self,
+                                               int           *x,
+                                               int           *y);
+int            _mks_paintable_share           (MksPaintable  *self,
+                                               GError       **error);
+void           _mks_paintable_suspend         (MksPaintable  *self);
+int            _mks_paintable_resume          (MksPaintable  *self,
+                                               GError       **error);
 
 G_END_DECLS
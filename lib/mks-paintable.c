@@ -28,10 +28,15 @@
 #include <pixman.h>
 
 #include "mks-cairo-framebuffer-private.h"
+#include "mks-cursor-cache-private.h"
 #include "mks-dmabuf-paintable-private.h"
+#include "mks-frame-stats-private.h"
+#include "mks-map-cache-private.h"
 #include "mks-mapped-paintable-private.h"
 #include "mks-paintable-private.h"
+#include "mks-pixels-private.h"
 #include "mks-qemu.h"
+#include "mks-shm-publisher-private.h"
 #include "mks-util-private.h"
 
 #include "mks-marshal.h"
@@ -44,14 +49,133 @@ struct _MksPaintable
   MksQemuListenerUnixMap            *listener_map;
   GDBusConnection                   *connection;
   GdkDisplay                        *display;
+
+  /* Bumped whenever the connection is opened or closed so that a
+   * connection which completes after _mks_paintable_suspend() is not
+   * exported. Only used from the main thread.
+   */
+  guint                              connection_generation;
+
   GdkPaintable                      *child;
   GdkCursor                         *cursor;
+  MksCursorCache                    *cursor_cache;
   MksDmabufScanoutData              *scanout_data;
+  guint                              scanout_generation;
+
+  /* Recent ScanoutMap mappings, kept across child changes so that a
+   * console switch back to a shared map does not need to remap it.
+   */
+  MksMapCache                       *map_cache;
+
+  /* Surfaces for framebuffers, reused across resolution changes */
+  MksSurfacePool                    *surface_pool;
+
+  /* Updates are recorded here as they are received, possibly from
+   * the display worker thread.
+   */
+  MksFrameStats                     *frame_stats;
+
+  /* The context we were created on which owns @child and where all
+   * signals and property notifications are emitted.
+   */
+  GMainContext                      *main_context;
+
+  /* When MKS_DEBUG=display-thread is set, the listener is dispatched
+   * on @worker_context from @worker_thread so that decoding and painting
+   * of pixel data does not compete with input and layout.
+   */
+  GMainContext                      *worker_context;
+  GThread                           *worker_thread;
+  int                                worker_stopping;
+
+  /* Protects @framebuffer which is the cairo framebuffer Update and
+   * Scanout draw into. It may run ahead of @child while a replacement
+   * is being published to the main thread. It is only replaced, detached
+   * or cleared where the listener is dispatched so that happens in the
+   * order QEMU sent the calls, see mks_paintable_connect_dispatch().
+   *
+   * Also protects @shm_publisher which copies the contents for readers
+   * in other processes once _mks_paintable_share() was called.
+   */
+  GMutex                             mutex;
+  MksCairoFramebuffer               *framebuffer;
+  MksShmPublisher                   *shm_publisher;
+
+  /* When MKS_DEBUG=pipeline is set, Update and Scanout are acknowledged
+   * as soon as they are validated and the payloads are queued here to be
+   * applied from @pending_source. Both are only used from the context the
+   * listener is dispatched on. @pending_epoch is bumped along with
+   * detaching or clearing @framebuffer so that queued payloads received
+   * before that are dropped.
+   */
+  GQueue                             pending;
+  GSource                           *pending_source;
+  int                                pending_epoch;
+
+  /* MouseSet may arrive many times per frame. We coalesce them and emit
+   * the latest position once per frame from @mouse_set_source.
+   */
+  guint                              mouse_set_source;
   int                                mouse_x;
   int                                mouse_y;
+
+  /* Set while "activity" is queued or was emitted less than
+   * MKS_PAINTABLE_ACTIVITY_INTERVAL ago, from any thread.
+   */
+  int                                activity_queued;
+
   guint                              y0_top : 1;
+  guint                              pipeline : 1;
 };
 
+typedef struct _MksPendingUpdate
+{
+  GList   link;
+  GBytes *bytes;
+  int     epoch;
+  int     x;
+  int     y;
+  int     width;
+  int     height;
+  guint   stride;
+  guint   pixman_format;
+  guint   is_scanout : 1;
+} MksPendingUpdate;
+
+typedef struct _MksMainClosure
+{
+  GClosure      closure;
+  GClosure     *target;
+  GMainContext *main_context;
+} MksMainClosure;
+
+typedef void (*MksPaintableDispatchFunc) (MksPaintable *self);
+
+typedef struct _MksMainCall
+{
+  GClosure *target;
+  GValue   *param_values;
+  guint     n_param_values;
+} MksMainCall;
+
+typedef struct _MksPaintableOpen
+{
+  MksPaintable *self;
+  guint         generation;
+} MksPaintableOpen;
+
+typedef struct _MksPaintableExport
+{
+  MksPaintable    *self;
+  GDBusConnection *connection;
+} MksPaintableExport;
+
+typedef struct _MksPublishFramebuffer
+{
+  MksPaintable        *self;
+  MksCairoFramebuffer *framebuffer;
+} MksPublishFramebuffer;
+
 enum {
   PROP_0,
   PROP_CURSOR,
@@ -60,6 +184,7 @@ enum {
 };
 
 enum {
+  ACTIVITY,
   MOUSE_SET,
   N_SIGNALS
 };
@@ -67,33 +192,59 @@ enum {
 static GParamSpec *properties [N_PROPS];
 static guint signals [N_SIGNALS];
 
+/* Once this many payloads are queued, Update and Scanout apply the queue
+ * before replying so QEMU is throttled to the rate we can paint at.
+ */
+#define MKS_PENDING_UPDATE_MAX 4
+
+/* "activity" is emitted at most this often (in msec), which is as often
+ * as MksScreen:last-active-time may advance.
+ */
+#define MKS_PAINTABLE_ACTIVITY_INTERVAL 250
+
+G_LOCK_DEFINE_STATIC (stall);
+static gint64 stall_total;
+static guint stall_counter;
+static gsize stall_counter_initialized;
+
+/* Framebuffers are always 32-bit ARGB with other guest formats being
+ * converted into them as damage arrives.
+ */
 static cairo_format_t
-_pixman_format_to_cairo_format (guint pixman_format)
+_pixman_format_to_framebuffer_format (guint pixman_format)
 {
-  switch (pixman_format)
-    {
-#if _CAIRO_CHECK_VERSION(1, 17, 2)
-    case PIXMAN_rgba_float:
-      return CAIRO_FORMAT_RGBA128F;
-    case PIXMAN_rgb_float:
-      return CAIRO_FORMAT_RGB96F;
-#endif
-
-    case PIXMAN_a8r8g8b8:
-      return CAIRO_FORMAT_ARGB32;
-    case PIXMAN_x2r10g10b10:
-      return CAIRO_FORMAT_RGB30;
-    case PIXMAN_x8r8g8b8:
-      return CAIRO_FORMAT_RGB24;
-    case PIXMAN_a8:
-      return CAIRO_FORMAT_A8;
-    case PIXMAN_a1:
-      return CAIRO_FORMAT_A1;
-    case PIXMAN_r5g6b5:
-      return CAIRO_FORMAT_RGB16_565;
-    default:
-      return 0;
-  }
+  cairo_format_t format;
+
+  if (mks_pixels_can_convert (pixman_format))
+    return PIXMAN_FORMAT_A (pixman_format) ? CAIRO_FORMAT_ARGB32 : CAIRO_FORMAT_RGB24;
+
+  format = mks_pixman_format_to_cairo_format (pixman_format);
+
+  if (format == CAIRO_FORMAT_ARGB32 || format == CAIRO_FORMAT_RGB24)
+    return format;
+
+  return CAIRO_FORMAT_INVALID;
+}
+
+static gboolean
+mks_paintable_check_stride (guint pixman_format,
+                            guint width,
+                            guint height,
+                            guint stride,
+                            gsize data_len)
+{
+  gsize row_bytes;
+
+  if (width == 0 || height == 0)
+    return TRUE;
+
+  /* We copy rows directly from the message so the last row must be
+   * within the data even when the stride is larger than the row.
+   */
+  row_bytes = ((gsize)width * PIXMAN_FORMAT_BPP (pixman_format) + 7) / 8;
+
+  return stride >= row_bytes &&
+         data_len >= ((gsize)stride * (height - 1)) + row_bytes;
 }
 
 static int
@@ -147,12 +298,87 @@ paintable_iface_init (GdkPaintableInterface *iface)
 G_DEFINE_FINAL_TYPE_WITH_CODE (MksPaintable, mks_paintable, G_TYPE_OBJECT,
                                G_IMPLEMENT_INTERFACE (GDK_TYPE_PAINTABLE, paintable_iface_init))
 
+static void
+mks_pending_update_free (MksPendingUpdate *pending)
+{
+  g_clear_pointer (&pending->bytes, g_bytes_unref);
+  g_free (pending);
+}
+
+static void
+mks_paintable_clear_pending (MksPaintable *self)
+{
+  MksPendingUpdate *pending;
+
+  while ((pending = g_queue_peek_head (&self->pending)))
+    {
+      g_queue_unlink (&self->pending, &pending->link);
+      mks_pending_update_free (pending);
+    }
+}
+
+/*
+ * mks_paintable_record_stall:
+ *
+ * Adds the time QEMU has been waiting since @begin_time for the reply
+ * to an Update or Scanout to the "QEMU Stall" counter.
+ */
+static void
+mks_paintable_record_stall (gint64 begin_time)
+{
+  gint64 total;
+
+  if (g_once_init_enter (&stall_counter_initialized))
+    {
+      stall_counter = mks_trace_counter_new ("Display",
+                                             "QEMU Stall",
+                                             "Time QEMU waited for Update/Scanout (usec)");
+      g_once_init_leave (&stall_counter_initialized, TRUE);
+    }
+
+  if (stall_counter == 0)
+    return;
+
+  G_LOCK (stall);
+  stall_total += g_get_monotonic_time () - begin_time;
+  total = stall_total;
+  G_UNLOCK (stall);
+
+  mks_trace_counter_set (stall_counter, total);
+}
+
 static void
 mks_paintable_dispose (GObject *object)
 {
   MksPaintable *self = (MksPaintable *)object;
 
-  g_clear_object (&self->connection);
+  /* Stop the worker before releasing anything it may be using. The
+   * worker never blocks on the main thread so this cannot deadlock.
+   */
+  if (self->worker_thread != NULL)
+    {
+      g_atomic_int_set (&self->worker_stopping, TRUE);
+      g_main_context_wakeup (self->worker_context);
+      g_thread_join (g_steal_pointer (&self->worker_thread));
+    }
+
+  if (self->pending_source != NULL)
+    {
+      g_source_destroy (self->pending_source);
+      g_clear_pointer (&self->pending_source, g_source_unref);
+    }
+
+  mks_paintable_clear_pending (self);
+
+  g_mutex_lock (&self->mutex);
+  g_clear_object (&self->framebuffer);
+  g_clear_pointer (&self->shm_publisher, mks_shm_publisher_unref);
+  g_mutex_unlock (&self->mutex);
+
+  g_clear_handle_id (&self->mouse_set_source, g_source_remove);
+
+  /* Other references to the connection may outlive us */
+  mks_listener_connection_clear (&self->connection);
   g_clear_object (&self->listener);
   g_clear_object (&self->listener_dmabuf2);
   g_clear_object (&self->listener_map);
@@ -164,6 +390,22 @@ mks_paintable_dispose (GObject *object)
   G_OBJECT_CLASS (mks_paintable_parent_class)->dispose (object);
 }
 
+static void
+mks_paintable_finalize (GObject *object)
+{
+  MksPaintable *self = (MksPaintable *)object;
+
+  g_clear_pointer (&self->worker_context, g_main_context_unref);
+  g_clear_pointer (&self->main_context, g_main_context_unref);
+  g_clear_pointer (&self->map_cache, mks_map_cache_free);
+  g_clear_pointer (&self->cursor_cache, mks_cursor_cache_free);
+  g_clear_pointer (&self->surface_pool, mks_surface_pool_unref);
+  g_clear_object (&self->frame_stats);
+  g_mutex_clear (&self->mutex);
+
+  G_OBJECT_CLASS (mks_paintable_parent_class)->finalize (object);
+}
+
 static void
 mks_paintable_get_property (GObject    *object,
                             guint       prop_id,
@@ -193,6 +435,7 @@ mks_paintable_class_init (MksPaintableClass *klass)
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
   object_class->dispose = mks_paintable_dispose;
+  object_class->finalize = mks_paintable_finalize;
   object_class->get_property = mks_paintable_get_property;
 
   properties [PROP_CURSOR] =
@@ -207,6 +450,16 @@ mks_paintable_class_init (MksPaintableClass *klass)
 
   g_object_class_install_properties (object_class, N_PROPS, properties);
 
+  /* The guest changed the contents, emitted whether or not they are drawn */
+  signals [ACTIVITY] =
+    g_signal_new ("activity",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL,
+                  NULL,
+                  G_TYPE_NONE, 0);
+
   signals [MOUSE_SET] =
     g_signal_new ("mouse-set",
                   G_TYPE_FROM_CLASS (klass),
@@ -223,6 +476,201 @@ mks_paintable_class_init (MksPaintableClass *klass)
 static void
 mks_paintable_init (MksPaintable *self)
 {
+  self->main_context = g_main_context_ref_thread_default ();
+  self->map_cache = mks_map_cache_new ();
+  self->cursor_cache = mks_cursor_cache_new ();
+  self->surface_pool = mks_surface_pool_new ();
+  self->frame_stats = mks_frame_stats_new ();
+  g_mutex_init (&self->mutex);
+}
+
+static gpointer
+mks_paintable_worker_thread (gpointer data)
+{
+  MksPaintable *self = data;
+
+  /* @self is guaranteed to be alive here as dispose joins the thread */
+  g_main_context_push_thread_default (self->worker_context);
+  while (!g_atomic_int_get (&self->worker_stopping))
+    g_main_context_iteration (self->worker_context, TRUE);
+  g_main_context_pop_thread_default (self->worker_context);
+
+  return NULL;
+}
+
+static gboolean
+mks_main_call_dispatch (gpointer data)
+{
+  MksMainCall *call = data;
+  GValue return_value = G_VALUE_INIT;
+
+  g_value_init (&return_value, G_TYPE_BOOLEAN);
+  g_closure_invoke (call->target,
+                    &return_value,
+                    call->n_param_values,
+                    call->param_values,
+                    NULL);
+  g_value_unset (&return_value);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+mks_main_call_free (gpointer data)
+{
+  MksMainCall *call = data;
+
+  for (guint i = 0; i < call->n_param_values; i++)
+    g_value_unset (&call->param_values[i]);
+  g_free (call->param_values);
+  g_closure_unref (call->target);
+  g_free (call);
+}
+
+static void
+mks_main_closure_marshal (GClosure     *closure,
+                          GValue       *return_value,
+                          guint         n_param_values,
+                          const GValue *param_values,
+                          gpointer      invocation_hint,
+                          gpointer      marshal_data)
+{
+  MksMainClosure *main_closure = (MksMainClosure *)closure;
+  MksMainCall *call;
+
+  if (g_main_context_is_owner (main_closure->main_context))
+    {
+      g_closure_invoke (main_closure->target,
+                        return_value,
+                        n_param_values,
+                        param_values,
+                        invocation_hint);
+      return;
+    }
+
+  call = g_new0 (MksMainCall, 1);
+  call->target = g_closure_ref (main_closure->target);
+  call->n_param_values = n_param_values;
+  call->param_values = g_new0 (GValue, n_param_values);
+
+  for (guint i = 0; i < n_param_values; i++)
+    {
+      g_value_init (&call->param_values[i], G_VALUE_TYPE (&param_values[i]));
+      g_value_copy (&param_values[i], &call->param_values[i]);
+    }
+
+  g_main_context_invoke_full (main_closure->main_context,
+                              G_PRIORITY_DEFAULT,
+                              mks_main_call_dispatch,
+                              call,
+                              mks_main_call_free);
+
+  /* The method invocation will be completed from the main thread */
+  if (return_value != NULL)
+    g_value_set_boolean (return_value, TRUE);
+}
+
+static void
+mks_main_closure_finalize (gpointer  data,
+                           GClosure *closure)
+{
+  MksMainClosure *main_closure = (MksMainClosure *)closure;
+
+  g_closure_unref (main_closure->target);
+  g_main_context_unref (main_closure->main_context);
+}
+
+/*
+ * mks_paintable_connect:
+ *
+ * Connects @callback to @signal_name on @instance with @self swapped
+ * in as the first parameter.
+ *
+ * If @main_thread_only is set and the listener is dispatched from the
+ * display worker, the emission is re-dispatched on the main context.
+ * That is used for handlers which touch @child, the cursor, or emit
+ * signals that widgets are connected to.
+ */
+static void
+mks_paintable_connect (MksPaintable *self,
+                       gpointer      instance,
+                       const char   *signal_name,
+                       GCallback     callback,
+                       gboolean      main_thread_only)
+{
+  MksMainClosure *main_closure;
+  GClosure *closure;
+
+  g_assert (MKS_IS_PAINTABLE (self));
+  g_assert (G_IS_OBJECT (instance));
+
+  if (self->worker_context == NULL || !main_thread_only)
+    {
+      g_signal_connect_object (instance,
+                               signal_name,
+                               callback,
+                               self,
+                               G_CONNECT_SWAPPED);
+      return;
+    }
+
+  closure = g_closure_new_simple (sizeof (MksMainClosure), NULL);
+  main_closure = (MksMainClosure *)closure;
+  main_closure->main_context = g_main_context_ref (self->main_context);
+  main_closure->target = g_cclosure_new_object_swap (callback, G_OBJECT (self));
+  g_closure_ref (main_closure->target);
+  g_closure_sink (main_closure->target);
+  g_closure_set_marshal (main_closure->target, g_cclosure_marshal_generic);
+
+  g_closure_set_marshal (closure, mks_main_closure_marshal);
+  g_closure_add_finalize_notifier (closure, NULL, mks_main_closure_finalize);
+  g_object_watch_closure (G_OBJECT (self), closure);
+
+  g_signal_connect_closure (instance, signal_name, closure, FALSE);
+}
+
+static void
+mks_dispatch_closure_marshal (GClosure     *closure,
+                              GValue       *return_value,
+                              guint         n_param_values,
+                              const GValue *param_values,
+                              gpointer      invocation_hint,
+                              gpointer      marshal_data)
+{
+  MksPaintableDispatchFunc func = (MksPaintableDispatchFunc)((GCClosure *)closure)->callback;
+
+  func (closure->data);
+
+  /* Let the handler connected after us complete the invocation */
+  if (return_value != NULL)
+    g_value_set_boolean (return_value, FALSE);
+}
+
+/*
+ * mks_paintable_connect_dispatch:
+ *
+ * Connects @func to run for @signal_name on @instance where the listener
+ * is dispatched, before the handler connected afterwards with
+ * mks_paintable_connect().
+ *
+ * Handlers re-dispatched on the main context run after calls QEMU sent
+ * later may have been handled by the display worker. Anything those
+ * calls depend on is therefore changed from @func instead.
+ */
+static void
+mks_paintable_connect_dispatch (MksPaintable             *self,
+                                gpointer                  instance,
+                                const char               *signal_name,
+                                MksPaintableDispatchFunc  func)
+{
+  GClosure *closure;
+
+  g_assert (MKS_IS_PAINTABLE (self));
+  g_assert (G_IS_OBJECT (instance));
+
+  closure = g_cclosure_new_object (G_CALLBACK (func), G_OBJECT (self));
+  g_closure_set_marshal (closure, mks_dispatch_closure_marshal);
+  g_signal_connect_closure (instance, signal_name, closure, FALSE);
 }
 
 static void
@@ -245,6 +693,148 @@ mks_paintable_invalidate_size_cb (MksPaintable *self,
   gdk_paintable_invalidate_size (GDK_PAINTABLE (self));
 }
 
+static gboolean
+mks_paintable_activity_rearm_cb (gpointer data)
+{
+  MksPaintable *self = data;
+
+  g_assert (MKS_IS_PAINTABLE (self));
+
+  g_atomic_int_set (&self->activity_queued, FALSE);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+mks_paintable_activity_cb (gpointer data)
+{
+  MksPaintable *self = data;
+
+  g_assert (MKS_IS_PAINTABLE (self));
+
+  g_signal_emit (self, signals[ACTIVITY], 0);
+
+  g_timeout_add_full (G_PRIORITY_DEFAULT,
+                      MKS_PAINTABLE_ACTIVITY_INTERVAL,
+                      mks_paintable_activity_rearm_cb,
+                      g_object_ref (self),
+                      g_object_unref);
+
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * mks_paintable_mark_active:
+ *
+ * Emits "activity" on the main context unless it was emitted recently.
+ * This may be called from the display worker thread.
+ */
+static void
+mks_paintable_mark_active (MksPaintable *self)
+{
+  g_assert (MKS_IS_PAINTABLE (self));
+
+  if (!g_atomic_int_compare_and_exchange (&self->activity_queued, FALSE, TRUE))
+    return;
+
+  g_main_context_invoke_full (self->main_context,
+                              G_PRIORITY_DEFAULT,
+                              mks_paintable_activity_cb,
+                              g_object_ref (self),
+                              g_object_unref);
+}
+
+/*
+ * mks_paintable_record_update:
+ *
+ * Records an update of @n_bytes of pixel data in the frame statistics
+ * and marks @self active. This may be called from the display worker.
+ */
+static void
+mks_paintable_record_update (MksPaintable *self,
+                             gsize         n_bytes)
+{
+  g_assert (MKS_IS_PAINTABLE (self));
+
+  mks_frame_stats_record_update (self->frame_stats, n_bytes);
+  mks_paintable_mark_active (self);
+}
+
+static MksCairoFramebuffer *
+mks_paintable_dup_framebuffer (MksPaintable *self)
+{
+  MksCairoFramebuffer *ret = NULL;
+
+  g_assert (MKS_IS_PAINTABLE (self));
+
+  g_mutex_lock (&self->mutex);
+  g_set_object (&ret, self->framebuffer);
+  g_mutex_unlock (&self->mutex);
+
+  return ret;
+}
+
+static MksShmPublisher *
+mks_paintable_dup_shm_publisher (MksPaintable *self)
+{
+  MksShmPublisher *ret = NULL;
+
+  g_assert (MKS_IS_PAINTABLE (self));
+
+  g_mutex_lock (&self->mutex);
+  if (self->shm_publisher != NULL)
+    ret = mks_shm_publisher_ref (self->shm_publisher);
+  g_mutex_unlock (&self->mutex);
+
+  return ret;
+}
+
+/*
+ * mks_paintable_share_framebuffer:
+ *
+ * Copies @area of @framebuffer to other processes if shared. This may
+ * be called from the display worker thread.
+ */
+static void
+mks_paintable_share_framebuffer (MksPaintable                *self,
+                                 MksCairoFramebuffer         *framebuffer,
+                                 const cairo_rectangle_int_t *area)
+{
+  g_autoptr(MksShmPublisher) publisher = NULL;
+
+  g_assert (MKS_IS_PAINTABLE (self));
+  g_assert (MKS_IS_CAIRO_FRAMEBUFFER (framebuffer));
+
+  if ((publisher = mks_paintable_dup_shm_publisher (self)))
+    mks_cairo_framebuffer_publish (framebuffer, publisher, area);
+}
+
+/*
+ * mks_paintable_share_child:
+ *
+ * Copies the whole contents to other processes if shared, or tells them
+ * there are none for children which cannot be read back.
+ */
+static void
+mks_paintable_share_child (MksPaintable *self)
+{
+  g_autoptr(MksShmPublisher) publisher = NULL;
+  g_autoptr(MksCairoFramebuffer) framebuffer = NULL;
+
+  g_assert (MKS_IS_PAINTABLE (self));
+
+  if (!(publisher = mks_paintable_dup_shm_publisher (self)))
+    return;
+
+  /* The worker may already draw into a newer framebuffer than @child */
+  if ((framebuffer = mks_paintable_dup_framebuffer (self)))
+    mks_cairo_framebuffer_publish (framebuffer, publisher, NULL);
+  else if (MKS_IS_MAPPED_PAINTABLE (self->child))
+    mks_mapped_paintable_publish (MKS_MAPPED_PAINTABLE (self->child), publisher, NULL);
+  else
+    mks_shm_publisher_clear (publisher);
+}
+
 static void
 mks_paintable_set_child (MksPaintable *self,
                          GdkPaintable *child)
@@ -257,6 +847,10 @@ mks_paintable_set_child (MksPaintable *self,
   if (self->child == child)
     return;
 
+  /* Scanout always provides top-down contents */
+  if (MKS_IS_CAIRO_FRAMEBUFFER (child))
+    self->y0_top = TRUE;
+
   size_changed = self->child == NULL ||
                  child == NULL ||
                  gdk_paintable_get_intrinsic_width (self->child) != gdk_paintable_get_intrinsic_width (child) ||
@@ -288,6 +882,8 @@ mks_paintable_set_child (MksPaintable *self,
                                G_CONNECT_SWAPPED);
     }
 
+  mks_paintable_share_child (self);
+
   gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
 
   if (size_changed)
@@ -296,6 +892,71 @@ mks_paintable_set_child (MksPaintable *self,
   g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_PAINTABLE]);
 }
 
+static void
+mks_publish_framebuffer_free (gpointer data)
+{
+  MksPublishFramebuffer *state = data;
+
+  g_clear_object (&state->self);
+  g_clear_object (&state->framebuffer);
+  g_free (state);
+}
+
+static gboolean
+mks_paintable_publish_framebuffer_cb (gpointer data)
+{
+  MksPublishFramebuffer *state = data;
+  MksPaintable *self = state->self;
+  gboolean is_current;
+
+  g_assert (MKS_IS_PAINTABLE (self));
+  g_assert (MKS_IS_CAIRO_FRAMEBUFFER (state->framebuffer));
+
+  /* Drop stale framebuffers which were replaced before we got here */
+  g_mutex_lock (&self->mutex);
+  is_current = self->framebuffer == state->framebuffer;
+  g_mutex_unlock (&self->mutex);
+
+  if (is_current)
+    mks_paintable_set_child (self, GDK_PAINTABLE (state->framebuffer));
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+mks_paintable_replace_framebuffer (MksPaintable        *self,
+                                   MksCairoFramebuffer *framebuffer)
+{
+  MksPublishFramebuffer *state;
+
+  g_assert (MKS_IS_PAINTABLE (self));
+  g_assert (MKS_IS_CAIRO_FRAMEBUFFER (framebuffer));
+
+  g_mutex_lock (&self->mutex);
+  g_set_object (&self->framebuffer, framebuffer);
+  g_mutex_unlock (&self->mutex);
+
+  if (g_main_context_is_owner (self->main_context))
+    {
+      mks_paintable_set_child (self, GDK_PAINTABLE (framebuffer));
+      return;
+    }
+
+  /* This is queued with the same priority as handlers re-dispatched by
+   * mks_main_closure_marshal() so they are applied in the order QEMU sent
+   * them. Anything replacing @framebuffer later makes this one stale.
+   */
+  state = g_new0 (MksPublishFramebuffer, 1);
+  state->self = g_object_ref (self);
+  state->framebuffer = g_object_ref (framebuffer);
+
+  g_main_context_invoke_full (self->main_context,
+                              G_PRIORITY_DEFAULT,
+                              mks_paintable_publish_framebuffer_cb,
+                              state,
+                              mks_publish_framebuffer_free);
+}
+
 static gboolean
 mks_paintable_listener_scanout_map (MksPaintable           *self,
                                     GDBusMethodInvocation  *invocation,
@@ -310,6 +971,7 @@ mks_paintable_listener_scanout_map (MksPaintable           *self,
 {
   g_autoptr(MksMappedPaintable) child = NULL;
   g_autoptr(GError) error = NULL;
+  g_autoptr(GBytes) bytes = NULL;
   int map_fd = -1;
   guint fd_index;
 
@@ -340,9 +1002,26 @@ mks_paintable_listener_scanout_map (MksPaintable           *self,
       return TRUE;
     }
 
-  if (!mks_mapped_paintable_import (MKS_MAPPED_PAINTABLE (self->child),
-                                    map_fd,
-                                    offset,
+  if (width == 0 || height == 0 || stride == 0)
+    {
+      g_dbus_method_invocation_return_error_literal (invocation,
+                                                     G_IO_ERROR,
+                                                     G_IO_ERROR_INVALID_ARGUMENT,
+                                                     "Invalid shared map");
+      g_clear_fd (&map_fd, NULL);
+      return TRUE;
+    }
+
+  bytes = mks_map_cache_lookup (self->map_cache,
+                                map_fd,
+                                offset,
+                                (gsize) stride * height,
+                                &error);
+  g_clear_fd (&map_fd, NULL);
+
+  if (bytes == NULL ||
+      !mks_mapped_paintable_import (MKS_MAPPED_PAINTABLE (self->child),
+                                    bytes,
                                     width,
                                     height,
                                     stride,
@@ -351,11 +1030,12 @@ mks_paintable_listener_scanout_map (MksPaintable           *self,
                                     &error))
     {
       g_dbus_method_invocation_return_gerror (invocation, error);
-      g_clear_fd (&map_fd, NULL);
       return TRUE;
     }
 
-  g_clear_fd (&map_fd, NULL);
+  mks_paintable_share_child (self);
+
+  mks_paintable_record_update (self, (gsize)stride * height);
   mks_qemu_listener_unix_map_complete_scanout_map (listener, invocation, NULL);
   return TRUE;
 }
@@ -369,7 +1049,7 @@ mks_paintable_listener_update_map (MksPaintable           *self,
                                    int                     height,
                                    MksQemuListenerUnixMap *listener)
 {
-  cairo_region_t *region;
+  g_autoptr(MksShmPublisher) publisher = NULL;
 
   g_assert (MKS_IS_PAINTABLE (self));
   g_assert (G_IS_DBUS_METHOD_INVOCATION (invocation));
@@ -381,9 +1061,14 @@ mks_paintable_listener_update_map (MksPaintable           *self,
       return TRUE;
     }
 
-  region = cairo_region_create_rectangle (&(cairo_rectangle_int_t) { x, y, width, height });
-  mks_mapped_paintable_damage (MKS_MAPPED_PAINTABLE (self->child), region);
-  cairo_region_destroy (region);
+  mks_mapped_paintable_damage (MKS_MAPPED_PAINTABLE (self->child),
+                               &(cairo_rectangle_int_t) { x, y, width, height });
+
+  if ((publisher = mks_paintable_dup_shm_publisher (self)))
+    mks_mapped_paintable_publish (MKS_MAPPED_PAINTABLE (self->child),
+                                  publisher,
+                                  &(cairo_rectangle_int_t) { x, y, width, height });
+  mks_paintable_record_update (self, (gsize)width * height * 4);
   mks_qemu_listener_unix_map_complete_update_map (listener, invocation);
   return TRUE;
 }
@@ -449,10 +1134,12 @@ mks_paintable_listener_scanout_dmabuf (MksPaintable          *self,
   scanout_data->stride[0] = stride;
   scanout_data->fourcc = fourcc;
   scanout_data->modifier = modifier;
+  scanout_data->generation = ++self->scanout_generation;
 
   g_clear_pointer (&self->scanout_data, mks_dmabuf_scanout_data_free);
   self->scanout_data = scanout_data;
 
+  mks_paintable_mark_active (self);
   mks_qemu_listener_complete_scanout_dmabuf (listener, invocation, NULL);
 
   return TRUE;
@@ -532,6 +1219,7 @@ mks_paintable_listener_scanout_dmabuf2 (MksPaintable                      *self,
   scanout_data->n_planes = num_planes;
   scanout_data->fourcc = fourcc;
   scanout_data->modifier = modifier;
+  scanout_data->generation = ++self->scanout_generation;
 
   for (i = 0; i < num_planes; i++)
     {
@@ -561,6 +1249,7 @@ mks_paintable_listener_scanout_dmabuf2 (MksPaintable                      *self,
   g_clear_pointer (&self->scanout_data, mks_dmabuf_scanout_data_free);
   self->scanout_data = g_steal_pointer (&scanout_data);
 
+  mks_paintable_mark_active (self);
   mks_qemu_listener_unix_scanout_dmabuf2_complete_scanout_dmabuf2 (listener, invocation, NULL);
 
   return TRUE;
@@ -575,7 +1264,6 @@ mks_paintable_listener_update_dmabuf (MksPaintable          *self,
                                       int                    height,
                                       MksQemuListener       *listener)
 {
-  cairo_region_t *region = NULL;
   g_autoptr(GError) error = NULL;
 
   g_assert (MKS_IS_PAINTABLE (self));
@@ -591,25 +1279,236 @@ mks_paintable_listener_update_dmabuf (MksPaintable          *self,
         y = self->scanout_data->y + y;
 
       x = self->scanout_data->x + x;
-      region = cairo_region_create_rectangle (&(cairo_rectangle_int_t) { x, y, width, height });
       if (!mks_dmabuf_paintable_import (MKS_DMABUF_PAINTABLE (self->child),
                                         self->display,
                                         self->scanout_data,
-                                        region,
+                                        &(cairo_rectangle_int_t) { x, y, width, height },
                                         &error))
         {
           g_dbus_method_invocation_return_gerror (invocation, error);
-          goto cleanup;
+          return TRUE;
         }
+
+      mks_paintable_record_update (self, (gsize)width * height * 4);
     }
 
   mks_qemu_listener_complete_update_dmabuf (listener, invocation);
-cleanup:
-  g_clear_pointer (&region, cairo_region_destroy);
 
   return TRUE;
 }
 
+static void
+mks_paintable_apply_update (MksPaintable *self,
+                            int           x,
+                            int           y,
+                            int           width,
+                            int           height,
+                            guint         stride,
+                            guint         pixman_format,
+                            const guint8 *data)
+{
+  g_autoptr(MksCairoFramebuffer) framebuffer = NULL;
+  int fb_width;
+  int fb_height;
+
+  g_assert (MKS_IS_PAINTABLE (self));
+
+  /* The child may have been replaced while this update was queued */
+  if (!(framebuffer = mks_paintable_dup_framebuffer (self)))
+    return;
+
+  /* We can get in a protocol race condition here in that we will get updates
+   * for framebuffer content _BEFORE_ we'll get notified of property changes
+   * about the MksQemuConsole's size.
+   *
+   * To overcome that, if we detect something larger than our current
+   * framebuffer, we'll resize it and draw over the old contents in a
+   * new framebuffer.
+   *
+   * When shrinking, we can do this as well and then handle it when the
+   * console size notification arrives.
+   *
+   * Generally this is seen at startup during EFI/BIOS.
+   */
+  fb_width = mks_cairo_framebuffer_get_width (framebuffer);
+  fb_height = mks_cairo_framebuffer_get_height (framebuffer);
+
+  if (x + width > fb_width || y + height > fb_height)
+    {
+      guint max_width = MAX (fb_width, x + width);
+      guint max_height = MAX (fb_height, y + height);
+      g_autoptr(MksCairoFramebuffer) resized = NULL;
+
+      resized = mks_cairo_framebuffer_new_resized (framebuffer, max_width, max_height);
+      mks_paintable_replace_framebuffer (self, resized);
+      g_set_object (&framebuffer, resized);
+    }
+
+  mks_cairo_framebuffer_blit (framebuffer, x, y, width, height, pixman_format, data, stride);
+  mks_paintable_share_framebuffer (self, framebuffer, &(cairo_rectangle_int_t) { x, y, width, height });
+}
+
+static void
+mks_paintable_apply_scanout (MksPaintable *self,
+                             guint         width,
+                             guint         height,
+                             guint         stride,
+                             guint         pixman_format,
+                             const guint8 *data)
+{
+  g_autoptr(MksCairoFramebuffer) framebuffer = NULL;
+  cairo_format_t format;
+
+  g_assert (MKS_IS_PAINTABLE (self));
+
+  format = _pixman_format_to_framebuffer_format (pixman_format);
+  framebuffer = mks_paintable_dup_framebuffer (self);
+
+  if (framebuffer == NULL ||
+      format != mks_cairo_framebuffer_get_format (framebuffer) ||
+      width != mks_cairo_framebuffer_get_width (framebuffer) ||
+      height != mks_cairo_framebuffer_get_height (framebuffer))
+    {
+      g_clear_object (&framebuffer);
+      framebuffer = mks_cairo_framebuffer_new_for_pool (self->surface_pool, format, width, height);
+      mks_paintable_replace_framebuffer (self, framebuffer);
+    }
+
+  mks_cairo_framebuffer_blit (framebuffer, 0, 0, width, height, pixman_format, data, stride);
+  mks_paintable_share_framebuffer (self, framebuffer, NULL);
+}
+
+static void
+mks_paintable_apply_pending (MksPaintable *self)
+{
+  MksPendingUpdate *pending;
+  int epoch;
+
+  g_assert (MKS_IS_PAINTABLE (self));
+
+  MKS_TRACE_SCOPE ("paintable.apply-pending", "queued=%u", self->pending.length);
+
+  epoch = g_atomic_int_get (&self->pending_epoch);
+
+  while ((pending = g_queue_peek_head (&self->pending)))
+    {
+      const guint8 *data = g_bytes_get_data (pending->bytes, NULL);
+
+      g_queue_unlink (&self->pending, &pending->link);
+
+      /* Drop payloads received before Disable or a scanout of another kind */
+      if (pending->epoch == epoch)
+        {
+          if (pending->is_scanout)
+            mks_paintable_apply_scanout (self,
+                                         pending->width,
+                                         pending->height,
+                                         pending->stride,
+                                         pending->pixman_format,
+                                         data);
+          else
+            mks_paintable_apply_update (self,
+                                        pending->x,
+                                        pending->y,
+                                        pending->width,
+                                        pending->height,
+                                        pending->stride,
+                                        pending->pixman_format,
+                                        data);
+        }
+
+      mks_pending_update_free (pending);
+    }
+}
+
+static gboolean
+mks_paintable_pending_cb (gpointer data)
+{
+  MksPaintable *self = data;
+
+  g_assert (MKS_IS_PAINTABLE (self));
+
+  g_clear_pointer (&self->pending_source, g_source_unref);
+  mks_paintable_apply_pending (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+mks_paintable_has_pending_scanout (MksPaintable *self)
+{
+  int epoch = g_atomic_int_get (&self->pending_epoch);
+
+  for (const GList *iter = self->pending.head; iter; iter = iter->next)
+    {
+      const MksPendingUpdate *pending = iter->data;
+
+      if (pending->is_scanout && pending->epoch == epoch)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/*
+ * mks_paintable_queue_pending:
+ *
+ * Queues @pending to be applied once the listener's main context is
+ * idle, taking ownership of it.
+ *
+ * Queued payloads which @pending fully overwrites are dropped so that a
+ * burst of full-frame updates only paints the last one. If the queue is
+ * still full, it is applied synchronously which delays the reply to QEMU.
+ */
+static void
+mks_paintable_queue_pending (MksPaintable     *self,
+                             MksPendingUpdate *pending)
+{
+  const GList *iter;
+
+  g_assert (MKS_IS_PAINTABLE (self));
+  g_assert (pending != NULL);
+
+  iter = self->pending.head;
+
+  while (iter != NULL)
+    {
+      MksPendingUpdate *queued = iter->data;
+
+      iter = iter->next;
+
+      if (pending->is_scanout ||
+          queued->epoch != pending->epoch ||
+          (!queued->is_scanout &&
+           queued->x >= pending->x &&
+           queued->y >= pending->y &&
+           queued->x + queued->width <= pending->x + pending->width &&
+           queued->y + queued->height <= pending->y + pending->height))
+        {
+          g_queue_unlink (&self->pending, &queued->link);
+          mks_pending_update_free (queued);
+        }
+    }
+
+  if (self->pending.length >= MKS_PENDING_UPDATE_MAX)
+    mks_paintable_apply_pending (self);
+
+  pending->link.data = pending;
+  g_queue_push_tail_link (&self->pending, &pending->link);
+
+  if (self->pending_source == NULL)
+    {
+      /* Run after the D-Bus dispatch of other queued calls so they can be
+       * collapsed, but before the frame clock paints.
+       */
+      self->pending_source = g_idle_source_new ();
+      g_source_set_priority (self->pending_source, G_PRIORITY_HIGH_IDLE);
+      g_source_set_callback (self->pending_source, mks_paintable_pending_cb, self, NULL);
+      g_source_set_static_name (self->pending_source, "[mks-paintable-pending]");
+      g_source_attach (self->pending_source, g_main_context_get_thread_default ());
+    }
+}
+
 static gboolean
 mks_paintable_listener_update (MksPaintable          *self,
                                GDBusMethodInvocation *invocation,
@@ -622,31 +1521,45 @@ mks_paintable_listener_update (MksPaintable          *self,
                                GVariant              *bytestring,
                                MksQemuListener       *listener)
 {
+  g_autoptr(MksCairoFramebuffer) framebuffer = NULL;
   g_autoptr(GBytes) bytes = NULL;
-  cairo_surface_t *source;
   const guint8 *data;
-  cairo_t *cr;
-  cairo_format_t format;
+  gint64 begin_time;
   gsize data_len;
 
   g_assert (MKS_IS_PAINTABLE (self));
   g_assert (G_IS_DBUS_METHOD_INVOCATION (invocation));
   g_assert (MKS_QEMU_IS_LISTENER (listener));
 
-  if (!MKS_IS_CAIRO_FRAMEBUFFER (self->child) ||
-      !(format = _pixman_format_to_cairo_format (pixman_format)))
+  MKS_TRACE_SCOPE ("paintable.update", "x=%d y=%d width=%d height=%d", x, y, width, height);
+
+  begin_time = g_get_monotonic_time ();
+  framebuffer = mks_paintable_dup_framebuffer (self);
+
+  if ((framebuffer == NULL && !mks_paintable_has_pending_scanout (self)) ||
+      (!mks_pixels_can_convert (pixman_format) &&
+       mks_pixman_format_to_cairo_format (pixman_format) == CAIRO_FORMAT_INVALID))
+    {
+      g_dbus_method_invocation_return_error_literal (invocation,
+                                                     G_IO_ERROR,
+                                                     G_IO_ERROR_NOT_SUPPORTED,
+                                                     "Invalid operation");
+      return TRUE;
+    }
+
+  if (x < 0 || y < 0 || width < 0 || height < 0)
     {
       g_dbus_method_invocation_return_error_literal (invocation,
                                                      G_IO_ERROR,
-                                                     G_IO_ERROR_NOT_SUPPORTED,
-                                                     "Invalid operation");
+                                                     G_IO_ERROR_INVALID_ARGUMENT,
+                                                     "Invalid update area");
       return TRUE;
     }
 
   bytes = g_variant_get_data_as_bytes (bytestring);
   data = g_bytes_get_data (bytes, &data_len);
 
-  if (data_len < cairo_format_stride_for_width (format, width) * height)
+  if (!mks_paintable_check_stride (pixman_format, width, height, stride, data_len))
     {
       g_dbus_method_invocation_return_error_literal (invocation,
                                                      G_IO_ERROR,
@@ -655,40 +1568,30 @@ mks_paintable_listener_update (MksPaintable          *self,
       return TRUE;
     }
 
-  /* We can get in a protocol race condition here in that we will get updates
-   * for framebuffer content _BEFORE_ we'll get notified of property changes
-   * about the MksQemuConsole's size.
-   *
-   * To overcome that, if we detect something larger than our current
-   * framebuffer, we'll resize it and draw over the old contents in a
-   * new framebuffer.
-   *
-   * When shrinking, we can do this as well and then handle it when the
-   * console size notification arrives.
-   *
-   * Generally this is seen at startup during EFI/BIOS.
-   */
-  if (x + width > gdk_paintable_get_intrinsic_width (self->child) ||
-      y + height > gdk_paintable_get_intrinsic_height (self->child))
-    {
-      guint max_width = MAX (gdk_paintable_get_intrinsic_width (self->child), x + width);
-      guint max_height = MAX (gdk_paintable_get_intrinsic_height (self->child), y + height);
-      g_autoptr(MksCairoFramebuffer) framebuffer = mks_cairo_framebuffer_new (format, max_width, max_height);
+  mks_paintable_record_update (self, data_len);
 
-      mks_cairo_framebuffer_copy_to (MKS_CAIRO_FRAMEBUFFER (self->child), framebuffer);
-      mks_paintable_set_child (self, GDK_PAINTABLE (framebuffer));
+  if (self->pipeline)
+    {
+      MksPendingUpdate *pending = g_new0 (MksPendingUpdate, 1);
+
+      pending->bytes = g_steal_pointer (&bytes);
+      pending->epoch = g_atomic_int_get (&self->pending_epoch);
+      pending->x = x;
+      pending->y = y;
+      pending->width = width;
+      pending->height = height;
+      pending->stride = stride;
+      pending->pixman_format = pixman_format;
+
+      mks_paintable_queue_pending (self, pending);
+    }
+  else
+    {
+      mks_paintable_apply_update (self, x, y, width, height, stride, pixman_format, data);
     }
-
-  source = cairo_image_surface_create_for_data ((guint8 *)data, format, width, height, stride);
-  cr = mks_cairo_framebuffer_update (MKS_CAIRO_FRAMEBUFFER (self->child), x, y, width, height);
-  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
-  cairo_set_source_surface (cr, source, 0, 0);
-  cairo_rectangle (cr, 0, 0, width, height);
-  cairo_paint (cr);
-  cairo_destroy (cr);
-  cairo_surface_destroy (source);
 
   mks_qemu_listener_complete_update (listener, invocation);
+  mks_paintable_record_stall (begin_time);
 
   return TRUE;
 }
@@ -704,10 +1607,8 @@ mks_paintable_listener_scanout (MksPaintable          *self,
                                 MksQemuListener       *listener)
 {
   g_autoptr(GBytes) bytes = NULL;
-  cairo_surface_t *source;
   const guint8 *data;
-  cairo_t *cr;
-  cairo_format_t format;
+  gint64 begin_time;
   gsize data_len;
 
   g_assert (MKS_IS_PAINTABLE (self));
@@ -715,7 +1616,11 @@ mks_paintable_listener_scanout (MksPaintable          *self,
   g_assert (MKS_QEMU_IS_LISTENER (listener));
   g_assert (g_variant_is_of_type (bytestring, G_VARIANT_TYPE_BYTESTRING));
 
-  if (!(format = _pixman_format_to_cairo_format (pixman_format)))
+  MKS_TRACE_SCOPE ("paintable.scanout", "width=%u height=%u", width, height);
+
+  begin_time = g_get_monotonic_time ();
+
+  if (_pixman_format_to_framebuffer_format (pixman_format) == CAIRO_FORMAT_INVALID)
     {
       g_dbus_method_invocation_return_error_literal (invocation,
                                                      G_IO_ERROR,
@@ -727,7 +1632,7 @@ mks_paintable_listener_scanout (MksPaintable          *self,
   bytes = g_variant_get_data_as_bytes (bytestring);
   data = g_bytes_get_data (bytes, &data_len);
 
-  if (data_len < cairo_format_stride_for_width (format, width) * height)
+  if (!mks_paintable_check_stride (pixman_format, width, height, stride, data_len))
     {
       g_dbus_method_invocation_return_error_literal (invocation,
                                                      G_IO_ERROR,
@@ -736,28 +1641,29 @@ mks_paintable_listener_scanout (MksPaintable          *self,
       return TRUE;
     }
 
-  if (self->child == NULL ||
-      !MKS_IS_CAIRO_FRAMEBUFFER (self->child) ||
-      width != gdk_paintable_get_intrinsic_width (self->child) ||
-      height != gdk_paintable_get_intrinsic_height (self->child))
-    {
-      g_autoptr(MksCairoFramebuffer) child = mks_cairo_framebuffer_new (format, width, height);
+  mks_paintable_record_update (self, data_len);
 
-      mks_paintable_set_child (self, GDK_PAINTABLE (child));
-    }
+  if (self->pipeline)
+    {
+      MksPendingUpdate *pending = g_new0 (MksPendingUpdate, 1);
 
-  self->y0_top = TRUE;
+      pending->bytes = g_steal_pointer (&bytes);
+      pending->epoch = g_atomic_int_get (&self->pending_epoch);
+      pending->width = width;
+      pending->height = height;
+      pending->stride = stride;
+      pending->pixman_format = pixman_format;
+      pending->is_scanout = TRUE;
 
-  source = cairo_image_surface_create_for_data ((guint8 *)data, format, width, height, stride);
-  cr = mks_cairo_framebuffer_update (MKS_CAIRO_FRAMEBUFFER (self->child), 0, 0, width, height);
-  cairo_set_source_surface (cr, source, 0, 0);
-  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
-  cairo_rectangle (cr, 0, 0, width, height);
-  cairo_paint (cr);
-  cairo_destroy (cr);
-  cairo_surface_destroy (source);
+      mks_paintable_queue_pending (self, pending);
+    }
+  else
+    {
+      mks_paintable_apply_scanout (self, width, height, stride, pixman_format, data);
+    }
 
   mks_qemu_listener_complete_scanout (listener, invocation);
+  mks_paintable_record_stall (begin_time);
 
   return TRUE;
 }
@@ -773,7 +1679,6 @@ mks_paintable_listener_cursor_define (MksPaintable          *self,
                                       MksQemuListener       *listener)
 {
   g_autoptr(GBytes) bytes = NULL;
-  g_autoptr(GdkTexture) texture = NULL;
   g_autoptr(GdkCursor) cursor = NULL;
   gsize data_len;
 
@@ -790,17 +1695,12 @@ mks_paintable_listener_cursor_define (MksPaintable          *self,
   if (data_len != (4 * width * height))
     goto failure;
 
-  texture = gdk_memory_texture_new (width,
-                                    height,
-#if G_BYTE_ORDER == G_LITTLE_ENDIAN
-                                    GDK_MEMORY_B8G8R8A8_PREMULTIPLIED,
-#else
-                                    GDK_MEMORY_A8R8G8B8_PREMULTIPLIED,
-#endif
+  cursor = mks_cursor_cache_lookup (self->cursor_cache,
                                     bytes,
-                                    width * 4);
-
-  cursor = gdk_cursor_new_from_texture (texture, hot_x, hot_y, NULL);
+                                    width,
+                                    height,
+                                    hot_x,
+                                    hot_y);
 
   if (g_set_object (&self->cursor, cursor))
     g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_CURSOR]);
@@ -811,6 +1711,31 @@ failure:
   return TRUE;
 }
 
+static void
+mks_paintable_flush_mouse_set (MksPaintable *self)
+{
+  g_assert (MKS_IS_PAINTABLE (self));
+
+  if (self->mouse_set_source == 0)
+    return;
+
+  g_clear_handle_id (&self->mouse_set_source, g_source_remove);
+  g_signal_emit (self, signals[MOUSE_SET], 0, self->mouse_x, self->mouse_y);
+}
+
+static gboolean
+mks_paintable_mouse_set_cb (gpointer data)
+{
+  MksPaintable *self = data;
+
+  g_assert (MKS_IS_PAINTABLE (self));
+
+  self->mouse_set_source = 0;
+  g_signal_emit (self, signals[MOUSE_SET], 0, self->mouse_x, self->mouse_y);
+
+  return G_SOURCE_REMOVE;
+}
+
 static gboolean
 mks_paintable_listener_mouse_set (MksPaintable          *self,
                                   GDBusMethodInvocation *invocation,
@@ -828,11 +1753,59 @@ mks_paintable_listener_mouse_set (MksPaintable          *self,
 
   mks_qemu_listener_complete_mouse_set (listener, invocation);
 
-  g_signal_emit (self, signals[MOUSE_SET], 0, x, y);
+  /* Use the redraw priority so the notification is folded into the same
+   * main loop iteration as the frame clock paint.
+   */
+  if (self->mouse_set_source == 0)
+    self->mouse_set_source = g_idle_add_full (GDK_PRIORITY_REDRAW,
+                                              mks_paintable_mouse_set_cb,
+                                              self,
+                                              NULL);
 
   return TRUE;
 }
 
+/*
+ * mks_paintable_detach_framebuffer:
+ *
+ * Stops Update and Scanout from drawing into the framebuffer before a
+ * scanout with another kind of child. Called where the listener is
+ * dispatched, see mks_paintable_connect_dispatch().
+ */
+static void
+mks_paintable_detach_framebuffer (MksPaintable *self)
+{
+  g_assert (MKS_IS_PAINTABLE (self));
+
+  g_atomic_int_inc (&self->pending_epoch);
+
+  g_mutex_lock (&self->mutex);
+  g_clear_object (&self->framebuffer);
+  g_mutex_unlock (&self->mutex);
+}
+
+/*
+ * mks_paintable_clear_framebuffer:
+ *
+ * Clears the framebuffer for Disable from where the listener is
+ * dispatched, which is also where Update and Scanout draw into it.
+ */
+static void
+mks_paintable_clear_framebuffer (MksPaintable *self)
+{
+  g_autoptr(MksCairoFramebuffer) framebuffer = NULL;
+
+  g_assert (MKS_IS_PAINTABLE (self));
+
+  g_atomic_int_inc (&self->pending_epoch);
+
+  if ((framebuffer = mks_paintable_dup_framebuffer (self)))
+    {
+      mks_cairo_framebuffer_clear (framebuffer);
+      mks_paintable_share_framebuffer (self, framebuffer, NULL);
+    }
+}
+
 static gboolean
 mks_paintable_listener_disable (MksPaintable          *self,
                                 GDBusMethodInvocation *invocation,
@@ -842,11 +1815,12 @@ mks_paintable_listener_disable (MksPaintable          *self,
   g_assert (G_IS_DBUS_METHOD_INVOCATION (invocation));
   g_assert (MKS_QEMU_IS_LISTENER (listener));
 
-  if (MKS_IS_CAIRO_FRAMEBUFFER (self->child))
-    mks_cairo_framebuffer_clear (MKS_CAIRO_FRAMEBUFFER (self->child));
-  else if (MKS_IS_MAPPED_PAINTABLE (self->child))
+  /* A framebuffer was cleared by mks_paintable_clear_framebuffer() */
+  if (MKS_IS_MAPPED_PAINTABLE (self->child))
     mks_mapped_paintable_clear (MKS_MAPPED_PAINTABLE (self->child));
 
+  mks_map_cache_clear (self->map_cache);
+
   gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
 
   mks_qemu_listener_complete_disable (listener, invocation);
@@ -855,12 +1829,94 @@ mks_paintable_listener_disable (MksPaintable          *self,
 }
 
 
+static gboolean
+mks_paintable_export (MksPaintable     *self,
+                      GDBusConnection  *connection,
+                      GError          **error)
+{
+  g_autoptr(GError) local_error = NULL;
+
+  g_assert (MKS_IS_PAINTABLE (self));
+  g_assert (G_IS_DBUS_CONNECTION (connection));
+
+  if (!g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (self->listener),
+                                         connection,
+                                         "/org/qemu/Display1/Listener",
+                                         &local_error))
+    {
+      g_propagate_prefixed_error (error,
+                                  g_steal_pointer (&local_error),
+                                  "Failed to export listener on bus: ");
+      return FALSE;
+    }
+
+  if (!g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (self->listener_dmabuf2),
+                                         connection,
+                                         "/org/qemu/Display1/Listener",
+                                         &local_error))
+    {
+      g_propagate_prefixed_error (error,
+                                  g_steal_pointer (&local_error),
+                                  "Failed to export DMA-BUF2 listener on bus: ");
+      return FALSE;
+    }
+
+  if (!g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (self->listener_map),
+                                         connection,
+                                         "/org/qemu/Display1/Listener",
+                                         &local_error))
+    {
+      g_propagate_prefixed_error (error,
+                                  g_steal_pointer (&local_error),
+                                  "Failed to export map listener on bus: ");
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+mks_paintable_open_free (MksPaintableOpen *state)
+{
+  g_clear_object (&state->self);
+  g_free (state);
+}
+
+static void
+mks_paintable_export_free (MksPaintableExport *state)
+{
+  g_clear_object (&state->connection);
+  g_free (state);
+}
+
+/* @self is guaranteed to be alive here as dispose joins the worker,
+ * which is the only place this is dispatched.
+ */
+static gboolean
+mks_paintable_export_worker_cb (gpointer data)
+{
+  MksPaintableExport *state = data;
+  g_autoptr(GError) error = NULL;
+
+  if (g_dbus_connection_is_closed (state->connection))
+    return G_SOURCE_REMOVE;
+
+  if (!mks_paintable_export (state->self, state->connection, &error))
+    g_warning ("%s", error->message);
+  else
+    g_dbus_connection_start_message_processing (state->connection);
+
+  return G_SOURCE_REMOVE;
+}
+
 static DexFuture *
 mks_paintable_connection_cb (DexFuture *future,
                              gpointer   user_data)
 {
-  MksPaintable *self = user_data;
+  MksPaintableOpen *state = user_data;
+  MksPaintable *self = state->self;
   g_autoptr(GError) error = NULL;
+  GDBusConnection *connection;
   const GValue *value;
 
   g_assert (MKS_IS_PAINTABLE (self));
@@ -872,134 +1928,103 @@ mks_paintable_connection_cb (DexFuture *future,
       return dex_future_new_true ();
     }
 
-  g_set_object (&self->connection, g_value_get_object (value));
+  connection = g_value_get_object (value);
 
-  if (!g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (self->listener),
-                                         self->connection,
-                                         "/org/qemu/Display1/Listener",
-                                         &error))
+  if (state->generation != self->connection_generation)
     {
-      g_warning ("Failed to export listener on bus: %s", error->message);
+      g_dbus_connection_close (connection, NULL, NULL, NULL);
       return dex_future_new_true ();
     }
 
-  if (!g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (self->listener_dmabuf2),
-                                         self->connection,
-                                         "/org/qemu/Display1/Listener",
-                                         &error))
+  g_set_object (&self->connection, connection);
+
+  /* Once the worker is running it owns its context, so a connection
+   * opened by _mks_paintable_resume() is exported from there instead.
+   */
+  if (self->worker_thread != NULL)
     {
-      g_warning ("Failed to export DMA-BUF2 listener on bus: %s", error->message);
+      MksPaintableExport *export = g_new0 (MksPaintableExport, 1);
+
+      export->self = self;
+      export->connection = g_object_ref (connection);
+
+      g_main_context_invoke_full (self->worker_context,
+                                  G_PRIORITY_DEFAULT,
+                                  mks_paintable_export_worker_cb,
+                                  export,
+                                  (GDestroyNotify) mks_paintable_export_free);
+
       return dex_future_new_true ();
     }
 
-  if (!g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (self->listener_map),
-                                         self->connection,
-                                         "/org/qemu/Display1/Listener",
-                                         &error))
+  /* Method calls are dispatched on the thread-default main context at
+   * the time of export. The worker thread is started afterwards so that
+   * we can still acquire the context here.
+   */
+  if (self->worker_context != NULL)
+    g_main_context_push_thread_default (self->worker_context);
+
+  if (!mks_paintable_export (self, connection, &error))
     {
-      g_warning ("Failed to export map listener on bus: %s", error->message);
+      if (self->worker_context != NULL)
+        g_main_context_pop_thread_default (self->worker_context);
+      g_warning ("%s", error->message);
       return dex_future_new_true ();
     }
 
-  g_dbus_connection_start_message_processing (self->connection);
+  if (self->worker_context != NULL)
+    {
+      g_main_context_pop_thread_default (self->worker_context);
+      self->worker_thread = g_thread_new ("mks-display",
+                                          mks_paintable_worker_thread,
+                                          self);
+    }
+
+  g_dbus_connection_start_message_processing (connection);
 
   return dex_future_new_true ();
 }
 
-GdkPaintable *
-_mks_paintable_new (GdkDisplay    *display,
+/*
+ * mks_paintable_open:
+ *
+ * Creates a socketpair() for the D-Bus peer-to-peer connection QEMU uses
+ * to call the listener. The connection is established asynchronously.
+ *
+ * Returns: the file-descriptor for QEMU, or -1 and @error is set
+ */
+static int
+mks_paintable_open (MksPaintable  *self,
                     GCancellable  *cancellable,
-                    int           *peer_fd,
                     GError       **error)
 {
-  g_autoptr(MksPaintable) self = NULL;
   g_autoptr(GSocketConnection) io_stream = NULL;
   g_autoptr(GSocket) socket = NULL;
+  MksPaintableOpen *state;
   g_autofd int us = -1;
   g_autofd int them = -1;
   gint64 begin_time;
 
-  g_return_val_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable), NULL);
-  g_return_val_if_fail (peer_fd != NULL, NULL);
-
-  *peer_fd = -1;
+  g_assert (MKS_IS_PAINTABLE (self));
+  g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
 
-  self = g_object_new (MKS_TYPE_PAINTABLE, NULL);
-  self->display = g_object_ref (display);
   /* Create a socketpair() to use for D-Bus P2P protocol. We will be receiving
    * DMA-BUF FDs over this.
    */
   if (!mks_socketpair_create (&us, &them, error))
-    return NULL;
+    return -1;
 
   /* Create socket for our side of the socket pair */
   if (!(socket = g_socket_new_from_fd (us, error)))
-    return NULL;
+    return -1;
   us = -1;
 
   /* And convert that socket into a GIOStream */
   io_stream = g_socket_connection_factory_create_connection (socket);
 
-  /* Setup our listener and callbacks to process requests */
-  self->listener = mks_qemu_listener_skeleton_new ();
-  self->listener_dmabuf2 = mks_qemu_listener_unix_scanout_dmabuf2_skeleton_new ();
-  self->listener_map = mks_qemu_listener_unix_map_skeleton_new ();
-  mks_qemu_listener_set_interfaces (self->listener,
-                                    (const char * const[]) {
-                                      "org.qemu.Display1.Listener.Unix.Map",
-                                      "org.qemu.Display1.Listener.Unix.ScanoutDMABUF2",
-                                      NULL
-                                    });
-  g_signal_connect_object (self->listener,
-                           "handle-scanout",
-                           G_CALLBACK (mks_paintable_listener_scanout),
-                           self,
-                           G_CONNECT_SWAPPED);
-  g_signal_connect_object (self->listener,
-                           "handle-update",
-                           G_CALLBACK (mks_paintable_listener_update),
-                           self,
-                           G_CONNECT_SWAPPED);
-  g_signal_connect_object (self->listener,
-                           "handle-scanout-dmabuf",
-                           G_CALLBACK (mks_paintable_listener_scanout_dmabuf),
-                           self,
-                           G_CONNECT_SWAPPED);
-  g_signal_connect_object (self->listener,
-                           "handle-update-dmabuf",
-                           G_CALLBACK (mks_paintable_listener_update_dmabuf),
-                           self,
-                           G_CONNECT_SWAPPED);
-  g_signal_connect_object (self->listener_dmabuf2,
-                           "handle-scanout-dmabuf2",
-                           G_CALLBACK (mks_paintable_listener_scanout_dmabuf2),
-                           self,
-                           G_CONNECT_SWAPPED);
-  g_signal_connect_object (self->listener_map,
-                           "handle-scanout-map",
-                           G_CALLBACK (mks_paintable_listener_scanout_map),
-                           self,
-                           G_CONNECT_SWAPPED);
-  g_signal_connect_object (self->listener_map,
-                           "handle-update-map",
-                           G_CALLBACK (mks_paintable_listener_update_map),
-                           self,
-                           G_CONNECT_SWAPPED);
-  g_signal_connect_object (self->listener,
-                           "handle-disable",
-                           G_CALLBACK (mks_paintable_listener_disable),
-                           self,
-                           G_CONNECT_SWAPPED);
-  g_signal_connect_object (self->listener,
-                           "handle-cursor-define",
-                           G_CALLBACK (mks_paintable_listener_cursor_define),
-                           self,
-                           G_CONNECT_SWAPPED);
-  g_signal_connect_object (self->listener,
-                           "handle-mouse-set",
-                           G_CALLBACK (mks_paintable_listener_mouse_set),
-                           self,
-                           G_CONNECT_SWAPPED);
+  state = g_new0 (MksPaintableOpen, 1);
+  state->self = g_object_ref (self);
+  state->generation = ++self->connection_generation;
 
   /* Asynchronously create connection because we can't do it synchronously
    * as the other side is doing AUTHENTICATION_SERVER for no good reason.
@@ -1012,10 +2037,80 @@ _mks_paintable_new (GdkDisplay    *display,
                                                                  begin_time,
                                                                  "paintable.dbus-connection"),
                                          mks_paintable_connection_cb,
-                                         g_object_ref (self),
-                                         g_object_unref));
+                                         state,
+                                         (GDestroyNotify) mks_paintable_open_free));
+
+  return g_steal_fd (&them);
+}
+
+GdkPaintable *
+_mks_paintable_new (GdkDisplay    *display,
+                    GCancellable  *cancellable,
+                    int           *peer_fd,
+                    GError       **error)
+{
+  g_autoptr(MksPaintable) self = NULL;
+
+  g_return_val_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable), NULL);
+  g_return_val_if_fail (peer_fd != NULL, NULL);
+
+  *peer_fd = -1;
+
+  self = g_object_new (MKS_TYPE_PAINTABLE, NULL);
+  self->display = g_object_ref (display);
+
+  /* Setup our listener and callbacks to process requests */
+  self->listener = mks_qemu_listener_skeleton_new ();
+  self->listener_dmabuf2 = mks_qemu_listener_unix_scanout_dmabuf2_skeleton_new ();
+  self->listener_map = mks_qemu_listener_unix_map_skeleton_new ();
+  mks_qemu_listener_set_interfaces (self->listener,
+                                    (const char * const[]) {
+                                      "org.qemu.Display1.Listener.Unix.Map",
+                                      "org.qemu.Display1.Listener.Unix.ScanoutDMABUF2",
+                                      NULL
+                                    });
 
-  *peer_fd = g_steal_fd (&them);
+  if (mks_get_debug_flags () & MKS_DEBUG_DISPLAY_THREAD)
+    self->worker_context = g_main_context_new ();
+
+  self->pipeline = !!(mks_get_debug_flags () & MKS_DEBUG_PIPELINE);
+
+  /* Update and Scanout are applied directly from the display worker when
+   * enabled. Everything else is cheap and touches state owned by the main
+   * thread so it is always handled there, after changing what Update and
+   * Scanout draw into from the worker.
+   */
+  mks_paintable_connect_dispatch (self, self->listener, "handle-scanout-dmabuf",
+                                  mks_paintable_detach_framebuffer);
+  mks_paintable_connect_dispatch (self, self->listener_dmabuf2, "handle-scanout-dmabuf2",
+                                  mks_paintable_detach_framebuffer);
+  mks_paintable_connect_dispatch (self, self->listener_map, "handle-scanout-map",
+                                  mks_paintable_detach_framebuffer);
+  mks_paintable_connect_dispatch (self, self->listener, "handle-disable",
+                                  mks_paintable_clear_framebuffer);
+  mks_paintable_connect (self, self->listener, "handle-scanout",
+                         G_CALLBACK (mks_paintable_listener_scanout), FALSE);
+  mks_paintable_connect (self, self->listener, "handle-update",
+                         G_CALLBACK (mks_paintable_listener_update), FALSE);
+  mks_paintable_connect (self, self->listener, "handle-scanout-dmabuf",
+                         G_CALLBACK (mks_paintable_listener_scanout_dmabuf), TRUE);
+  mks_paintable_connect (self, self->listener, "handle-update-dmabuf",
+                         G_CALLBACK (mks_paintable_listener_update_dmabuf), TRUE);
+  mks_paintable_connect (self, self->listener_dmabuf2, "handle-scanout-dmabuf2",
+                         G_CALLBACK (mks_paintable_listener_scanout_dmabuf2), TRUE);
+  mks_paintable_connect (self, self->listener_map, "handle-scanout-map",
+                         G_CALLBACK (mks_paintable_listener_scanout_map), TRUE);
+  mks_paintable_connect (self, self->listener_map, "handle-update-map",
+                         G_CALLBACK (mks_paintable_listener_update_map), TRUE);
+  mks_paintable_connect (self, self->listener, "handle-disable",
+                         G_CALLBACK (mks_paintable_listener_disable), TRUE);
+  mks_paintable_connect (self, self->listener, "handle-cursor-define",
+                         G_CALLBACK (mks_paintable_listener_cursor_define), TRUE);
+  mks_paintable_connect (self, self->listener, "handle-mouse-set",
+                         G_CALLBACK (mks_paintable_listener_mouse_set), TRUE);
+
+  if (-1 == (*peer_fd = mks_paintable_open (self, cancellable, error)))
+    return NULL;
 
   g_assert (*peer_fd != -1);
   g_assert (MKS_IS_PAINTABLE (self));
@@ -1040,6 +2135,113 @@ _mks_paintable_get_cursor (MksPaintable *self)
   return self->cursor;
 }
 
+/**
+ * _mks_paintable_get_frame_stats:
+ * @self: a #MksPaintable
+ *
+ * Gets the statistics for updates received by @self.
+ *
+ * Returns: (transfer none): a #MksFrameStats
+ */
+MksFrameStats *
+_mks_paintable_get_frame_stats (MksPaintable *self)
+{
+  g_return_val_if_fail (MKS_IS_PAINTABLE (self), NULL);
+
+  return self->frame_stats;
+}
+
+/**
+ * _mks_paintable_share:
+ * @self: a #MksPaintable
+ * @error: a location for a #GError, or %NULL
+ *
+ * Starts copying the contents of @self into shared memory, if not
+ * already, which other processes may map using #MksSharedPaintable.
+ *
+ * Returns: a new read-only file-descriptor for the shared memory
+ *   owned by the caller, or -1 and @error is set.
+ */
+int
+_mks_paintable_share (MksPaintable  *self,
+                      GError       **error)
+{
+  g_autoptr(MksShmPublisher) publisher = NULL;
+
+  g_return_val_if_fail (MKS_IS_PAINTABLE (self), -1);
+
+  if (!(publisher = mks_paintable_dup_shm_publisher (self)))
+    {
+      if (!(publisher = mks_shm_publisher_new (error)))
+        return -1;
+
+      g_mutex_lock (&self->mutex);
+      g_assert (self->shm_publisher == NULL);
+      self->shm_publisher = mks_shm_publisher_ref (publisher);
+      g_mutex_unlock (&self->mutex);
+
+      mks_paintable_share_child (self);
+    }
+
+  return mks_shm_publisher_dup_fd (publisher, error);
+}
+
+/**
+ * _mks_paintable_suspend:
+ * @self: a #MksPaintable
+ *
+ * Closes the connection to QEMU so that no more updates are sent while
+ * nothing is showing @self. The last frame is kept until it is replaced
+ * after _mks_paintable_resume().
+ */
+void
+_mks_paintable_suspend (MksPaintable *self)
+{
+  GDBusInterfaceSkeleton *skeletons[3];
+
+  g_return_if_fail (MKS_IS_PAINTABLE (self));
+
+  /* Drop a connection which is still being established */
+  self->connection_generation++;
+
+  if (self->connection == NULL)
+    return;
+
+  skeletons[0] = G_DBUS_INTERFACE_SKELETON (self->listener);
+  skeletons[1] = G_DBUS_INTERFACE_SKELETON (self->listener_dmabuf2);
+  skeletons[2] = G_DBUS_INTERFACE_SKELETON (self->listener_map);
+
+  for (guint i = 0; i < G_N_ELEMENTS (skeletons); i++)
+    {
+      if (g_dbus_interface_skeleton_has_connection (skeletons[i], self->connection))
+        g_dbus_interface_skeleton_unexport_from_connection (skeletons[i], self->connection);
+    }
+
+  mks_listener_connection_clear (&self->connection);
+}
+
+/**
+ * _mks_paintable_resume:
+ * @self: a #MksPaintable
+ * @error: a location for a #GError, or %NULL
+ *
+ * Opens a new connection after _mks_paintable_suspend(). The caller
+ * registers the returned file-descriptor with the console, after which
+ * QEMU sends the current contents with Scanout or ScanoutMap.
+ *
+ * Returns: the file-descriptor for QEMU owned by the caller, or -1
+ *   and @error is set.
+ */
+int
+_mks_paintable_resume (MksPaintable  *self,
+                       GError       **error)
+{
+  g_return_val_if_fail (MKS_IS_PAINTABLE (self), -1);
+  g_return_val_if_fail (self->connection == NULL, -1);
+
+  return mks_paintable_open (self, NULL, error);
+}
+
 void
 _mks_paintable_snapshot (MksPaintable *self,
                          GtkSnapshot  *snapshot,
@@ -1053,6 +2255,14 @@ _mks_paintable_snapshot (MksPaintable *self,
   g_return_if_fail (GTK_IS_SNAPSHOT (snapshot));
   g_return_if_fail (scale > 0);
 
+  mks_paintable_flush_mouse_set (self);
+
+  if (MKS_IS_DMABUF_PAINTABLE (self->child))
+    mks_frame_stats_set_dmabuf_path (self->frame_stats,
+                                     mks_dmabuf_paintable_get_path (MKS_DMABUF_PAINTABLE (self->child)));
+  else
+    mks_frame_stats_set_dmabuf_path (self->frame_stats, MKS_DMABUF_PATH_NONE);
+
   if (self->child == NULL)
     return;
 
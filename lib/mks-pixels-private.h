@@ -0,0 +1,89 @@
+/* mks-pixels-private.h
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* 4:2:0 layouts which mks_pixels_convert_yuv_rows() understands */
+typedef enum _MksPixelsYuv
+{
+  /* A Y plane followed by a plane of interleaved U and V */
+  MKS_PIXELS_NV12,
+  /* Separate Y, U and V planes */
+  MKS_PIXELS_I420,
+  MKS_PIXELS_N_YUV
+} MksPixelsYuv;
+
+const char         *mks_pixels_get_impl_name    (void);
+const char * const *mks_pixels_get_impl_names   (void);
+gboolean            mks_pixels_set_impl         (const char   *name);
+gboolean            mks_pixels_can_convert      (guint         pixman_format);
+void                mks_pixels_copy_rows        (guint8       *dst,
+                                                 gsize         dst_stride,
+                                                 const guint8 *src,
+                                                 gsize         src_stride,
+                                                 gsize         row_bytes,
+                                                 guint         n_rows);
+void                mks_pixels_convert_rows     (guint         pixman_format,
+                                                 guint8       *dst,
+                                                 gsize         dst_stride,
+                                                 const guint8 *src,
+                                                 gsize         src_stride,
+                                                 guint         width,
+                                                 guint         n_rows);
+void                mks_pixels_convert_yuv_rows (MksPixelsYuv  layout,
+                                                 guint8       *dst,
+                                                 gsize         dst_stride,
+                                                 const guint8 *planes[3],
+                                                 const gsize   strides[3],
+                                                 guint         x,
+                                                 guint         y,
+                                                 guint         width,
+                                                 guint         n_rows);
+void                mks_pixels_flip_rows        (guint8       *pixels,
+                                                 gsize         stride,
+                                                 gsize         row_bytes,
+                                                 guint         n_rows);
+guint64             mks_pixels_hash_rows        (const guint8 *src,
+                                                 gsize         src_stride,
+                                                 gsize         row_bytes,
+                                                 guint         n_rows);
+void                mks_pixels_downsample       (guint         pixman_format,
+                                                 guint8       *dst,
+                                                 gsize         dst_stride,
+                                                 guint         dst_width,
+                                                 guint         dst_height,
+                                                 const guint8 *src,
+                                                 gsize         src_stride,
+                                                 guint         src_width,
+                                                 guint         src_height,
+                                                 guint         x,
+                                                 guint         y,
+                                                 guint         width,
+                                                 guint         height);
+void                mks_pixels_downsample_align (guint         src_size,
+                                                 guint         dst_size,
+                                                 guint        *pos,
+                                                 guint        *size);
+
+G_END_DECLS
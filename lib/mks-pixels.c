@@ -0,0 +1,951 @@
+/* mks-pixels.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <pixman.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+# define MKS_PIXELS_X86 1
+#elif defined(__aarch64__)
+# define MKS_PIXELS_ARM64 1
+#endif
+
+#include "mks-pixels-private.h"
+
+/* All conversions produce native-endian 32-bit words with alpha in the
+ * high byte, which matches CAIRO_FORMAT_ARGB32/RGB24 and PIXMAN_a8r8g8b8.
+ *
+ * Each conversion is written once as an expression which is valid for
+ * both guint32 and GCC vector types so that the same code is used for
+ * the scalar tail and the SSE2/AVX2/AVX-512/NEON bodies.
+ */
+#define OPAQUE_MASK 0xff000000u
+
+#define CONVERT_OPAQUE(p) \
+  ((p) | OPAQUE_MASK)
+#define CONVERT_SWAP_RB(p) \
+  (((p) & 0xff00ff00u) | (((p) >> 16) & 0xffu) | (((p) & 0xffu) << 16))
+#define CONVERT_SWAP_RB_OPAQUE(p) \
+  (CONVERT_SWAP_RB (p) | OPAQUE_MASK)
+#define CONVERT_X2R10G10B10(p) \
+  (OPAQUE_MASK | ((((p) >> 22) & 0xffu) << 16) | ((((p) >> 12) & 0xffu) << 8) | (((p) >> 2) & 0xffu))
+#define CONVERT_R5G6B5(p) \
+  (OPAQUE_MASK | \
+   (((((p) >> 8) & 0xf8u) | (((p) >> 13) & 0x07u)) << 16) | \
+   (((((p) >> 3) & 0xfcu) | (((p) >> 9) & 0x03u)) << 8) | \
+   ((((p) << 3) & 0xf8u) | (((p) >> 2) & 0x07u)))
+
+typedef void (*MksConvertRow) (guint8       *dst,
+                               const guint8 *src,
+                               guint         width);
+
+typedef enum _MksPixelsKernel
+{
+  KERNEL_OPAQUE,
+  KERNEL_SWAP_RB,
+  KERNEL_SWAP_RB_OPAQUE,
+  KERNEL_X2R10G10B10,
+  KERNEL_R5G6B5,
+  N_KERNELS
+} MksPixelsKernel;
+
+/* @y points at the first pixel of a luma row and @u/@v at the chroma
+ * samples of that pixel, which must start a pair. With NV12, @u points
+ * at interleaved UV and @v is unused.
+ */
+typedef void (*MksConvertYuvRow) (guint8       *dst,
+                                  const guint8 *y,
+                                  const guint8 *u,
+                                  const guint8 *v,
+                                  guint         width);
+
+typedef guint64 (*MksHashRow) (guint64       seed,
+                               const guint8 *src,
+                               gsize         row_bytes);
+
+typedef void (*MksBoxRow) (guint32      *acc,
+                           const guint8 *src,
+                           const guint  *bounds,
+                           guint         n_boxes);
+
+typedef void (*MksSwapRow) (guint8 *a,
+                            guint8 *b,
+                            gsize   row_bytes);
+
+typedef struct _MksPixelsImpl
+{
+  const char       *name;
+  MksConvertRow     convert_row[N_KERNELS];
+  MksConvertYuvRow  convert_yuv_row[MKS_PIXELS_N_YUV];
+  MksHashRow        hash_row;
+  MksBoxRow         box_row;
+  MksSwapRow        swap_row;
+} MksPixelsImpl;
+
+/* Constants from xxHash64. This is not meant to resist collisions
+ * from an adversary, only to notice when pixels change.
+ */
+#define HASH_PRIME1 G_GUINT64_CONSTANT (0x9e3779b185ebca87)
+#define HASH_PRIME2 G_GUINT64_CONSTANT (0xc2b2ae3d27d4eb4f)
+#define HASH_ROUND(h, w) \
+  ((((h) ^ ((w) * HASH_PRIME2)) << 31 | ((h) ^ ((w) * HASH_PRIME2)) >> 33) * HASH_PRIME1)
+
+/* The row is consumed as four 64-bit lanes regardless of the instruction
+ * set so that every implementation produces the same hash. The compiler
+ * splits the vector into as many registers as the target requires.
+ */
+#define DEFINE_HASH_ROW(name, attrs)                                             \
+  attrs static guint64                                                           \
+  name (guint64       seed,                                                      \
+        const guint8 *src,                                                       \
+        gsize         row_bytes)                                                 \
+  {                                                                              \
+    typedef guint64 Vec __attribute__((vector_size (32)));                       \
+    Vec acc = { seed, seed + HASH_PRIME1, seed + HASH_PRIME2, seed - HASH_PRIME1 }; \
+    guint64 h;                                                                   \
+    gsize i = 0;                                                                 \
+                                                                                 \
+    for (; i + sizeof (Vec) <= row_bytes; i += sizeof (Vec))                     \
+      {                                                                          \
+        Vec w;                                                                   \
+        memcpy (&w, &src[i], sizeof w);                                          \
+        acc = HASH_ROUND (acc, w);                                               \
+      }                                                                          \
+                                                                                 \
+    h = HASH_ROUND (acc[0], acc[1]) ^ HASH_ROUND (acc[2], acc[3]);               \
+                                                                                 \
+    for (; i < row_bytes; i++)                                                   \
+      h = HASH_ROUND (h, (guint64)src[i]);                                       \
+                                                                                 \
+    return HASH_ROUND (h, (guint64)row_bytes);                                   \
+  }
+
+#define DEFINE_CONVERT_ROW_32(name, attrs, lanes, CONVERT)                      \
+  attrs static void                                                              \
+  name (guint8       *dst,                                                       \
+        const guint8 *src,                                                       \
+        guint         width)                                                     \
+  {                                                                              \
+    typedef guint32 Vec __attribute__((vector_size ((lanes) * 4)));              \
+    guint i = 0;                                                                 \
+                                                                                 \
+    for (; (lanes) > 1 && i + (lanes) <= width; i += (lanes))                    \
+      {                                                                          \
+        Vec p;                                                                   \
+        memcpy (&p, &src[i * 4], sizeof p);                                      \
+        p = CONVERT (p);                                                         \
+        memcpy (&dst[i * 4], &p, sizeof p);                                      \
+      }                                                                          \
+                                                                                 \
+    for (; i < width; i++)                                                       \
+      {                                                                          \
+        guint32 p;                                                               \
+        memcpy (&p, &src[i * 4], 4);                                             \
+        p = CONVERT (p);                                                         \
+        memcpy (&dst[i * 4], &p, 4);                                             \
+      }                                                                          \
+  }
+
+#define DEFINE_CONVERT_ROW_16(name, attrs, lanes, CONVERT)                      \
+  attrs static void                                                              \
+  name (guint8       *dst,                                                       \
+        const guint8 *src,                                                       \
+        guint         width)                                                     \
+  {                                                                              \
+    typedef guint16 Vec16 __attribute__((vector_size ((lanes) * 2)));            \
+    typedef guint32 Vec __attribute__((vector_size ((lanes) * 4)));              \
+    guint i = 0;                                                                 \
+                                                                                 \
+    for (; (lanes) > 1 && i + (lanes) <= width; i += (lanes))                    \
+      {                                                                          \
+        Vec16 p16;                                                               \
+        Vec p;                                                                   \
+        memcpy (&p16, &src[i * 2], sizeof p16);                                  \
+        p = __builtin_convertvector (p16, Vec);                                  \
+        p = CONVERT (p);                                                         \
+        memcpy (&dst[i * 4], &p, sizeof p);                                      \
+      }                                                                          \
+                                                                                 \
+    for (; i < width; i++)                                                       \
+      {                                                                          \
+        guint16 p16;                                                             \
+        guint32 p;                                                               \
+        memcpy (&p16, &src[i * 2], 2);                                           \
+        p = p16;                                                                 \
+        p = CONVERT (p);                                                         \
+        memcpy (&dst[i * 4], &p, 4);                                             \
+      }                                                                          \
+  }
+
+/* BT.601 limited range in 8.8 fixed point. The scanout does not carry
+ * its colorimetry so this matches what most guest video stacks produce.
+ * Like the conversions above, these are valid for gint32 and vectors of
+ * it. @c is Y - 16, @d is U - 128 and @e is V - 128.
+ */
+#define YUV_CLAMP(x) \
+  ((((x) & ~((x) >> 31)) | ((255 - (x)) >> 31)) & 255)
+#define CONVERT_YUV(c, d, e) \
+  ((YUV_CLAMP ((298 * (c) + 409 * (e) + 128) >> 8) << 16) | \
+   (YUV_CLAMP ((298 * (c) - 100 * (d) - 208 * (e) + 128) >> 8) << 8) | \
+   YUV_CLAMP ((298 * (c) + 516 * (d) + 128) >> 8))
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+# define NV12_U_SHIFT 0
+# define NV12_V_SHIFT 8
+#else
+# define NV12_U_SHIFT 8
+# define NV12_V_SHIFT 0
+#endif
+
+/* The vector types need at least two chroma samples, the scalar tier
+ * never enters the vector body so its types are only for show.
+ */
+#define YUV_LANES(lanes) ((lanes) < 4 ? 4 : (lanes))
+
+/* Each vector of luma shares half as many chroma samples. They are
+ * widened to 32 bits and multiplied by 0x10001 so that reading the
+ * result as 16-bit lanes repeats each sample for both pixels of its pair.
+ */
+#define DEFINE_CONVERT_YUV_ROW(name, attrs, lanes, semi_planar)                 \
+  attrs static void                                                              \
+  name (guint8       *dst,                                                       \
+        const guint8 *y,                                                         \
+        const guint8 *u,                                                         \
+        const guint8 *v,                                                         \
+        guint         width)                                                     \
+  {                                                                              \
+    typedef guint8 Vec8 __attribute__((vector_size (YUV_LANES (lanes))));       \
+    typedef guint16 Vec16 __attribute__((vector_size (YUV_LANES (lanes) * 2))); \
+    typedef guint8 Half8 __attribute__((vector_size (YUV_LANES (lanes) / 2)));  \
+    typedef guint16 Half16 __attribute__((vector_size (YUV_LANES (lanes))));    \
+    typedef guint32 Half32 __attribute__((vector_size (YUV_LANES (lanes) * 2))); \
+    typedef gint32 VecI __attribute__((vector_size (YUV_LANES (lanes) * 4)));   \
+    typedef guint32 Vec __attribute__((vector_size (YUV_LANES (lanes) * 4)));   \
+    guint i = 0;                                                                 \
+                                                                                 \
+    for (; (lanes) > 1 && i + (lanes) <= width; i += (lanes))                    \
+      {                                                                          \
+        Half32 u32, v32;                                                         \
+        Vec16 u16, v16;                                                          \
+        Vec8 y8;                                                                 \
+        VecI c, d, e;                                                            \
+        Vec p;                                                                   \
+                                                                                 \
+        if (semi_planar)                                                         \
+          {                                                                      \
+            Half16 uv;                                                           \
+            memcpy (&uv, &u[i], sizeof uv);                                      \
+            u32 = __builtin_convertvector ((uv >> NV12_U_SHIFT) & 0xff, Half32); \
+            v32 = __builtin_convertvector ((uv >> NV12_V_SHIFT) & 0xff, Half32); \
+          }                                                                      \
+        else                                                                     \
+          {                                                                      \
+            Half8 h;                                                             \
+            memcpy (&h, &u[i / 2], sizeof h);                                    \
+            u32 = __builtin_convertvector (h, Half32);                           \
+            memcpy (&h, &v[i / 2], sizeof h);                                    \
+            v32 = __builtin_convertvector (h, Half32);                           \
+          }                                                                      \
+                                                                                 \
+        u32 *= 0x10001;                                                          \
+        v32 *= 0x10001;                                                          \
+        memcpy (&u16, &u32, sizeof u16);                                         \
+        memcpy (&v16, &v32, sizeof v16);                                         \
+        memcpy (&y8, &y[i], sizeof y8);                                          \
+                                                                                 \
+        c = __builtin_convertvector (y8, VecI) - 16;                             \
+        d = __builtin_convertvector (u16, VecI) - 128;                           \
+        e = __builtin_convertvector (v16, VecI) - 128;                           \
+        p = (Vec)CONVERT_YUV (c, d, e) | OPAQUE_MASK;                            \
+        memcpy (&dst[i * 4], &p, sizeof p);                                      \
+      }                                                                          \
+                                                                                 \
+    for (; i < width; i++)                                                       \
+      {                                                                          \
+        gint32 c = (gint32)y[i] - 16;                                            \
+        gint32 d;                                                                \
+        gint32 e;                                                                \
+        guint32 p;                                                               \
+                                                                                 \
+        if (semi_planar)                                                         \
+          {                                                                      \
+            d = (gint32)u[i & ~1u] - 128;                                        \
+            e = (gint32)u[(i & ~1u) + 1] - 128;                                  \
+          }                                                                      \
+        else                                                                     \
+          {                                                                      \
+            d = (gint32)u[i / 2] - 128;                                          \
+            e = (gint32)v[i / 2] - 128;                                          \
+          }                                                                      \
+                                                                                 \
+        p = (guint32)CONVERT_YUV (c, d, e) | OPAQUE_MASK;                        \
+        memcpy (&dst[i * 4], &p, 4);                                             \
+      }                                                                          \
+  }
+
+/* Adds each ARGB32 pixel of @src into the accumulator of the box it
+ * belongs to. Box i covers pixels bounds[i] up to bounds[i + 1] and has
+ * one 32-bit lane per channel so that a whole pixel is added at once.
+ */
+#define DEFINE_BOX_ROW(name, attrs)                                              \
+  attrs static void                                                              \
+  name (guint32      *acc,                                                       \
+        const guint8 *src,                                                       \
+        const guint  *bounds,                                                    \
+        guint         n_boxes)                                                   \
+  {                                                                              \
+    typedef guint8 Vec8 __attribute__((vector_size (4)));                        \
+    typedef guint32 Vec __attribute__((vector_size (16)));                       \
+                                                                                 \
+    for (guint i = 0; i < n_boxes; i++)                                          \
+      {                                                                          \
+        Vec sum;                                                                 \
+        memcpy (&sum, &acc[i * 4], sizeof sum);                                  \
+                                                                                 \
+        for (guint x = bounds[i]; x < bounds[i + 1]; x++)                        \
+          {                                                                      \
+            Vec8 p;                                                              \
+            memcpy (&p, &src[x * 4], sizeof p);                                  \
+            sum += __builtin_convertvector (p, Vec);                             \
+          }                                                                      \
+                                                                                 \
+        memcpy (&acc[i * 4], &sum, sizeof sum);                                  \
+      }                                                                          \
+  }
+
+#define DEFINE_SWAP_ROW(name, attrs, lanes)                                      \
+  attrs static void                                                              \
+  name (guint8 *a,                                                               \
+        guint8 *b,                                                               \
+        gsize   row_bytes)                                                       \
+  {                                                                              \
+    typedef guint32 Vec __attribute__((vector_size ((lanes) * 4)));              \
+    gsize i = 0;                                                                 \
+                                                                                 \
+    for (; (lanes) > 1 && i + sizeof (Vec) <= row_bytes; i += sizeof (Vec))      \
+      {                                                                          \
+        Vec va, vb;                                                              \
+        memcpy (&va, &a[i], sizeof va);                                          \
+        memcpy (&vb, &b[i], sizeof vb);                                          \
+        memcpy (&a[i], &vb, sizeof vb);                                          \
+        memcpy (&b[i], &va, sizeof va);                                          \
+      }                                                                          \
+                                                                                 \
+    for (; i < row_bytes; i++)                                                   \
+      {                                                                          \
+        guint8 t = a[i];                                                         \
+        a[i] = b[i];                                                             \
+        b[i] = t;                                                                \
+      }                                                                          \
+  }
+
+#define DEFINE_KERNELS(suffix, attrs, lanes)                                              \
+  DEFINE_CONVERT_ROW_32 (convert_row_opaque_##suffix, attrs, lanes, CONVERT_OPAQUE)       \
+  DEFINE_CONVERT_ROW_32 (convert_row_swap_rb_##suffix, attrs, lanes, CONVERT_SWAP_RB)     \
+  DEFINE_CONVERT_ROW_32 (convert_row_swap_rb_opaque_##suffix, attrs, lanes, CONVERT_SWAP_RB_OPAQUE) \
+  DEFINE_CONVERT_ROW_32 (convert_row_x2r10g10b10_##suffix, attrs, lanes, CONVERT_X2R10G10B10) \
+  DEFINE_CONVERT_ROW_16 (convert_row_r5g6b5_##suffix, attrs, lanes, CONVERT_R5G6B5)       \
+  DEFINE_CONVERT_YUV_ROW (convert_row_nv12_##suffix, attrs, lanes, TRUE)                  \
+  DEFINE_CONVERT_YUV_ROW (convert_row_i420_##suffix, attrs, lanes, FALSE)                 \
+  DEFINE_HASH_ROW (hash_row_##suffix, attrs)                                              \
+  DEFINE_BOX_ROW (box_row_##suffix, attrs)                                                \
+  DEFINE_SWAP_ROW (swap_row_##suffix, attrs, lanes)                                       \
+  static const MksPixelsImpl impl_##suffix = {                                            \
+    #suffix,                                                                              \
+    {                                                                                     \
+      [KERNEL_OPAQUE] = convert_row_opaque_##suffix,                                      \
+      [KERNEL_SWAP_RB] = convert_row_swap_rb_##suffix,                                    \
+      [KERNEL_SWAP_RB_OPAQUE] = convert_row_swap_rb_opaque_##suffix,                      \
+      [KERNEL_X2R10G10B10] = convert_row_x2r10g10b10_##suffix,                            \
+      [KERNEL_R5G6B5] = convert_row_r5g6b5_##suffix,                                      \
+    },                                                                                    \
+    {                                                                                     \
+      [MKS_PIXELS_NV12] = convert_row_nv12_##suffix,                                      \
+      [MKS_PIXELS_I420] = convert_row_i420_##suffix,                                      \
+    },                                                                                    \
+    hash_row_##suffix,                                                                    \
+    box_row_##suffix,                                                                     \
+    swap_row_##suffix,                                                                    \
+  };
+
+DEFINE_KERNELS (scalar, , 1)
+#ifdef MKS_PIXELS_X86
+DEFINE_KERNELS (sse2, __attribute__((target ("sse2"))), 4)
+DEFINE_KERNELS (avx2, __attribute__((target ("avx2"))), 8)
+DEFINE_KERNELS (avx512, __attribute__((target ("avx512f,avx512bw"))), 16)
+#endif
+#ifdef MKS_PIXELS_ARM64
+/* NEON is part of the aarch64 baseline so no target attribute is needed */
+DEFINE_KERNELS (neon, , 4)
+#endif
+
+/* Ordered from most to least preferred */
+static const MksPixelsImpl *impls[] = {
+#ifdef MKS_PIXELS_X86
+  &impl_avx512,
+  &impl_avx2,
+  &impl_sse2,
+#endif
+#ifdef MKS_PIXELS_ARM64
+  &impl_neon,
+#endif
+  &impl_scalar,
+};
+
+static const MksPixelsImpl *current_impl;
+
+static gboolean
+mks_pixels_impl_is_supported (const MksPixelsImpl *impl)
+{
+#ifdef MKS_PIXELS_X86
+  __builtin_cpu_init ();
+
+  if (impl == &impl_avx512)
+    return __builtin_cpu_supports ("avx512f") && __builtin_cpu_supports ("avx512bw");
+
+  if (impl == &impl_avx2)
+    return __builtin_cpu_supports ("avx2");
+
+  if (impl == &impl_sse2)
+    return __builtin_cpu_supports ("sse2");
+#endif
+
+  return TRUE;
+}
+
+static const MksPixelsImpl *
+mks_pixels_find_impl (const char *name)
+{
+  for (guint i = 0; i < G_N_ELEMENTS (impls); i++)
+    {
+      if (g_strcmp0 (impls[i]->name, name) == 0)
+        return mks_pixels_impl_is_supported (impls[i]) ? impls[i] : NULL;
+    }
+
+  return NULL;
+}
+
+static const MksPixelsImpl *
+mks_pixels_get_impl (void)
+{
+  static gsize initialized;
+
+  if (g_once_init_enter (&initialized))
+    {
+      const char *name = g_getenv ("MKS_PIXELS_IMPL");
+      const MksPixelsImpl *selected = NULL;
+
+      /* Allow forcing a tier to compare them or to rule one out */
+      if (name != NULL && !(selected = mks_pixels_find_impl (name)))
+        g_warning ("MKS_PIXELS_IMPL=%s is not supported on this CPU, ignoring", name);
+
+      for (guint i = 0; selected == NULL && i < G_N_ELEMENTS (impls); i++)
+        {
+          if (mks_pixels_impl_is_supported (impls[i]))
+            selected = impls[i];
+        }
+
+      g_atomic_pointer_set (&current_impl, selected);
+      g_once_init_leave (&initialized, TRUE);
+    }
+
+  return g_atomic_pointer_get (&current_impl);
+}
+
+static gboolean
+mks_pixels_get_kernel (guint            pixman_format,
+                       MksPixelsKernel *kernel)
+{
+  switch (pixman_format)
+    {
+    case PIXMAN_x8r8g8b8:
+      *kernel = KERNEL_OPAQUE;
+      return TRUE;
+
+    case PIXMAN_a8b8g8r8:
+      *kernel = KERNEL_SWAP_RB;
+      return TRUE;
+
+    case PIXMAN_x8b8g8r8:
+      *kernel = KERNEL_SWAP_RB_OPAQUE;
+      return TRUE;
+
+    case PIXMAN_x2r10g10b10:
+      *kernel = KERNEL_X2R10G10B10;
+      return TRUE;
+
+    case PIXMAN_r5g6b5:
+      *kernel = KERNEL_R5G6B5;
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
+/*
+ * mks_pixels_get_impl_name:
+ *
+ * Gets the name of the kernels selected for the running CPU.
+ *
+ * Returns: a string such as "avx512", "avx2", "sse2", "neon", or "scalar"
+ */
+const char *
+mks_pixels_get_impl_name (void)
+{
+  return mks_pixels_get_impl ()->name;
+}
+
+/*
+ * mks_pixels_get_impl_names:
+ *
+ * Gets the names of the kernels which may be used on the running CPU,
+ * most preferred first.
+ *
+ * Returns: (transfer none): a %NULL-terminated array of names
+ */
+const char * const *
+mks_pixels_get_impl_names (void)
+{
+  static const char *names[G_N_ELEMENTS (impls) + 1];
+  static gsize initialized;
+
+  if (g_once_init_enter (&initialized))
+    {
+      guint n_names = 0;
+
+      for (guint i = 0; i < G_N_ELEMENTS (impls); i++)
+        {
+          if (mks_pixels_impl_is_supported (impls[i]))
+            names[n_names++] = impls[i]->name;
+        }
+
+      names[n_names] = NULL;
+
+      g_once_init_leave (&initialized, TRUE);
+    }
+
+  return names;
+}
+
+/*
+ * mks_pixels_set_impl:
+ * @name: a name from mks_pixels_get_impl_names()
+ *
+ * Switches every following operation to the kernels named @name. This
+ * is meant for tests and benchmarks which compare implementations.
+ *
+ * Returns: %TRUE if @name is supported on the running CPU
+ */
+gboolean
+mks_pixels_set_impl (const char *name)
+{
+  const MksPixelsImpl *impl;
+
+  g_return_val_if_fail (name != NULL, FALSE);
+
+  /* Ensure MKS_PIXELS_IMPL cannot override us later */
+  (void) mks_pixels_get_impl ();
+
+  if (!(impl = mks_pixels_find_impl (name)))
+    return FALSE;
+
+  g_atomic_pointer_set (&current_impl, impl);
+
+  return TRUE;
+}
+
+/*
+ * mks_pixels_can_convert:
+ * @pixman_format: a pixman format code
+ *
+ * Checks if mks_pixels_convert_rows() can convert from @pixman_format
+ * into native-endian ARGB32.
+ */
+gboolean
+mks_pixels_can_convert (guint pixman_format)
+{
+  MksPixelsKernel kernel;
+
+  return pixman_format == PIXMAN_a8r8g8b8 ||
+         mks_pixels_get_kernel (pixman_format, &kernel);
+}
+
+/*
+ * mks_pixels_copy_rows:
+ *
+ * Copies @n_rows rows of @row_bytes from @src to @dst honoring the
+ * stride of each.
+ *
+ * The C library memcpy() is already vectorized for the running CPU so
+ * this only takes care of collapsing contiguous rows into one copy.
+ */
+void
+mks_pixels_copy_rows (guint8       *dst,
+                      gsize         dst_stride,
+                      const guint8 *src,
+                      gsize         src_stride,
+                      gsize         row_bytes,
+                      guint         n_rows)
+{
+  g_assert (dst != NULL);
+  g_assert (src != NULL);
+  g_assert (dst_stride >= row_bytes);
+  g_assert (src_stride >= row_bytes);
+
+  if (n_rows == 0 || row_bytes == 0)
+    return;
+
+  if (dst_stride == row_bytes && src_stride == row_bytes)
+    {
+      memcpy (dst, src, row_bytes * n_rows);
+      return;
+    }
+
+  for (guint i = 0; i < n_rows; i++)
+    memcpy (&dst[i * dst_stride], &src[i * src_stride], row_bytes);
+}
+
+/*
+ * mks_pixels_convert_rows:
+ * @pixman_format: the format of @src
+ *
+ * Converts @width pixels of @n_rows rows from @src into native-endian
+ * ARGB32 in @dst.
+ *
+ * Formats without alpha are made opaque so that the result may be used
+ * as premultiplied ARGB without padding being read as translucency.
+ *
+ * Only the requested rows are touched so callers should pass damaged
+ * areas rather than the whole frame.
+ */
+void
+mks_pixels_convert_rows (guint         pixman_format,
+                         guint8       *dst,
+                         gsize         dst_stride,
+                         const guint8 *src,
+                         gsize         src_stride,
+                         guint         width,
+                         guint         n_rows)
+{
+  MksConvertRow convert_row;
+  MksPixelsKernel kernel;
+
+  g_assert (dst != NULL);
+  g_assert (src != NULL);
+  g_assert (dst_stride >= (gsize)width * 4);
+  g_assert (src_stride >= (gsize)width * PIXMAN_FORMAT_BPP (pixman_format) / 8);
+
+  if (pixman_format == PIXMAN_a8r8g8b8)
+    {
+      mks_pixels_copy_rows (dst, dst_stride, src, src_stride, (gsize)width * 4, n_rows);
+      return;
+    }
+
+  if (!mks_pixels_get_kernel (pixman_format, &kernel))
+    g_return_if_reached ();
+
+  convert_row = mks_pixels_get_impl ()->convert_row[kernel];
+
+  for (guint i = 0; i < n_rows; i++)
+    convert_row (&dst[i * dst_stride], &src[i * src_stride], width);
+}
+
+/*
+ * mks_pixels_convert_yuv_rows:
+ * @layout: the layout of @planes
+ * @dst: the destination for the first converted pixel
+ * @planes: the first byte of the Y, U and V planes, V is unused for NV12
+ * @strides: the stride of each plane
+ * @x: the first column to convert
+ * @y: the first row to convert
+ *
+ * Converts @width pixels of @n_rows rows starting at @x,@y of 4:2:0 YUV
+ * into opaque native-endian ARGB32 in @dst.
+ *
+ * Chroma is shared by 2x2 pixels so @x and @y may be odd, such as when
+ * converting a damaged area. Rows of @planes are in memory order, which
+ * lets callers convert one row at a time to flip the result.
+ */
+void
+mks_pixels_convert_yuv_rows (MksPixelsYuv  layout,
+                             guint8       *dst,
+                             gsize         dst_stride,
+                             const guint8 *planes[3],
+                             const gsize   strides[3],
+                             guint         x,
+                             guint         y,
+                             guint         width,
+                             guint         n_rows)
+{
+  MksConvertYuvRow convert_row;
+  gboolean semi_planar = layout == MKS_PIXELS_NV12;
+
+  g_assert (layout < MKS_PIXELS_N_YUV);
+  g_assert (dst != NULL);
+  g_assert (dst_stride >= (gsize)width * 4);
+  g_assert (planes[0] != NULL && planes[1] != NULL);
+  g_assert (semi_planar || planes[2] != NULL);
+
+  if (width == 0)
+    return;
+
+  convert_row = mks_pixels_get_impl ()->convert_yuv_row[layout];
+
+  for (guint i = 0; i < n_rows; i++)
+    {
+      guint row = y + i;
+      const guint8 *luma = &planes[0][(gsize)row * strides[0]];
+      const guint8 *u = &planes[1][(gsize)(row / 2) * strides[1]];
+      const guint8 *v = semi_planar ? NULL : &planes[2][(gsize)(row / 2) * strides[2]];
+      guint8 *out = &dst[i * dst_stride];
+      guint col = x;
+      guint n = width;
+
+      /* Kernels start on a chroma pair, so an odd column goes first */
+      if (col % 2 == 1)
+        {
+          convert_row (out,
+                       &luma[col],
+                       semi_planar ? &u[col - 1] : &u[col / 2],
+                       semi_planar ? NULL : &v[col / 2],
+                       1);
+          out += 4;
+          col++;
+          n--;
+        }
+
+      convert_row (out,
+                   &luma[col],
+                   semi_planar ? &u[col] : &u[col / 2],
+                   semi_planar ? NULL : &v[col / 2],
+                   n);
+    }
+}
+
+/*
+ * mks_pixels_flip_rows:
+ *
+ * Reverses the order of @n_rows rows of @row_bytes in place, such as
+ * to turn the contents of a y0_top scanout right side up.
+ */
+void
+mks_pixels_flip_rows (guint8 *pixels,
+                      gsize   stride,
+                      gsize   row_bytes,
+                      guint   n_rows)
+{
+  MksSwapRow swap_row;
+
+  g_assert (pixels != NULL || n_rows == 0);
+  g_assert (stride >= row_bytes);
+
+  swap_row = mks_pixels_get_impl ()->swap_row;
+
+  for (guint i = 0; i < n_rows / 2; i++)
+    swap_row (&pixels[i * stride], &pixels[(n_rows - 1 - i) * stride], row_bytes);
+}
+
+/*
+ * mks_pixels_hash_rows:
+ *
+ * Computes a 64-bit hash of @row_bytes from each of @n_rows rows of
+ * @src. Padding between rows is not included.
+ *
+ * The result is the same for every implementation but is only intended
+ * to detect changes between two versions of the same area.
+ */
+guint64
+mks_pixels_hash_rows (const guint8 *src,
+                      gsize         src_stride,
+                      gsize         row_bytes,
+                      guint         n_rows)
+{
+  MksHashRow hash_row;
+  guint64 h = HASH_PRIME1;
+
+  g_assert (src != NULL || n_rows == 0);
+  g_assert (src_stride >= row_bytes);
+
+  hash_row = mks_pixels_get_impl ()->hash_row;
+
+  for (guint i = 0; i < n_rows; i++)
+    h = hash_row (h, &src[i * src_stride], row_bytes);
+
+  return h;
+}
+
+static inline guint
+box_start (guint i,
+           guint src_size,
+           guint dst_size)
+{
+  return (guint64)i * src_size / dst_size;
+}
+
+static inline guint
+box_index (guint s,
+           guint src_size,
+           guint dst_size)
+{
+  return ((guint64)(s + 1) * dst_size - 1) / src_size;
+}
+
+/*
+ * mks_pixels_downsample_align:
+ * @src_size: the size of the source along one axis
+ * @dst_size: the size of the destination along the same axis
+ * @pos: (inout): the start of a span in the source
+ * @size: (inout): the length of the span
+ *
+ * Grows a span of the source so that it starts and ends on the boundary
+ * of a box used by mks_pixels_downsample(). Downsampling the aligned span
+ * produces the same pixels as downsampling the whole source would.
+ */
+void
+mks_pixels_downsample_align (guint  src_size,
+                             guint  dst_size,
+                             guint *pos,
+                             guint *size)
+{
+  guint first;
+  guint last;
+
+  g_assert (dst_size > 0);
+  g_assert (dst_size <= src_size);
+  g_assert (*pos + *size <= src_size);
+
+  if (*size == 0)
+    return;
+
+  first = box_index (*pos, src_size, dst_size);
+  last = box_index (*pos + *size - 1, src_size, dst_size);
+
+  *pos = box_start (first, src_size, dst_size);
+  *size = box_start (last + 1, src_size, dst_size) - *pos;
+}
+
+/*
+ * mks_pixels_downsample:
+ * @pixman_format: the format of @src
+ * @dst: the destination of @dst_width by @dst_height ARGB32 pixels
+ * @src: the pixel at @x,@y of a source of @src_width by @src_height
+ * @x: the X position of the available area within the source
+ * @y: the Y position of the available area within the source
+ * @width: the width of the available area
+ * @height: the height of the available area
+ *
+ * Shrinks an area of the source into the pixels of @dst it maps to using
+ * a box filter. Each destination pixel is the average of the source
+ * pixels it covers, so no source pixel is skipped no matter the ratio.
+ *
+ * Only @width by @height pixels starting at @src are read. Destination
+ * pixels which straddle the edge of the area are averaged over the part
+ * within it, use mks_pixels_downsample_align() beforehand when the rest
+ * of the source can be read as well.
+ *
+ * The destination must not be larger than the source.
+ */
+void
+mks_pixels_downsample (guint         pixman_format,
+                       guint8       *dst,
+                       gsize         dst_stride,
+                       guint         dst_width,
+                       guint         dst_height,
+                       const guint8 *src,
+                       gsize         src_stride,
+                       guint         src_width,
+                       guint         src_height,
+                       guint         x,
+                       guint         y,
+                       guint         width,
+                       guint         height)
+{
+  g_autofree guint32 *acc = NULL;
+  g_autofree guint *bounds = NULL;
+  g_autofree guint8 *row = NULL;
+  MksBoxRow box_row;
+  guint dst_x0, dst_x1;
+  guint dst_y0, dst_y1;
+  guint n_boxes;
+
+  g_assert (dst != NULL);
+  g_assert (src != NULL);
+  g_assert (dst_width > 0 && dst_width <= src_width);
+  g_assert (dst_height > 0 && dst_height <= src_height);
+  g_assert (x + width <= src_width);
+  g_assert (y + height <= src_height);
+  g_assert (mks_pixels_can_convert (pixman_format));
+
+  if (width == 0 || height == 0)
+    return;
+
+  dst_x0 = box_index (x, src_width, dst_width);
+  dst_x1 = box_index (x + width - 1, src_width, dst_width) + 1;
+  dst_y0 = box_index (y, src_height, dst_height);
+  dst_y1 = box_index (y + height - 1, src_height, dst_height) + 1;
+  n_boxes = dst_x1 - dst_x0;
+
+  /* Box boundaries relative to @x, clipped to the available area */
+  bounds = g_new (guint, n_boxes + 1);
+  for (guint i = 0; i <= n_boxes; i++)
+    bounds[i] = CLAMP (box_start (dst_x0 + i, src_width, dst_width), x, x + width) - x;
+
+  acc = g_new (guint32, n_boxes * 4);
+  row = g_malloc ((gsize)width * 4);
+  box_row = mks_pixels_get_impl ()->box_row;
+
+  for (guint dy = dst_y0; dy < dst_y1; dy++)
+    {
+      guint sy0 = MAX (box_start (dy, src_height, dst_height), y);
+      guint sy1 = MIN (box_start (dy + 1, src_height, dst_height), y + height);
+      guint32 *out = (guint32 *)(gpointer)&dst[dy * dst_stride + dst_x0 * 4];
+
+      memset (acc, 0, n_boxes * 4 * sizeof *acc);
+
+      for (guint sy = sy0; sy < sy1; sy++)
+        {
+          const guint8 *line = &src[(sy - y) * src_stride];
+
+          if (pixman_format != PIXMAN_a8r8g8b8)
+            {
+              mks_pixels_convert_rows (pixman_format, row, (gsize)width * 4,
+                                       line, src_stride, width, 1);
+              line = row;
+            }
+
+          box_row (acc, line, bounds, n_boxes);
+        }
+
+      for (guint i = 0; i < n_boxes; i++)
+        {
+          guint n = (bounds[i + 1] - bounds[i]) * (sy1 - sy0);
+          guint8 p[4];
+
+          for (guint c = 0; c < 4; c++)
+            p[c] = (acc[i * 4 + c] + n / 2) / n;
+
+          memcpy (&out[i], p, 4);
+        }
+    }
+}
@@ -0,0 +1,704 @@
+/* mks-screen-capture.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "config.h"
+
+#include <pixman.h>
+
+#include "mks-cpu-listener-private.h"
+#include "mks-damage-private.h"
+#include "mks-dmabuf-map-private.h"
+#include "mks-pixels-private.h"
+#include "mks-screen-capture-private.h"
+#include "mks-util-private.h"
+
+/**
+ * MksScreenCapture:
+ *
+ * Captures the contents of a [class@Mks.Screen] without a display.
+ *
+ * `MksScreenCapture` registers its own listener with the guest console
+ * and keeps just enough state to produce frames on request. It is meant
+ * for tooling such as screenshots in CI or health checks where creating
+ * a `GtkWindow` is not an option.
+ *
+ * Frames are always delivered as %GDK_MEMORY_DEFAULT regardless of the
+ * format used by the guest. Shared memory scanouts are copied straight
+ * out of the mapping and DMA-BUF scanouts are read through a CPU mapping
+ * of the buffer, so only linear buffers can be captured. Besides RGB
+ * formats, those may be NV12, YUV420 or YVU420 as used by guest video.
+ *
+ * Use [method@Mks.Screen.create_capture] to create a capture.
+ */
+
+/**
+ * MksScreenFrame:
+ *
+ * A frame produced by [method@Mks.ScreenCapture.next_frame].
+ *
+ * The frame contains the pixels for the area described by
+ * [method@Mks.ScreenFrame.get_x], [method@Mks.ScreenFrame.get_y],
+ * [method@Mks.ScreenFrame.get_width] and
+ * [method@Mks.ScreenFrame.get_height] within a screen of
+ * [method@Mks.ScreenFrame.get_screen_width] by
+ * [method@Mks.ScreenFrame.get_screen_height] pixels.
+ */
+
+typedef struct _MksCaptureRequest
+{
+  DexPromise            *promise;
+  MksScreenCaptureFlags  flags;
+} MksCaptureRequest;
+
+struct _MksScreenFrame
+{
+  int     ref_count;
+  GBytes *bytes;
+  gsize   stride;
+  int     x;
+  int     y;
+  int     width;
+  int     height;
+  guint   screen_width;
+  guint   screen_height;
+};
+
+struct _MksScreenCapture
+{
+  GObject          parent_instance;
+
+  MksCpuListener  *listener;
+
+  /* MksCaptureRequest waiting for a frame, or damage in the case of
+   * MKS_SCREEN_CAPTURE_DAMAGE.
+   */
+  GQueue           pending;
+
+  /* Damage since the last capture in screen coordinates */
+  MksDamage        damage;
+
+  guint            width;
+  guint            height;
+
+  /* Copy of MKS_CPU_LISTENER_SOURCE_PAYLOAD, always native ARGB32 with
+   * width * 4 stride.
+   */
+  guint8          *shadow;
+
+  guint            captured : 1;
+};
+
+G_DEFINE_FINAL_TYPE (MksScreenCapture, mks_screen_capture, G_TYPE_OBJECT)
+
+G_DEFINE_BOXED_TYPE (MksScreenFrame,
+                     mks_screen_frame,
+                     mks_screen_frame_ref,
+                     mks_screen_frame_unref)
+
+static MksScreenFrame *
+mks_screen_frame_new (GBytes *bytes,
+                      gsize   stride,
+                      int     x,
+                      int     y,
+                      int     width,
+                      int     height,
+                      guint   screen_width,
+                      guint   screen_height)
+{
+  MksScreenFrame *self;
+
+  self = g_new0 (MksScreenFrame, 1);
+  self->ref_count = 1;
+  self->bytes = g_bytes_ref (bytes);
+  self->stride = stride;
+  self->x = x;
+  self->y = y;
+  self->width = width;
+  self->height = height;
+  self->screen_width = screen_width;
+  self->screen_height = screen_height;
+
+  return self;
+}
+
+static void
+mks_capture_request_free (MksCaptureRequest *request)
+{
+  dex_clear (&request->promise);
+  g_free (request);
+}
+
+static void
+mks_screen_capture_clear_source (MksScreenCapture *self)
+{
+  g_assert (MKS_IS_SCREEN_CAPTURE (self));
+
+  g_clear_pointer (&self->shadow, g_free);
+
+  self->width = 0;
+  self->height = 0;
+
+  mks_damage_clear (&self->damage);
+}
+
+static void
+mks_screen_capture_set_size (MksScreenCapture *self,
+                             guint             width,
+                             guint             height)
+{
+  g_assert (MKS_IS_SCREEN_CAPTURE (self));
+
+  self->width = width;
+  self->height = height;
+
+  /* A new scanout invalidates everything a damage capture has seen */
+  mks_damage_clear (&self->damage);
+  mks_damage_add (&self->damage,
+                  &(cairo_rectangle_int_t) { 0, 0, width, height });
+}
+
+static void
+mks_screen_capture_damage (MksScreenCapture *self,
+                           int               x,
+                           int               y,
+                           int               width,
+                           int               height)
+{
+  g_assert (MKS_IS_SCREEN_CAPTURE (self));
+
+  mks_damage_add (&self->damage,
+                  &(cairo_rectangle_int_t) { x, y, width, height });
+  mks_damage_clip (&self->damage,
+                   &(cairo_rectangle_int_t) { 0, 0, self->width, self->height });
+}
+
+static gboolean
+mks_screen_capture_read_dmabuf (MksScreenCapture             *self,
+                                const cairo_rectangle_int_t  *area,
+                                guint8                       *dst,
+                                gsize                         dst_stride,
+                                GError                      **error)
+{
+  MksDmabufMap map;
+
+  g_assert (MKS_IS_SCREEN_CAPTURE (self));
+
+  if (!mks_dmabuf_map_begin (&map, mks_cpu_listener_get_dmabuf (self->listener), error))
+    return FALSE;
+
+  mks_dmabuf_map_convert (&map,
+                          area->x, area->y, area->width, area->height,
+                          dst, dst_stride);
+
+  mks_dmabuf_map_end (&map);
+
+  return TRUE;
+}
+
+static MksScreenFrame *
+mks_screen_capture_snapshot (MksScreenCapture       *self,
+                             MksScreenCaptureFlags   flags,
+                             GError                **error)
+{
+  g_autoptr(GBytes) bytes = NULL;
+  cairo_rectangle_int_t area = { 0, 0, self->width, self->height };
+  guint8 *data;
+  gsize stride;
+
+  g_assert (MKS_IS_SCREEN_CAPTURE (self));
+
+  MKS_TRACE_SCOPE ("capture.snapshot", "width=%u height=%u", self->width, self->height);
+
+  if ((flags & MKS_SCREEN_CAPTURE_DAMAGE) != 0 && self->captured)
+    mks_damage_get_extents (&self->damage, &area);
+
+  stride = (gsize)area.width * 4;
+  data = g_malloc (stride * area.height);
+
+  switch (mks_cpu_listener_get_source (self->listener))
+    {
+    case MKS_CPU_LISTENER_SOURCE_PAYLOAD:
+      mks_pixels_copy_rows (data,
+                            stride,
+                            self->shadow + area.y * ((gsize)self->width * 4) + area.x * 4,
+                            (gsize)self->width * 4,
+                            stride,
+                            area.height);
+      break;
+
+    case MKS_CPU_LISTENER_SOURCE_MAP:
+      {
+        const guint8 *src;
+        guint map_stride;
+        guint map_format;
+        gsize bpp;
+
+        src = mks_cpu_listener_get_map (self->listener, &map_stride, &map_format);
+        bpp = PIXMAN_FORMAT_BPP (map_format) / 8;
+
+        mks_pixels_convert_rows (map_format,
+                                 data,
+                                 stride,
+                                 src + area.y * (gsize)map_stride + area.x * bpp,
+                                 map_stride,
+                                 area.width,
+                                 area.height);
+      }
+      break;
+
+    case MKS_CPU_LISTENER_SOURCE_DMABUF:
+      if (!mks_screen_capture_read_dmabuf (self, &area, data, stride, error))
+        {
+          g_free (data);
+          return NULL;
+        }
+      break;
+
+    case MKS_CPU_LISTENER_SOURCE_NONE:
+    default:
+      g_assert_not_reached ();
+    }
+
+  bytes = g_bytes_new_take (data, stride * area.height);
+
+  mks_damage_clear (&self->damage);
+  self->captured = TRUE;
+
+  return mks_screen_frame_new (bytes,
+                               stride,
+                               area.x,
+                               area.y,
+                               area.width,
+                               area.height,
+                               self->width,
+                               self->height);
+}
+
+static void
+mks_screen_capture_flush (MksScreenCapture *self)
+{
+  GList *iter;
+
+  g_assert (MKS_IS_SCREEN_CAPTURE (self));
+
+  if (mks_cpu_listener_get_source (self->listener) == MKS_CPU_LISTENER_SOURCE_NONE)
+    return;
+
+  iter = self->pending.head;
+
+  while (iter != NULL)
+    {
+      MksCaptureRequest *request = iter->data;
+      g_autoptr(MksScreenFrame) frame = NULL;
+      g_autoptr(GError) error = NULL;
+      GList *next = iter->next;
+
+      if ((request->flags & (MKS_SCREEN_CAPTURE_DAMAGE | MKS_SCREEN_CAPTURE_CHANGED)) != 0 &&
+          self->captured &&
+          mks_damage_is_empty (&self->damage))
+        {
+          iter = next;
+          continue;
+        }
+
+      g_queue_delete_link (&self->pending, iter);
+
+      if ((frame = mks_screen_capture_snapshot (self, request->flags, &error)))
+        dex_promise_resolve_boxed (request->promise, MKS_TYPE_SCREEN_FRAME, frame);
+      else
+        dex_promise_reject (request->promise, g_steal_pointer (&error));
+
+      mks_capture_request_free (request);
+
+      iter = next;
+    }
+}
+
+static void
+mks_screen_capture_scanout_cb (MksScreenCapture *self,
+                               MksCpuListener   *listener)
+{
+  guint width;
+  guint height;
+
+  g_assert (MKS_IS_SCREEN_CAPTURE (self));
+  g_assert (MKS_IS_CPU_LISTENER (listener));
+
+  width = mks_cpu_listener_get_width (listener);
+  height = mks_cpu_listener_get_height (listener);
+
+  mks_screen_capture_clear_source (self);
+
+  /* Payloads are gone once the signal returns, so keep a copy */
+  if (mks_cpu_listener_get_source (listener) == MKS_CPU_LISTENER_SOURCE_PAYLOAD)
+    {
+      const guint8 *data;
+      guint stride;
+      guint pixman_format;
+
+      data = mks_cpu_listener_get_payload (listener, &stride, &pixman_format);
+
+      self->shadow = g_malloc ((gsize)width * 4 * height);
+      mks_pixels_convert_rows (pixman_format,
+                               self->shadow,
+                               (gsize)width * 4,
+                               data,
+                               stride,
+                               width,
+                               height);
+    }
+
+  mks_screen_capture_set_size (self, width, height);
+
+  mks_screen_capture_flush (self);
+}
+
+static void
+mks_screen_capture_update_cb (MksScreenCapture *self,
+                              int               x,
+                              int               y,
+                              int               width,
+                              int               height,
+                              MksCpuListener   *listener)
+{
+  g_assert (MKS_IS_SCREEN_CAPTURE (self));
+  g_assert (MKS_IS_CPU_LISTENER (listener));
+
+  if (mks_cpu_listener_get_source (listener) == MKS_CPU_LISTENER_SOURCE_PAYLOAD)
+    {
+      const guint8 *data;
+      guint stride;
+      guint pixman_format;
+
+      data = mks_cpu_listener_get_payload (listener, &stride, &pixman_format);
+
+      mks_pixels_convert_rows (pixman_format,
+                               self->shadow + y * ((gsize)self->width * 4) + x * 4,
+                               (gsize)self->width * 4,
+                               data,
+                               stride,
+                               width,
+                               height);
+    }
+
+  mks_screen_capture_damage (self, x, y, width, height);
+
+  mks_screen_capture_flush (self);
+}
+
+static void
+mks_screen_capture_disable_cb (MksScreenCapture *self,
+                               MksCpuListener   *listener)
+{
+  g_assert (MKS_IS_SCREEN_CAPTURE (self));
+  g_assert (MKS_IS_CPU_LISTENER (listener));
+
+  mks_screen_capture_clear_source (self);
+}
+
+static void
+mks_screen_capture_dispose (GObject *object)
+{
+  MksScreenCapture *self = (MksScreenCapture *)object;
+  MksCaptureRequest *request;
+
+  while ((request = g_queue_pop_head (&self->pending)))
+    {
+      dex_promise_reject (request->promise,
+                          g_error_new_literal (G_IO_ERROR,
+                                               G_IO_ERROR_CANCELLED,
+                                               "Screen capture was disposed"));
+      mks_capture_request_free (request);
+    }
+
+  g_clear_object (&self->listener);
+
+  mks_screen_capture_clear_source (self);
+
+  G_OBJECT_CLASS (mks_screen_capture_parent_class)->dispose (object);
+}
+
+static void
+mks_screen_capture_class_init (MksScreenCaptureClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = mks_screen_capture_dispose;
+}
+
+static void
+mks_screen_capture_init (MksScreenCapture *self)
+{
+  mks_damage_init (&self->damage);
+}
+
+MksScreenCapture *
+_mks_screen_capture_new (int     *peer_fd,
+                         GError **error)
+{
+  g_autoptr(MksScreenCapture) self = NULL;
+
+  g_return_val_if_fail (peer_fd != NULL, NULL);
+
+  *peer_fd = -1;
+
+  self = g_object_new (MKS_TYPE_SCREEN_CAPTURE, NULL);
+
+  if (!(self->listener = mks_cpu_listener_new (peer_fd, error)))
+    return NULL;
+
+  g_signal_connect_object (self->listener, "scanout",
+                           G_CALLBACK (mks_screen_capture_scanout_cb),
+                           self, G_CONNECT_SWAPPED);
+  g_signal_connect_object (self->listener, "update",
+                           G_CALLBACK (mks_screen_capture_update_cb),
+                           self, G_CONNECT_SWAPPED);
+  g_signal_connect_object (self->listener, "disable",
+                           G_CALLBACK (mks_screen_capture_disable_cb),
+                           self, G_CONNECT_SWAPPED);
+
+  return g_steal_pointer (&self);
+}
+
+/**
+ * mks_screen_capture_next_frame:
+ * @self: a #MksScreenCapture
+ * @flags: a #MksScreenCaptureFlags
+ *
+ * Requests the next frame from the screen.
+ *
+ * The future resolves as soon as the guest has provided a complete
+ * frame. If %MKS_SCREEN_CAPTURE_DAMAGE or %MKS_SCREEN_CAPTURE_CHANGED is
+ * set and a frame was captured previously, it waits until the guest
+ * changes something. With %MKS_SCREEN_CAPTURE_DAMAGE the frame only covers
+ * the extents of what changed since that capture.
+ *
+ * Returns: (transfer full): a [class@Dex.Future] that resolves to a
+ *   [struct@Mks.ScreenFrame].
+ */
+DexFuture *
+mks_screen_capture_next_frame (MksScreenCapture      *self,
+                               MksScreenCaptureFlags  flags)
+{
+  MksCaptureRequest *request;
+  DexFuture *ret;
+
+  dex_return_error_if_fail (MKS_IS_SCREEN_CAPTURE (self));
+
+  request = g_new0 (MksCaptureRequest, 1);
+  request->promise = dex_promise_new ();
+  request->flags = flags;
+
+  ret = dex_ref (request->promise);
+
+  g_queue_push_tail (&self->pending, request);
+  mks_screen_capture_flush (self);
+
+  return ret;
+}
+
+void
+mks_screen_capture_next_frame_async (MksScreenCapture      *self,
+                                     MksScreenCaptureFlags  flags,
+                                     GCancellable          *cancellable,
+                                     GAsyncReadyCallback    callback,
+                                     gpointer               user_data)
+{
+  mks_future_to_async_result (self, cancellable, callback, user_data, G_STRFUNC,
+                              mks_screen_capture_next_frame (self, flags));
+}
+
+/**
+ * mks_screen_capture_next_frame_finish:
+ * @self: a #MksScreenCapture
+ * @result: a `GAsyncResult`
+ * @error: return location for a `GError`, or %NULL
+ *
+ * Completes a request to [method@Mks.ScreenCapture.next_frame_async].
+ *
+ * Returns: (transfer full): a #MksScreenFrame or %NULL
+ */
+MksScreenFrame *
+mks_screen_capture_next_frame_finish (MksScreenCapture  *self,
+                                      GAsyncResult      *result,
+                                      GError           **error)
+{
+  g_return_val_if_fail (MKS_IS_SCREEN_CAPTURE (self), NULL);
+  g_return_val_if_fail (DEX_IS_ASYNC_RESULT (result), NULL);
+
+  return dex_async_result_propagate_pointer (DEX_ASYNC_RESULT (result), error);
+}
+
+MksScreenFrame *
+mks_screen_frame_ref (MksScreenFrame *self)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (self->ref_count > 0, NULL);
+
+  g_atomic_int_inc (&self->ref_count);
+
+  return self;
+}
+
+void
+mks_screen_frame_unref (MksScreenFrame *self)
+{
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (self->ref_count > 0);
+
+  if (g_atomic_int_dec_and_test (&self->ref_count))
+    {
+      g_clear_pointer (&self->bytes, g_bytes_unref);
+      g_free (self);
+    }
+}
+
+/**
+ * mks_screen_frame_get_bytes:
+ * @self: a #MksScreenFrame
+ *
+ * Gets the pixels of the frame.
+ *
+ * Rows are [method@Mks.ScreenFrame.get_stride] bytes apart and stored
+ * in the format returned by [method@Mks.ScreenFrame.get_format].
+ *
+ * Returns: (transfer none): a #GBytes
+ */
+GBytes *
+mks_screen_frame_get_bytes (MksScreenFrame *self)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+
+  return self->bytes;
+}
+
+/**
+ * mks_screen_frame_get_format:
+ * @self: a #MksScreenFrame
+ *
+ * Gets the memory format of the frame.
+ *
+ * Returns: a #GdkMemoryFormat
+ */
+GdkMemoryFormat
+mks_screen_frame_get_format (MksScreenFrame *self)
+{
+  g_return_val_if_fail (self != NULL, GDK_MEMORY_DEFAULT);
+
+  return GDK_MEMORY_DEFAULT;
+}
+
+/**
+ * mks_screen_frame_get_stride:
+ * @self: a #MksScreenFrame
+ *
+ * Gets the number of bytes between rows of the frame.
+ */
+gsize
+mks_screen_frame_get_stride (MksScreenFrame *self)
+{
+  g_return_val_if_fail (self != NULL, 0);
+
+  return self->stride;
+}
+
+/**
+ * mks_screen_frame_get_x:
+ * @self: a #MksScreenFrame
+ *
+ * Gets the X position of the frame within the screen.
+ */
+int
+mks_screen_frame_get_x (MksScreenFrame *self)
+{
+  g_return_val_if_fail (self != NULL, 0);
+
+  return self->x;
+}
+
+/**
+ * mks_screen_frame_get_y:
+ * @self: a #MksScreenFrame
+ *
+ * Gets the Y position of the frame within the screen.
+ */
+int
+mks_screen_frame_get_y (MksScreenFrame *self)
+{
+  g_return_val_if_fail (self != NULL, 0);
+
+  return self->y;
+}
+
+/**
+ * mks_screen_frame_get_width:
+ * @self: a #MksScreenFrame
+ *
+ * Gets the width of the frame in pixels.
+ */
+int
+mks_screen_frame_get_width (MksScreenFrame *self)
+{
+  g_return_val_if_fail (self != NULL, 0);
+
+  return self->width;
+}
+
+/**
+ * mks_screen_frame_get_height:
+ * @self: a #MksScreenFrame
+ *
+ * Gets the height of the frame in pixels.
+ */
+int
+mks_screen_frame_get_height (MksScreenFrame *self)
+{
+  g_return_val_if_fail (self != NULL, 0);
+
+  return self->height;
+}
+
+/**
+ * mks_screen_frame_get_screen_width:
+ * @self: a #MksScreenFrame
+ *
+ * Gets the width of the screen at the time the frame was captured.
+ */
+guint
+mks_screen_frame_get_screen_width (MksScreenFrame *self)
+{
+  g_return_val_if_fail (self != NULL, 0);
+
+  return self->screen_width;
+}
+
+/**
+ * mks_screen_frame_get_screen_height:
+ * @self: a #MksScreenFrame
+ *
+ * Gets the height of the screen at the time the frame was captured.
+ */
+guint
+mks_screen_frame_get_screen_height (MksScreenFrame *self)
+{
+  g_return_val_if_fail (self != NULL, 0);
+
+  return self->screen_height;
+}
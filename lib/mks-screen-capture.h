@@ -0,0 +1,99 @@
+/* mks-screen-capture.h
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#pragma once
+
+#if !defined(MKS_INSIDE) && !defined(MKS_COMPILATION)
+# error "Only <libmks.h> can be included directly."
+#endif
+
+#include <gdk/gdk.h>
+#include <libdex.h>
+
+#include "mks-types.h"
+#include "mks-version-macros.h"
+
+G_BEGIN_DECLS
+
+#define MKS_TYPE_SCREEN_CAPTURE (mks_screen_capture_get_type())
+#define MKS_TYPE_SCREEN_FRAME   (mks_screen_frame_get_type())
+
+/**
+ * MksScreenCaptureFlags:
+ * @MKS_SCREEN_CAPTURE_NONE: Capture the whole screen.
+ * @MKS_SCREEN_CAPTURE_DAMAGE: Only capture the area which changed since
+ *   the previous capture.
+ * @MKS_SCREEN_CAPTURE_CHANGED: Wait for something to change since the
+ *   previous capture but still capture the whole screen.
+ *
+ * Flags used when requesting a frame from a [class@Mks.ScreenCapture].
+ */
+typedef enum _MksScreenCaptureFlags
+{
+  MKS_SCREEN_CAPTURE_NONE    = 0,
+  MKS_SCREEN_CAPTURE_DAMAGE  = 1 << 0,
+  MKS_SCREEN_CAPTURE_CHANGED = 1 << 1,
+} MksScreenCaptureFlags;
+
+MKS_AVAILABLE_IN_ALL
+G_DECLARE_FINAL_TYPE (MksScreenCapture, mks_screen_capture, MKS, SCREEN_CAPTURE, GObject)
+
+MKS_AVAILABLE_IN_ALL
+DexFuture       *mks_screen_capture_next_frame        (MksScreenCapture       *self,
+                                                       MksScreenCaptureFlags   flags);
+MKS_AVAILABLE_IN_ALL
+void             mks_screen_capture_next_frame_async  (MksScreenCapture       *self,
+                                                       MksScreenCaptureFlags   flags,
+                                                       GCancellable           *cancellable,
+                                                       GAsyncReadyCallback     callback,
+                                                       gpointer                user_data);
+MKS_AVAILABLE_IN_ALL
+MksScreenFrame  *mks_screen_capture_next_frame_finish (MksScreenCapture       *self,
+                                                       GAsyncResult           *result,
+                                                       GError                **error);
+
+MKS_AVAILABLE_IN_ALL
+GType            mks_screen_frame_get_type            (void) G_GNUC_CONST;
+MKS_AVAILABLE_IN_ALL
+MksScreenFrame  *mks_screen_frame_ref                 (MksScreenFrame         *self);
+MKS_AVAILABLE_IN_ALL
+void             mks_screen_frame_unref               (MksScreenFrame         *self);
+MKS_AVAILABLE_IN_ALL
+GBytes          *mks_screen_frame_get_bytes           (MksScreenFrame         *self);
+MKS_AVAILABLE_IN_ALL
+GdkMemoryFormat  mks_screen_frame_get_format          (MksScreenFrame         *self);
+MKS_AVAILABLE_IN_ALL
+gsize            mks_screen_frame_get_stride          (MksScreenFrame         *self);
+MKS_AVAILABLE_IN_ALL
+int              mks_screen_frame_get_x               (MksScreenFrame         *self);
+MKS_AVAILABLE_IN_ALL
+int              mks_screen_frame_get_y               (MksScreenFrame         *self);
+MKS_AVAILABLE_IN_ALL
+int              mks_screen_frame_get_width           (MksScreenFrame         *self);
+MKS_AVAILABLE_IN_ALL
+int              mks_screen_frame_get_height          (MksScreenFrame         *self);
+MKS_AVAILABLE_IN_ALL
+guint            mks_screen_frame_get_screen_width    (MksScreenFrame         *self);
+MKS_AVAILABLE_IN_ALL
+guint            mks_screen_frame_get_screen_height   (MksScreenFrame         *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MksScreenFrame, mks_screen_frame_unref)
+
+G_END_DECLS
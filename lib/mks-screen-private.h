@@ -30,6 +30,11 @@ struct _MksScreen
   MksDevice parent_instance;
 
   gint64 last_active_time;
+
+  /* Paintables returned from mks_screen_attach(), one per GdkDisplay,
+   * shared by every caller while any of them holds a reference.
+   */
+  GQueue attachments;
 };
 
 struct _MksScreenClass
@@ -48,8 +53,35 @@ struct _MksScreenClass
                                         MksScreenAttributes *attributes);
   DexFuture     *(*attach)             (MksScreen           *self,
                                         GdkDisplay          *display);
+  DexFuture     *(*create_capture)     (MksScreen           *self);
+  DexFuture     *(*create_thumbnail)   (MksScreen           *self,
+                                        guint                max_width,
+                                        guint                max_height,
+                                        guint                max_fps);
+  void           (*suspend)            (MksScreen           *self,
+                                        GdkPaintable        *paintable);
+  void           (*resume)             (MksScreen           *self,
+                                        GdkPaintable        *paintable);
 };
 
+/* last-active-time advances at most once per epoch so that observers
+ * are not notified for every frame the guest draws.
+ */
+#define MKS_SCREEN_ACTIVITY_EPOCH (250 * G_TIME_SPAN_MILLISECOND)
+
 void _mks_screen_mark_active (MksScreen *self);
 
+static inline gboolean
+_mks_screen_advance_last_active_time (MksScreen *self,
+                                      gint64     now)
+{
+  if (self->last_active_time != 0 &&
+      now - self->last_active_time < MKS_SCREEN_ACTIVITY_EPOCH)
+    return FALSE;
+
+  self->last_active_time = now;
+
+  return TRUE;
+}
+
 G_END_DECLS
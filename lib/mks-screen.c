@@ -20,16 +20,73 @@
 
 #include "config.h"
 
+#include <string.h>
+
+#include <gst/app/gstappsrc.h>
+
 #include "mks-enums.h"
 #include "mks-keyboard.h"
 #include "mks-mouse.h"
+#include "mks-paintable-private.h"
+#include "mks-pixels-private.h"
 #include "mks-screen-private.h"
 #include "mks-screen-attributes.h"
+#include "mks-screen-capture.h"
 #include "mks-touchable.h"
 #include "mks-util-private.h"
 
+typedef struct _MksScreenAttachment
+{
+  GList         link;
+  MksScreen    *screen;
+  GdkDisplay   *display;
+
+  /* Weak pointer to the shared paintable once attached */
+  GdkPaintable *paintable;
+
+  /* The future other callers wait on while attaching */
+  DexFuture    *future;
+
+  /* Widgets showing @paintable. While none of them is shown, such as
+   * in a hidden tab or a minimized window, the subclass is asked to
+   * stop sending contents until one is shown again.
+   */
+  guint         n_views;
+  guint         n_shown;
+  guint         suspended : 1;
+  guint         published : 1;
+} MksScreenAttachment;
+
+typedef struct _MksScreenAttach
+{
+  GWeakRef    self;
+  GdkDisplay *display;
+} MksScreenAttach;
+
+/**
+ * MksScreenView:
+ *
+ * Tells a [class@Mks.Screen] whether a widget showing a paintable from
+ * [method@Mks.Screen.attach] can be seen.
+ *
+ * Created with [method@Mks.Screen.add_view]. The view is removed when
+ * its last reference is released.
+ */
+struct _MksScreenView
+{
+  int           ref_count;
+  GWeakRef      screen;
+  GdkPaintable *paintable;
+  guint         shown : 1;
+};
+
 G_DEFINE_ABSTRACT_TYPE (MksScreen, mks_screen, MKS_TYPE_DEVICE)
 
+G_DEFINE_BOXED_TYPE (MksScreenView,
+                     mks_screen_view,
+                     mks_screen_view_ref,
+                     mks_screen_view_unref)
+
 enum {
   PROP_0,
   PROP_DEVICE_ADDRESS,
@@ -97,11 +154,141 @@ mks_screen_get_property (GObject    *object,
     }
 }
 
+static void
+mks_screen_attachment_free (MksScreenAttachment *attachment)
+{
+  g_assert (attachment != NULL);
+  g_assert (attachment->link.prev == NULL);
+  g_assert (attachment->link.next == NULL);
+
+  g_clear_object (&attachment->display);
+  dex_clear (&attachment->future);
+  g_free (attachment);
+}
+
+static void
+mks_screen_attachment_remove (MksScreenAttachment *attachment)
+{
+  g_assert (attachment != NULL);
+  g_assert (MKS_IS_SCREEN (attachment->screen));
+
+  g_queue_unlink (&attachment->screen->attachments, &attachment->link);
+  mks_screen_attachment_free (attachment);
+}
+
+static void
+mks_screen_attachment_finalized_cb (gpointer  data,
+                                    GObject  *where_the_object_was)
+{
+  MksScreenAttachment *attachment = data;
+
+  g_assert (attachment != NULL);
+  g_assert (attachment->paintable == (gpointer)where_the_object_was);
+
+  /* The last viewer went away, the next attach starts over */
+  mks_screen_attachment_remove (attachment);
+}
+
+static MksScreenAttachment *
+mks_screen_find_attachment (MksScreen  *self,
+                            GdkDisplay *display)
+{
+  g_assert (MKS_IS_SCREEN (self));
+  g_assert (GDK_IS_DISPLAY (display));
+
+  for (const GList *iter = self->attachments.head; iter; iter = iter->next)
+    {
+      MksScreenAttachment *attachment = iter->data;
+
+      if (attachment->display == display)
+        return attachment;
+    }
+
+  return NULL;
+}
+
+static MksScreenAttachment *
+mks_screen_find_attachment_for_paintable (MksScreen    *self,
+                                          GdkPaintable *paintable)
+{
+  g_assert (MKS_IS_SCREEN (self));
+  g_assert (GDK_IS_PAINTABLE (paintable));
+
+  for (const GList *iter = self->attachments.head; iter; iter = iter->next)
+    {
+      MksScreenAttachment *attachment = iter->data;
+
+      if (attachment->paintable == paintable)
+        return attachment;
+    }
+
+  return NULL;
+}
+
+static void
+mks_screen_attachment_set_suspended (MksScreenAttachment *attachment,
+                                     gboolean             suspended)
+{
+  MksScreenClass *klass;
+
+  g_assert (attachment != NULL);
+  g_assert (MKS_IS_SCREEN (attachment->screen));
+  g_assert (GDK_IS_PAINTABLE (attachment->paintable));
+
+  if (suspended == attachment->suspended)
+    return;
+
+  attachment->suspended = suspended;
+  klass = MKS_SCREEN_GET_CLASS (attachment->screen);
+
+  if (suspended && klass->suspend != NULL)
+    klass->suspend (attachment->screen, attachment->paintable);
+  else if (!suspended && klass->resume != NULL)
+    klass->resume (attachment->screen, attachment->paintable);
+}
+
+static void
+mks_screen_attachment_update_suspended (MksScreenAttachment *attachment)
+{
+  g_assert (attachment != NULL);
+
+  /* Other processes may be reading a published paintable, so it is kept
+   * updated too. Once the last view is removed while hidden the paintable
+   * is usually about to be finalized, so it stays suspended rather than
+   * registering with QEMU again. Attaching it again resumes it.
+   */
+  if (attachment->n_shown > 0 || attachment->published)
+    mks_screen_attachment_set_suspended (attachment, FALSE);
+  else if (attachment->n_views > 0)
+    mks_screen_attachment_set_suspended (attachment, TRUE);
+}
+
+static void
+mks_screen_dispose (GObject *object)
+{
+  MksScreen *self = (MksScreen *)object;
+
+  while (self->attachments.head != NULL)
+    {
+      MksScreenAttachment *attachment = self->attachments.head->data;
+
+      if (attachment->paintable != NULL)
+        g_object_weak_unref (G_OBJECT (attachment->paintable),
+                             mks_screen_attachment_finalized_cb,
+                             attachment);
+
+      mks_screen_attachment_remove (attachment);
+    }
+
+  G_OBJECT_CLASS (mks_screen_parent_class)->dispose (object);
+}
+
 static void
 mks_screen_class_init (MksScreenClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
+  object_class->dispose = mks_screen_dispose;
   object_class->get_property = mks_screen_get_property;
 
   /**
@@ -152,6 +339,9 @@ mks_screen_class_init (MksScreenClass *klass)
    * The value is in monotonic time, comparable to
    * [func@GLib.get_monotonic_time]. A value of 0 means no display content has
    * been observed yet.
+   *
+   * To keep notifications cheap the value advances at most once every
+   * 250 milliseconds while the screen is being updated.
    */
   properties [PROP_LAST_ACTIVE_TIME] =
     g_param_spec_int64 ("last-active-time", NULL, NULL,
@@ -223,17 +413,10 @@ mks_screen_get_kind (MksScreen *self)
 void
 _mks_screen_mark_active (MksScreen *self)
 {
-  gint64 now;
-
   g_return_if_fail (MKS_IS_SCREEN (self));
 
-  now = g_get_monotonic_time ();
-
-  if (self->last_active_time != now)
-    {
-      self->last_active_time = now;
-      g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_LAST_ACTIVE_TIME]);
-    }
+  if (_mks_screen_advance_last_active_time (self, g_get_monotonic_time ()))
+    g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_LAST_ACTIVE_TIME]);
 }
 
 /**
@@ -372,6 +555,55 @@ mks_screen_configure_finish (MksScreen     *self,
   return dex_async_result_propagate_boolean (DEX_ASYNC_RESULT (result), error);
 }
 
+static void
+mks_screen_attach_free (MksScreenAttach *state)
+{
+  g_weak_ref_clear (&state->self);
+  g_clear_object (&state->display);
+  g_free (state);
+}
+
+static DexFuture *
+mks_screen_attach_complete (DexFuture *completed,
+                            gpointer   user_data)
+{
+  MksScreenAttach *state = user_data;
+  g_autoptr(MksScreen) self = NULL;
+  g_autoptr(GError) error = NULL;
+  MksScreenAttachment *attachment = NULL;
+  const GValue *value;
+
+  g_assert (DEX_IS_FUTURE (completed));
+  g_assert (state != NULL);
+  g_assert (GDK_IS_DISPLAY (state->display));
+
+  if ((self = g_weak_ref_get (&state->self)))
+    attachment = mks_screen_find_attachment (self, state->display);
+
+  value = dex_future_get_value (completed, &error);
+
+  if (attachment != NULL && attachment->paintable == NULL)
+    {
+      if (value == NULL)
+        {
+          /* Let the next caller try again */
+          mks_screen_attachment_remove (attachment);
+        }
+      else
+        {
+          attachment->paintable = g_value_get_object (value);
+          g_object_weak_ref (G_OBJECT (attachment->paintable),
+                             mks_screen_attachment_finalized_cb,
+                             attachment);
+
+          /* The future holds a reference to the paintable */
+          dex_clear (&attachment->future);
+        }
+    }
+
+  return dex_ref (completed);
+}
+
 /**
  * mks_screen_attach:
  * @self: a `MksScreen`
@@ -379,6 +611,11 @@ mks_screen_configure_finish (MksScreen     *self,
  *
  * Creates a paintable that is updated with the contents of @self.
  *
+ * Attaching the same screen again for the same @display, such as for a
+ * preview of a screen shown elsewhere, resolves to the same paintable
+ * so the screen contents are only transferred and stored once. Each
+ * widget showing it still draws it at its own size.
+ *
  * Returns: (transfer full): a [class@Dex.Future] that resolves to a
  *   [iface@Gdk.Paintable].
  */
@@ -386,6 +623,10 @@ DexFuture *
 mks_screen_attach (MksScreen  *self,
                    GdkDisplay *display)
 {
+  MksScreenAttachment *attachment;
+  MksScreenAttach *state;
+  DexFuture *future;
+
   dex_return_error_if_fail (MKS_IS_SCREEN (self));
   dex_return_error_if_fail (GDK_IS_DISPLAY (display));
 
@@ -394,7 +635,45 @@ mks_screen_attach (MksScreen  *self,
                                   G_IO_ERROR_NOT_SUPPORTED,
                                   "Not supported");
 
-  return MKS_SCREEN_GET_CLASS (self)->attach (self, display);
+  if ((attachment = mks_screen_find_attachment (self, display)))
+    {
+      if (attachment->paintable != NULL)
+        {
+          /* Callers without a widget are always updated */
+          if (attachment->n_views == 0)
+            mks_screen_attachment_set_suspended (attachment, FALSE);
+
+          return dex_future_new_for_object (attachment->paintable);
+        }
+
+      g_assert (attachment->future != NULL);
+
+      return dex_ref (attachment->future);
+    }
+
+  attachment = g_new0 (MksScreenAttachment, 1);
+  attachment->link.data = attachment;
+  attachment->screen = self;
+  attachment->display = g_object_ref (display);
+  g_queue_push_tail_link (&self->attachments, &attachment->link);
+
+  state = g_new0 (MksScreenAttach, 1);
+  g_weak_ref_init (&state->self, self);
+  state->display = g_object_ref (display);
+
+  future = dex_future_finally (MKS_SCREEN_GET_CLASS (self)->attach (self, display),
+                               mks_screen_attach_complete,
+                               state,
+                               (GDestroyNotify) mks_screen_attach_free);
+
+  /* The attachment may have been resolved or removed already if the
+   * subclass completed synchronously.
+   */
+  if ((attachment = mks_screen_find_attachment (self, display)) &&
+      attachment->paintable == NULL)
+    attachment->future = dex_ref (future);
+
+  return future;
 }
 
 void
@@ -428,3 +707,726 @@ mks_screen_attach_finish (MksScreen     *self,
 
   return dex_async_result_propagate_pointer (DEX_ASYNC_RESULT (result), error);
 }
+
+/**
+ * mks_screen_add_view:
+ * @self: a `MksScreen`
+ * @paintable: a `GdkPaintable` from [method@Mks.Screen.attach]
+ * @shown: if the widget showing @paintable can be seen
+ *
+ * Tells @self about a widget showing @paintable so that QEMU may stop
+ * sending contents while every such widget is hidden, such as in
+ * another tab or a minimized window. The contents are sent again once
+ * one of them is shown.
+ *
+ * Call [method@Mks.ScreenView.set_shown] as the widget is hidden or
+ * shown, and release the view once the widget no longer shows
+ * @paintable. A paintable whose last view is released while hidden
+ * stays suspended until it is attached again.
+ *
+ * [class@Mks.Display] does this itself. Paintables which never had a
+ * view are always updated.
+ *
+ * Returns: (transfer full): a `MksScreenView`
+ */
+MksScreenView *
+mks_screen_add_view (MksScreen    *self,
+                     GdkPaintable *paintable,
+                     gboolean      shown)
+{
+  MksScreenAttachment *attachment;
+  MksScreenView *view;
+
+  g_return_val_if_fail (MKS_IS_SCREEN (self), NULL);
+  g_return_val_if_fail (GDK_IS_PAINTABLE (paintable), NULL);
+
+  view = g_new0 (MksScreenView, 1);
+  view->ref_count = 1;
+  g_weak_ref_init (&view->screen, self);
+  view->paintable = g_object_ref (paintable);
+  view->shown = !!shown;
+
+  if ((attachment = mks_screen_find_attachment_for_paintable (self, paintable)))
+    {
+      attachment->n_views++;
+      if (view->shown)
+        attachment->n_shown++;
+
+      mks_screen_attachment_update_suspended (attachment);
+    }
+
+  return view;
+}
+
+MksScreenView *
+mks_screen_view_ref (MksScreenView *self)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (self->ref_count > 0, NULL);
+
+  g_atomic_int_inc (&self->ref_count);
+
+  return self;
+}
+
+/**
+ * mks_screen_view_unref:
+ * @self: a `MksScreenView`
+ *
+ * Releases a reference to @self.
+ *
+ * Once the last reference is released the view is removed from the
+ * screen, as if its widget had been destroyed.
+ */
+void
+mks_screen_view_unref (MksScreenView *self)
+{
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (self->ref_count > 0);
+
+  if (g_atomic_int_dec_and_test (&self->ref_count))
+    {
+      g_autoptr(MksScreen) screen = g_weak_ref_get (&self->screen);
+      MksScreenAttachment *attachment;
+
+      if (screen != NULL &&
+          (attachment = mks_screen_find_attachment_for_paintable (screen, self->paintable)))
+        {
+          g_assert (attachment->n_views > 0);
+
+          attachment->n_views--;
+          if (self->shown)
+            attachment->n_shown--;
+
+          mks_screen_attachment_update_suspended (attachment);
+        }
+
+      g_weak_ref_clear (&self->screen);
+      g_clear_object (&self->paintable);
+      g_free (self);
+    }
+}
+
+/**
+ * mks_screen_view_get_shown:
+ * @self: a `MksScreenView`
+ *
+ * Gets if the widget of @self was last reported as shown.
+ *
+ * Returns: %TRUE if the view is shown
+ */
+gboolean
+mks_screen_view_get_shown (MksScreenView *self)
+{
+  g_return_val_if_fail (self != NULL, FALSE);
+
+  return self->shown;
+}
+
+/**
+ * mks_screen_view_set_shown:
+ * @self: a `MksScreenView`
+ * @shown: if the widget can be seen
+ *
+ * Updates if the widget of @self can be seen, such as when it is
+ * mapped, unmapped or its window is minimized.
+ */
+void
+mks_screen_view_set_shown (MksScreenView *self,
+                           gboolean       shown)
+{
+  g_autoptr(MksScreen) screen = NULL;
+  MksScreenAttachment *attachment;
+
+  g_return_if_fail (self != NULL);
+
+  shown = !!shown;
+
+  if (shown == self->shown)
+    return;
+
+  self->shown = shown;
+
+  if ((screen = g_weak_ref_get (&self->screen)) &&
+      (attachment = mks_screen_find_attachment_for_paintable (screen, self->paintable)))
+    {
+      if (shown)
+        attachment->n_shown++;
+      else
+        attachment->n_shown--;
+
+      mks_screen_attachment_update_suspended (attachment);
+    }
+}
+
+/**
+ * mks_screen_publish:
+ * @self: a `MksScreen`
+ * @paintable: a `GdkPaintable` from [method@Mks.Screen.attach]
+ * @error: a location for a `GError`, or %NULL
+ *
+ * Makes the contents of @paintable available to other processes on the
+ * same host without them connecting to QEMU.
+ *
+ * The contents are copied into shared memory as QEMU updates them. Pass
+ * the resulting file-descriptor to another process, such as over a
+ * D-Bus method call, where [ctor@Mks.SharedPaintable.new] can show it.
+ * Any number of processes may use it, and calling this again returns a
+ * new file-descriptor for the same shared memory.
+ *
+ * Publishing stops when @paintable is finalized.
+ *
+ * Returns: a read-only file-descriptor owned by the caller, or -1
+ *   and @error is set.
+ */
+int
+mks_screen_publish (MksScreen     *self,
+                    GdkPaintable  *paintable,
+                    GError       **error)
+{
+  MksScreenAttachment *attachment;
+
+  g_return_val_if_fail (MKS_IS_SCREEN (self), -1);
+  g_return_val_if_fail (GDK_IS_PAINTABLE (paintable), -1);
+
+  if ((attachment = mks_screen_find_attachment_for_paintable (self, paintable)) &&
+      MKS_IS_PAINTABLE (paintable))
+    {
+      int fd;
+
+      if (-1 != (fd = _mks_paintable_share (MKS_PAINTABLE (paintable), error)))
+        {
+          /* Readers cannot tell us when they are hidden */
+          attachment->published = TRUE;
+          mks_screen_attachment_update_suspended (attachment);
+        }
+
+      return fd;
+    }
+
+  g_set_error_literal (error,
+                       G_IO_ERROR,
+                       G_IO_ERROR_NOT_SUPPORTED,
+                       "Paintable is not attached to screen");
+
+  return -1;
+}
+
+/**
+ * mks_screen_get_frame_stats:
+ * @self: a `MksScreen`
+ * @paintable: a `GdkPaintable` from [method@Mks.Screen.attach]
+ *
+ * Gets the statistics for updates received by @paintable.
+ *
+ * This is the same object as [method@Mks.Display.get_frame_stats] for
+ * displays showing @paintable. Frame rate, dropped frames and latency
+ * are only recorded while @paintable is drawn by a [class@Mks.Display],
+ * the update rate is recorded however it is drawn.
+ *
+ * Returns: (transfer none) (nullable): a `MksFrameStats`, or %NULL if
+ *   @paintable is not attached to @self.
+ */
+MksFrameStats *
+mks_screen_get_frame_stats (MksScreen    *self,
+                            GdkPaintable *paintable)
+{
+  g_return_val_if_fail (MKS_IS_SCREEN (self), NULL);
+  g_return_val_if_fail (GDK_IS_PAINTABLE (paintable), NULL);
+
+  if (mks_screen_find_attachment_for_paintable (self, paintable) != NULL &&
+      MKS_IS_PAINTABLE (paintable))
+    return _mks_paintable_get_frame_stats (MKS_PAINTABLE (paintable));
+
+  return NULL;
+}
+
+/**
+ * mks_screen_create_capture:
+ * @self: a `MksScreen`
+ *
+ * Creates a capture which can provide the contents of @self without
+ * a display or widget.
+ *
+ * Returns: (transfer full): a [class@Dex.Future] that resolves to a
+ *   [class@Mks.ScreenCapture].
+ */
+DexFuture *
+mks_screen_create_capture (MksScreen *self)
+{
+  dex_return_error_if_fail (MKS_IS_SCREEN (self));
+
+  if (MKS_SCREEN_GET_CLASS (self)->create_capture == NULL)
+    return dex_future_new_reject (G_IO_ERROR,
+                                  G_IO_ERROR_NOT_SUPPORTED,
+                                  "Not supported");
+
+  return MKS_SCREEN_GET_CLASS (self)->create_capture (self);
+}
+
+void
+mks_screen_create_capture_async (MksScreen           *self,
+                                 GCancellable        *cancellable,
+                                 GAsyncReadyCallback  callback,
+                                 gpointer             user_data)
+{
+  mks_future_to_async_result (self, cancellable, callback, user_data, G_STRFUNC,
+                              mks_screen_create_capture (self));
+}
+
+/**
+ * mks_screen_create_capture_finish:
+ * @self: a `MksScreen`
+ * @result: a `GAsyncResult`
+ * @error: return location for a `GError`, or %NULL
+ *
+ * Completes a request to create a capture for @self.
+ *
+ * Returns: (transfer full) (nullable): a `MksScreenCapture`.
+ */
+MksScreenCapture *
+mks_screen_create_capture_finish (MksScreen     *self,
+                                  GAsyncResult  *result,
+                                  GError       **error)
+{
+  g_return_val_if_fail (MKS_IS_SCREEN (self), NULL);
+  g_return_val_if_fail (DEX_IS_ASYNC_RESULT (result), NULL);
+
+  return dex_async_result_propagate_pointer (DEX_ASYNC_RESULT (result), error);
+}
+
+/**
+ * mks_screen_create_thumbnail:
+ * @self: a `MksScreen`
+ * @max_width: the largest width of the thumbnail in pixels
+ * @max_height: the largest height of the thumbnail in pixels
+ * @max_fps: the most times per second the thumbnail may change
+ *
+ * Creates a low resolution view of @self such as for a grid of many
+ * virtual machines.
+ *
+ * The paintable is scaled down to fit within @max_width and @max_height
+ * while keeping the aspect ratio of the screen. Unlike
+ * [method@Mks.Screen.attach], only the downscaled pixels are kept in
+ * memory, updates are applied to the thumbnail on the CPU as they
+ * arrive, and the contents are invalidated at most @max_fps times per
+ * second. DMA-BUF scanouts are read back by the CPU at most once per
+ * second and only when they are linear.
+ *
+ * Returns: (transfer full): a [class@Dex.Future] that resolves to a
+ *   [iface@Gdk.Paintable].
+ */
+DexFuture *
+mks_screen_create_thumbnail (MksScreen *self,
+                             guint      max_width,
+                             guint      max_height,
+                             guint      max_fps)
+{
+  dex_return_error_if_fail (MKS_IS_SCREEN (self));
+  dex_return_error_if_fail (max_width > 0);
+  dex_return_error_if_fail (max_height > 0);
+  dex_return_error_if_fail (max_fps > 0);
+
+  if (MKS_SCREEN_GET_CLASS (self)->create_thumbnail == NULL)
+    return dex_future_new_reject (G_IO_ERROR,
+                                  G_IO_ERROR_NOT_SUPPORTED,
+                                  "Not supported");
+
+  return MKS_SCREEN_GET_CLASS (self)->create_thumbnail (self, max_width, max_height, max_fps);
+}
+
+void
+mks_screen_create_thumbnail_async (MksScreen           *self,
+                                   guint                max_width,
+                                   guint                max_height,
+                                   guint                max_fps,
+                                   GCancellable        *cancellable,
+                                   GAsyncReadyCallback  callback,
+                                   gpointer             user_data)
+{
+  mks_future_to_async_result (self, cancellable, callback, user_data, G_STRFUNC,
+                              mks_screen_create_thumbnail (self, max_width, max_height, max_fps));
+}
+
+/**
+ * mks_screen_create_thumbnail_finish:
+ * @self: a `MksScreen`
+ * @result: a `GAsyncResult`
+ * @error: return location for a `GError`, or %NULL
+ *
+ * Completes a request to create a thumbnail for @self.
+ *
+ * Returns: (transfer full) (nullable): a `GdkPaintable`.
+ */
+GdkPaintable *
+mks_screen_create_thumbnail_finish (MksScreen     *self,
+                                    GAsyncResult  *result,
+                                    GError       **error)
+{
+  g_return_val_if_fail (MKS_IS_SCREEN (self), NULL);
+  g_return_val_if_fail (DEX_IS_ASYNC_RESULT (result), NULL);
+
+  return dex_async_result_propagate_pointer (DEX_ASYNC_RESULT (result), error);
+}
+
+/* Raw frames are queued until this many are waiting downstream, after
+ * which the source stops capturing and lets damage accumulate.
+ */
+#define GST_SOURCE_MAX_QUEUED_FRAMES 2
+
+typedef struct _MksScreenGstSource
+{
+  GMainContext     *main_context;
+  MksScreenCapture *capture;
+  /* The last frame pushed, which damage captures are applied to */
+  GBytes           *last_frame;
+  guint             width;
+  guint             height;
+  /* Set from the streaming thread */
+  int               enough_data;
+  guint             waiting : 1;
+} MksScreenGstSource;
+
+static void mks_screen_gst_source_request (GstElement *element);
+
+static void
+mks_screen_gst_source_free (gpointer data)
+{
+  MksScreenGstSource *source = data;
+
+  g_clear_object (&source->capture);
+  g_clear_pointer (&source->last_frame, g_bytes_unref);
+  g_clear_pointer (&source->main_context, g_main_context_unref);
+  g_free (source);
+}
+
+static GWeakRef *
+mks_screen_gst_source_weak_ref_new (GstElement *element)
+{
+  GWeakRef *wr = g_new0 (GWeakRef, 1);
+  g_weak_ref_init (wr, element);
+  return wr;
+}
+
+static void
+mks_screen_gst_source_weak_ref_free (gpointer data)
+{
+  GWeakRef *wr = data;
+
+  g_weak_ref_clear (wr);
+  g_free (wr);
+}
+
+static void
+mks_screen_gst_source_update_caps (GstElement     *element,
+                                   MksScreenFrame *frame)
+{
+  MksScreenGstSource *source;
+  g_autoptr(GstCaps) caps = NULL;
+
+  g_assert (GST_IS_APP_SRC (element));
+  g_assert (frame != NULL);
+
+  source = g_object_get_data (G_OBJECT (element), "MksScreenGstSource");
+  source->width = mks_screen_frame_get_screen_width (frame);
+  source->height = mks_screen_frame_get_screen_height (frame);
+
+  /* Frames are GDK_MEMORY_DEFAULT which is premultiplied, but the guest
+   * framebuffer is opaque so the alpha channel is ignored.
+   */
+  caps = gst_caps_new_simple ("video/x-raw",
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+                              "format", G_TYPE_STRING, "BGRx",
+#else
+                              "format", G_TYPE_STRING, "xRGB",
+#endif
+                              "width", G_TYPE_INT, (int)source->width,
+                              "height", G_TYPE_INT, (int)source->height,
+                              "framerate", GST_TYPE_FRACTION, 0, 1,
+                              NULL);
+
+  gst_app_src_set_caps (GST_APP_SRC (element), caps);
+  gst_app_src_set_max_bytes (GST_APP_SRC (element),
+                             (guint64)source->width * 4 *
+                             source->height *
+                             GST_SOURCE_MAX_QUEUED_FRAMES);
+}
+
+/*
+ * mks_screen_gst_source_apply_damage:
+ *
+ * Applies @frame, which holds the damaged area of the screen, to the
+ * last frame pushed.
+ *
+ * Returns: (transfer full) (nullable): a new frame of the whole screen,
+ *   or %NULL if the damaged area did not actually change.
+ */
+static GBytes *
+mks_screen_gst_source_apply_damage (MksScreenGstSource *source,
+                                    MksScreenFrame     *frame)
+{
+  const guint8 *src;
+  const guint8 *last;
+  guint8 *dst;
+  gsize src_stride;
+  gsize stride;
+  gsize row_bytes;
+  gsize offset;
+  gsize size;
+  int height;
+  int y;
+
+  g_assert (source != NULL);
+  g_assert (source->last_frame != NULL);
+  g_assert (frame != NULL);
+
+  src = g_bytes_get_data (mks_screen_frame_get_bytes (frame), NULL);
+  src_stride = mks_screen_frame_get_stride (frame);
+  last = g_bytes_get_data (source->last_frame, &size);
+  stride = (gsize)source->width * 4;
+  row_bytes = (gsize)mks_screen_frame_get_width (frame) * 4;
+  height = mks_screen_frame_get_height (frame);
+  offset = (gsize)mks_screen_frame_get_y (frame) * stride +
+           (gsize)mks_screen_frame_get_x (frame) * 4;
+
+  /* Damage does not guarantee that anything visible changed, so do not
+   * hand the encoder a frame identical to the previous one.
+   */
+  for (y = 0; y < height; y++)
+    {
+      if (memcmp (last + offset + y * stride, src + y * src_stride, row_bytes) != 0)
+        break;
+    }
+
+  if (y == height)
+    return NULL;
+
+  /* The frame owns its pixels so a whole screen can be pushed as is */
+  if (src_stride == stride && row_bytes == stride && (gsize)height * stride == size)
+    return g_bytes_ref (mks_screen_frame_get_bytes (frame));
+
+  dst = g_memdup2 (last, size);
+  mks_pixels_copy_rows (dst + offset, stride, src, src_stride, row_bytes, height);
+
+  return g_bytes_new_take (dst, size);
+}
+
+static DexFuture *
+mks_screen_gst_source_frame_cb (DexFuture *future,
+                                gpointer   user_data)
+{
+  GWeakRef *wr = user_data;
+  g_autoptr(GstElement) element = NULL;
+  g_autoptr(GstBuffer) buffer = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  g_autoptr(GError) error = NULL;
+  MksScreenGstSource *source;
+  MksScreenFrame *frame;
+  const GValue *value;
+
+  g_assert (DEX_IS_FUTURE (future));
+
+  if (!(element = g_weak_ref_get (wr)))
+    return dex_future_new_true ();
+
+  source = g_object_get_data (G_OBJECT (element), "MksScreenGstSource");
+  source->waiting = FALSE;
+
+  if (!(value = dex_future_get_value (future, &error)))
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_debug ("Failed to capture screen: %s", error->message);
+      gst_app_src_end_of_stream (GST_APP_SRC (element));
+      return dex_future_new_true ();
+    }
+
+  frame = g_value_get_boxed (value);
+
+  if (source->width != mks_screen_frame_get_screen_width (frame) ||
+      source->height != mks_screen_frame_get_screen_height (frame))
+    {
+      mks_screen_gst_source_update_caps (element, frame);
+      g_clear_pointer (&source->last_frame, g_bytes_unref);
+    }
+
+  if (source->last_frame != NULL)
+    bytes = mks_screen_gst_source_apply_damage (source, frame);
+  else if (mks_screen_frame_get_x (frame) == 0 &&
+           mks_screen_frame_get_y (frame) == 0 &&
+           mks_screen_frame_get_width (frame) == (int)source->width &&
+           mks_screen_frame_get_height (frame) == (int)source->height)
+    bytes = g_bytes_ref (mks_screen_frame_get_bytes (frame));
+
+  /* Otherwise there is nothing new, or only part of a screen that was
+   * resized, in which case the next request captures all of it.
+   */
+  if (bytes != NULL)
+    {
+      buffer = gst_buffer_new_wrapped_bytes (g_bytes_ref (bytes));
+      gst_app_src_push_buffer (GST_APP_SRC (element), g_steal_pointer (&buffer));
+
+      g_clear_pointer (&source->last_frame, g_bytes_unref);
+      source->last_frame = g_steal_pointer (&bytes);
+    }
+
+  mks_screen_gst_source_request (element);
+
+  return dex_future_new_true ();
+}
+
+static void
+mks_screen_gst_source_request (GstElement *element)
+{
+  MksScreenGstSource *source;
+
+  g_assert (GST_IS_APP_SRC (element));
+
+  source = g_object_get_data (G_OBJECT (element), "MksScreenGstSource");
+
+  if (source == NULL ||
+      source->capture == NULL ||
+      source->waiting ||
+      g_atomic_int_get (&source->enough_data))
+    return;
+
+  source->waiting = TRUE;
+
+  /* Once a frame was pushed only the damaged area is captured and
+   * compared, rather than reading and comparing the whole screen.
+   */
+  dex_future_disown (dex_future_finally (mks_screen_capture_next_frame (source->capture,
+                                                                        (source->last_frame ?
+                                                                         (MKS_SCREEN_CAPTURE_CHANGED |
+                                                                          MKS_SCREEN_CAPTURE_DAMAGE) :
+                                                                         MKS_SCREEN_CAPTURE_NONE)),
+                                         mks_screen_gst_source_frame_cb,
+                                         mks_screen_gst_source_weak_ref_new (element),
+                                         mks_screen_gst_source_weak_ref_free));
+}
+
+static DexFuture *
+mks_screen_gst_source_capture_cb (DexFuture *future,
+                                  gpointer   user_data)
+{
+  GWeakRef *wr = user_data;
+  g_autoptr(GstElement) element = NULL;
+  g_autoptr(GError) error = NULL;
+  MksScreenGstSource *source;
+  const GValue *value;
+
+  g_assert (DEX_IS_FUTURE (future));
+
+  if (!(element = g_weak_ref_get (wr)))
+    return dex_future_new_true ();
+
+  if (!(value = dex_future_get_value (future, &error)))
+    {
+      g_warning ("Failed to capture screen: %s", error->message);
+      gst_app_src_end_of_stream (GST_APP_SRC (element));
+      return dex_future_new_true ();
+    }
+
+  source = g_object_get_data (G_OBJECT (element), "MksScreenGstSource");
+  g_set_object (&source->capture, g_value_get_object (value));
+
+  mks_screen_gst_source_request (element);
+
+  return dex_future_new_true ();
+}
+
+static gboolean
+mks_screen_gst_source_resume_cb (gpointer user_data)
+{
+  GWeakRef *wr = user_data;
+  g_autoptr(GstElement) element = NULL;
+
+  if ((element = g_weak_ref_get (wr)))
+    mks_screen_gst_source_request (element);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+mks_screen_gst_source_need_data_cb (GstElement *element,
+                                    guint       length,
+                                    gpointer    user_data)
+{
+  MksScreenGstSource *source = user_data;
+
+  g_assert (GST_IS_APP_SRC (element));
+
+  /* Called from the streaming thread, captures are requested from the
+   * main context the source was created on.
+   */
+  if (g_atomic_int_compare_and_exchange (&source->enough_data, TRUE, FALSE))
+    g_main_context_invoke_full (source->main_context,
+                                G_PRIORITY_DEFAULT,
+                                mks_screen_gst_source_resume_cb,
+                                mks_screen_gst_source_weak_ref_new (element),
+                                mks_screen_gst_source_weak_ref_free);
+}
+
+static void
+mks_screen_gst_source_enough_data_cb (GstElement *element,
+                                      gpointer    user_data)
+{
+  MksScreenGstSource *source = user_data;
+
+  g_assert (GST_IS_APP_SRC (element));
+
+  g_atomic_int_set (&source->enough_data, TRUE);
+}
+
+/**
+ * mks_screen_create_gst_source:
+ * @self: a `MksScreen`
+ *
+ * Creates a GStreamer source for the contents of @self.
+ *
+ * The source produces raw video frames with a variable framerate. A
+ * frame is only pushed when the guest changes the contents of the
+ * screen, so a static screen produces no buffers. Use `videorate`
+ * downstream if a constant framerate is required.
+ *
+ * Returns: (transfer floating) (nullable): a new `GstElement`.
+ */
+GstElement *
+mks_screen_create_gst_source (MksScreen *self)
+{
+  MksScreenGstSource *source;
+  GstElement *element;
+
+  g_return_val_if_fail (MKS_IS_SCREEN (self), NULL);
+
+  element = gst_element_factory_make ("appsrc", NULL);
+  g_return_val_if_fail (element != NULL, NULL);
+
+  g_object_set (element,
+                "format", GST_FORMAT_TIME,
+                "is-live", TRUE,
+                "do-timestamp", TRUE,
+                NULL);
+
+  source = g_new0 (MksScreenGstSource, 1);
+  source->main_context = g_main_context_ref_thread_default ();
+  g_object_set_data_full (G_OBJECT (element),
+                          "MksScreenGstSource",
+                          source,
+                          mks_screen_gst_source_free);
+
+  g_signal_connect (element,
+                    "need-data",
+                    G_CALLBACK (mks_screen_gst_source_need_data_cb),
+                    source);
+  g_signal_connect (element,
+                    "enough-data",
+                    G_CALLBACK (mks_screen_gst_source_enough_data_cb),
+                    source);
+
+  dex_future_disown (dex_future_finally (mks_screen_create_capture (self),
+                                         mks_screen_gst_source_capture_cb,
+                                         mks_screen_gst_source_weak_ref_new (element),
+                                         mks_screen_gst_source_weak_ref_free));
+
+  return element;
+}
@@ -25,6 +25,7 @@
 #endif
 
 #include <gdk/gdk.h>
+#include <gst/gst.h>
 #include <libdex.h>
 
 #include "mks-types.h"
@@ -33,6 +34,7 @@
 G_BEGIN_DECLS
 
 #define MKS_TYPE_SCREEN            (mks_screen_get_type())
+#define MKS_TYPE_SCREEN_VIEW       (mks_screen_view_get_type())
 
 MKS_AVAILABLE_IN_ALL
 MKS_DECLARE_INTERNAL_TYPE (MksScreen, mks_screen, MKS, SCREEN, MksDevice)
@@ -51,48 +53,103 @@ typedef enum _MksScreenKind
 } MksScreenKind;
 
 MKS_AVAILABLE_IN_ALL
-MksScreenKind  mks_screen_get_kind             (MksScreen            *self);
+MksScreenKind     mks_screen_get_kind                (MksScreen            *self);
 MKS_AVAILABLE_IN_ALL
-MksKeyboard   *mks_screen_get_keyboard         (MksScreen            *self);
+MksKeyboard      *mks_screen_get_keyboard            (MksScreen            *self);
 MKS_AVAILABLE_IN_ALL
-MksMouse      *mks_screen_get_mouse            (MksScreen            *self);
+MksMouse         *mks_screen_get_mouse               (MksScreen            *self);
 MKS_AVAILABLE_IN_ALL
-MksTouchable  *mks_screen_get_touchable        (MksScreen            *self);
+MksTouchable     *mks_screen_get_touchable           (MksScreen            *self);
 MKS_AVAILABLE_IN_ALL
-guint          mks_screen_get_width            (MksScreen            *self);
+guint             mks_screen_get_width               (MksScreen            *self);
 MKS_AVAILABLE_IN_ALL
-guint          mks_screen_get_height           (MksScreen            *self);
+guint             mks_screen_get_height              (MksScreen            *self);
 MKS_AVAILABLE_IN_ALL
-guint          mks_screen_get_number           (MksScreen            *self);
+guint             mks_screen_get_number              (MksScreen            *self);
 MKS_AVAILABLE_IN_ALL
-gint64         mks_screen_get_last_active_time (MksScreen            *self);
+gint64            mks_screen_get_last_active_time    (MksScreen            *self);
 MKS_AVAILABLE_IN_ALL
-const char    *mks_screen_get_device_address   (MksScreen            *self);
+const char       *mks_screen_get_device_address      (MksScreen            *self);
 MKS_AVAILABLE_IN_ALL
-DexFuture     *mks_screen_configure            (MksScreen            *self,
-                                                MksScreenAttributes  *attributes);
+DexFuture        *mks_screen_configure               (MksScreen            *self,
+                                                      MksScreenAttributes  *attributes);
 MKS_AVAILABLE_IN_ALL
-void           mks_screen_configure_async      (MksScreen            *self,
-                                                MksScreenAttributes  *attributes,
-                                                GCancellable         *cancellable,
-                                                GAsyncReadyCallback   callback,
-                                                gpointer              user_data);
+void              mks_screen_configure_async         (MksScreen            *self,
+                                                      MksScreenAttributes  *attributes,
+                                                      GCancellable         *cancellable,
+                                                      GAsyncReadyCallback   callback,
+                                                      gpointer              user_data);
 MKS_AVAILABLE_IN_ALL
-gboolean       mks_screen_configure_finish     (MksScreen            *self,
-                                                GAsyncResult         *result,
-                                                GError              **error);
+gboolean          mks_screen_configure_finish        (MksScreen            *self,
+                                                      GAsyncResult         *result,
+                                                      GError              **error);
 MKS_AVAILABLE_IN_ALL
-DexFuture     *mks_screen_attach               (MksScreen            *self,
-                                                GdkDisplay           *display);
+DexFuture        *mks_screen_attach                  (MksScreen            *self,
+                                                      GdkDisplay           *display);
 MKS_AVAILABLE_IN_ALL
-void           mks_screen_attach_async         (MksScreen            *self,
-                                                GdkDisplay           *display,
-                                                GCancellable         *cancellable,
-                                                GAsyncReadyCallback   callback,
-                                                gpointer              user_data);
+void              mks_screen_attach_async            (MksScreen            *self,
+                                                      GdkDisplay           *display,
+                                                      GCancellable         *cancellable,
+                                                      GAsyncReadyCallback   callback,
+                                                      gpointer              user_data);
 MKS_AVAILABLE_IN_ALL
-GdkPaintable  *mks_screen_attach_finish        (MksScreen            *self,
-                                                GAsyncResult         *result,
-                                                GError              **error);
+GdkPaintable     *mks_screen_attach_finish           (MksScreen            *self,
+                                                      GAsyncResult         *result,
+                                                      GError              **error);
+MKS_AVAILABLE_IN_ALL
+MksScreenView    *mks_screen_add_view                (MksScreen            *self,
+                                                      GdkPaintable         *paintable,
+                                                      gboolean              shown);
+MKS_AVAILABLE_IN_ALL
+int               mks_screen_publish                 (MksScreen            *self,
+                                                      GdkPaintable         *paintable,
+                                                      GError              **error);
+MKS_AVAILABLE_IN_ALL
+MksFrameStats    *mks_screen_get_frame_stats         (MksScreen            *self,
+                                                      GdkPaintable         *paintable);
+MKS_AVAILABLE_IN_ALL
+DexFuture        *mks_screen_create_capture          (MksScreen            *self);
+MKS_AVAILABLE_IN_ALL
+void              mks_screen_create_capture_async    (MksScreen            *self,
+                                                      GCancellable         *cancellable,
+                                                      GAsyncReadyCallback   callback,
+                                                      gpointer              user_data);
+MKS_AVAILABLE_IN_ALL
+MksScreenCapture *mks_screen_create_capture_finish   (MksScreen            *self,
+                                                      GAsyncResult         *result,
+                                                      GError              **error);
+MKS_AVAILABLE_IN_ALL
+DexFuture        *mks_screen_create_thumbnail        (MksScreen            *self,
+                                                      guint                 max_width,
+                                                      guint                 max_height,
+                                                      guint                 max_fps);
+MKS_AVAILABLE_IN_ALL
+void              mks_screen_create_thumbnail_async  (MksScreen            *self,
+                                                      guint                 max_width,
+                                                      guint                 max_height,
+                                                      guint                 max_fps,
+                                                      GCancellable         *cancellable,
+                                                      GAsyncReadyCallback   callback,
+                                                      gpointer              user_data);
+MKS_AVAILABLE_IN_ALL
+GdkPaintable     *mks_screen_create_thumbnail_finish (MksScreen            *self,
+                                                      GAsyncResult         *result,
+                                                      GError              **error);
+MKS_AVAILABLE_IN_ALL
+GstElement       *mks_screen_create_gst_source       (MksScreen            *self);
+
+MKS_AVAILABLE_IN_ALL
+GType             mks_screen_view_get_type           (void) G_GNUC_CONST;
+MKS_AVAILABLE_IN_ALL
+MksScreenView    *mks_screen_view_ref                (MksScreenView        *self);
+MKS_AVAILABLE_IN_ALL
+void              mks_screen_view_unref              (MksScreenView        *self);
+MKS_AVAILABLE_IN_ALL
+gboolean          mks_screen_view_get_shown          (MksScreenView        *self);
+MKS_AVAILABLE_IN_ALL
+void              mks_screen_view_set_shown          (MksScreenView        *self,
+                                                      gboolean              shown);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MksScreenView, mks_screen_view_unref)
 
 G_END_DECLS
@@ -260,6 +260,19 @@ mks_session_set_primary_screen (MksSession *self,
     g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_PRIMARY_SCREEN]);
 }
 
+/* A screen other than the primary must have been active this much more
+ * recently than the primary before it takes over. This keeps two busy
+ * screens from trading places on every activity epoch.
+ */
+#define PRIMARY_SCREEN_HYSTERESIS G_TIME_SPAN_SECOND
+
+static gboolean
+mks_session_screen_is_more_active (MksScreen *screen,
+                                   gint64     active_time)
+{
+  return mks_screen_get_last_active_time (screen) > active_time + PRIMARY_SCREEN_HYSTERESIS;
+}
+
 static void
 mks_session_update_primary_screen (MksSession *self)
 {
@@ -294,11 +307,12 @@ mks_session_update_primary_screen (MksSession *self)
       active_time = mks_screen_get_last_active_time (screen);
 
       /* Once a primary screen exists, metadata alone should not steal focus
-       * from it. A different screen needs newer display activity to replace it.
+       * from it. A different screen needs clearly newer display activity to
+       * replace it.
        */
       if (current_is_candidate &&
           screen != self->primary_screen &&
-          active_time <= current_active_time)
+          !mks_session_screen_is_more_active (screen, current_active_time))
         continue;
 
       if (active_time > best_active_time ||
@@ -337,6 +351,32 @@ mks_session_resort_screen (MksSession *self,
   g_list_store_insert (self->screens, new_position, hold);
 }
 
+/* Activity is the most frequent reason to reconsider the primary screen.
+ * The screen which just became active is the most recently active one, so
+ * it only needs to be compared against the current primary.
+ */
+static void
+mks_session_screen_activity (MksSession *self,
+                             MksScreen  *screen)
+{
+  g_assert (MKS_IS_SESSION (self));
+  g_assert (MKS_IS_SCREEN (screen));
+
+  if (screen == self->primary_screen)
+    return;
+
+  if (self->primary_screen == NULL ||
+      !mks_session_screen_is_primary_candidate (self, self->primary_screen))
+    {
+      mks_session_update_primary_screen (self);
+      return;
+    }
+
+  if (mks_session_score_primary_screen (self, screen) >= 0 &&
+      mks_session_screen_is_more_active (screen, mks_screen_get_last_active_time (self->primary_screen)))
+    mks_session_set_primary_screen (self, screen);
+}
+
 static void
 mks_session_screen_notify_cb (MksSession *self,
                               GParamSpec *pspec,
@@ -354,12 +394,13 @@ mks_session_screen_notify_cb (MksSession *self,
       g_str_equal (name, "number"))
     mks_session_resort_screen (self, screen);
 
-  if (g_str_equal (name, "device-address") ||
-      g_str_equal (name, "height") ||
-      g_str_equal (name, "kind") ||
-      g_str_equal (name, "last-active-time") ||
-      g_str_equal (name, "number") ||
-      g_str_equal (name, "width"))
+  if (g_str_equal (name, "last-active-time"))
+    mks_session_screen_activity (self, screen);
+  else if (g_str_equal (name, "device-address") ||
+           g_str_equal (name, "height") ||
+           g_str_equal (name, "kind") ||
+           g_str_equal (name, "number") ||
+           g_str_equal (name, "width"))
     mks_session_update_primary_screen (self);
 }
 
@@ -0,0 +1,661 @@
+/* mks-shared-paintable.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <gtk/gtk.h>
+#include <pixman.h>
+
+#include "mks-mapped-paintable-private.h"
+#include "mks-shared-paintable.h"
+#include "mks-shm-publisher-private.h"
+
+/* The publisher does not notify readers, the sequence number is
+ * checked about once per frame instead. While it does not change, the
+ * interval doubles up to POLL_INTERVAL_MAX_MSEC so that idle readers
+ * rarely wake up.
+ */
+#define POLL_INTERVAL_MSEC     16
+#define POLL_INTERVAL_MAX_MSEC 256
+
+/* Copies torn by the publisher are attempted this many times before
+ * waiting for the next poll.
+ */
+#define MAX_READ_ATTEMPTS 3
+
+/**
+ * MksSharedPaintable:
+ *
+ * A paintable showing a screen published by another process.
+ *
+ * The process attached to the screen calls [method@Mks.Screen.publish]
+ * and passes the resulting file-descriptor to other processes, such as a
+ * recorder or a thumbnailer. Each of them creates a `MksSharedPaintable`
+ * from it which maps the framebuffer read-only. No messages are exchanged
+ * per frame, neither with QEMU nor with the publishing process. Changes
+ * are checked for about once per frame while the screen changes, and
+ * only a few times per second while it does not.
+ *
+ * Only screens updated through shared memory or `Update` and `Scanout`
+ * messages are published. Screens which QEMU only provides as DMA-BUF
+ * show no contents.
+ */
+struct _MksSharedPaintable
+{
+  GObject             parent_instance;
+
+  /* The whole memfd and the pixels following the header */
+  GBytes             *map;
+  GBytes             *pixels;
+  const MksShmHeader *header;
+
+  MksMappedPaintable *child;
+
+  /* Private copies of the pixels, see MksSharedBuffer */
+  GPtrArray          *buffers;
+
+  /* The last sequence number which was imported into @child */
+  guint64             seq;
+
+  guint               poll_source;
+  guint               poll_interval;
+  guint               closed : 1;
+};
+
+typedef struct
+{
+  gpointer data;
+  gsize    length;
+} MksSharedMapping;
+
+/* The publisher may write to the memfd at any time, so @child is given
+ * a copy which was read while the sequence number did not change. GTK
+ * may upload from that copy for as long as a texture holds it, so it is
+ * only written to again once every #GBytes for it was released.
+ *
+ * @stale is the area which changed since the copy was last written, or
+ * %NULL if all of it must be read again.
+ */
+typedef struct _MksSharedBuffer
+{
+  guint8         *data;
+  gsize           size;
+  cairo_region_t *stale;
+  int             n_users;
+} MksSharedBuffer;
+
+static void
+mks_shared_mapping_free (gpointer data)
+{
+  MksSharedMapping *mapping = data;
+
+  munmap (mapping->data, mapping->length);
+  g_free (mapping);
+}
+
+static void
+mks_shared_buffer_finalize (gpointer data)
+{
+  MksSharedBuffer *buffer = data;
+
+  g_clear_pointer (&buffer->stale, cairo_region_destroy);
+  g_clear_pointer (&buffer->data, g_free);
+}
+
+static void
+mks_shared_buffer_release (gpointer data)
+{
+  g_atomic_rc_box_release_full (data, mks_shared_buffer_finalize);
+}
+
+static void
+mks_shared_buffer_unuse (gpointer data)
+{
+  MksSharedBuffer *buffer = data;
+
+  g_atomic_int_add (&buffer->n_users, -1);
+  mks_shared_buffer_release (buffer);
+}
+
+static GBytes *
+mks_shared_buffer_use (MksSharedBuffer *buffer)
+{
+  g_atomic_int_inc (&buffer->n_users);
+
+  return g_bytes_new_with_free_func (buffer->data,
+                                     buffer->size,
+                                     mks_shared_buffer_unuse,
+                                     g_atomic_rc_box_acquire (buffer));
+}
+
+/* Adds @region, or everything if %NULL, to what @buffer lacks */
+static void
+mks_shared_buffer_invalidate (MksSharedBuffer      *buffer,
+                              const cairo_region_t *region)
+{
+  if (buffer->stale == NULL)
+    return;
+
+  if (region == NULL)
+    g_clear_pointer (&buffer->stale, cairo_region_destroy);
+  else
+    cairo_region_union (buffer->stale, region);
+}
+
+static int
+mks_shared_paintable_get_intrinsic_width (GdkPaintable *paintable)
+{
+  return gdk_paintable_get_intrinsic_width (GDK_PAINTABLE (MKS_SHARED_PAINTABLE (paintable)->child));
+}
+
+static int
+mks_shared_paintable_get_intrinsic_height (GdkPaintable *paintable)
+{
+  return gdk_paintable_get_intrinsic_height (GDK_PAINTABLE (MKS_SHARED_PAINTABLE (paintable)->child));
+}
+
+static double
+mks_shared_paintable_get_intrinsic_aspect_ratio (GdkPaintable *paintable)
+{
+  return gdk_paintable_get_intrinsic_aspect_ratio (GDK_PAINTABLE (MKS_SHARED_PAINTABLE (paintable)->child));
+}
+
+static void
+mks_shared_paintable_snapshot (GdkPaintable *paintable,
+                               GdkSnapshot  *snapshot,
+                               double        width,
+                               double        height)
+{
+  gdk_paintable_snapshot (GDK_PAINTABLE (MKS_SHARED_PAINTABLE (paintable)->child),
+                          snapshot, width, height);
+}
+
+static void
+paintable_iface_init (GdkPaintableInterface *iface)
+{
+  iface->get_intrinsic_width = mks_shared_paintable_get_intrinsic_width;
+  iface->get_intrinsic_height = mks_shared_paintable_get_intrinsic_height;
+  iface->get_intrinsic_aspect_ratio = mks_shared_paintable_get_intrinsic_aspect_ratio;
+  iface->snapshot = mks_shared_paintable_snapshot;
+}
+
+G_DEFINE_FINAL_TYPE_WITH_CODE (MksSharedPaintable, mks_shared_paintable, G_TYPE_OBJECT,
+                               G_IMPLEMENT_INTERFACE (GDK_TYPE_PAINTABLE, paintable_iface_init))
+
+/*
+ * mks_shared_paintable_collect_damage:
+ *
+ * Gets the area written since @self->seq up to @seq, or %NULL if the
+ * damage ring no longer covers it and everything must be redrawn.
+ */
+static cairo_region_t *
+mks_shared_paintable_collect_damage (MksSharedPaintable *self,
+                                     guint64             seq)
+{
+  cairo_region_t *region;
+
+  g_assert (MKS_IS_SHARED_PAINTABLE (self));
+
+  if (self->seq == 0 || (seq - self->seq) / 2 > MKS_SHM_N_DAMAGE)
+    return NULL;
+
+  region = cairo_region_create ();
+
+  for (guint64 s = self->seq + 2; s <= seq; s += 2)
+    {
+      const MksShmDamage *damage = &self->header->damage[(s / 2) % MKS_SHM_N_DAMAGE];
+
+      if (damage->seq != s)
+        {
+          cairo_region_destroy (region);
+          return NULL;
+        }
+
+      cairo_region_union_rectangle (region,
+                                    &(cairo_rectangle_int_t) {
+                                      damage->x, damage->y,
+                                      damage->width, damage->height
+                                    });
+    }
+
+  return region;
+}
+
+/*
+ * mks_shared_paintable_acquire_buffer:
+ *
+ * Finds a copy of @size bytes which is no longer used by @child, or
+ * creates one which must be read completely.
+ */
+static MksSharedBuffer *
+mks_shared_paintable_acquire_buffer (MksSharedPaintable *self,
+                                     gsize               size)
+{
+  MksSharedBuffer *buffer;
+
+  g_assert (MKS_IS_SHARED_PAINTABLE (self));
+
+  for (guint i = 0; i < self->buffers->len; i++)
+    {
+      buffer = g_ptr_array_index (self->buffers, i);
+
+      if (g_atomic_int_get (&buffer->n_users) > 0)
+        continue;
+
+      if (buffer->size != size)
+        {
+          g_free (buffer->data);
+          buffer->data = g_malloc (size);
+          buffer->size = size;
+          g_clear_pointer (&buffer->stale, cairo_region_destroy);
+        }
+
+      return buffer;
+    }
+
+  buffer = g_atomic_rc_box_new0 (MksSharedBuffer);
+  buffer->data = g_malloc (size);
+  buffer->size = size;
+  g_ptr_array_add (self->buffers, buffer);
+
+  return buffer;
+}
+
+/*
+ * mks_shared_paintable_copy:
+ *
+ * Copies @region of the shared pixels, or all of them if %NULL, into
+ * @buffer. The region must be within the framebuffer.
+ */
+static void
+mks_shared_paintable_copy (MksSharedPaintable   *self,
+                           MksSharedBuffer      *buffer,
+                           const cairo_region_t *region,
+                           guint                 stride,
+                           guint                 bpp)
+{
+  const guint8 *src = g_bytes_get_data (self->pixels, NULL);
+  int n_rects;
+
+  g_assert (MKS_IS_SHARED_PAINTABLE (self));
+
+  if (region == NULL)
+    {
+      memcpy (buffer->data, src, buffer->size);
+      return;
+    }
+
+  n_rects = cairo_region_num_rectangles (region);
+
+  for (int i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+      gsize offset;
+
+      cairo_region_get_rectangle (region, i, &rect);
+      offset = (gsize)rect.y * stride + (gsize)rect.x * bpp;
+
+      for (int y = 0; y < rect.height; y++)
+        memcpy (buffer->data + offset + (gsize)y * stride,
+                src + offset + (gsize)y * stride,
+                (gsize)rect.width * bpp);
+    }
+}
+
+/*
+ * mks_shared_paintable_read:
+ *
+ * Imports what the publisher wrote since the last call into @child.
+ *
+ * Returns: %TRUE if the publisher wrote anything
+ */
+static gboolean
+mks_shared_paintable_read (MksSharedPaintable *self)
+{
+  const MksShmHeader *header = self->header;
+
+  g_assert (MKS_IS_SHARED_PAINTABLE (self));
+
+  for (guint attempt = 0; attempt < MAX_READ_ATTEMPTS; attempt++)
+    {
+      g_autoptr(GError) error = NULL;
+      g_autoptr(GBytes) bytes = NULL;
+      MksSharedBuffer *buffer;
+      cairo_region_t *region;
+      cairo_region_t *copy;
+      guint64 seq;
+      guint flags;
+      guint width;
+      guint height;
+      guint stride;
+      guint pixman_format;
+      guint bpp;
+      gboolean layout_changed;
+
+      seq = __atomic_load_n (&header->seq, __ATOMIC_ACQUIRE);
+
+      if (seq == self->seq)
+        return FALSE;
+
+      /* The publisher is in the middle of writing */
+      if (seq % 2 != 0)
+        return TRUE;
+
+      flags = header->flags;
+      width = header->width;
+      height = header->height;
+      stride = header->stride;
+      pixman_format = header->pixman_format;
+      bpp = PIXMAN_FORMAT_BPP (pixman_format) / 8;
+
+      layout_changed = width != (guint)gdk_paintable_get_intrinsic_width (GDK_PAINTABLE (self->child)) ||
+                       height != (guint)gdk_paintable_get_intrinsic_height (GDK_PAINTABLE (self->child));
+
+      if (width == 0 || height == 0)
+        {
+          __atomic_thread_fence (__ATOMIC_ACQUIRE);
+          if (__atomic_load_n (&header->seq, __ATOMIC_RELAXED) != seq)
+            continue;
+
+          self->seq = seq;
+          self->closed = !!(flags & MKS_SHM_CLOSED);
+
+          if (layout_changed)
+            {
+              mks_mapped_paintable_clear (self->child);
+              gdk_paintable_invalidate_size (GDK_PAINTABLE (self));
+              gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
+            }
+
+          return TRUE;
+        }
+
+      /* The header may be torn as well, which is caught below */
+      if (bpp == 0 ||
+          (gsize)width * bpp > stride ||
+          (gsize)stride * height > g_bytes_get_size (self->pixels))
+        continue;
+
+      region = layout_changed ? NULL : mks_shared_paintable_collect_damage (self, seq);
+
+      if (region != NULL)
+        cairo_region_intersect_rectangle (region, &(cairo_rectangle_int_t) { 0, 0, width, height });
+
+      buffer = mks_shared_paintable_acquire_buffer (self, (gsize)stride * height);
+
+      if (region == NULL || buffer->stale == NULL)
+        {
+          copy = NULL;
+        }
+      else
+        {
+          copy = cairo_region_copy (buffer->stale);
+          cairo_region_union (copy, region);
+        }
+
+      mks_shared_paintable_copy (self, buffer, copy, stride, bpp);
+
+      /* What was copied may be torn if the publisher wrote meanwhile */
+      __atomic_thread_fence (__ATOMIC_ACQUIRE);
+      if (__atomic_load_n (&header->seq, __ATOMIC_RELAXED) != seq)
+        {
+          g_clear_pointer (&buffer->stale, cairo_region_destroy);
+          buffer->stale = g_steal_pointer (&copy);
+          g_clear_pointer (&region, cairo_region_destroy);
+          continue;
+        }
+
+      self->seq = seq;
+      self->closed = !!(flags & MKS_SHM_CLOSED);
+
+      for (guint i = 0; i < self->buffers->len; i++)
+        {
+          MksSharedBuffer *other = g_ptr_array_index (self->buffers, i);
+
+          if (other != buffer)
+            mks_shared_buffer_invalidate (other, region);
+        }
+
+      g_clear_pointer (&copy, cairo_region_destroy);
+      g_clear_pointer (&buffer->stale, cairo_region_destroy);
+      buffer->stale = cairo_region_create ();
+
+      if (region == NULL || !cairo_region_is_empty (region))
+        {
+          bytes = mks_shared_buffer_use (buffer);
+
+          if (!mks_mapped_paintable_import (self->child,
+                                            bytes,
+                                            width,
+                                            height,
+                                            stride,
+                                            pixman_format,
+                                            region,
+                                            &error))
+            g_warning ("Failed to import shared framebuffer: %s", error->message);
+        }
+
+      g_clear_pointer (&region, cairo_region_destroy);
+
+      return TRUE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+mks_shared_paintable_poll_cb (gpointer data)
+{
+  MksSharedPaintable *self = data;
+  guint interval;
+
+  g_assert (MKS_IS_SHARED_PAINTABLE (self));
+
+  if (mks_shared_paintable_read (self))
+    interval = POLL_INTERVAL_MSEC;
+  else
+    interval = MIN (self->poll_interval * 2, POLL_INTERVAL_MAX_MSEC);
+
+  if (self->closed)
+    {
+      self->poll_source = 0;
+      return G_SOURCE_REMOVE;
+    }
+
+  if (interval == self->poll_interval)
+    return G_SOURCE_CONTINUE;
+
+  self->poll_interval = interval;
+  self->poll_source = g_timeout_add (interval, mks_shared_paintable_poll_cb, self);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+mks_shared_paintable_invalidate_contents_cb (MksSharedPaintable *self,
+                                             GdkPaintable       *child)
+{
+  gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
+}
+
+static void
+mks_shared_paintable_invalidate_size_cb (MksSharedPaintable *self,
+                                         GdkPaintable       *child)
+{
+  gdk_paintable_invalidate_size (GDK_PAINTABLE (self));
+}
+
+static void
+mks_shared_paintable_dispose (GObject *object)
+{
+  MksSharedPaintable *self = (MksSharedPaintable *)object;
+
+  g_clear_handle_id (&self->poll_source, g_source_remove);
+  g_clear_object (&self->child);
+  g_clear_pointer (&self->buffers, g_ptr_array_unref);
+  g_clear_pointer (&self->pixels, g_bytes_unref);
+  g_clear_pointer (&self->map, g_bytes_unref);
+  self->header = NULL;
+
+  G_OBJECT_CLASS (mks_shared_paintable_parent_class)->dispose (object);
+}
+
+static void
+mks_shared_paintable_class_init (MksSharedPaintableClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = mks_shared_paintable_dispose;
+}
+
+static void
+mks_shared_paintable_init (MksSharedPaintable *self)
+{
+  self->child = mks_mapped_paintable_new ();
+  self->buffers = g_ptr_array_new_with_free_func (mks_shared_buffer_release);
+  g_signal_connect_object (self->child,
+                           "invalidate-contents",
+                           G_CALLBACK (mks_shared_paintable_invalidate_contents_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+  g_signal_connect_object (self->child,
+                           "invalidate-size",
+                           G_CALLBACK (mks_shared_paintable_invalidate_size_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+}
+
+static GBytes *
+mks_shared_paintable_map (int      fd,
+                          GError **error)
+{
+  MksSharedMapping *mapping;
+  struct stat stbuf;
+  gpointer data;
+  int seals;
+
+  if (fstat (fd, &stbuf) != 0 ||
+      -1 == (seals = fcntl (fd, F_GET_SEALS)))
+    {
+      int errsv = errno;
+      g_set_error (error,
+                   G_IO_ERROR,
+                   g_io_error_from_errno (errsv),
+                   "Failed to query shared framebuffer: %s",
+                   g_strerror (errsv));
+      return NULL;
+    }
+
+  /* Without the seal the publisher could truncate the file and crash
+   * us with SIGBUS while uploading.
+   */
+  if (!(seals & F_SEAL_SHRINK) || stbuf.st_size < (off_t)MKS_SHM_SIZE)
+    {
+      g_set_error_literal (error,
+                           G_IO_ERROR,
+                           G_IO_ERROR_INVALID_DATA,
+                           "Not a shared framebuffer");
+      return NULL;
+    }
+
+  data = mmap (NULL, MKS_SHM_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+
+  if (data == MAP_FAILED)
+    {
+      int errsv = errno;
+      g_set_error (error,
+                   G_IO_ERROR,
+                   g_io_error_from_errno (errsv),
+                   "Failed to mmap shared framebuffer: %s",
+                   g_strerror (errsv));
+      return NULL;
+    }
+
+  mapping = g_new0 (MksSharedMapping, 1);
+  mapping->data = data;
+  mapping->length = MKS_SHM_SIZE;
+
+  return g_bytes_new_with_free_func (data,
+                                     MKS_SHM_SIZE,
+                                     mks_shared_mapping_free,
+                                     mapping);
+}
+
+/**
+ * mks_shared_paintable_new:
+ * @fd: a file-descriptor from [method@Mks.Screen.publish]
+ * @error: a location for a #GError, or %NULL
+ *
+ * Creates a paintable showing the screen published through @fd.
+ *
+ * @fd is not consumed and may be closed once this returns.
+ *
+ * Returns: (transfer full): a #MksSharedPaintable, or %NULL and @error is set
+ */
+MksSharedPaintable *
+mks_shared_paintable_new (int      fd,
+                          GError **error)
+{
+  g_autoptr(MksSharedPaintable) self = NULL;
+  g_autoptr(GBytes) map = NULL;
+  const MksShmHeader *header;
+
+  g_return_val_if_fail (fd > -1, NULL);
+
+  if (!(map = mks_shared_paintable_map (fd, error)))
+    return NULL;
+
+  header = g_bytes_get_data (map, NULL);
+
+  if (header->magic != MKS_SHM_MAGIC || header->version != MKS_SHM_VERSION)
+    {
+      g_set_error_literal (error,
+                           G_IO_ERROR,
+                           G_IO_ERROR_NOT_SUPPORTED,
+                           "Unsupported shared framebuffer version");
+      return NULL;
+    }
+
+  self = g_object_new (MKS_TYPE_SHARED_PAINTABLE, NULL);
+  self->header = header;
+  self->pixels = g_bytes_new_from_bytes (map,
+                                         MKS_SHM_HEADER_SIZE,
+                                         MKS_SHM_SIZE - MKS_SHM_HEADER_SIZE);
+  self->map = g_steal_pointer (&map);
+
+  /* Show the current contents right away */
+  mks_shared_paintable_read (self);
+
+  if (!self->closed)
+    {
+      self->poll_interval = POLL_INTERVAL_MSEC;
+      self->poll_source = g_timeout_add (self->poll_interval,
+                                         mks_shared_paintable_poll_cb,
+                                         self);
+    }
+
+  return g_steal_pointer (&self);
+}
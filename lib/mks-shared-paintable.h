@@ -0,0 +1,43 @@
+/* mks-shared-paintable.h
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#pragma once
+
+#if !defined(MKS_INSIDE) && !defined(MKS_COMPILATION)
+# error "Only <libmks.h> can be included directly."
+#endif
+
+#include <gdk/gdk.h>
+
+#include "mks-types.h"
+#include "mks-version-macros.h"
+
+G_BEGIN_DECLS
+
+#define MKS_TYPE_SHARED_PAINTABLE (mks_shared_paintable_get_type())
+
+MKS_AVAILABLE_IN_ALL
+G_DECLARE_FINAL_TYPE (MksSharedPaintable, mks_shared_paintable, MKS, SHARED_PAINTABLE, GObject)
+
+MKS_AVAILABLE_IN_ALL
+MksSharedPaintable *mks_shared_paintable_new (int      fd,
+                                              GError **error);
+
+G_END_DECLS
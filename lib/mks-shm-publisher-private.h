@@ -0,0 +1,94 @@
+/* mks-shm-publisher-private.h
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#pragma once
+
+#include <cairo.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* A published framebuffer is a sealed memfd with a header page followed
+ * by the pixels. The size of the memfd never changes, so readers may map
+ * it once. Pages which were never written are not backed by memory.
+ */
+#define MKS_SHM_MAGIC       0x464b4d53u
+#define MKS_SHM_VERSION     1
+#define MKS_SHM_HEADER_SIZE 4096
+#define MKS_SHM_MAX_WIDTH   8192
+#define MKS_SHM_MAX_HEIGHT  8192
+#define MKS_SHM_SIZE        (MKS_SHM_HEADER_SIZE + (gsize)MKS_SHM_MAX_WIDTH * MKS_SHM_MAX_HEIGHT * 4)
+#define MKS_SHM_N_DAMAGE    64
+
+typedef enum _MksShmFlags
+{
+  /* The publisher went away, nothing else will be written */
+  MKS_SHM_CLOSED = 1 << 0,
+} MksShmFlags;
+
+typedef struct _MksShmDamage
+{
+  guint64 seq;
+  gint32  x;
+  gint32  y;
+  gint32  width;
+  gint32  height;
+} MksShmDamage;
+
+/* @seq is odd while the publisher is writing and even otherwise. Each
+ * write advances it by two and records its area in @damage at index
+ * (seq / 2) % MKS_SHM_N_DAMAGE so that readers can redraw only what
+ * changed since the sequence they last observed.
+ */
+typedef struct _MksShmHeader
+{
+  guint32      magic;
+  guint32      version;
+  guint64      seq;
+  guint32      flags;
+  guint32      width;
+  guint32      height;
+  guint32      stride;
+  guint32      pixman_format;
+  guint32      padding;
+  MksShmDamage damage[MKS_SHM_N_DAMAGE];
+} MksShmHeader;
+
+G_STATIC_ASSERT (sizeof (MksShmHeader) <= MKS_SHM_HEADER_SIZE);
+
+typedef struct _MksShmPublisher MksShmPublisher;
+
+MksShmPublisher *mks_shm_publisher_new     (GError                     **error);
+MksShmPublisher *mks_shm_publisher_ref     (MksShmPublisher             *self);
+void             mks_shm_publisher_unref   (MksShmPublisher             *self);
+int              mks_shm_publisher_dup_fd  (MksShmPublisher             *self,
+                                            GError                     **error);
+void             mks_shm_publisher_publish (MksShmPublisher             *self,
+                                            const guint8                *data,
+                                            guint                        stride,
+                                            guint                        width,
+                                            guint                        height,
+                                            guint                        pixman_format,
+                                            const cairo_rectangle_int_t *area);
+void             mks_shm_publisher_clear   (MksShmPublisher             *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MksShmPublisher, mks_shm_publisher_unref)
+
+G_END_DECLS
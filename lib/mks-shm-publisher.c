@@ -0,0 +1,314 @@
+/* mks-shm-publisher.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <pixman.h>
+
+#include "mks-shm-publisher-private.h"
+
+struct _MksShmPublisher
+{
+  int           ref_count;
+
+  /* Protects writes to @header and the pixels which may come from both
+   * the main thread and the display worker thread.
+   */
+  GMutex        mutex;
+
+  int           fd;
+  guint8       *data;
+  MksShmHeader *header;
+};
+
+static void
+set_error_from_errno (GError     **error,
+                      const char  *message)
+{
+  int errsv = errno;
+
+  g_set_error (error,
+               G_IO_ERROR,
+               g_io_error_from_errno (errsv),
+               "%s: %s",
+               message,
+               g_strerror (errsv));
+}
+
+/* Only the publisher writes to the header so the fields may be read
+ * without atomics here. Readers pair the release in end_write() with
+ * an acquire of @seq.
+ */
+static guint64
+mks_shm_publisher_begin_write (MksShmPublisher *self)
+{
+  guint64 seq = self->header->seq + 1;
+
+  g_assert (seq % 2 == 1);
+
+  __atomic_store_n (&self->header->seq, seq, __ATOMIC_RELAXED);
+  __atomic_thread_fence (__ATOMIC_RELEASE);
+
+  return seq + 1;
+}
+
+static void
+mks_shm_publisher_end_write (MksShmPublisher             *self,
+                             guint64                      seq,
+                             const cairo_rectangle_int_t *area)
+{
+  MksShmDamage *damage = &self->header->damage[(seq / 2) % MKS_SHM_N_DAMAGE];
+
+  damage->seq = seq;
+  damage->x = area->x;
+  damage->y = area->y;
+  damage->width = area->width;
+  damage->height = area->height;
+
+  __atomic_store_n (&self->header->seq, seq, __ATOMIC_RELEASE);
+}
+
+MksShmPublisher *
+mks_shm_publisher_new (GError **error)
+{
+  MksShmPublisher *self;
+  g_autofd int fd = -1;
+  gpointer data;
+
+  if (-1 == (fd = memfd_create ("mks-framebuffer", MFD_CLOEXEC | MFD_ALLOW_SEALING)))
+    {
+      set_error_from_errno (error, "Failed to create memfd");
+      return NULL;
+    }
+
+  /* Readers map the whole file once, so it must not shrink beneath them */
+  if (ftruncate (fd, MKS_SHM_SIZE) != 0 ||
+      fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0)
+    {
+      set_error_from_errno (error, "Failed to size memfd");
+      return NULL;
+    }
+
+  data = mmap (NULL, MKS_SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  if (data == MAP_FAILED)
+    {
+      set_error_from_errno (error, "Failed to mmap memfd");
+      return NULL;
+    }
+
+  self = g_new0 (MksShmPublisher, 1);
+  self->ref_count = 1;
+  g_mutex_init (&self->mutex);
+  self->fd = g_steal_fd (&fd);
+  self->data = data;
+  self->header = data;
+  self->header->magic = MKS_SHM_MAGIC;
+  self->header->version = MKS_SHM_VERSION;
+
+  return self;
+}
+
+MksShmPublisher *
+mks_shm_publisher_ref (MksShmPublisher *self)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (self->ref_count > 0, NULL);
+
+  g_atomic_int_inc (&self->ref_count);
+
+  return self;
+}
+
+void
+mks_shm_publisher_unref (MksShmPublisher *self)
+{
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (self->ref_count > 0);
+
+  if (g_atomic_int_dec_and_test (&self->ref_count))
+    {
+      guint64 seq;
+
+      /* Let readers stop polling, they keep the last frame */
+      seq = mks_shm_publisher_begin_write (self);
+      self->header->flags |= MKS_SHM_CLOSED;
+      mks_shm_publisher_end_write (self, seq, &(cairo_rectangle_int_t) { 0, 0, 0, 0 });
+
+      munmap (self->data, MKS_SHM_SIZE);
+      g_clear_fd (&self->fd, NULL);
+      g_mutex_clear (&self->mutex);
+      g_free (self);
+    }
+}
+
+/**
+ * mks_shm_publisher_dup_fd:
+ * @self: a #MksShmPublisher
+ *
+ * Opens the memfd again as read-only so that readers in other processes
+ * cannot write to the framebuffer, even if they map it writable.
+ *
+ * Returns: a new file-descriptor owned by the caller, or -1
+ */
+int
+mks_shm_publisher_dup_fd (MksShmPublisher  *self,
+                          GError          **error)
+{
+  g_autofree char *path = NULL;
+  int fd;
+
+  g_return_val_if_fail (self != NULL, -1);
+
+  path = g_strdup_printf ("/proc/self/fd/%d", self->fd);
+
+  if (-1 == (fd = g_open (path, O_RDONLY | O_CLOEXEC, 0)))
+    set_error_from_errno (error, "Failed to reopen memfd");
+
+  return fd;
+}
+
+/**
+ * mks_shm_publisher_publish:
+ * @self: a #MksShmPublisher
+ * @data: the first pixel of the framebuffer
+ * @stride: the stride of @data
+ * @width: the width of the framebuffer
+ * @height: the height of the framebuffer
+ * @pixman_format: the format of @data
+ * @area: (nullable): the area which changed, or %NULL for everything
+ *
+ * Copies @area of the framebuffer into the shared memory. Everything is
+ * copied when the size or format changes from the previous call.
+ */
+void
+mks_shm_publisher_publish (MksShmPublisher             *self,
+                           const guint8                *data,
+                           guint                        stride,
+                           guint                        width,
+                           guint                        height,
+                           guint                        pixman_format,
+                           const cairo_rectangle_int_t *area)
+{
+  cairo_rectangle_int_t clipped;
+  MksShmHeader *header;
+  const guint8 *src;
+  guint8 *dst;
+  guint bpp;
+  guint dst_stride;
+  guint64 seq;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (data != NULL);
+
+  bpp = PIXMAN_FORMAT_BPP (pixman_format);
+
+  /* Guests larger than the memfd are not published */
+  if (width == 0 || height == 0 || bpp == 0 || bpp % 8 != 0 || bpp > 32 ||
+      width > MKS_SHM_MAX_WIDTH || height > MKS_SHM_MAX_HEIGHT)
+    {
+      mks_shm_publisher_clear (self);
+      return;
+    }
+
+  bpp /= 8;
+  dst_stride = (width * bpp + 3) & ~3;
+  header = self->header;
+
+  g_mutex_lock (&self->mutex);
+
+  if (area == NULL ||
+      header->width != width ||
+      header->height != height ||
+      header->pixman_format != pixman_format)
+    {
+      clipped = (cairo_rectangle_int_t) { 0, 0, width, height };
+    }
+  else
+    {
+      int x2 = MIN (area->x + area->width, (int)width);
+      int y2 = MIN (area->y + area->height, (int)height);
+
+      clipped.x = MAX (area->x, 0);
+      clipped.y = MAX (area->y, 0);
+      clipped.width = x2 - clipped.x;
+      clipped.height = y2 - clipped.y;
+
+      if (clipped.width <= 0 || clipped.height <= 0)
+        goto unlock;
+    }
+
+  seq = mks_shm_publisher_begin_write (self);
+
+  header->width = width;
+  header->height = height;
+  header->stride = dst_stride;
+  header->pixman_format = pixman_format;
+
+  src = data + (gsize)clipped.y * stride + (gsize)clipped.x * bpp;
+  dst = self->data + MKS_SHM_HEADER_SIZE + (gsize)clipped.y * dst_stride + (gsize)clipped.x * bpp;
+
+  for (int i = 0; i < clipped.height; i++)
+    memcpy (dst + (gsize)i * dst_stride,
+            src + (gsize)i * stride,
+            (gsize)clipped.width * bpp);
+
+  mks_shm_publisher_end_write (self, seq, &clipped);
+
+unlock:
+  g_mutex_unlock (&self->mutex);
+}
+
+/**
+ * mks_shm_publisher_clear:
+ * @self: a #MksShmPublisher
+ *
+ * Tells readers there is no framebuffer to show, such as while the guest
+ * display is disabled or is only available as a DMA-BUF.
+ */
+void
+mks_shm_publisher_clear (MksShmPublisher *self)
+{
+  guint64 seq;
+
+  g_return_if_fail (self != NULL);
+
+  g_mutex_lock (&self->mutex);
+
+  if (self->header->width != 0 || self->header->height != 0)
+    {
+      seq = mks_shm_publisher_begin_write (self);
+      self->header->width = 0;
+      self->header->height = 0;
+      self->header->stride = 0;
+      self->header->pixman_format = 0;
+      mks_shm_publisher_end_write (self, seq, &(cairo_rectangle_int_t) { 0, 0, 0, 0 });
+    }
+
+  g_mutex_unlock (&self->mutex);
+}
@@ -0,0 +1,45 @@
+/* mks-surface-pool-private.h
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#pragma once
+
+#include <cairo.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _MksSurfacePool MksSurfacePool;
+
+MksSurfacePool  *mks_surface_pool_new     (void);
+MksSurfacePool  *mks_surface_pool_ref     (MksSurfacePool *self);
+void             mks_surface_pool_unref   (MksSurfacePool *self);
+cairo_surface_t *mks_surface_pool_acquire (MksSurfacePool *self,
+                                           cairo_format_t  format,
+                                           guint           width,
+                                           guint           height,
+                                           gboolean       *recycled);
+void             mks_surface_pool_release (MksSurfacePool  *self,
+                                           cairo_surface_t *surface);
+void             mks_surface_pool_trim    (MksSurfacePool  *self,
+                                           gint64           max_idle_usec);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MksSurfacePool, mks_surface_pool_unref)
+
+G_END_DECLS
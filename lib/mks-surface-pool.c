@@ -0,0 +1,297 @@
+/* mks-surface-pool.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "config.h"
+
+#include "mks-surface-pool-private.h"
+#include "mks-trace-private.h"
+
+/* EFI/BIOS mode switches and guest resolution probing replace the
+ * framebuffer many times in quick succession. Released surfaces are
+ * kept for a short while so that the next framebuffer can reuse one
+ * instead of allocating (and faulting in) several megabytes again.
+ *
+ * Idle surfaces are bounded by count and size, and are dropped once
+ * they have not been used for SETTLE_MSEC so that memory is returned
+ * after the mode settles.
+ */
+#define MAX_IDLE_SURFACES 4
+#define MAX_IDLE_BYTES    (128 * 1024 * 1024)
+#define SETTLE_MSEC       2000
+
+/* Don't hand out surfaces wasting more than half of their memory */
+#define MAX_WASTE_FACTOR  2
+
+typedef struct
+{
+  GList            link;
+  cairo_surface_t *surface;
+  gint64           released_at;
+  gsize            size;
+} MksIdleSurface;
+
+struct _MksSurfacePool
+{
+  int      ref_count;
+  GMutex   mutex;
+  GQueue   idle;
+  gsize    idle_bytes;
+  GSource *trim_source;
+};
+
+static gsize
+surface_size (cairo_surface_t *surface)
+{
+  return (gsize)cairo_image_surface_get_stride (surface) *
+         cairo_image_surface_get_height (surface);
+}
+
+static void
+mks_idle_surface_free (MksIdleSurface *idle)
+{
+  g_clear_pointer (&idle->surface, cairo_surface_destroy);
+  g_free (idle);
+}
+
+MksSurfacePool *
+mks_surface_pool_new (void)
+{
+  MksSurfacePool *self;
+
+  self = g_new0 (MksSurfacePool, 1);
+  self->ref_count = 1;
+  g_mutex_init (&self->mutex);
+
+  return self;
+}
+
+MksSurfacePool *
+mks_surface_pool_ref (MksSurfacePool *self)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (self->ref_count > 0, NULL);
+
+  g_atomic_int_inc (&self->ref_count);
+
+  return self;
+}
+
+void
+mks_surface_pool_unref (MksSurfacePool *self)
+{
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (self->ref_count > 0);
+
+  if (g_atomic_int_dec_and_test (&self->ref_count))
+    {
+      MksIdleSurface *idle;
+
+      /* The trim source holds a reference so it must be gone already */
+      g_assert (self->trim_source == NULL);
+
+      while ((idle = g_queue_pop_head (&self->idle)))
+        mks_idle_surface_free (idle);
+
+      g_mutex_clear (&self->mutex);
+      g_free (self);
+    }
+}
+
+/*
+ * mks_surface_pool_acquire:
+ * @format: the format of the surface
+ * @width: the minimum width of the surface
+ * @height: the minimum height of the surface
+ * @recycled: (out): if the surface has previous contents
+ *
+ * Gets an image surface at least @width by @height, reusing a released
+ * surface if one is large enough without being wasteful.
+ *
+ * Returns: (transfer full): a cairo image surface
+ */
+cairo_surface_t *
+mks_surface_pool_acquire (MksSurfacePool *self,
+                          cairo_format_t  format,
+                          guint           width,
+                          guint           height,
+                          gboolean       *recycled)
+{
+  MksIdleSurface *best = NULL;
+  cairo_surface_t *surface = NULL;
+  guint64 requested;
+  guint64 best_area = 0;
+
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (width > 0, NULL);
+  g_return_val_if_fail (height > 0, NULL);
+  g_return_val_if_fail (recycled != NULL, NULL);
+
+  requested = (guint64)width * height;
+
+  g_mutex_lock (&self->mutex);
+
+  for (const GList *iter = self->idle.head; iter; iter = iter->next)
+    {
+      MksIdleSurface *idle = iter->data;
+      guint idle_width = cairo_image_surface_get_width (idle->surface);
+      guint idle_height = cairo_image_surface_get_height (idle->surface);
+      guint64 area = (guint64)idle_width * idle_height;
+
+      if (cairo_image_surface_get_format (idle->surface) != format ||
+          idle_width < width ||
+          idle_height < height ||
+          area > requested * MAX_WASTE_FACTOR)
+        continue;
+
+      if (best == NULL || area < best_area)
+        {
+          best = idle;
+          best_area = area;
+        }
+    }
+
+  if (best != NULL)
+    {
+      g_queue_unlink (&self->idle, &best->link);
+      self->idle_bytes -= best->size;
+      surface = g_steal_pointer (&best->surface);
+      mks_idle_surface_free (best);
+    }
+
+  g_mutex_unlock (&self->mutex);
+
+  MKS_TRACE_MARK ("surfacepool.acquire",
+                  "width=%u height=%u recycled=%d",
+                  width, height, surface != NULL);
+
+  if ((*recycled = surface != NULL))
+    return surface;
+
+  return cairo_image_surface_create (format, width, height);
+}
+
+static gboolean
+mks_surface_pool_trim_cb (gpointer data)
+{
+  MksSurfacePool *self = data;
+  gboolean has_idle;
+
+  mks_surface_pool_trim (self, SETTLE_MSEC * 1000);
+
+  g_mutex_lock (&self->mutex);
+  if (!(has_idle = self->idle.length > 0))
+    self->trim_source = NULL;
+  g_mutex_unlock (&self->mutex);
+
+  return has_idle ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+}
+
+/*
+ * mks_surface_pool_release:
+ * @surface: (transfer full): a surface from mks_surface_pool_acquire()
+ *
+ * Returns @surface to the pool once nothing else is using its contents.
+ *
+ * This is safe to call from any thread.
+ */
+void
+mks_surface_pool_release (MksSurfacePool  *self,
+                          cairo_surface_t *surface)
+{
+  MksIdleSurface *idle;
+  GQueue evicted = G_QUEUE_INIT;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (surface != NULL);
+
+  idle = g_new0 (MksIdleSurface, 1);
+  idle->link.data = idle;
+  idle->surface = surface;
+  idle->released_at = g_get_monotonic_time ();
+  idle->size = surface_size (surface);
+
+  g_mutex_lock (&self->mutex);
+
+  g_queue_push_head_link (&self->idle, &idle->link);
+  self->idle_bytes += idle->size;
+
+  while (self->idle.length > MAX_IDLE_SURFACES ||
+         self->idle_bytes > MAX_IDLE_BYTES)
+    {
+      MksIdleSurface *oldest = g_queue_peek_tail (&self->idle);
+
+      g_queue_unlink (&self->idle, &oldest->link);
+      self->idle_bytes -= oldest->size;
+      g_queue_push_tail_link (&evicted, &oldest->link);
+    }
+
+  if (self->idle.length > 0 && self->trim_source == NULL)
+    {
+      self->trim_source = g_timeout_source_new (SETTLE_MSEC);
+      g_source_set_priority (self->trim_source, G_PRIORITY_LOW);
+      g_source_set_static_name (self->trim_source, "[mks-surface-pool-trim]");
+      g_source_set_callback (self->trim_source,
+                             mks_surface_pool_trim_cb,
+                             mks_surface_pool_ref (self),
+                             (GDestroyNotify) mks_surface_pool_unref);
+      g_source_attach (self->trim_source, NULL);
+      g_source_unref (self->trim_source);
+    }
+
+  g_mutex_unlock (&self->mutex);
+
+  while ((idle = g_queue_pop_head (&evicted)))
+    mks_idle_surface_free (idle);
+}
+
+/*
+ * mks_surface_pool_trim:
+ * @max_idle_usec: how long a surface may be idle, or 0 to drop all
+ *
+ * Frees surfaces which have been idle for longer than @max_idle_usec.
+ */
+void
+mks_surface_pool_trim (MksSurfacePool *self,
+                       gint64          max_idle_usec)
+{
+  GQueue expired = G_QUEUE_INIT;
+  MksIdleSurface *idle;
+  gint64 now;
+
+  g_return_if_fail (self != NULL);
+
+  now = g_get_monotonic_time ();
+
+  g_mutex_lock (&self->mutex);
+
+  /* Newest entries are at the head so expire from the tail */
+  while ((idle = g_queue_peek_tail (&self->idle)) &&
+         now - idle->released_at >= max_idle_usec)
+    {
+      g_queue_unlink (&self->idle, &idle->link);
+      self->idle_bytes -= idle->size;
+      g_queue_push_tail_link (&expired, &idle->link);
+    }
+
+  g_mutex_unlock (&self->mutex);
+
+  while ((idle = g_queue_pop_head (&expired)))
+    mks_idle_surface_free (idle);
+}
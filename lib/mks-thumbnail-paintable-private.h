@@ -0,0 +1,36 @@
+/* mks-thumbnail-paintable-private.h
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+#pragma once
+
+#include <gdk/gdk.h>
+
+G_BEGIN_DECLS
+
+#define MKS_TYPE_THUMBNAIL_PAINTABLE (mks_thumbnail_paintable_get_type())
+
+G_DECLARE_FINAL_TYPE (MksThumbnailPaintable, mks_thumbnail_paintable, MKS, THUMBNAIL_PAINTABLE, GObject)
+
+GdkPaintable *_mks_thumbnail_paintable_new (guint    max_width,
+                                            guint    max_height,
+                                            guint    max_fps,
+                                            int     *peer_fd,
+                                            GError **error);
+
+G_END_DECLS
@@ -0,0 +1,601 @@
+/* mks-thumbnail-paintable.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+#include "config.h"
+
+#include <pixman.h>
+
+#include "mks-cpu-listener-private.h"
+#include "mks-damage-private.h"
+#include "mks-dmabuf-map-private.h"
+#include "mks-pixels-private.h"
+#include "mks-thumbnail-paintable-private.h"
+#include "mks-util-private.h"
+
+/* Reading a DMA-BUF back through the CPU may stall on the device, so it
+ * happens at most this often regardless of the refresh rate.
+ */
+#define DMABUF_READBACK_INTERVAL G_TIME_SPAN_SECOND
+
+struct _MksThumbnailPaintable
+{
+  GObject          parent_instance;
+
+  MksCpuListener  *listener;
+
+  /* The last published contents */
+  GdkTexture      *texture;
+
+  /* The only copy of the screen contents that is kept around. Native
+   * ARGB32 of width by height with width * 4 stride.
+   */
+  guint8          *pixels;
+
+  /* Damage in screen coordinates which has not been read from the
+   * shared mapping yet.
+   */
+  MksDamage        damage;
+
+  gint64           interval;
+  gint64           last_refresh;
+  gint64           last_readback;
+  guint            refresh_source;
+
+  guint            max_width;
+  guint            max_height;
+  guint            width;
+  guint            height;
+  guint            screen_width;
+  guint            screen_height;
+
+  guint            changed : 1;
+  guint            size_changed : 1;
+  guint            dmabuf_dirty : 1;
+  guint            dmabuf_failed : 1;
+};
+
+enum {
+  ACTIVITY,
+  N_SIGNALS
+};
+
+static guint signals [N_SIGNALS];
+
+static int
+mks_thumbnail_paintable_get_intrinsic_width (GdkPaintable *paintable)
+{
+  return MKS_THUMBNAIL_PAINTABLE (paintable)->width;
+}
+
+static int
+mks_thumbnail_paintable_get_intrinsic_height (GdkPaintable *paintable)
+{
+  return MKS_THUMBNAIL_PAINTABLE (paintable)->height;
+}
+
+static void
+mks_thumbnail_paintable_snapshot (GdkPaintable *paintable,
+                                  GdkSnapshot  *snapshot,
+                                  double        width,
+                                  double        height)
+{
+  MksThumbnailPaintable *self = MKS_THUMBNAIL_PAINTABLE (paintable);
+
+  if (self->texture != NULL)
+    gdk_paintable_snapshot (GDK_PAINTABLE (self->texture), snapshot, width, height);
+}
+
+static void
+paintable_iface_init (GdkPaintableInterface *iface)
+{
+  iface->get_intrinsic_width = mks_thumbnail_paintable_get_intrinsic_width;
+  iface->get_intrinsic_height = mks_thumbnail_paintable_get_intrinsic_height;
+  iface->snapshot = mks_thumbnail_paintable_snapshot;
+}
+
+G_DEFINE_FINAL_TYPE_WITH_CODE (MksThumbnailPaintable, mks_thumbnail_paintable, G_TYPE_OBJECT,
+                               G_IMPLEMENT_INTERFACE (GDK_TYPE_PAINTABLE, paintable_iface_init))
+
+static void
+mks_thumbnail_paintable_clear_source (MksThumbnailPaintable *self)
+{
+  g_assert (MKS_IS_THUMBNAIL_PAINTABLE (self));
+
+  self->dmabuf_dirty = FALSE;
+  self->dmabuf_failed = FALSE;
+
+  mks_damage_clear (&self->damage);
+}
+
+static void
+mks_thumbnail_paintable_set_screen_size (MksThumbnailPaintable *self,
+                                         guint                  screen_width,
+                                         guint                  screen_height)
+{
+  double scale;
+  guint width;
+  guint height;
+
+  g_assert (MKS_IS_THUMBNAIL_PAINTABLE (self));
+  g_assert (screen_width > 0);
+  g_assert (screen_height > 0);
+
+  self->screen_width = screen_width;
+  self->screen_height = screen_height;
+
+  /* Fit within the requested size keeping the aspect ratio, but never
+   * make the thumbnail larger than the screen itself.
+   */
+  scale = MIN (1., MIN ((double)self->max_width / screen_width,
+                        (double)self->max_height / screen_height));
+  width = MAX (1, (guint)(screen_width * scale));
+  height = MAX (1, (guint)(screen_height * scale));
+
+  if (width != self->width || height != self->height)
+    {
+      self->width = width;
+      self->height = height;
+      self->size_changed = TRUE;
+
+      g_free (self->pixels);
+      self->pixels = g_malloc0 ((gsize)width * 4 * height);
+    }
+}
+
+static void
+mks_thumbnail_paintable_read_map (MksThumbnailPaintable *self)
+{
+  const guint8 *data;
+  guint map_stride;
+  guint map_format;
+  gsize bpp;
+
+  g_assert (MKS_IS_THUMBNAIL_PAINTABLE (self));
+
+  data = mks_cpu_listener_get_map (self->listener, &map_stride, &map_format);
+  bpp = PIXMAN_FORMAT_BPP (map_format) / 8;
+
+  for (guint i = 0; i < self->damage.n_rects; i++)
+    {
+      const cairo_rectangle_int_t *rect = &self->damage.rects[i];
+      guint x = rect->x;
+      guint y = rect->y;
+      guint width = rect->width;
+      guint height = rect->height;
+
+      /* The whole screen is available, so read complete boxes rather
+       * than averaging just the damaged part of the edges.
+       */
+      mks_pixels_downsample_align (self->screen_width, self->width, &x, &width);
+      mks_pixels_downsample_align (self->screen_height, self->height, &y, &height);
+
+      mks_pixels_downsample (map_format,
+                             self->pixels,
+                             (gsize)self->width * 4,
+                             self->width,
+                             self->height,
+                             data + y * (gsize)map_stride + x * bpp,
+                             map_stride,
+                             self->screen_width,
+                             self->screen_height,
+                             x, y, width, height);
+    }
+
+  if (!mks_damage_is_empty (&self->damage))
+    self->changed = TRUE;
+
+  mks_damage_clear (&self->damage);
+}
+
+static void
+mks_thumbnail_paintable_read_dmabuf (MksThumbnailPaintable *self)
+{
+  g_autoptr(GError) error = NULL;
+  const MksDmabufScanout *dmabuf;
+  MksDmabufMap map;
+  const guint8 *src;
+
+  g_assert (MKS_IS_THUMBNAIL_PAINTABLE (self));
+
+  dmabuf = mks_cpu_listener_get_dmabuf (self->listener);
+
+  self->dmabuf_dirty = FALSE;
+  self->last_readback = g_get_monotonic_time ();
+
+  if (!mks_dmabuf_map_begin (&map, dmabuf, &error))
+    {
+      g_debug ("Cannot read DMA-BUF for thumbnail: %s", error->message);
+      self->dmabuf_failed = TRUE;
+      return;
+    }
+
+  /* YUV is converted in full first, which also turns it the right way
+   * up. Thumbnails refresh rarely enough for that to be affordable.
+   */
+  if (map.pixman_format == 0)
+    {
+      gsize stride = (gsize)self->screen_width * 4;
+      g_autofree guint8 *converted = g_malloc (stride * self->screen_height);
+
+      mks_dmabuf_map_convert (&map,
+                              0, 0, self->screen_width, self->screen_height,
+                              converted, stride);
+      mks_dmabuf_map_end (&map);
+
+      mks_pixels_downsample (PIXMAN_a8r8g8b8,
+                             self->pixels,
+                             (gsize)self->width * 4,
+                             self->width,
+                             self->height,
+                             converted,
+                             stride,
+                             self->screen_width,
+                             self->screen_height,
+                             0, 0, self->screen_width, self->screen_height);
+
+      self->changed = TRUE;
+      return;
+    }
+
+  /* Rows are in memory order, which is upside down with y0_top. The
+   * thumbnail is flipped back afterwards which is far cheaper than
+   * flipping the source.
+   */
+  if (dmabuf->y0_top)
+    src = mks_dmabuf_map_get_row (&map, self->screen_height - 1);
+  else
+    src = mks_dmabuf_map_get_row (&map, 0);
+
+  mks_pixels_downsample (map.pixman_format,
+                         self->pixels,
+                         (gsize)self->width * 4,
+                         self->width,
+                         self->height,
+                         src,
+                         map.stride,
+                         self->screen_width,
+                         self->screen_height,
+                         0, 0, self->screen_width, self->screen_height);
+
+  mks_dmabuf_map_end (&map);
+
+  if (dmabuf->y0_top)
+    mks_pixels_flip_rows (self->pixels,
+                          (gsize)self->width * 4,
+                          (gsize)self->width * 4,
+                          self->height);
+
+  self->changed = TRUE;
+}
+
+static gboolean
+mks_thumbnail_paintable_refresh_cb (gpointer user_data)
+{
+  MksThumbnailPaintable *self = user_data;
+  MksCpuListenerSource source;
+
+  g_assert (MKS_IS_THUMBNAIL_PAINTABLE (self));
+
+  self->refresh_source = 0;
+  self->last_refresh = g_get_monotonic_time ();
+
+  MKS_TRACE_SCOPE ("thumbnail.refresh", "width=%u height=%u", self->width, self->height);
+
+  source = mks_cpu_listener_get_source (self->listener);
+
+  if (source == MKS_CPU_LISTENER_SOURCE_MAP)
+    mks_thumbnail_paintable_read_map (self);
+  else if (source == MKS_CPU_LISTENER_SOURCE_DMABUF && self->dmabuf_dirty)
+    mks_thumbnail_paintable_read_dmabuf (self);
+
+  if (self->changed)
+    {
+      g_autoptr(GBytes) bytes = NULL;
+      gsize stride = (gsize)self->width * 4;
+
+      bytes = g_bytes_new (self->pixels, stride * self->height);
+
+      g_clear_object (&self->texture);
+      self->texture = gdk_memory_texture_new (self->width,
+                                              self->height,
+                                              GDK_MEMORY_DEFAULT,
+                                              bytes,
+                                              stride);
+      self->changed = FALSE;
+
+      if (self->size_changed)
+        {
+          self->size_changed = FALSE;
+          gdk_paintable_invalidate_size (GDK_PAINTABLE (self));
+        }
+
+      gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+mks_thumbnail_paintable_queue_refresh (MksThumbnailPaintable *self)
+{
+  gint64 next;
+  gint64 now;
+
+  g_assert (MKS_IS_THUMBNAIL_PAINTABLE (self));
+
+  if (self->refresh_source != 0)
+    return;
+
+  next = self->last_refresh + self->interval;
+
+  if (self->dmabuf_dirty)
+    {
+      if (self->dmabuf_failed)
+        return;
+
+      next = MAX (next, self->last_readback + DMABUF_READBACK_INTERVAL);
+    }
+
+  now = g_get_monotonic_time ();
+
+  self->refresh_source = g_timeout_add_full (G_PRIORITY_DEFAULT,
+                                             next > now ? (next - now) / 1000 : 0,
+                                             mks_thumbnail_paintable_refresh_cb,
+                                             self,
+                                             NULL);
+}
+
+static void
+mks_thumbnail_paintable_scanout_cb (MksThumbnailPaintable *self,
+                                    MksCpuListener        *listener)
+{
+  guint width;
+  guint height;
+
+  g_assert (MKS_IS_THUMBNAIL_PAINTABLE (self));
+  g_assert (MKS_IS_CPU_LISTENER (listener));
+
+  width = mks_cpu_listener_get_width (listener);
+  height = mks_cpu_listener_get_height (listener);
+
+  mks_thumbnail_paintable_clear_source (self);
+  mks_thumbnail_paintable_set_screen_size (self, width, height);
+
+  switch (mks_cpu_listener_get_source (listener))
+    {
+    case MKS_CPU_LISTENER_SOURCE_PAYLOAD:
+      {
+        const guint8 *data;
+        guint stride;
+        guint pixman_format;
+
+        data = mks_cpu_listener_get_payload (listener, &stride, &pixman_format);
+        mks_pixels_downsample (pixman_format,
+                               self->pixels,
+                               (gsize)self->width * 4,
+                               self->width,
+                               self->height,
+                               data,
+                               stride,
+                               width,
+                               height,
+                               0, 0, width, height);
+        self->changed = TRUE;
+      }
+      break;
+
+    case MKS_CPU_LISTENER_SOURCE_MAP:
+      mks_damage_add (&self->damage,
+                      &(cairo_rectangle_int_t) { 0, 0, width, height });
+      break;
+
+    case MKS_CPU_LISTENER_SOURCE_DMABUF:
+      self->dmabuf_dirty = TRUE;
+      break;
+
+    case MKS_CPU_LISTENER_SOURCE_NONE:
+    default:
+      g_assert_not_reached ();
+    }
+
+  mks_thumbnail_paintable_queue_refresh (self);
+
+  g_signal_emit (self, signals [ACTIVITY], 0);
+}
+
+static void
+mks_thumbnail_paintable_update_cb (MksThumbnailPaintable *self,
+                                   int                    x,
+                                   int                    y,
+                                   int                    width,
+                                   int                    height,
+                                   MksCpuListener        *listener)
+{
+  g_assert (MKS_IS_THUMBNAIL_PAINTABLE (self));
+  g_assert (MKS_IS_CPU_LISTENER (listener));
+
+  switch (mks_cpu_listener_get_source (listener))
+    {
+    case MKS_CPU_LISTENER_SOURCE_PAYLOAD:
+      {
+        const guint8 *data;
+        guint stride;
+        guint pixman_format;
+
+        /* The rest of the screen is gone by now, so thumbnail pixels on
+         * the edge of the update are averaged over the part that changed.
+         */
+        data = mks_cpu_listener_get_payload (listener, &stride, &pixman_format);
+        mks_pixels_downsample (pixman_format,
+                               self->pixels,
+                               (gsize)self->width * 4,
+                               self->width,
+                               self->height,
+                               data,
+                               stride,
+                               self->screen_width,
+                               self->screen_height,
+                               x, y, width, height);
+        self->changed = TRUE;
+      }
+      break;
+
+    case MKS_CPU_LISTENER_SOURCE_MAP:
+      /* Nothing is read until the next refresh, so frequent small
+       * updates only grow the damage.
+       */
+      mks_damage_add (&self->damage,
+                      &(cairo_rectangle_int_t) { x, y, width, height });
+      break;
+
+    case MKS_CPU_LISTENER_SOURCE_DMABUF:
+      /* The whole buffer is read back periodically, the update only
+       * tells us that doing so is worthwhile.
+       */
+      self->dmabuf_dirty = TRUE;
+      break;
+
+    case MKS_CPU_LISTENER_SOURCE_NONE:
+    default:
+      g_assert_not_reached ();
+    }
+
+  mks_thumbnail_paintable_queue_refresh (self);
+
+  g_signal_emit (self, signals [ACTIVITY], 0);
+}
+
+static void
+mks_thumbnail_paintable_disable_cb (MksThumbnailPaintable *self,
+                                    MksCpuListener        *listener)
+{
+  g_assert (MKS_IS_THUMBNAIL_PAINTABLE (self));
+  g_assert (MKS_IS_CPU_LISTENER (listener));
+
+  mks_thumbnail_paintable_clear_source (self);
+
+  if (self->texture != NULL)
+    {
+      g_clear_object (&self->texture);
+      gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
+    }
+}
+
+static void
+mks_thumbnail_paintable_dispose (GObject *object)
+{
+  MksThumbnailPaintable *self = (MksThumbnailPaintable *)object;
+
+  g_clear_handle_id (&self->refresh_source, g_source_remove);
+
+  g_clear_object (&self->listener);
+  g_clear_object (&self->texture);
+
+  mks_thumbnail_paintable_clear_source (self);
+
+  G_OBJECT_CLASS (mks_thumbnail_paintable_parent_class)->dispose (object);
+}
+
+static void
+mks_thumbnail_paintable_finalize (GObject *object)
+{
+  MksThumbnailPaintable *self = (MksThumbnailPaintable *)object;
+
+  g_clear_pointer (&self->pixels, g_free);
+
+  G_OBJECT_CLASS (mks_thumbnail_paintable_parent_class)->finalize (object);
+}
+
+static void
+mks_thumbnail_paintable_class_init (MksThumbnailPaintableClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = mks_thumbnail_paintable_dispose;
+  object_class->finalize = mks_thumbnail_paintable_finalize;
+
+  /* The guest changed the contents, emitted for every Scanout and Update
+   * even when the thumbnail is not refreshed.
+   */
+  signals [ACTIVITY] =
+    g_signal_new ("activity",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL,
+                  NULL,
+                  G_TYPE_NONE, 0);
+}
+
+static void
+mks_thumbnail_paintable_init (MksThumbnailPaintable *self)
+{
+  mks_damage_init (&self->damage);
+}
+
+/*
+ * _mks_thumbnail_paintable_new:
+ * @max_width: the largest width of the thumbnail
+ * @max_height: the largest height of the thumbnail
+ * @max_fps: the most times per second the contents may change
+ * @peer_fd: (out): location for the peer to pass to RegisterListener
+ *
+ * Creates a paintable which shows a downscaled copy of a screen.
+ *
+ * Only the thumbnail itself is kept in memory. Updates are shrunk with
+ * a box filter as they arrive, shared memory scanouts are only read from
+ * where they were damaged when the thumbnail refreshes, and DMA-BUF
+ * scanouts are read back by the CPU at most once per second.
+ */
+GdkPaintable *
+_mks_thumbnail_paintable_new (guint    max_width,
+                              guint    max_height,
+                              guint    max_fps,
+                              int     *peer_fd,
+                              GError **error)
+{
+  g_autoptr(MksThumbnailPaintable) self = NULL;
+
+  g_return_val_if_fail (max_width > 0, NULL);
+  g_return_val_if_fail (max_height > 0, NULL);
+  g_return_val_if_fail (max_fps > 0, NULL);
+  g_return_val_if_fail (peer_fd != NULL, NULL);
+
+  *peer_fd = -1;
+
+  self = g_object_new (MKS_TYPE_THUMBNAIL_PAINTABLE, NULL);
+  self->max_width = max_width;
+  self->max_height = max_height;
+  self->interval = G_USEC_PER_SEC / max_fps;
+
+  if (!(self->listener = mks_cpu_listener_new (peer_fd, error)))
+    return NULL;
+
+  g_signal_connect_object (self->listener, "scanout",
+                           G_CALLBACK (mks_thumbnail_paintable_scanout_cb),
+                           self, G_CONNECT_SWAPPED);
+  g_signal_connect_object (self->listener, "update",
+                           G_CALLBACK (mks_thumbnail_paintable_update_cb),
+                           self, G_CONNECT_SWAPPED);
+  g_signal_connect_object (self->listener, "disable",
+                           G_CALLBACK (mks_thumbnail_paintable_disable_cb),
+                           self, G_CONNECT_SWAPPED);
+
+  return GDK_PAINTABLE (g_steal_pointer (&self));
+}
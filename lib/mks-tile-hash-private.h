@@ -0,0 +1,48 @@
+/* mks-tile-hash-private.h
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#pragma once
+
+#include <cairo.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define MKS_TILE_HASH_SIZE 64
+
+typedef struct _MksTileHash MksTileHash;
+
+MksTileHash    *mks_tile_hash_new       (void);
+void            mks_tile_hash_free      (MksTileHash          *self);
+void            mks_tile_hash_reset     (MksTileHash          *self);
+cairo_region_t *mks_tile_hash_filter    (MksTileHash          *self,
+                                         const guint8         *data,
+                                         gsize                 stride,
+                                         guint                 width,
+                                         guint                 height,
+                                         guint                 bytes_per_pixel,
+                                         const cairo_region_t *damage);
+void            mks_tile_hash_get_stats (MksTileHash          *self,
+                                         guint64              *bytes_damaged,
+                                         guint64              *bytes_changed);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MksTileHash, mks_tile_hash_free)
+
+G_END_DECLS
@@ -0,0 +1,250 @@
+/* mks-tile-hash.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "mks-pixels-private.h"
+#include "mks-tile-hash-private.h"
+#include "mks-trace-private.h"
+
+/* QEMU regularly reports damage for pixels which did not change, such as
+ * a full repaint after Scanout or a firmware console redraw. We keep a
+ * hash per MKS_TILE_HASH_SIZE square tile of the last uploaded contents
+ * and shrink damage to the tiles which actually differ.
+ */
+struct _MksTileHash
+{
+  guint64 *hashes;
+  guint   *stamps;
+  guint    stamp;
+
+  guint    width;
+  guint    height;
+  guint    bytes_per_pixel;
+  guint    n_columns;
+  guint    n_rows;
+
+  guint64  bytes_damaged;
+  guint64  bytes_changed;
+};
+
+MksTileHash *
+mks_tile_hash_new (void)
+{
+  return g_new0 (MksTileHash, 1);
+}
+
+void
+mks_tile_hash_free (MksTileHash *self)
+{
+  if (self == NULL)
+    return;
+
+  g_clear_pointer (&self->hashes, g_free);
+  g_clear_pointer (&self->stamps, g_free);
+  g_free (self);
+}
+
+/*
+ * mks_tile_hash_reset:
+ *
+ * Forgets all tile contents so the next damage to each tile is
+ * reported as a change.
+ */
+void
+mks_tile_hash_reset (MksTileHash *self)
+{
+  g_return_if_fail (self != NULL);
+
+  g_clear_pointer (&self->hashes, g_free);
+  g_clear_pointer (&self->stamps, g_free);
+
+  self->stamp = 0;
+  self->width = 0;
+  self->height = 0;
+  self->bytes_per_pixel = 0;
+  self->n_columns = 0;
+  self->n_rows = 0;
+}
+
+static guint64
+region_area (const cairo_region_t *region)
+{
+  guint64 area = 0;
+
+  for (int i = cairo_region_num_rectangles (region) - 1; i >= 0; i--)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (region, i, &rect);
+      area += (guint64)rect.width * rect.height;
+    }
+
+  return area;
+}
+
+/*
+ * mks_tile_hash_filter:
+ * @data: the contents after @damage was applied
+ * @damage: the damage reported for @data
+ *
+ * Hashes every tile touched by @damage and compares it to the hash
+ * from the previous call.
+ *
+ * Returns: (transfer full): the subset of @damage within tiles whose
+ *   contents changed, which may be empty
+ */
+cairo_region_t *
+mks_tile_hash_filter (MksTileHash          *self,
+                      const guint8         *data,
+                      gsize                 stride,
+                      guint                 width,
+                      guint                 height,
+                      guint                 bytes_per_pixel,
+                      const cairo_region_t *damage)
+{
+  cairo_region_t *changed;
+  cairo_region_t *clipped;
+  guint64 damaged_area;
+  guint64 changed_area;
+
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (data != NULL, NULL);
+  g_return_val_if_fail (damage != NULL, NULL);
+  g_return_val_if_fail (bytes_per_pixel > 0, NULL);
+
+  if (self->width != width ||
+      self->height != height ||
+      self->bytes_per_pixel != bytes_per_pixel)
+    {
+      mks_tile_hash_reset (self);
+
+      self->width = width;
+      self->height = height;
+      self->bytes_per_pixel = bytes_per_pixel;
+      self->n_columns = (width + MKS_TILE_HASH_SIZE - 1) / MKS_TILE_HASH_SIZE;
+      self->n_rows = (height + MKS_TILE_HASH_SIZE - 1) / MKS_TILE_HASH_SIZE;
+      self->hashes = g_new0 (guint64, (gsize)self->n_columns * self->n_rows);
+      self->stamps = g_new0 (guint, (gsize)self->n_columns * self->n_rows);
+    }
+
+  /* Stamps let us hash each tile once even when rectangles share it. A
+   * stamp of zero means the tile has never been hashed.
+   */
+  if (++self->stamp == 0)
+    {
+      memset (self->stamps, 0, sizeof (guint) * self->n_columns * self->n_rows);
+      self->stamp = 1;
+    }
+
+  clipped = cairo_region_copy (damage);
+  cairo_region_intersect_rectangle (clipped, &(cairo_rectangle_int_t) { 0, 0, width, height });
+  changed = cairo_region_create ();
+
+  for (int i = cairo_region_num_rectangles (clipped) - 1; i >= 0; i--)
+    {
+      cairo_rectangle_int_t rect;
+      guint column_begin, column_end;
+      guint row_begin, row_end;
+
+      cairo_region_get_rectangle (clipped, i, &rect);
+
+      column_begin = rect.x / MKS_TILE_HASH_SIZE;
+      column_end = (rect.x + rect.width - 1) / MKS_TILE_HASH_SIZE;
+      row_begin = rect.y / MKS_TILE_HASH_SIZE;
+      row_end = (rect.y + rect.height - 1) / MKS_TILE_HASH_SIZE;
+
+      for (guint row = row_begin; row <= row_end; row++)
+        {
+          for (guint column = column_begin; column <= column_end; column++)
+            {
+              gsize index = (gsize)row * self->n_columns + column;
+              cairo_rectangle_int_t tile;
+              gboolean known;
+              guint64 hash;
+
+              if (self->stamps[index] == self->stamp)
+                continue;
+
+              tile.x = column * MKS_TILE_HASH_SIZE;
+              tile.y = row * MKS_TILE_HASH_SIZE;
+              tile.width = MIN (MKS_TILE_HASH_SIZE, width - tile.x);
+              tile.height = MIN (MKS_TILE_HASH_SIZE, height - tile.y);
+
+              hash = mks_pixels_hash_rows (&data[(gsize)tile.y * stride + (gsize)tile.x * bytes_per_pixel],
+                                           stride,
+                                           (gsize)tile.width * bytes_per_pixel,
+                                           tile.height);
+
+              known = self->stamps[index] != 0;
+              self->stamps[index] = self->stamp;
+
+              if (known && self->hashes[index] == hash)
+                continue;
+
+              self->hashes[index] = hash;
+              cairo_region_union_rectangle (changed, &tile);
+            }
+        }
+    }
+
+  cairo_region_intersect (changed, clipped);
+
+  damaged_area = region_area (clipped);
+  changed_area = region_area (changed);
+
+  self->bytes_damaged += damaged_area * bytes_per_pixel;
+  self->bytes_changed += changed_area * bytes_per_pixel;
+
+  MKS_TRACE_MARK ("tilehash.filter",
+                  "damaged=%"G_GUINT64_FORMAT" changed=%"G_GUINT64_FORMAT" "
+                  "total-damaged=%"G_GUINT64_FORMAT" total-changed=%"G_GUINT64_FORMAT,
+                  damaged_area * bytes_per_pixel,
+                  changed_area * bytes_per_pixel,
+                  self->bytes_damaged,
+                  self->bytes_changed);
+
+  cairo_region_destroy (clipped);
+
+  return changed;
+}
+
+/*
+ * mks_tile_hash_get_stats:
+ * @bytes_damaged: (out) (optional): bytes of damage passed to the filter
+ * @bytes_changed: (out) (optional): bytes of damage which changed
+ *
+ * Gets the totals of every call to mks_tile_hash_filter().
+ */
+void
+mks_tile_hash_get_stats (MksTileHash *self,
+                         guint64     *bytes_damaged,
+                         guint64     *bytes_changed)
+{
+  g_return_if_fail (self != NULL);
+
+  if (bytes_damaged != NULL)
+    *bytes_damaged = self->bytes_damaged;
+
+  if (bytes_changed != NULL)
+    *bytes_changed = self->bytes_changed;
+}
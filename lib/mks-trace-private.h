@@ -41,6 +41,11 @@ void           mks_trace_log_printf  (int            severity,
                                       const char    *domain,
                                       const char    *message_format,
                                       ...) G_GNUC_PRINTF (3, 4);
+guint          mks_trace_counter_new (const char    *category,
+                                      const char    *name,
+                                      const char    *description);
+void           mks_trace_counter_set (guint          counter_id,
+                                      gint64         value);
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (MksTraceScope, mks_trace_scope_free)
 
@@ -182,3 +182,62 @@ mks_trace_log_printf (int         severity,
   (void) message_format;
 #endif
 }
+
+/**
+ * mks_trace_counter_new:
+ *
+ * Defines a 64-bit integer counter in the capture.
+ *
+ * Returns: the counter identifier, or 0 if tracing is not active in
+ *   which case mks_trace_counter_set() ignores it.
+ */
+guint
+mks_trace_counter_new (const char *category,
+                       const char *name,
+                       const char *description)
+{
+#if defined(HAVE_SYSPROF) && HAVE_SYSPROF
+  SysprofCaptureCounter counter = {{0}};
+
+  g_return_val_if_fail (category != NULL, 0);
+  g_return_val_if_fail (name != NULL, 0);
+
+  if (!mks_trace_ensure_active ())
+    return 0;
+
+  g_strlcpy (counter.category, category, sizeof counter.category);
+  g_strlcpy (counter.name, name, sizeof counter.name);
+  g_strlcpy (counter.description, description ? description : "", sizeof counter.description);
+  counter.id = sysprof_collector_request_counters (1);
+  counter.type = SYSPROF_CAPTURE_COUNTER_INT64;
+  counter.value.v64 = 0;
+
+  sysprof_collector_define_counters (&counter, 1);
+
+  return counter.id;
+#else
+  (void) category;
+  (void) name;
+  (void) description;
+
+  return 0;
+#endif
+}
+
+void
+mks_trace_counter_set (guint  counter_id,
+                       gint64 value)
+{
+#if defined(HAVE_SYSPROF) && HAVE_SYSPROF
+  SysprofCaptureCounterValue counter_value;
+
+  if (counter_id == 0 || !mks_trace_ensure_active ())
+    return;
+
+  counter_value.v64 = value;
+  sysprof_collector_set_counters (&counter_id, &counter_value, 1);
+#else
+  (void) counter_id;
+  (void) value;
+#endif
+}
@@ -38,12 +38,17 @@ typedef struct _MksClipboardContent    MksClipboardContent;
 typedef struct _MksClipboardRedirector MksClipboardRedirector;
 typedef struct _MksDBusTransport       MksDBusTransport;
 typedef struct _MksDevice              MksDevice;
+typedef struct _MksFrameStats          MksFrameStats;
 typedef struct _MksKeyboard            MksKeyboard;
 typedef struct _MksMicrophone          MksMicrophone;
 typedef struct _MksMouse               MksMouse;
 typedef struct _MksScreen              MksScreen;
 typedef struct _MksScreenAttributes    MksScreenAttributes;
+typedef struct _MksScreenCapture       MksScreenCapture;
+typedef struct _MksScreenFrame         MksScreenFrame;
+typedef struct _MksScreenView          MksScreenView;
 typedef struct _MksSession             MksSession;
+typedef struct _MksSharedPaintable     MksSharedPaintable;
 typedef struct _MksSpeaker             MksSpeaker;
 typedef struct _MksTouchable           MksTouchable;
 
@@ -40,15 +40,27 @@ struct _MksSocketpairConnection
   int              peer_fd;
 };
 
+typedef enum _MksDebugFlags
+{
+  MKS_DEBUG_DISPLAY_THREAD = 1 << 0,
+  MKS_DEBUG_TILE_HASH      = 1 << 1,
+  MKS_DEBUG_FRAME_STATS    = 1 << 2,
+  MKS_DEBUG_PIPELINE       = 1 << 3,
+  MKS_DEBUG_DMABUF_CPU     = 1 << 4,
+} MksDebugFlags;
+
 #define _CAIRO_CHECK_VERSION(major, minor, micro) \
   (CAIRO_VERSION_MAJOR > (major) || \
    (CAIRO_VERSION_MAJOR == (major) && CAIRO_VERSION_MINOR > (minor)) || \
    (CAIRO_VERSION_MAJOR == (major) && CAIRO_VERSION_MINOR == (minor) && \
     CAIRO_VERSION_MICRO >= (micro)))
 
+MksDebugFlags            mks_get_debug_flags                (void);
+cairo_format_t           mks_pixman_format_to_cairo_format  (guint                     pixman_format);
 gboolean                 mks_socketpair_create              (int                      *us,
                                                              int                      *them,
                                                              GError                  **error);
+void                     mks_listener_connection_clear      (GDBusConnection         **connection);
 gboolean                 mks_scroll_event_is_inverted       (GdkEvent                 *event);
 GType                    mks_socketpair_connection_get_type (void) G_GNUC_CONST;
 MksSocketpairConnection *mks_socketpair_connection_ref      (MksSocketpairConnection  *self);
@@ -23,11 +23,23 @@
 #include <glib/gstdio.h>
 #include <sys/socket.h>
 
+#include <pixman.h>
+
 #include "mks-util-private.h"
 
 static GSettings *mouse_settings;
 static GSettings *touchpad_settings;
 static gsize initialized;
+static gsize debug_initialized;
+static MksDebugFlags debug_flags;
+
+static const GDebugKey debug_keys[] = {
+  { "display-thread", MKS_DEBUG_DISPLAY_THREAD },
+  { "tile-hash", MKS_DEBUG_TILE_HASH },
+  { "frame-stats", MKS_DEBUG_FRAME_STATS },
+  { "pipeline", MKS_DEBUG_PIPELINE },
+  { "dmabuf-cpu", MKS_DEBUG_DMABUF_CPU },
+};
 
 typedef struct
 {
@@ -116,6 +128,57 @@ mks_scroll_event_is_inverted (GdkEvent *event)
     }
 }
 
+/*
+ * mks_get_debug_flags:
+ *
+ * Gets the flags parsed from the `MKS_DEBUG` environment variable.
+ *
+ * These are used to opt into display code paths which are not yet
+ * enabled by default.
+ */
+MksDebugFlags
+mks_get_debug_flags (void)
+{
+  if (g_once_init_enter (&debug_initialized))
+    {
+      debug_flags = g_parse_debug_string (g_getenv ("MKS_DEBUG"),
+                                          debug_keys,
+                                          G_N_ELEMENTS (debug_keys));
+      g_once_init_leave (&debug_initialized, TRUE);
+    }
+
+  return debug_flags;
+}
+
+cairo_format_t
+mks_pixman_format_to_cairo_format (guint pixman_format)
+{
+  switch (pixman_format)
+    {
+#if _CAIRO_CHECK_VERSION(1, 17, 2)
+    case PIXMAN_rgba_float:
+      return CAIRO_FORMAT_RGBA128F;
+    case PIXMAN_rgb_float:
+      return CAIRO_FORMAT_RGB96F;
+#endif
+
+    case PIXMAN_a8r8g8b8:
+      return CAIRO_FORMAT_ARGB32;
+    case PIXMAN_x2r10g10b10:
+      return CAIRO_FORMAT_RGB30;
+    case PIXMAN_x8r8g8b8:
+      return CAIRO_FORMAT_RGB24;
+    case PIXMAN_a8:
+      return CAIRO_FORMAT_A8;
+    case PIXMAN_a1:
+      return CAIRO_FORMAT_A1;
+    case PIXMAN_r5g6b5:
+      return CAIRO_FORMAT_RGB16_565;
+    default:
+      return CAIRO_FORMAT_INVALID;
+    }
+}
+
 gboolean
 mks_socketpair_create (int     *us,
                        int     *them,
@@ -142,6 +205,27 @@ mks_socketpair_create (int     *us,
   return TRUE;
 }
 
+/*
+ * mks_listener_connection_clear:
+ * @connection: a location of a #GDBusConnection, or %NULL
+ *
+ * Closes a peer-to-peer connection used to register console listeners
+ * and clears @connection.
+ *
+ * QEMU has no UnregisterListener, it drops listeners whose connection
+ * goes away, so closing is how a listener is removed.
+ */
+void
+mks_listener_connection_clear (GDBusConnection **connection)
+{
+  g_return_if_fail (connection != NULL);
+
+  if (*connection != NULL)
+    g_dbus_connection_close (*connection, NULL, NULL, NULL);
+
+  g_clear_object (connection);
+}
+
 G_DEFINE_BOXED_TYPE (MksSocketpairConnection,
                      mks_socketpair_connection,
                      mks_socketpair_connection_ref,
@@ -0,0 +1,272 @@
+/* benchmark-blit.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "config.h"
+
+#include <cairo.h>
+#include <glib.h>
+#include <pixman.h>
+
+#include "mks-pixels-private.h"
+
+typedef struct
+{
+  guint width;
+  guint height;
+  guint iterations;
+} BenchSize;
+
+static const BenchSize sizes[] = {
+  {   64,   64, 20000 },
+  {  512,  512,  1000 },
+  { 3840, 2160,    50 },
+};
+
+static double
+bench_cairo (cairo_surface_t *target,
+             cairo_surface_t *source,
+             guint            iterations)
+{
+  gint64 begin = g_get_monotonic_time ();
+
+  for (guint i = 0; i < iterations; i++)
+    {
+      cairo_t *cr = cairo_create (target);
+
+      cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+      cairo_set_source_surface (cr, source, 0, 0);
+      cairo_rectangle (cr, 0, 0,
+                       cairo_image_surface_get_width (source),
+                       cairo_image_surface_get_height (source));
+      cairo_paint (cr);
+      cairo_destroy (cr);
+      cairo_surface_flush (target);
+    }
+
+  return (g_get_monotonic_time () - begin) / (double)iterations;
+}
+
+static double
+bench_rows (cairo_surface_t *target,
+            cairo_surface_t *source,
+            gboolean         opaque,
+            guint            iterations)
+{
+  guint width = cairo_image_surface_get_width (source);
+  guint height = cairo_image_surface_get_height (source);
+  gint64 begin = g_get_monotonic_time ();
+
+  for (guint i = 0; i < iterations; i++)
+    {
+      cairo_surface_flush (target);
+
+      if (opaque)
+        mks_pixels_convert_rows (PIXMAN_x8r8g8b8,
+                                 cairo_image_surface_get_data (target),
+                                 cairo_image_surface_get_stride (target),
+                                 cairo_image_surface_get_data (source),
+                                 cairo_image_surface_get_stride (source),
+                                 width,
+                                 height);
+      else
+        mks_pixels_copy_rows (cairo_image_surface_get_data (target),
+                              cairo_image_surface_get_stride (target),
+                              cairo_image_surface_get_data (source),
+                              cairo_image_surface_get_stride (source),
+                              (gsize)width * 4,
+                              height);
+
+      cairo_surface_mark_dirty (target);
+    }
+
+  return (g_get_monotonic_time () - begin) / (double)iterations;
+}
+
+static void
+run_format (cairo_format_t  format,
+            const char     *name)
+{
+  for (guint i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+      const BenchSize *size = &sizes[i];
+      cairo_surface_t *source;
+      cairo_surface_t *target;
+      double cairo_usec;
+      double rows_usec;
+      double mpix;
+      guint8 *data;
+
+      source = cairo_image_surface_create (format, size->width, size->height);
+      target = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, size->width, size->height);
+
+      /* Fill the source with something other than zeroes */
+      cairo_surface_flush (source);
+      data = cairo_image_surface_get_data (source);
+      for (gsize j = 0; j < (gsize)cairo_image_surface_get_stride (source) * size->height; j++)
+        data[j] = j * 7;
+      cairo_surface_mark_dirty (source);
+
+      cairo_usec = bench_cairo (target, source, size->iterations);
+      rows_usec = bench_rows (target, source, format == CAIRO_FORMAT_RGB24, size->iterations);
+      mpix = size->width * size->height / 1000000.0;
+
+      g_print ("%-6s %4ux%-4u  cairo: %9.2f usec (%7.1f Mpix/s)  %s: %9.2f usec (%7.1f Mpix/s)  %.2fx\n",
+               name,
+               size->width, size->height,
+               cairo_usec, mpix / (cairo_usec / G_USEC_PER_SEC),
+               mks_pixels_get_impl_name (),
+               rows_usec, mpix / (rows_usec / G_USEC_PER_SEC),
+               cairo_usec / rows_usec);
+
+      cairo_surface_destroy (source);
+      cairo_surface_destroy (target);
+    }
+}
+
+static void
+run_convert (pixman_format_code_t  format,
+             const char           *name)
+{
+  for (guint i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+      const BenchSize *size = &sizes[i];
+      gsize src_stride = ((gsize)size->width * PIXMAN_FORMAT_BPP (format) / 8 + 3) & ~(gsize)3;
+      gsize dst_stride = (gsize)size->width * 4;
+      g_autofree guint8 *src = g_malloc (src_stride * size->height);
+      g_autofree guint8 *dst = g_malloc (dst_stride * size->height);
+      gint64 begin;
+      double usec;
+      double mpix;
+
+      for (gsize j = 0; j < src_stride * size->height; j++)
+        src[j] = j * 7;
+
+      begin = g_get_monotonic_time ();
+      for (guint j = 0; j < size->iterations; j++)
+        mks_pixels_convert_rows (format, dst, dst_stride, src, src_stride,
+                                 size->width, size->height);
+      usec = (g_get_monotonic_time () - begin) / (double)size->iterations;
+      mpix = size->width * size->height / 1000000.0;
+
+      g_print ("%-11s %4ux%-4u  %s: %9.2f usec (%7.1f Mpix/s)\n",
+               name,
+               size->width, size->height,
+               mks_pixels_get_impl_name (),
+               usec, mpix / (usec / G_USEC_PER_SEC));
+    }
+}
+
+static void
+run_convert_yuv (MksPixelsYuv  layout,
+                 const char   *name)
+{
+  for (guint i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+      const BenchSize *size = &sizes[i];
+      gsize chroma_width = (size->width + 1) / 2;
+      gsize chroma_height = (size->height + 1) / 2;
+      gsize strides[3] = {
+        size->width,
+        layout == MKS_PIXELS_NV12 ? chroma_width * 2 : chroma_width,
+        chroma_width,
+      };
+      gsize src_size = strides[0] * size->height + (strides[1] + strides[2]) * chroma_height;
+      gsize dst_stride = (gsize)size->width * 4;
+      g_autofree guint8 *src = g_malloc (src_size);
+      g_autofree guint8 *dst = g_malloc (dst_stride * size->height);
+      const guint8 *planes[3];
+      gint64 begin;
+      double usec;
+      double mpix;
+
+      for (gsize j = 0; j < src_size; j++)
+        src[j] = j * 7;
+
+      planes[0] = src;
+      planes[1] = planes[0] + strides[0] * size->height;
+      planes[2] = planes[1] + strides[1] * chroma_height;
+
+      begin = g_get_monotonic_time ();
+      for (guint j = 0; j < size->iterations; j++)
+        mks_pixels_convert_yuv_rows (layout, dst, dst_stride, planes, strides,
+                                     0, 0, size->width, size->height);
+      usec = (g_get_monotonic_time () - begin) / (double)size->iterations;
+      mpix = size->width * size->height / 1000000.0;
+
+      g_print ("%-11s %4ux%-4u  %s: %9.2f usec (%7.1f Mpix/s)\n",
+               name,
+               size->width, size->height,
+               mks_pixels_get_impl_name (),
+               usec, mpix / (usec / G_USEC_PER_SEC));
+    }
+}
+
+static void
+run_flip (void)
+{
+  for (guint i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+      const BenchSize *size = &sizes[i];
+      gsize stride = (gsize)size->width * 4;
+      g_autofree guint8 *pixels = g_malloc0 (stride * size->height);
+      gint64 begin;
+      double usec;
+      double mpix;
+
+      begin = g_get_monotonic_time ();
+      for (guint j = 0; j < size->iterations; j++)
+        mks_pixels_flip_rows (pixels, stride, stride, size->height);
+      usec = (g_get_monotonic_time () - begin) / (double)size->iterations;
+      mpix = size->width * size->height / 1000000.0;
+
+      g_print ("%-11s %4ux%-4u  %s: %9.2f usec (%7.1f Mpix/s)\n",
+               "flip",
+               size->width, size->height,
+               mks_pixels_get_impl_name (),
+               usec, mpix / (usec / G_USEC_PER_SEC));
+    }
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  const char * const *names = mks_pixels_get_impl_names ();
+
+  run_format (CAIRO_FORMAT_ARGB32, "argb32");
+  run_format (CAIRO_FORMAT_RGB24, "xrgb32");
+
+  /* Conversions are reported for every implementation the CPU supports */
+  for (guint i = 0; names[i]; i++)
+    {
+      mks_pixels_set_impl (names[i]);
+
+      run_convert (PIXMAN_x8r8g8b8, "x8r8g8b8");
+      run_convert (PIXMAN_x8b8g8r8, "x8b8g8r8");
+      run_convert (PIXMAN_a8b8g8r8, "a8b8g8r8");
+      run_convert (PIXMAN_x2r10g10b10, "x2r10g10b10");
+      run_convert (PIXMAN_r5g6b5, "r5g6b5");
+      run_convert_yuv (MKS_PIXELS_NV12, "nv12");
+      run_convert_yuv (MKS_PIXELS_I420, "i420");
+      run_flip ();
+    }
+
+  return 0;
+}
@@ -0,0 +1,153 @@
+/* benchmark-damage.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "config.h"
+
+#include <cairo.h>
+#include <glib.h>
+
+#include "mks-damage-private.h"
+
+#define WIDTH       1920
+#define HEIGHT      1080
+#define N_FRAMES    20000
+
+typedef struct
+{
+  const char *name;
+  guint       updates_per_frame;
+  guint       max_size;
+} BenchLoad;
+
+static const BenchLoad loads[] = {
+  { "cursor",    2,   64 },
+  { "typing",    8,   32 },
+  { "scrolling", 32, 512 },
+  { "video",     64, 256 },
+};
+
+static cairo_rectangle_int_t *
+make_updates (const BenchLoad *load)
+{
+  cairo_rectangle_int_t *rects = g_new (cairo_rectangle_int_t, N_FRAMES * load->updates_per_frame);
+  GRand *rand = g_rand_new_with_seed (load->updates_per_frame);
+
+  for (guint i = 0; i < N_FRAMES * load->updates_per_frame; i++)
+    {
+      rects[i].width = g_rand_int_range (rand, 1, load->max_size);
+      rects[i].height = g_rand_int_range (rand, 1, load->max_size);
+      rects[i].x = g_rand_int_range (rand, 0, WIDTH - rects[i].width);
+      rects[i].y = g_rand_int_range (rand, 0, HEIGHT - rects[i].height);
+    }
+
+  g_rand_free (rand);
+
+  return rects;
+}
+
+/* What the paintables used to do: a region per update, unioned into
+ * the accumulated region which is handed to the texture builder.
+ */
+static double
+bench_region (const BenchLoad             *load,
+              const cairo_rectangle_int_t *updates,
+              guint                       *n_rects)
+{
+  gint64 begin = g_get_monotonic_time ();
+
+  *n_rects = 0;
+
+  for (guint i = 0; i < N_FRAMES; i++)
+    {
+      cairo_region_t *accumulated = NULL;
+
+      for (guint j = 0; j < load->updates_per_frame; j++)
+        {
+          cairo_region_t *region = cairo_region_create_rectangle (&updates[i * load->updates_per_frame + j]);
+
+          if (accumulated == NULL)
+            accumulated = cairo_region_copy (region);
+          else
+            cairo_region_union (accumulated, region);
+
+          cairo_region_destroy (region);
+        }
+
+      *n_rects += cairo_region_num_rectangles (accumulated);
+      cairo_region_destroy (accumulated);
+    }
+
+  return (g_get_monotonic_time () - begin) / (double)N_FRAMES;
+}
+
+static double
+bench_damage (const BenchLoad             *load,
+              const cairo_rectangle_int_t *updates,
+              guint                       *n_rects)
+{
+  MksDamage damage;
+  gint64 begin = g_get_monotonic_time ();
+
+  mks_damage_init (&damage);
+  *n_rects = 0;
+
+  for (guint i = 0; i < N_FRAMES; i++)
+    {
+      cairo_region_t *region;
+
+      for (guint j = 0; j < load->updates_per_frame; j++)
+        mks_damage_add (&damage, &updates[i * load->updates_per_frame + j]);
+
+      region = mks_damage_to_region (&damage);
+      *n_rects += cairo_region_num_rectangles (region);
+      cairo_region_destroy (region);
+
+      mks_damage_clear (&damage);
+    }
+
+  return (g_get_monotonic_time () - begin) / (double)N_FRAMES;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  for (guint i = 0; i < G_N_ELEMENTS (loads); i++)
+    {
+      const BenchLoad *load = &loads[i];
+      g_autofree cairo_rectangle_int_t *updates = make_updates (load);
+      guint region_rects;
+      guint damage_rects;
+      double region_usec;
+      double damage_usec;
+
+      region_usec = bench_region (load, updates, &region_rects);
+      damage_usec = bench_damage (load, updates, &damage_rects);
+
+      g_print ("%-10s %2u updates/frame  region: %7.2f usec (%5.1f rects)  damage: %7.2f usec (%5.1f rects)  %.2fx\n",
+               load->name,
+               load->updates_per_frame,
+               region_usec, region_rects / (double)N_FRAMES,
+               damage_usec, damage_rects / (double)N_FRAMES,
+               region_usec / damage_usec);
+    }
+
+  return 0;
+}
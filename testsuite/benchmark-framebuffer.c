@@ -0,0 +1,148 @@
+/* benchmark-framebuffer.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "config.h"
+
+#include <gsk/gsk.h>
+#include <gtk/gtk.h>
+#include <pixman.h>
+
+#include "mks-cairo-framebuffer-private.h"
+
+/* An 8K guest, or a multi-head layout of the same size, which is larger
+ * than the maximum texture size of many GPUs.
+ */
+#define WIDTH    7680
+#define HEIGHT   4320
+
+/* The size of the widget the framebuffer is scaled into */
+#define VIEWPORT_WIDTH  1920
+#define VIEWPORT_HEIGHT 1080
+
+#define N_FRAMES 20
+
+typedef struct
+{
+  const char *name;
+  guint       updates_per_frame;
+  guint       size;
+} BenchLoad;
+
+static const BenchLoad loads[] = {
+  { "cursor",  2,    64 },
+  { "typing",  8,    32 },
+  { "window",  1,  1024 },
+  { "full",    1,     0 },
+};
+
+static double
+bench_load (GskRenderer         *renderer,
+            MksCairoFramebuffer *framebuffer,
+            const BenchLoad     *load,
+            const guint8        *pixels,
+            double              *render_usec)
+{
+  GRand *rand = g_rand_new_with_seed (load->updates_per_frame);
+  gint64 render_time = 0;
+  gint64 begin;
+
+  begin = g_get_monotonic_time ();
+
+  for (guint i = 0; i < N_FRAMES; i++)
+    {
+      g_autoptr(GtkSnapshot) snapshot = gtk_snapshot_new ();
+      g_autoptr(GskRenderNode) node = NULL;
+      g_autoptr(GdkTexture) texture = NULL;
+      gint64 render_begin;
+
+      for (guint j = 0; j < load->updates_per_frame; j++)
+        {
+          guint width = load->size ? load->size : WIDTH;
+          guint height = load->size ? load->size : HEIGHT;
+          guint x = g_rand_int_range (rand, 0, WIDTH - width + 1);
+          guint y = g_rand_int_range (rand, 0, HEIGHT - height + 1);
+
+          mks_cairo_framebuffer_blit (framebuffer, x, y, width, height,
+                                      PIXMAN_x8r8g8b8, pixels, WIDTH * 4);
+        }
+
+      mks_cairo_framebuffer_snapshot (framebuffer, snapshot,
+                                      VIEWPORT_WIDTH, VIEWPORT_HEIGHT,
+                                      0, 0, 1);
+      node = gtk_snapshot_free_to_node (g_steal_pointer (&snapshot));
+
+      render_begin = g_get_monotonic_time ();
+      texture = gsk_renderer_render_texture (renderer, node,
+                                             &GRAPHENE_RECT_INIT (0, 0, VIEWPORT_WIDTH, VIEWPORT_HEIGHT));
+      render_time += g_get_monotonic_time () - render_begin;
+    }
+
+  g_rand_free (rand);
+
+  *render_usec = render_time / (double)N_FRAMES;
+
+  return (g_get_monotonic_time () - begin) / (double)N_FRAMES;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_autoptr(MksCairoFramebuffer) framebuffer = NULL;
+  g_autoptr(GskRenderer) renderer = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree guint8 *pixels = NULL;
+
+  /* Invalidations are emitted directly when we own the main context */
+  g_main_context_acquire (g_main_context_default ());
+
+  /* The cairo renderer runs without a display or GPU and has no maximum
+   * texture size, so the numbers only reflect the cost of tiling.
+   */
+  renderer = gsk_cairo_renderer_new ();
+  if (!gsk_renderer_realize (renderer, NULL, &error))
+    g_error ("Failed to realize renderer: %s", error->message);
+
+  pixels = g_malloc ((gsize)WIDTH * HEIGHT * 4);
+  for (gsize i = 0; i < (gsize)WIDTH * HEIGHT * 4; i++)
+    pixels[i] = i * 7;
+
+  framebuffer = mks_cairo_framebuffer_new (CAIRO_FORMAT_RGB24, WIDTH, HEIGHT);
+
+  for (guint i = 0; i < G_N_ELEMENTS (loads); i++)
+    {
+      const BenchLoad *load = &loads[i];
+      double render_usec;
+      double usec;
+
+      usec = bench_load (renderer, framebuffer, load, pixels, &render_usec);
+
+      g_print ("%ux%u %-7s %u updates/frame  frame: %9.2f usec  render: %9.2f usec\n",
+               WIDTH, HEIGHT,
+               load->name,
+               load->updates_per_frame,
+               usec, render_usec);
+    }
+
+  gsk_renderer_unrealize (renderer);
+  g_main_context_release (g_main_context_default ());
+
+  return 0;
+}
@@ -0,0 +1,141 @@
+/* benchmark-thumbnail.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+#include "config.h"
+
+#include <glib.h>
+#include <pixman.h>
+
+#include "mks-pixels-private.h"
+
+/* The size of a tile in a grid of virtual machines */
+#define TILE_WIDTH  320
+#define TILE_HEIGHT 180
+
+typedef struct
+{
+  guint width;
+  guint height;
+  guint iterations;
+} BenchSize;
+
+static const BenchSize sizes[] = {
+  { 1024,  768, 200 },
+  { 1920, 1080, 100 },
+  { 3840, 2160,  25 },
+};
+
+/* Area changed by a typical Update, such as a blinking cursor or a
+ * line of text being typed.
+ */
+#define DAMAGE_SIZE 64
+
+static void
+fit (guint  width,
+     guint  height,
+     guint *tile_width,
+     guint *tile_height)
+{
+  double scale = MIN (1., MIN ((double)TILE_WIDTH / width, (double)TILE_HEIGHT / height));
+
+  *tile_width = MAX (1, (guint)(width * scale));
+  *tile_height = MAX (1, (guint)(height * scale));
+}
+
+static void
+run_format (pixman_format_code_t  format,
+            const char           *name)
+{
+  for (guint i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+      const BenchSize *size = &sizes[i];
+      gsize src_stride = (gsize)size->width * PIXMAN_FORMAT_BPP (format) / 8;
+      g_autofree guint8 *src = g_malloc (src_stride * size->height);
+      g_autofree guint8 *dst = NULL;
+      guint dst_width;
+      guint dst_height;
+      gsize dst_stride;
+      gsize resident;
+      gint64 begin;
+      double full_usec;
+      double damage_usec;
+      double mpix;
+
+      fit (size->width, size->height, &dst_width, &dst_height);
+      dst_stride = (gsize)dst_width * 4;
+      dst = g_malloc (dst_stride * dst_height);
+
+      for (gsize j = 0; j < src_stride * size->height; j++)
+        src[j] = j * 7;
+
+      begin = g_get_monotonic_time ();
+      for (guint j = 0; j < size->iterations; j++)
+        mks_pixels_downsample (format,
+                               dst, dst_stride, dst_width, dst_height,
+                               src, src_stride, size->width, size->height,
+                               0, 0, size->width, size->height);
+      full_usec = (g_get_monotonic_time () - begin) / (double)size->iterations;
+
+      begin = g_get_monotonic_time ();
+      for (guint j = 0; j < size->iterations * 100; j++)
+        {
+          guint x = (j * 131) % (size->width - DAMAGE_SIZE);
+          guint y = (j * 71) % (size->height - DAMAGE_SIZE);
+          guint width = DAMAGE_SIZE;
+          guint height = DAMAGE_SIZE;
+
+          mks_pixels_downsample_align (size->width, dst_width, &x, &width);
+          mks_pixels_downsample_align (size->height, dst_height, &y, &height);
+          mks_pixels_downsample (format,
+                                 dst, dst_stride, dst_width, dst_height,
+                                 src + y * src_stride + x * PIXMAN_FORMAT_BPP (format) / 8,
+                                 src_stride, size->width, size->height,
+                                 x, y, width, height);
+        }
+      damage_usec = (g_get_monotonic_time () - begin) / (double)(size->iterations * 100);
+
+      /* The thumbnail keeps its pixels plus the texture last handed to
+       * GTK, compared to a full framebuffer for an attached paintable.
+       */
+      resident = 2 * dst_stride * dst_height;
+      mpix = size->width * size->height / 1000000.0;
+
+      g_print ("%-11s %4ux%-4u -> %3ux%-3u  %s: full %8.2f usec (%7.1f Mpix/s)  %dx%d damage %6.2f usec  "
+               "resident %4" G_GSIZE_FORMAT " KiB (full frame %5" G_GSIZE_FORMAT " KiB)\n",
+               name,
+               size->width, size->height,
+               dst_width, dst_height,
+               mks_pixels_get_impl_name (),
+               full_usec, mpix / (full_usec / G_USEC_PER_SEC),
+               DAMAGE_SIZE, DAMAGE_SIZE, damage_usec,
+               resident / 1024,
+               (gsize)size->width * 4 * size->height / 1024);
+    }
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  run_format (PIXMAN_a8r8g8b8, "a8r8g8b8");
+  run_format (PIXMAN_x8b8g8r8, "x8b8g8r8");
+  run_format (PIXMAN_r5g6b5, "r5g6b5");
+
+  return 0;
+}
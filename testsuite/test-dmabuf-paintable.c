@@ -0,0 +1,326 @@
+/* test-dmabuf-paintable.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "config.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <linux/udmabuf.h>
+
+#include <gtk/gtk.h>
+
+#include "mks-dmabuf-paintable-private.h"
+
+#define DRM_FORMAT_XRGB8888 0x34325258
+#define DRM_FORMAT_NV12     0x3231564e
+
+#define WIDTH  64
+#define HEIGHT 32
+#define STRIDE (WIDTH * 4)
+#define SIZE   (STRIDE * HEIGHT)
+
+typedef struct
+{
+  guint32 *pixels;
+  int      memfd;
+  int      fd;
+} TestBuffer;
+
+/* Uses udmabuf to get a real DMA-BUF when the kernel provides it and
+ * otherwise the memfd itself, which mmap()s the same way.
+ */
+static void
+test_buffer_init (TestBuffer *buffer)
+{
+  struct udmabuf_create create = {0};
+  int dev;
+
+  buffer->memfd = memfd_create ("test-dmabuf", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  g_assert_cmpint (buffer->memfd, >, -1);
+  g_assert_cmpint (ftruncate (buffer->memfd, SIZE), ==, 0);
+  g_assert_cmpint (fcntl (buffer->memfd, F_ADD_SEALS, F_SEAL_SHRINK), ==, 0);
+
+  buffer->pixels = mmap (NULL, SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, buffer->memfd, 0);
+  g_assert_true (buffer->pixels != MAP_FAILED);
+
+  buffer->fd = -1;
+
+  if (-1 != (dev = open ("/dev/udmabuf", O_RDWR | O_CLOEXEC)))
+    {
+      create.memfd = buffer->memfd;
+      create.flags = UDMABUF_FLAGS_CLOEXEC;
+      create.size = SIZE;
+      buffer->fd = ioctl (dev, UDMABUF_CREATE, &create);
+      close (dev);
+    }
+
+  if (buffer->fd == -1)
+    buffer->fd = dup (buffer->memfd);
+
+  g_assert_cmpint (buffer->fd, >, -1);
+}
+
+static void
+test_buffer_clear (TestBuffer *buffer)
+{
+  munmap (buffer->pixels, SIZE);
+  close (buffer->fd);
+  close (buffer->memfd);
+}
+
+static void
+test_buffer_fill (TestBuffer *buffer,
+                  guint32     seed)
+{
+  /* The X channel is left random, it must read back as opaque */
+  for (guint i = 0; i < WIDTH * HEIGHT; i++)
+    buffer->pixels[i] = (i * 0x010203) ^ seed;
+}
+
+static GdkTexture *
+snapshot_texture (GdkPaintable *paintable)
+{
+  GtkSnapshot *snapshot = gtk_snapshot_new ();
+  g_autoptr(GskRenderNode) node = NULL;
+  GskRenderNode *child;
+
+  gdk_paintable_snapshot (paintable, GDK_SNAPSHOT (snapshot), WIDTH, HEIGHT);
+  node = gtk_snapshot_free_to_node (snapshot);
+  g_assert_nonnull (node);
+
+  for (child = node;
+       gsk_render_node_get_node_type (child) == GSK_CLIP_NODE;
+       child = gsk_clip_node_get_child (child)) {}
+
+  g_assert_cmpint (gsk_render_node_get_node_type (child), ==, GSK_TEXTURE_NODE);
+
+  return g_object_ref (gsk_texture_node_get_texture (child));
+}
+
+static guint32
+expected_pixel (guint32 xrgb)
+{
+  return xrgb | 0xff000000;
+}
+
+static void
+test_dmabuf_paintable_cpu (void)
+{
+  g_autoptr(MksDmabufPaintable) paintable = NULL;
+  g_autoptr(GdkTexture) texture = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree guint32 *first = NULL;
+  g_autofree guint32 *pixels = NULL;
+  cairo_rectangle_int_t area = { 8, 4, 16, 8 };
+  MksDmabufScanoutData data = {0};
+  TestBuffer buffer;
+
+  test_buffer_init (&buffer);
+  test_buffer_fill (&buffer, 0);
+  first = g_memdup2 (buffer.pixels, SIZE);
+  pixels = g_new0 (guint32, WIDTH * HEIGHT);
+
+  data.width = data.backing_width = WIDTH;
+  data.height = data.backing_height = HEIGHT;
+  data.n_planes = 1;
+  data.fourcc = DRM_FORMAT_XRGB8888;
+  data.stride[0] = STRIDE;
+  data.dmabuf_fd[0] = buffer.fd;
+  data.generation = 1;
+
+  /* Without a display there is nothing to import into */
+  paintable = mks_dmabuf_paintable_new ();
+  g_assert_true (mks_dmabuf_paintable_import (paintable, NULL, &data, NULL, &error));
+  g_assert_no_error (error);
+  g_assert_cmpint (mks_dmabuf_paintable_get_path (paintable), ==, MKS_DMABUF_PATH_CPU);
+
+  texture = snapshot_texture (GDK_PAINTABLE (paintable));
+  g_assert_true (GDK_IS_MEMORY_TEXTURE (texture));
+  g_assert_cmpint (gdk_texture_get_width (texture), ==, WIDTH);
+  g_assert_cmpint (gdk_texture_get_height (texture), ==, HEIGHT);
+
+  gdk_texture_download (texture, (guint8 *)pixels, STRIDE);
+  for (guint i = 0; i < WIDTH * HEIGHT; i++)
+    g_assert_cmphex (pixels[i], ==, expected_pixel (first[i]));
+
+  /* Only the damaged area is read again */
+  test_buffer_fill (&buffer, 0x00ffffff);
+  g_assert_true (mks_dmabuf_paintable_import (paintable, NULL, &data, &area, &error));
+  g_assert_no_error (error);
+
+  g_clear_object (&texture);
+  texture = snapshot_texture (GDK_PAINTABLE (paintable));
+  gdk_texture_download (texture, (guint8 *)pixels, STRIDE);
+
+  for (guint y = 0; y < HEIGHT; y++)
+    {
+      for (guint x = 0; x < WIDTH; x++)
+        {
+          guint i = y * WIDTH + x;
+          gboolean damaged = x >= (guint)area.x && x < (guint)(area.x + area.width) &&
+                             y >= (guint)area.y && y < (guint)(area.y + area.height);
+
+          if (damaged)
+            g_assert_cmphex (pixels[i], ==, expected_pixel (buffer.pixels[i]));
+          else
+            g_assert_cmphex (pixels[i], ==, expected_pixel (first[i]));
+        }
+    }
+
+  test_buffer_clear (&buffer);
+}
+
+/* Fills @area of an NV12 frame which is WIDTH bytes wide per plane */
+static void
+fill_nv12 (guint8                      *pixels,
+           const cairo_rectangle_int_t *area,
+           guint8                       y,
+           guint8                       u,
+           guint8                       v)
+{
+  guint8 *uv = pixels + WIDTH * HEIGHT;
+
+  for (int row = area->y; row < area->y + area->height; row++)
+    memset (&pixels[row * WIDTH + area->x], y, area->width);
+
+  for (int row = area->y / 2; row < (area->y + area->height) / 2; row++)
+    {
+      for (int col = area->x / 2; col < (area->x + area->width) / 2; col++)
+        {
+          uv[row * WIDTH + col * 2] = u;
+          uv[row * WIDTH + col * 2 + 1] = v;
+        }
+    }
+}
+
+static void
+test_dmabuf_paintable_nv12 (void)
+{
+  g_autoptr(MksDmabufPaintable) paintable = NULL;
+  g_autoptr(GdkTexture) texture = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree guint32 *pixels = NULL;
+  cairo_rectangle_int_t area = { 8, 4, 16, 8 };
+  MksDmabufScanoutData data = {0};
+  TestBuffer buffer;
+
+  test_buffer_init (&buffer);
+  pixels = g_new0 (guint32, WIDTH * HEIGHT);
+
+  /* Both planes share the buffer, as they do for most guest drivers */
+  data.width = data.backing_width = WIDTH;
+  data.height = data.backing_height = HEIGHT;
+  data.n_planes = 2;
+  data.fourcc = DRM_FORMAT_NV12;
+  data.stride[0] = data.stride[1] = WIDTH;
+  data.offset[1] = WIDTH * HEIGHT;
+  data.dmabuf_fd[0] = data.dmabuf_fd[1] = buffer.fd;
+  data.generation = 1;
+
+  /* White */
+  fill_nv12 ((guint8 *)buffer.pixels,
+             &(cairo_rectangle_int_t) { 0, 0, WIDTH, HEIGHT },
+             235, 128, 128);
+
+  paintable = mks_dmabuf_paintable_new ();
+  g_assert_true (mks_dmabuf_paintable_import (paintable, NULL, &data, NULL, &error));
+  g_assert_no_error (error);
+
+  texture = snapshot_texture (GDK_PAINTABLE (paintable));
+  gdk_texture_download (texture, (guint8 *)pixels, STRIDE);
+  for (guint i = 0; i < WIDTH * HEIGHT; i++)
+    g_assert_cmphex (pixels[i], ==, 0xffffffff);
+
+  /* Red, converted only within the damaged area */
+  fill_nv12 ((guint8 *)buffer.pixels, &area, 81, 90, 240);
+  g_assert_true (mks_dmabuf_paintable_import (paintable, NULL, &data, &area, &error));
+  g_assert_no_error (error);
+
+  g_clear_object (&texture);
+  texture = snapshot_texture (GDK_PAINTABLE (paintable));
+  gdk_texture_download (texture, (guint8 *)pixels, STRIDE);
+
+  for (guint y = 0; y < HEIGHT; y++)
+    {
+      for (guint x = 0; x < WIDTH; x++)
+        {
+          gboolean damaged = x >= (guint)area.x && x < (guint)(area.x + area.width) &&
+                             y >= (guint)area.y && y < (guint)(area.y + area.height);
+
+          g_assert_cmphex (pixels[y * WIDTH + x], ==, damaged ? 0xffff0000 : 0xffffffff);
+        }
+    }
+
+  test_buffer_clear (&buffer);
+}
+
+static void
+test_dmabuf_paintable_tiled (void)
+{
+  g_autoptr(MksDmabufPaintable) paintable = NULL;
+  g_autoptr(GError) error = NULL;
+  MksDmabufScanoutData data = {0};
+  GtkSnapshot *snapshot;
+  TestBuffer buffer;
+
+  if (g_test_subprocess ())
+    {
+      test_buffer_init (&buffer);
+
+      data.width = data.backing_width = WIDTH;
+      data.height = data.backing_height = HEIGHT;
+      data.n_planes = 1;
+      data.fourcc = DRM_FORMAT_XRGB8888;
+      data.modifier = 1;
+      data.stride[0] = STRIDE;
+      data.dmabuf_fd[0] = buffer.fd;
+      data.generation = 1;
+
+      paintable = mks_dmabuf_paintable_new ();
+      g_assert_true (mks_dmabuf_paintable_import (paintable, NULL, &data, NULL, &error));
+
+      snapshot = gtk_snapshot_new ();
+      gdk_paintable_snapshot (GDK_PAINTABLE (paintable), GDK_SNAPSHOT (snapshot), WIDTH, HEIGHT);
+      g_clear_pointer (&snapshot, gtk_snapshot_free);
+
+      test_buffer_clear (&buffer);
+      return;
+    }
+
+  /* Tiled buffers cannot be read without the GPU */
+  g_test_trap_subprocess (NULL, 0, G_TEST_SUBPROCESS_DEFAULT);
+  g_test_trap_assert_failed ();
+  g_test_trap_assert_stderr ("*Failed to build texture*Cannot read DMA-BUF*");
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  g_test_add_func ("/Mks/DmabufPaintable/cpu", test_dmabuf_paintable_cpu);
+  g_test_add_func ("/Mks/DmabufPaintable/nv12", test_dmabuf_paintable_nv12);
+  g_test_add_func ("/Mks/DmabufPaintable/tiled", test_dmabuf_paintable_tiled);
+  return g_test_run ();
+}
@@ -18,11 +18,17 @@
  * SPDX-License-Identifier: LGPL-2.1-or-later
  */
 
+#include <string.h>
+#include <sys/socket.h>
+
 #include <libmks.h>
+#include <pixman.h>
 
 #include "lib/mks-screen-private.h"
 #include "lib/mks-transport-private.h"
 
+#include "mks-test-display1.h"
+
 typedef struct _MksTestTransport      MksTestTransport;
 typedef struct _MksTestTransportClass MksTestTransportClass;
 
@@ -182,19 +188,19 @@ mks_test_screen_set_size (MksScreen *screen,
 }
 
 static void
-mks_test_screen_mark_active (MksScreen *screen)
+mks_test_screen_mark_active_at (MksScreen *screen,
+                                gint64     now)
 {
-  gint64 now;
-
   g_assert (MKS_IS_SCREEN (screen));
 
-  now = g_get_monotonic_time ();
+  if (_mks_screen_advance_last_active_time (screen, now))
+    g_object_notify (G_OBJECT (screen), "last-active-time");
+}
 
-  if (screen->last_active_time != now)
-    {
-      screen->last_active_time = now;
-      g_object_notify (G_OBJECT (screen), "last-active-time");
-    }
+static void
+mks_test_screen_mark_active (MksScreen *screen)
+{
+  mks_test_screen_mark_active_at (screen, g_get_monotonic_time ());
 }
 
 static void
@@ -261,6 +267,366 @@ mks_test_screen_new (MksScreenKind  kind,
   return MKS_SCREEN (self);
 }
 
+typedef struct _MksTestQemu      MksTestQemu;
+typedef struct _MksTestQemuClass MksTestQemuClass;
+
+#define MKS_TYPE_TEST_QEMU (mks_test_qemu_get_type())
+
+GType mks_test_qemu_get_type (void);
+
+/* Stands in for QEMU with a single graphic console, exported on a
+ * peer-to-peer connection like with `-display dbus,p2p=yes`. Like QEMU,
+ * each listener registered with RegisterListener is sent a Scanout of
+ * the current contents once connected, and again for every frame, until
+ * its connection is closed.
+ */
+struct _MksTestQemu
+{
+  GObject parent_instance;
+
+  GDBusConnection          *connection;
+  GDBusObjectManagerServer *manager;
+  MksTestDisplayConsole    *console;
+
+  /* Connections to the registered listeners */
+  GPtrArray *listeners;
+  guint n_registered;
+  guint n_connecting;
+  guint n_pending;
+
+  guint width;
+  guint height;
+  guint pixman_format;
+  guint frame;
+  gsize bytes_sent;
+
+  /* The first error returned by a listener */
+  GError *rejected;
+};
+
+struct _MksTestQemuClass
+{
+  GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE (MksTestQemu, mks_test_qemu, G_TYPE_OBJECT)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MksTestQemu, g_object_unref)
+
+static void
+mks_test_qemu_scanout_cb (GObject      *object,
+                          GAsyncResult *result,
+                          gpointer      user_data)
+{
+  g_autoptr(MksTestQemu) self = user_data;
+  g_autoptr(GVariant) reply = NULL;
+  g_autoptr(GError) error = NULL;
+
+  g_assert (self->n_pending > 0);
+
+  self->n_pending--;
+
+  /* Listeners closed while the call was in flight are not an error */
+  if (!(reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (object), result, &error)) &&
+      g_dbus_error_is_remote_error (error) &&
+      self->rejected == NULL)
+    self->rejected = g_steal_pointer (&error);
+}
+
+static void
+mks_test_qemu_scanout (MksTestQemu     *self,
+                       GDBusConnection *listener)
+{
+  guint stride = self->width * 4;
+  gsize size = (gsize)stride * self->height;
+  guint8 *data = g_malloc (size);
+
+  memset (data, self->frame, size);
+
+  self->n_pending++;
+  self->bytes_sent += size;
+
+  g_dbus_connection_call (listener,
+                          NULL,
+                          "/org/qemu/Display1/Listener",
+                          "org.qemu.Display1.Listener",
+                          "Scanout",
+                          g_variant_new ("(uuuu@ay)",
+                                         self->width,
+                                         self->height,
+                                         stride,
+                                         self->pixman_format,
+                                         g_variant_new_from_data (G_VARIANT_TYPE_BYTESTRING,
+                                                                  data, size, TRUE,
+                                                                  g_free, data)),
+                          G_VARIANT_TYPE ("()"),
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1,
+                          NULL,
+                          mks_test_qemu_scanout_cb,
+                          g_object_ref (self));
+}
+
+static void
+mks_test_qemu_send_frame (MksTestQemu *self)
+{
+  self->frame++;
+
+  for (guint i = 0; i < self->listeners->len; i++)
+    mks_test_qemu_scanout (self, g_ptr_array_index (self->listeners, i));
+}
+
+static void
+mks_test_qemu_listener_closed_cb (MksTestQemu     *self,
+                                  gboolean         remote_peer_vanished,
+                                  GError          *error,
+                                  GDBusConnection *connection)
+{
+  g_ptr_array_remove (self->listeners, connection);
+}
+
+static void
+mks_test_qemu_listener_connected_cb (GObject      *object,
+                                     GAsyncResult *result,
+                                     gpointer      user_data)
+{
+  g_autoptr(MksTestQemu) self = user_data;
+  g_autoptr(GDBusConnection) connection = NULL;
+
+  g_assert (self->n_connecting > 0);
+
+  self->n_connecting--;
+
+  /* The listener may have gone away before it was connected */
+  if (!(connection = g_dbus_connection_new_finish (result, NULL)) ||
+      g_dbus_connection_is_closed (connection))
+    return;
+
+  g_signal_connect_object (connection,
+                           "closed",
+                           G_CALLBACK (mks_test_qemu_listener_closed_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+  g_ptr_array_add (self->listeners, g_object_ref (connection));
+
+  mks_test_qemu_scanout (self, connection);
+}
+
+static gboolean
+mks_test_qemu_handle_register_listener (MksTestQemu           *self,
+                                        GDBusMethodInvocation *invocation,
+                                        GUnixFDList           *fd_list,
+                                        GVariant              *listener,
+                                        MksTestDisplayConsole *console)
+{
+  g_autoptr(GSocketConnection) stream = NULL;
+  g_autoptr(GSocket) socket = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree char *guid = g_dbus_generate_guid ();
+  int fd;
+
+  fd = g_unix_fd_list_get (fd_list, g_variant_get_handle (listener), &error);
+  g_assert_no_error (error);
+
+  socket = g_socket_new_from_fd (fd, &error);
+  g_assert_no_error (error);
+
+  stream = g_socket_connection_factory_create_connection (socket);
+
+  self->n_registered++;
+  self->n_connecting++;
+
+  g_dbus_connection_new (G_IO_STREAM (stream),
+                         guid,
+                         G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_SERVER,
+                         NULL,
+                         NULL,
+                         mks_test_qemu_listener_connected_cb,
+                         g_object_ref (self));
+
+  mks_test_display_console_complete_register_listener (console, invocation, NULL);
+
+  return TRUE;
+}
+
+static void
+mks_test_qemu_finalize (GObject *object)
+{
+  MksTestQemu *self = (MksTestQemu *)object;
+
+  for (guint i = 0; i < self->listeners->len; i++)
+    g_dbus_connection_close (g_ptr_array_index (self->listeners, i), NULL, NULL, NULL);
+
+  if (self->connection != NULL)
+    g_dbus_connection_close (self->connection, NULL, NULL, NULL);
+
+  g_clear_pointer (&self->listeners, g_ptr_array_unref);
+  g_clear_object (&self->connection);
+  g_clear_object (&self->manager);
+  g_clear_object (&self->console);
+  g_clear_error (&self->rejected);
+
+  G_OBJECT_CLASS (mks_test_qemu_parent_class)->finalize (object);
+}
+
+static void
+mks_test_qemu_class_init (MksTestQemuClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = mks_test_qemu_finalize;
+}
+
+static void
+mks_test_qemu_init (MksTestQemu *self)
+{
+  self->listeners = g_ptr_array_new_with_free_func (g_object_unref);
+}
+
+static MksTestQemu *
+mks_test_qemu_new (guint width,
+                   guint height,
+                   guint pixman_format)
+{
+  g_autoptr(MksTestDisplayObjectSkeleton) object = NULL;
+  g_autoptr(MksTestDisplayKeyboard) keyboard = NULL;
+  g_autoptr(MksTestDisplayMouse) mouse = NULL;
+  MksTestQemu *self;
+
+  self = g_object_new (MKS_TYPE_TEST_QEMU, NULL);
+  self->width = width;
+  self->height = height;
+  self->pixman_format = pixman_format;
+
+  self->console = mks_test_display_console_skeleton_new ();
+  mks_test_display_console_set_label (self->console, "VGA");
+  mks_test_display_console_set_head (self->console, 0);
+  mks_test_display_console_set_type_ (self->console, "Graphic");
+  mks_test_display_console_set_width (self->console, width);
+  mks_test_display_console_set_height (self->console, height);
+  mks_test_display_console_set_device_address (self->console, "pci/0000/02.0");
+  g_signal_connect_object (self->console,
+                           "handle-register-listener",
+                           G_CALLBACK (mks_test_qemu_handle_register_listener),
+                           self,
+                           G_CONNECT_SWAPPED);
+
+  /* Screens are only created for consoles with a keyboard and mouse */
+  keyboard = mks_test_display_keyboard_skeleton_new ();
+  mouse = mks_test_display_mouse_skeleton_new ();
+
+  object = mks_test_display_object_skeleton_new ("/org/qemu/Display1/Console_0");
+  mks_test_display_object_skeleton_set_console (object, self->console);
+  mks_test_display_object_skeleton_set_keyboard (object, keyboard);
+  mks_test_display_object_skeleton_set_mouse (object, mouse);
+
+  self->manager = g_dbus_object_manager_server_new ("/org/qemu/Display1");
+  g_dbus_object_manager_server_export (self->manager, G_DBUS_OBJECT_SKELETON (object));
+
+  return self;
+}
+
+static void
+mks_test_qemu_connected_cb (GObject      *object,
+                            GAsyncResult *result,
+                            gpointer      user_data)
+{
+  GDBusConnection **connection = user_data;
+  g_autoptr(GError) error = NULL;
+
+  *connection = g_dbus_connection_new_finish (result, &error);
+  g_assert_no_error (error);
+}
+
+static void
+mks_test_qemu_open (int                   fd,
+                    GDBusConnectionFlags  flags,
+                    GDBusConnection     **connection)
+{
+  g_autoptr(GSocketConnection) stream = NULL;
+  g_autoptr(GSocket) socket = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree char *guid = NULL;
+
+  socket = g_socket_new_from_fd (fd, &error);
+  g_assert_no_error (error);
+
+  stream = g_socket_connection_factory_create_connection (socket);
+
+  if (flags & G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_SERVER)
+    guid = g_dbus_generate_guid ();
+
+  g_dbus_connection_new (G_IO_STREAM (stream),
+                         guid,
+                         flags,
+                         NULL,
+                         NULL,
+                         mks_test_qemu_connected_cb,
+                         connection);
+}
+
+static GObject *
+await_object (DexFuture *future)
+{
+  g_autoptr(GError) error = NULL;
+  const GValue *value;
+
+  while (dex_future_is_pending (future))
+    g_main_context_iteration (NULL, TRUE);
+
+  value = dex_future_get_value (future, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (value);
+
+  return g_value_dup_object (value);
+}
+
+/* Creates a session for @self and returns its screen */
+static MksScreen *
+mks_test_qemu_connect (MksTestQemu  *self,
+                       MksSession  **session)
+{
+  g_autoptr(GDBusConnection) connection = NULL;
+  g_autoptr(MksTransport) transport = NULL;
+  g_autoptr(DexFuture) future = NULL;
+  g_autoptr(GListModel) screens = NULL;
+  int fds[2];
+
+  g_assert_null (self->connection);
+  g_assert_cmpint (socketpair (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds), ==, 0);
+
+  mks_test_qemu_open (fds[0], G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_SERVER, &self->connection);
+  mks_test_qemu_open (fds[1], G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT, &connection);
+
+  while (self->connection == NULL || connection == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_dbus_object_manager_server_set_connection (self->manager, self->connection);
+
+  transport = mks_dbus_transport_new (connection, NULL);
+  future = mks_session_new (transport);
+  *session = MKS_SESSION (await_object (future));
+
+  screens = mks_session_list_screens (*session);
+  g_assert_cmpuint (g_list_model_get_n_items (screens), ==, 1);
+
+  return g_list_model_get_item (screens, 0);
+}
+
+/* Waits for every registration and call to complete, and for the number
+ * of connected listeners to settle at @n_listeners.
+ */
+static void
+mks_test_qemu_wait (MksTestQemu *self,
+                    guint        n_registered,
+                    guint        n_listeners)
+{
+  while (self->n_registered != n_registered ||
+         self->n_connecting > 0 ||
+         self->n_pending > 0 ||
+         self->listeners->len != n_listeners)
+    g_main_context_iteration (NULL, TRUE);
+}
+
 static void
 test_mks_session_list_devices (void)
 {
@@ -441,6 +807,275 @@ test_mks_session_primary_screen_waits_for_settled_graphic_activity (void)
   g_assert_true (primary == virtio);
 }
 
+static void
+count_notify_cb (GObject    *object,
+                 GParamSpec *pspec,
+                 guint      *count)
+{
+  (*count)++;
+}
+
+static void
+test_mks_screen_activity_epoch (void)
+{
+  g_autoptr(MksScreen) screen = NULL;
+  gint64 t0 = g_get_monotonic_time ();
+  guint count = 0;
+
+  screen = mks_test_screen_new (MKS_SCREEN_KIND_GRAPHIC, 1024, 768, 0, "pci.0");
+  g_signal_connect (screen,
+                    "notify::last-active-time",
+                    G_CALLBACK (count_notify_cb),
+                    &count);
+
+  mks_test_screen_mark_active_at (screen, t0);
+  g_assert_cmpuint (count, ==, 1);
+  g_assert_cmpint (mks_screen_get_last_active_time (screen), ==, t0);
+
+  /* Every frame within the epoch is coalesced into the first one */
+  for (guint i = 1; i < 15; i++)
+    mks_test_screen_mark_active_at (screen, t0 + i * 16 * G_TIME_SPAN_MILLISECOND);
+  g_assert_cmpuint (count, ==, 1);
+  g_assert_cmpint (mks_screen_get_last_active_time (screen), ==, t0);
+
+  mks_test_screen_mark_active_at (screen, t0 + MKS_SCREEN_ACTIVITY_EPOCH);
+  g_assert_cmpuint (count, ==, 2);
+  g_assert_cmpint (mks_screen_get_last_active_time (screen), ==, t0 + MKS_SCREEN_ACTIVITY_EPOCH);
+}
+
+static void
+test_mks_session_primary_screen_hysteresis (void)
+{
+  g_autoptr(MksTransport) transport = NULL;
+  g_autoptr(MksSession) session = NULL;
+  g_autoptr(MksScreen) head_0 = NULL;
+  g_autoptr(MksScreen) head_1 = NULL;
+  g_autoptr(MksScreen) primary = NULL;
+  gint64 t0 = g_get_monotonic_time ();
+  guint changes = 0;
+
+  session = mks_test_session_new (&transport);
+  head_0 = mks_test_screen_new (MKS_SCREEN_KIND_GRAPHIC, 1024, 768, 0, "pci.0");
+  head_1 = mks_test_screen_new (MKS_SCREEN_KIND_GRAPHIC, 1024, 768, 1, "pci.1");
+
+  mks_test_transport_emit_device_added (transport, MKS_DEVICE (head_0));
+  mks_test_transport_emit_device_added (transport, MKS_DEVICE (head_1));
+
+  mks_test_screen_mark_active_at (head_0, t0);
+
+  primary = mks_session_dup_primary_screen (session);
+  g_assert_true (primary == head_0);
+
+  g_signal_connect (session,
+                    "notify::primary-screen",
+                    G_CALLBACK (count_notify_cb),
+                    &changes);
+
+  /* Both screens updating continuously must not flip the primary screen
+   * back and forth on every activity epoch.
+   */
+  for (guint i = 1; i <= 8; i++)
+    {
+      gint64 now = t0 + i * MKS_SCREEN_ACTIVITY_EPOCH;
+
+      mks_test_screen_mark_active_at (head_1, now);
+      mks_test_screen_mark_active_at (head_0, now);
+    }
+
+  g_assert_cmpuint (changes, ==, 0);
+  g_clear_object (&primary);
+  primary = mks_session_dup_primary_screen (session);
+  g_assert_true (primary == head_0);
+
+  /* Once the primary screen goes idle, the busy one takes over */
+  for (guint i = 9; i <= 16; i++)
+    mks_test_screen_mark_active_at (head_1, t0 + i * MKS_SCREEN_ACTIVITY_EPOCH);
+
+  g_assert_cmpuint (changes, ==, 1);
+  g_clear_object (&primary);
+  primary = mks_session_dup_primary_screen (session);
+  g_assert_true (primary == head_1);
+}
+
+static GdkPaintable *
+attach_sync (MksScreen  *screen,
+             GdkDisplay *display)
+{
+  g_autoptr(DexFuture) future = mks_screen_attach (screen, display);
+
+  return GDK_PAINTABLE (await_object (future));
+}
+
+static void
+test_mks_screen_attach_shared (void)
+{
+  g_autoptr(MksTestQemu) qemu = NULL;
+  g_autoptr(MksSession) session = NULL;
+  g_autoptr(MksScreen) screen = NULL;
+  g_autoptr(GdkPaintable) main_view = NULL;
+  g_autoptr(GdkPaintable) preview = NULL;
+  g_autoptr(GdkPaintable) reattached = NULL;
+  GdkDisplay *display;
+  gsize frame_size = 64 * 48 * 4;
+
+  if (!gtk_init_check () || !(display = gdk_display_get_default ()))
+    {
+      g_test_skip ("No display available");
+      return;
+    }
+
+  qemu = mks_test_qemu_new (64, 48, PIXMAN_x8r8g8b8);
+  screen = mks_test_qemu_connect (qemu, &session);
+
+  /* Until attached, the screen registers a listener to track activity */
+  mks_test_qemu_wait (qemu, 1, 1);
+  g_assert_cmpuint (qemu->bytes_sent, ==, frame_size);
+
+  /* A second viewer of the same screen shares the listener, which
+   * replaces the activity listener.
+   */
+  main_view = attach_sync (screen, display);
+  preview = attach_sync (screen, display);
+  g_assert_true (main_view == preview);
+  mks_test_qemu_wait (qemu, 2, 1);
+  g_assert_cmpuint (qemu->bytes_sent, ==, frame_size * 2);
+
+  mks_test_qemu_send_frame (qemu);
+  mks_test_qemu_wait (qemu, 2, 1);
+  g_assert_cmpuint (qemu->bytes_sent, ==, frame_size * 3);
+
+  /* The listener stays registered until the last viewer is gone */
+  g_clear_object (&main_view);
+  mks_test_qemu_send_frame (qemu);
+  mks_test_qemu_wait (qemu, 2, 1);
+  g_assert_cmpuint (qemu->bytes_sent, ==, frame_size * 4);
+
+  /* Then its connection is closed and activity is tracked again */
+  g_clear_object (&preview);
+  mks_test_qemu_wait (qemu, 3, 1);
+  g_assert_cmpuint (qemu->bytes_sent, ==, frame_size * 5);
+
+  reattached = attach_sync (screen, display);
+  mks_test_qemu_wait (qemu, 4, 1);
+  g_assert_cmpuint (qemu->bytes_sent, ==, frame_size * 6);
+  g_assert_no_error (qemu->rejected);
+}
+
+static void
+test_mks_paintable_scanout_argb (void)
+{
+  g_autoptr(MksTestQemu) qemu = NULL;
+  g_autoptr(MksSession) session = NULL;
+  g_autoptr(MksScreen) screen = NULL;
+  g_autoptr(GdkPaintable) paintable = NULL;
+  GdkDisplay *display;
+
+  if (!gtk_init_check () || !(display = gdk_display_get_default ()))
+    {
+      g_test_skip ("No display available");
+      return;
+    }
+
+  /* CAIRO_FORMAT_ARGB32 is zero, so it must not be taken for a failed
+   * format conversion.
+   */
+  qemu = mks_test_qemu_new (64, 48, PIXMAN_a8r8g8b8);
+  screen = mks_test_qemu_connect (qemu, &session);
+  mks_test_qemu_wait (qemu, 1, 1);
+  g_assert_no_error (qemu->rejected);
+
+  paintable = attach_sync (screen, display);
+  mks_test_qemu_wait (qemu, 2, 1);
+  g_assert_no_error (qemu->rejected);
+
+  mks_test_qemu_send_frame (qemu);
+  mks_test_qemu_wait (qemu, 2, 1);
+  g_assert_no_error (qemu->rejected);
+}
+
+static void
+test_mks_screen_suspend_hidden (void)
+{
+  g_autoptr(MksTestQemu) qemu = NULL;
+  g_autoptr(MksSession) session = NULL;
+  g_autoptr(MksScreen) screen = NULL;
+  g_autoptr(GdkPaintable) main_view = NULL;
+  g_autoptr(GdkPaintable) preview = NULL;
+  g_autoptr(GdkPaintable) reattached = NULL;
+  g_autoptr(MksScreenView) main_view_view = NULL;
+  g_autoptr(MksScreenView) preview_view = NULL;
+  GdkDisplay *display;
+  gsize frame_size = 64 * 48 * 4;
+
+  if (!gtk_init_check () || !(display = gdk_display_get_default ()))
+    {
+      g_test_skip ("No display available");
+      return;
+    }
+
+  qemu = mks_test_qemu_new (64, 48, PIXMAN_x8r8g8b8);
+  screen = mks_test_qemu_connect (qemu, &session);
+  mks_test_qemu_wait (qemu, 1, 1);
+  g_assert_cmpuint (qemu->bytes_sent, ==, frame_size);
+
+  main_view = attach_sync (screen, display);
+  preview = attach_sync (screen, display);
+  mks_test_qemu_wait (qemu, 2, 1);
+  g_assert_cmpuint (qemu->bytes_sent, ==, frame_size * 2);
+
+  /* Callers without a widget keep receiving frames */
+  mks_test_qemu_send_frame (qemu);
+  mks_test_qemu_wait (qemu, 2, 1);
+  g_assert_cmpuint (qemu->bytes_sent, ==, frame_size * 3);
+
+  main_view_view = mks_screen_add_view (screen, main_view, TRUE);
+  preview_view = mks_screen_add_view (screen, preview, FALSE);
+  mks_test_qemu_send_frame (qemu);
+  mks_test_qemu_wait (qemu, 2, 1);
+  g_assert_cmpuint (qemu->bytes_sent, ==, frame_size * 4);
+
+  /* Hiding the last shown widget closes the listener connection */
+  mks_screen_view_set_shown (main_view_view, FALSE);
+  mks_test_qemu_wait (qemu, 2, 0);
+
+  for (guint i = 0; i < 10; i++)
+    mks_test_qemu_send_frame (qemu);
+  mks_test_qemu_wait (qemu, 2, 0);
+  g_assert_cmpuint (qemu->bytes_sent, ==, frame_size * 4);
+
+  /* Showing one registers again and gets the current contents */
+  mks_screen_view_set_shown (preview_view, TRUE);
+  mks_test_qemu_wait (qemu, 3, 1);
+  g_assert_cmpuint (qemu->bytes_sent, ==, frame_size * 5);
+
+  mks_test_qemu_send_frame (qemu);
+  mks_test_qemu_wait (qemu, 3, 1);
+  g_assert_cmpuint (qemu->bytes_sent, ==, frame_size * 6);
+
+  /* Releasing the views while hidden does not register again */
+  mks_screen_view_set_shown (preview_view, FALSE);
+  mks_test_qemu_wait (qemu, 3, 0);
+  g_clear_pointer (&main_view_view, mks_screen_view_unref);
+  g_clear_pointer (&preview_view, mks_screen_view_unref);
+  mks_test_qemu_send_frame (qemu);
+  mks_test_qemu_wait (qemu, 3, 0);
+  g_assert_cmpuint (qemu->bytes_sent, ==, frame_size * 6);
+
+  /* Until a caller without a widget attaches it again */
+  reattached = attach_sync (screen, display);
+  g_assert_true (reattached == main_view);
+  mks_test_qemu_wait (qemu, 4, 1);
+  g_assert_cmpuint (qemu->bytes_sent, ==, frame_size * 7);
+
+  /* Once every viewer is gone, activity is tracked again */
+  g_clear_object (&reattached);
+  g_clear_object (&main_view);
+  g_clear_object (&preview);
+  mks_test_qemu_wait (qemu, 5, 1);
+  g_assert_cmpuint (qemu->bytes_sent, ==, frame_size * 8);
+  g_assert_no_error (qemu->rejected);
+}
+
 static void
 test_mks_transport_add_tests (void)
 {
@@ -451,6 +1086,12 @@ test_mks_transport_add_tests (void)
                    test_mks_session_primary_screen_waits_for_new_graphic_activity);
   g_test_add_func ("/Mks/session/primary-screen/waits-for-settled-graphic-activity",
                    test_mks_session_primary_screen_waits_for_settled_graphic_activity);
+  g_test_add_func ("/Mks/session/primary-screen/hysteresis",
+                   test_mks_session_primary_screen_hysteresis);
+  g_test_add_func ("/Mks/screen/activity-epoch", test_mks_screen_activity_epoch);
+  g_test_add_func ("/Mks/screen/attach-shared", test_mks_screen_attach_shared);
+  g_test_add_func ("/Mks/screen/suspend-hidden", test_mks_screen_suspend_hidden);
+  g_test_add_func ("/Mks/paintable/scanout-argb", test_mks_paintable_scanout_argb);
 }
 
 int
@@ -458,6 +1099,7 @@ main (int   argc,
       char *argv[])
 {
   g_test_init (&argc, &argv, NULL);
+  dex_init ();
   test_mks_transport_add_tests ();
 
   return g_test_run ();
@@ -0,0 +1,548 @@
+/* test-pixels.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include <pixman.h>
+
+#include "mks-pixels-private.h"
+
+/* Odd widths so that both the vector body and scalar tail are used */
+static const guint widths[] = { 1, 3, 7, 8, 9, 17, 33, 131 };
+
+static guint32
+reference_pixel (guint         pixman_format,
+                 const guint8 *src)
+{
+  guint32 p32;
+  guint16 p16;
+  guint a, r, g, b;
+
+  switch (pixman_format)
+    {
+    case PIXMAN_a8r8g8b8:
+      memcpy (&p32, src, 4);
+      return p32;
+
+    case PIXMAN_x8r8g8b8:
+      memcpy (&p32, src, 4);
+      return 0xff000000 | (p32 & 0xffffff);
+
+    case PIXMAN_a8b8g8r8:
+    case PIXMAN_x8b8g8r8:
+      memcpy (&p32, src, 4);
+      a = pixman_format == PIXMAN_a8b8g8r8 ? (p32 >> 24) : 0xff;
+      b = (p32 >> 16) & 0xff;
+      g = (p32 >> 8) & 0xff;
+      r = p32 & 0xff;
+      return (a << 24) | (r << 16) | (g << 8) | b;
+
+    case PIXMAN_x2r10g10b10:
+      memcpy (&p32, src, 4);
+      r = ((p32 >> 20) & 0x3ff) * 255 / 1023;
+      g = ((p32 >> 10) & 0x3ff) * 255 / 1023;
+      b = (p32 & 0x3ff) * 255 / 1023;
+      return 0xff000000 | (r << 16) | (g << 8) | b;
+
+    case PIXMAN_r5g6b5:
+      memcpy (&p16, src, 2);
+      r = (p16 >> 11) & 0x1f;
+      g = (p16 >> 5) & 0x3f;
+      b = p16 & 0x1f;
+      r = (r << 3) | (r >> 2);
+      g = (g << 2) | (g >> 4);
+      b = (b << 3) | (b >> 2);
+      return 0xff000000 | (r << 16) | (g << 8) | b;
+
+    default:
+      g_assert_not_reached ();
+    }
+}
+
+static void
+check_format (guint pixman_format,
+              guint max_error)
+{
+  guint bpp = PIXMAN_FORMAT_BPP (pixman_format) / 8;
+
+  g_assert_true (mks_pixels_can_convert (pixman_format));
+
+  for (guint w = 0; w < G_N_ELEMENTS (widths); w++)
+    {
+      guint width = widths[w];
+      guint height = 5;
+      gsize src_stride = width * bpp + 12;
+      gsize dst_stride = width * 4 + 8;
+      g_autofree guint8 *src = g_malloc (src_stride * height + 1);
+      g_autofree guint8 *dst = g_malloc0 (dst_stride * height + 1);
+
+      for (gsize i = 0; i < src_stride * height + 1; i++)
+        src[i] = g_test_rand_int_range (0, 256);
+
+      /* Use unaligned source and destination to mirror D-Bus payloads */
+      mks_pixels_convert_rows (pixman_format,
+                               dst + 1, dst_stride,
+                               src + 1, src_stride,
+                               width, height);
+
+      for (guint y = 0; y < height; y++)
+        {
+          /* Padding past the row must not be touched */
+          for (gsize i = width * 4; i < dst_stride; i++)
+            g_assert_cmpint (dst[1 + y * dst_stride + i], ==, 0);
+
+          for (guint x = 0; x < width; x++)
+            {
+              guint32 expected = reference_pixel (pixman_format, &src[1 + y * src_stride + x * bpp]);
+              guint32 actual;
+
+              memcpy (&actual, &dst[1 + y * dst_stride + x * 4], 4);
+
+              for (guint shift = 0; shift < 32; shift += 8)
+                {
+                  int e = (expected >> shift) & 0xff;
+                  int a = (actual >> shift) & 0xff;
+
+                  g_assert_cmpint (ABS (e - a), <=, max_error);
+                }
+            }
+        }
+    }
+}
+
+/* BT.601 limited range, written out in full rather than in vectors */
+static guint32
+reference_yuv_pixel (int y,
+                     int u,
+                     int v)
+{
+  int c = y - 16;
+  int d = u - 128;
+  int e = v - 128;
+  int r = CLAMP ((298 * c + 409 * e + 128) >> 8, 0, 255);
+  int g = CLAMP ((298 * c - 100 * d - 208 * e + 128) >> 8, 0, 255);
+  int b = CLAMP ((298 * c + 516 * d + 128) >> 8, 0, 255);
+
+  return 0xff000000 | (r << 16) | (g << 8) | b;
+}
+
+static void
+check_yuv (MksPixelsYuv layout)
+{
+  for (guint w = 0; w < G_N_ELEMENTS (widths); w++)
+    {
+      for (guint x = 0; x < 2; x++)
+        {
+          /* Start on odd rows and columns to split chroma pairs */
+          guint width = widths[w];
+          guint height = 5;
+          guint y = 1;
+          guint chroma_width = (x + width + 1) / 2;
+          guint chroma_height = (y + height + 1) / 2;
+          gsize strides[3] = {
+            x + width + 5,
+            layout == MKS_PIXELS_NV12 ? chroma_width * 2 + 3 : chroma_width + 3,
+            chroma_width + 1,
+          };
+          gsize dst_stride = width * 4 + 8;
+          g_autofree guint8 *luma = g_malloc (strides[0] * (y + height));
+          g_autofree guint8 *u = g_malloc (strides[1] * chroma_height);
+          g_autofree guint8 *v = g_malloc (strides[2] * chroma_height);
+          g_autofree guint8 *dst = g_malloc0 (dst_stride * height);
+          const guint8 *planes[3] = { luma, u, layout == MKS_PIXELS_NV12 ? NULL : v };
+
+          for (gsize i = 0; i < strides[0] * (y + height); i++)
+            luma[i] = g_test_rand_int_range (0, 256);
+          for (gsize i = 0; i < strides[1] * chroma_height; i++)
+            u[i] = g_test_rand_int_range (0, 256);
+          for (gsize i = 0; i < strides[2] * chroma_height; i++)
+            v[i] = g_test_rand_int_range (0, 256);
+
+          mks_pixels_convert_yuv_rows (layout, dst, dst_stride, planes, strides,
+                                       x, y, width, height);
+
+          for (guint row = 0; row < height; row++)
+            {
+              guint sy = y + row;
+
+              /* Padding past the row must not be touched */
+              for (gsize i = width * 4; i < dst_stride; i++)
+                g_assert_cmpint (dst[row * dst_stride + i], ==, 0);
+
+              for (guint col = 0; col < width; col++)
+                {
+                  guint sx = x + col;
+                  guint32 expected;
+                  guint32 actual;
+                  int cu, cv;
+
+                  if (layout == MKS_PIXELS_NV12)
+                    {
+                      cu = u[sy / 2 * strides[1] + sx / 2 * 2];
+                      cv = u[sy / 2 * strides[1] + sx / 2 * 2 + 1];
+                    }
+                  else
+                    {
+                      cu = u[sy / 2 * strides[1] + sx / 2];
+                      cv = v[sy / 2 * strides[2] + sx / 2];
+                    }
+
+                  expected = reference_yuv_pixel (luma[sy * strides[0] + sx], cu, cv);
+                  memcpy (&actual, &dst[row * dst_stride + col * 4], 4);
+
+                  g_assert_cmphex (actual, ==, expected);
+                }
+            }
+        }
+    }
+}
+
+/* A 4x4 frame of 2x2 blocks in black, white, red and blue */
+static const guint8 golden_luma[] = {
+   16,  16, 235, 235,
+   16,  16, 235, 235,
+   81,  81,  41,  41,
+   81,  81,  41,  41,
+};
+static const guint8 golden_u[] = { 128, 128, 90, 240 };
+static const guint8 golden_v[] = { 128, 128, 240, 110 };
+static const guint32 golden_argb[] = {
+  0xff000000, 0xff000000, 0xffffffff, 0xffffffff,
+  0xff000000, 0xff000000, 0xffffffff, 0xffffffff,
+  0xffff0000, 0xffff0000, 0xff0000ff, 0xff0000ff,
+  0xffff0000, 0xffff0000, 0xff0000ff, 0xff0000ff,
+};
+
+static void
+check_yuv_golden (MksPixelsYuv  layout,
+                  const guint8 *planes[3],
+                  const gsize   strides[3])
+{
+  guint32 dst[16];
+
+  mks_pixels_convert_yuv_rows (layout, (guint8 *)dst, 4 * 4, planes, strides, 0, 0, 4, 4);
+  g_assert_cmpmem (dst, sizeof dst, golden_argb, sizeof golden_argb);
+
+  /* The middle of the frame touches all four blocks */
+  memset (dst, 0, sizeof dst);
+  mks_pixels_convert_yuv_rows (layout, (guint8 *)dst, 2 * 4, planes, strides, 1, 1, 2, 2);
+  g_assert_cmphex (dst[0], ==, golden_argb[5]);
+  g_assert_cmphex (dst[1], ==, golden_argb[6]);
+  g_assert_cmphex (dst[2], ==, golden_argb[9]);
+  g_assert_cmphex (dst[3], ==, golden_argb[10]);
+}
+
+static void
+test_pixels_nv12 (void)
+{
+  guint8 uv[8];
+  const guint8 *planes[3] = { golden_luma, uv, NULL };
+  const gsize strides[3] = { 4, 4, 0 };
+
+  /* Interleave the chroma of the golden frame */
+  for (guint i = 0; i < 4; i++)
+    {
+      uv[i * 2] = golden_u[i];
+      uv[i * 2 + 1] = golden_v[i];
+    }
+
+  check_yuv_golden (MKS_PIXELS_NV12, planes, strides);
+  check_yuv (MKS_PIXELS_NV12);
+}
+
+static void
+test_pixels_i420 (void)
+{
+  const guint8 *planes[3] = { golden_luma, golden_u, golden_v };
+  const gsize strides[3] = { 4, 2, 2 };
+
+  check_yuv_golden (MKS_PIXELS_I420, planes, strides);
+  check_yuv (MKS_PIXELS_I420);
+}
+
+static void
+test_pixels_a8r8g8b8 (void)
+{
+  check_format (PIXMAN_a8r8g8b8, 0);
+}
+
+static void
+test_pixels_x8r8g8b8 (void)
+{
+  check_format (PIXMAN_x8r8g8b8, 0);
+}
+
+static void
+test_pixels_a8b8g8r8 (void)
+{
+  check_format (PIXMAN_a8b8g8r8, 0);
+}
+
+static void
+test_pixels_x8b8g8r8 (void)
+{
+  check_format (PIXMAN_x8b8g8r8, 0);
+}
+
+static void
+test_pixels_x2r10g10b10 (void)
+{
+  /* Truncation to 8 bits may be off by one from rounding */
+  check_format (PIXMAN_x2r10g10b10, 1);
+}
+
+static void
+test_pixels_r5g6b5 (void)
+{
+  check_format (PIXMAN_r5g6b5, 0);
+}
+
+static void
+test_pixels_unsupported (void)
+{
+  g_assert_false (mks_pixels_can_convert (PIXMAN_a8));
+  g_assert_false (mks_pixels_can_convert (0));
+}
+
+static void
+test_pixels_hash (void)
+{
+  gsize stride = 64 * 4 + 16;
+  g_autofree guint8 *data = g_malloc (stride * 64);
+  guint64 hash;
+
+  for (gsize i = 0; i < stride * 64; i++)
+    data[i] = g_test_rand_int_range (0, 256);
+
+  hash = mks_pixels_hash_rows (data, stride, 64 * 4, 64);
+  g_assert_cmpuint (hash, ==, mks_pixels_hash_rows (data, stride, 64 * 4, 64));
+
+  /* Padding is not part of the hash */
+  data[stride - 1] ^= 1;
+  g_assert_cmpuint (hash, ==, mks_pixels_hash_rows (data, stride, 64 * 4, 64));
+
+  /* But every byte of the rows is, including the unvectorized tail */
+  for (gsize i = 0; i < 64 * 4; i += 31)
+    {
+      data[stride * 37 + i] ^= 0x10;
+      g_assert_cmpuint (hash, !=, mks_pixels_hash_rows (data, stride, 64 * 4, 64));
+      data[stride * 37 + i] ^= 0x10;
+    }
+
+  g_assert_cmpuint (hash, !=, mks_pixels_hash_rows (data, stride, 64 * 4 - 3, 64));
+  g_assert_cmpuint (hash, !=, mks_pixels_hash_rows (data, stride, 64 * 4, 63));
+}
+
+static void
+test_pixels_downsample (void)
+{
+  /* Ratios which do not divide evenly so that boxes differ in size */
+  guint src_width = 37;
+  guint src_height = 23;
+  guint dst_width = 10;
+  guint dst_height = 7;
+  gsize src_stride = src_width * 4 + 12;
+  gsize dst_stride = dst_width * 4;
+  g_autofree guint8 *src = g_malloc (src_stride * src_height);
+  g_autofree guint8 *dst = g_malloc0 (dst_stride * dst_height);
+  g_autofree guint8 *damaged = g_malloc0 (dst_stride * dst_height);
+  static const struct {
+    guint x, y, width, height;
+  } rects[] = {
+    {  0, 0,  5,  5 },
+    {  5, 0, 32,  3 },
+    {  0, 3, 37, 20 },
+  };
+
+  for (gsize i = 0; i < src_stride * src_height; i++)
+    src[i] = g_test_rand_int_range (0, 256);
+
+  mks_pixels_downsample (PIXMAN_a8r8g8b8,
+                         dst, dst_stride, dst_width, dst_height,
+                         src, src_stride, src_width, src_height,
+                         0, 0, src_width, src_height);
+
+  /* Every destination pixel is the rounded average of its box */
+  for (guint dy = 0; dy < dst_height; dy++)
+    {
+      guint y0 = dy * src_height / dst_height;
+      guint y1 = (dy + 1) * src_height / dst_height;
+
+      for (guint dx = 0; dx < dst_width; dx++)
+        {
+          guint x0 = dx * src_width / dst_width;
+          guint x1 = (dx + 1) * src_width / dst_width;
+          guint n = (x1 - x0) * (y1 - y0);
+
+          for (guint c = 0; c < 4; c++)
+            {
+              guint sum = 0;
+
+              for (guint y = y0; y < y1; y++)
+                for (guint x = x0; x < x1; x++)
+                  sum += src[y * src_stride + x * 4 + c];
+
+              g_assert_cmpint (dst[dy * dst_stride + dx * 4 + c], ==, (sum + n / 2) / n);
+            }
+        }
+    }
+
+  /* Aligned damage produces the same pixels as the whole frame */
+  for (guint i = 0; i < G_N_ELEMENTS (rects); i++)
+    {
+      guint x = rects[i].x;
+      guint y = rects[i].y;
+      guint width = rects[i].width;
+      guint height = rects[i].height;
+
+      mks_pixels_downsample_align (src_width, dst_width, &x, &width);
+      mks_pixels_downsample_align (src_height, dst_height, &y, &height);
+
+      mks_pixels_downsample (PIXMAN_a8r8g8b8,
+                             damaged, dst_stride, dst_width, dst_height,
+                             src + y * src_stride + x * 4, src_stride, src_width, src_height,
+                             x, y, width, height);
+    }
+
+  g_assert_cmpmem (dst, dst_stride * dst_height, damaged, dst_stride * dst_height);
+}
+
+static void
+test_pixels_downsample_convert (void)
+{
+  guint width = 33;
+  guint height = 9;
+  gsize src_stride = width * 2;
+  gsize dst_stride = width * 4;
+  g_autofree guint8 *src = g_malloc (src_stride * height);
+  g_autofree guint8 *converted = g_malloc (dst_stride * height);
+  g_autofree guint8 *dst = g_malloc (dst_stride * height);
+
+  for (gsize i = 0; i < src_stride * height; i++)
+    src[i] = g_test_rand_int_range (0, 256);
+
+  /* Without scaling, downsampling is a plain conversion */
+  mks_pixels_convert_rows (PIXMAN_r5g6b5, converted, dst_stride, src, src_stride, width, height);
+  mks_pixels_downsample (PIXMAN_r5g6b5,
+                         dst, dst_stride, width, height,
+                         src, src_stride, width, height,
+                         0, 0, width, height);
+
+  g_assert_cmpmem (converted, dst_stride * height, dst, dst_stride * height);
+}
+
+static void
+test_pixels_flip (void)
+{
+  /* Odd row count so the middle row stays in place */
+  guint height = 7;
+  gsize row_bytes = 131 * 4 + 3;
+  gsize stride = row_bytes + 9;
+  g_autofree guint8 *src = g_malloc (stride * height);
+  g_autofree guint8 *dst = g_malloc (stride * height);
+
+  for (gsize i = 0; i < stride * height; i++)
+    src[i] = g_test_rand_int_range (0, 256);
+
+  memcpy (dst, src, stride * height);
+  mks_pixels_flip_rows (dst, stride, row_bytes, height);
+
+  for (guint y = 0; y < height; y++)
+    {
+      g_assert_cmpmem (&dst[y * stride], row_bytes,
+                       &src[(height - 1 - y) * stride], row_bytes);
+
+      /* Padding past the row must not be touched */
+      g_assert_cmpmem (&dst[y * stride + row_bytes], stride - row_bytes,
+                       &src[y * stride + row_bytes], stride - row_bytes);
+    }
+}
+
+static void
+test_pixels_impls (void)
+{
+  const char * const *names = mks_pixels_get_impl_names ();
+  const char *initial = mks_pixels_get_impl_name ();
+  gsize stride = 131 * 4;
+  g_autofree guint8 *data = g_malloc (stride * 9);
+  guint64 hash;
+
+  g_assert_nonnull (names);
+  g_assert_true (g_strv_contains (names, "scalar"));
+  g_assert_true (g_strv_contains (names, initial));
+  g_assert_false (mks_pixels_set_impl ("not-an-impl"));
+
+  for (gsize i = 0; i < stride * 9; i++)
+    data[i] = g_test_rand_int_range (0, 256);
+
+  g_assert_true (mks_pixels_set_impl ("scalar"));
+  hash = mks_pixels_hash_rows (data, stride, stride, 9);
+
+  /* Every implementation must match the scalar reference */
+  for (guint i = 0; names[i]; i++)
+    {
+      g_test_message ("Checking %s pixel kernels", names[i]);
+
+      g_assert_true (mks_pixels_set_impl (names[i]));
+      g_assert_cmpstr (mks_pixels_get_impl_name (), ==, names[i]);
+
+      check_format (PIXMAN_x8r8g8b8, 0);
+      check_format (PIXMAN_a8b8g8r8, 0);
+      check_format (PIXMAN_x8b8g8r8, 0);
+      check_format (PIXMAN_x2r10g10b10, 1);
+      check_format (PIXMAN_r5g6b5, 0);
+      test_pixels_nv12 ();
+      test_pixels_i420 ();
+      test_pixels_flip ();
+
+      g_assert_cmpuint (hash, ==, mks_pixels_hash_rows (data, stride, stride, 9));
+    }
+
+  g_assert_true (mks_pixels_set_impl (initial));
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_message ("Using %s pixel kernels", mks_pixels_get_impl_name ());
+
+  g_test_add_func ("/Mks/Pixels/a8r8g8b8", test_pixels_a8r8g8b8);
+  g_test_add_func ("/Mks/Pixels/x8r8g8b8", test_pixels_x8r8g8b8);
+  g_test_add_func ("/Mks/Pixels/a8b8g8r8", test_pixels_a8b8g8r8);
+  g_test_add_func ("/Mks/Pixels/x8b8g8r8", test_pixels_x8b8g8r8);
+  g_test_add_func ("/Mks/Pixels/x2r10g10b10", test_pixels_x2r10g10b10);
+  g_test_add_func ("/Mks/Pixels/r5g6b5", test_pixels_r5g6b5);
+  g_test_add_func ("/Mks/Pixels/nv12", test_pixels_nv12);
+  g_test_add_func ("/Mks/Pixels/i420", test_pixels_i420);
+  g_test_add_func ("/Mks/Pixels/unsupported", test_pixels_unsupported);
+  g_test_add_func ("/Mks/Pixels/hash", test_pixels_hash);
+  g_test_add_func ("/Mks/Pixels/flip", test_pixels_flip);
+  g_test_add_func ("/Mks/Pixels/impls", test_pixels_impls);
+  g_test_add_func ("/Mks/Pixels/downsample", test_pixels_downsample);
+  g_test_add_func ("/Mks/Pixels/downsample-convert", test_pixels_downsample_convert);
+
+  return g_test_run ();
+}
@@ -0,0 +1,222 @@
+/* test-shm-publisher.c
+ *
+ * Copyright 2026 Christian Hergert <christian@sourceandstack.com>
+ *
+ * This library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <libmks.h>
+#include <pixman.h>
+
+#include "mks-shm-publisher-private.h"
+
+static guint8 *
+create_frame (guint  width,
+              guint  height,
+              guint  stride,
+              guint8 seed)
+{
+  guint8 *data = g_malloc (stride * height);
+
+  for (guint i = 0; i < stride * height; i++)
+    data[i] = (guint8)(i * 7 + seed);
+
+  return data;
+}
+
+static const guint8 *
+shared_pixel (const guint8 *map,
+              guint         x,
+              guint         y)
+{
+  const MksShmHeader *header = (const MksShmHeader *)map;
+
+  return map + MKS_SHM_HEADER_SIZE + (gsize)y * header->stride + (gsize)x * 4;
+}
+
+static void
+test_shm_publisher_publish (void)
+{
+  g_autoptr(MksShmPublisher) publisher = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree guint8 *frame = NULL;
+  g_autofree guint8 *next = NULL;
+  const MksShmHeader *header;
+  const MksShmDamage *damage;
+  guint8 *map;
+  int fd;
+
+  publisher = mks_shm_publisher_new (&error);
+  g_assert_no_error (error);
+  g_assert_nonnull (publisher);
+
+  frame = create_frame (64, 32, 64 * 4 + 16, 0);
+  mks_shm_publisher_publish (publisher, frame, 64 * 4 + 16, 64, 32, PIXMAN_x8r8g8b8, NULL);
+
+  fd = mks_shm_publisher_dup_fd (publisher, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (fd, >, -1);
+
+  /* Readers cannot write to the framebuffer */
+  g_assert_true (mmap (NULL, MKS_SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) == MAP_FAILED);
+  g_assert_cmpint (errno, ==, EACCES);
+
+  map = mmap (NULL, MKS_SHM_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+  g_assert_true (map != MAP_FAILED);
+  close (fd);
+
+  header = (const MksShmHeader *)map;
+  g_assert_cmphex (header->magic, ==, MKS_SHM_MAGIC);
+  g_assert_cmpuint (header->seq, ==, 2);
+  g_assert_cmpuint (header->width, ==, 64);
+  g_assert_cmpuint (header->height, ==, 32);
+  g_assert_cmpuint (header->stride, ==, 64 * 4);
+  g_assert_cmphex (header->pixman_format, ==, PIXMAN_x8r8g8b8);
+
+  for (guint y = 0; y < 32; y++)
+    g_assert_cmpmem (shared_pixel (map, 0, y), 64 * 4, &frame[y * (64 * 4 + 16)], 64 * 4);
+
+  /* Only the damaged area is copied and recorded */
+  next = create_frame (64, 32, 64 * 4 + 16, 1);
+  mks_shm_publisher_publish (publisher, next, 64 * 4 + 16, 64, 32, PIXMAN_x8r8g8b8,
+                             &(cairo_rectangle_int_t) { 8, 4, 16, 8 });
+  g_assert_cmpuint (header->seq, ==, 4);
+
+  damage = &header->damage[2];
+  g_assert_cmpuint (damage->seq, ==, 4);
+  g_assert_cmpint (damage->x, ==, 8);
+  g_assert_cmpint (damage->y, ==, 4);
+  g_assert_cmpint (damage->width, ==, 16);
+  g_assert_cmpint (damage->height, ==, 8);
+
+  g_assert_cmpmem (shared_pixel (map, 8, 4), 16 * 4, &next[4 * (64 * 4 + 16) + 8 * 4], 16 * 4);
+  g_assert_cmpmem (shared_pixel (map, 0, 0), 4, &frame[0], 4);
+
+  /* Damage outside the framebuffer is dropped */
+  mks_shm_publisher_publish (publisher, next, 64 * 4 + 16, 64, 32, PIXMAN_x8r8g8b8,
+                             &(cairo_rectangle_int_t) { 100, 100, 16, 8 });
+  g_assert_cmpuint (header->seq, ==, 4);
+
+  /* A new size publishes everything regardless of the area */
+  mks_shm_publisher_publish (publisher, next, 32 * 4, 32, 16, PIXMAN_a8r8g8b8,
+                             &(cairo_rectangle_int_t) { 0, 0, 1, 1 });
+  g_assert_cmpuint (header->seq, ==, 6);
+  g_assert_cmpuint (header->width, ==, 32);
+  g_assert_cmpuint (header->stride, ==, 32 * 4);
+  g_assert_cmpint (header->damage[3].width, ==, 32);
+  g_assert_cmpint (header->damage[3].height, ==, 16);
+
+  mks_shm_publisher_clear (publisher);
+  g_assert_cmpuint (header->seq, ==, 8);
+  g_assert_cmpuint (header->width, ==, 0);
+  g_assert_cmpuint (header->flags & MKS_SHM_CLOSED, ==, 0);
+
+  g_clear_pointer (&publisher, mks_shm_publisher_unref);
+  g_assert_cmpuint (header->seq, ==, 10);
+  g_assert_cmpuint (header->flags & MKS_SHM_CLOSED, !=, 0);
+
+  munmap (map, MKS_SHM_SIZE);
+}
+
+static void
+count_cb (GdkPaintable *paintable,
+          guint        *count)
+{
+  (*count)++;
+}
+
+static void
+test_shared_paintable_follow (void)
+{
+  g_autoptr(MksShmPublisher) publisher = NULL;
+  g_autoptr(MksSharedPaintable) paintable = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree guint8 *frame = NULL;
+  guint n_size = 0;
+  guint n_contents = 0;
+  int fd;
+
+  publisher = mks_shm_publisher_new (&error);
+  g_assert_no_error (error);
+
+  frame = create_frame (64, 32, 64 * 4, 0);
+  mks_shm_publisher_publish (publisher, frame, 64 * 4, 64, 32, PIXMAN_x8r8g8b8, NULL);
+
+  fd = mks_shm_publisher_dup_fd (publisher, &error);
+  g_assert_no_error (error);
+
+  paintable = mks_shared_paintable_new (fd, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (paintable);
+  close (fd);
+
+  g_assert_cmpint (gdk_paintable_get_intrinsic_width (GDK_PAINTABLE (paintable)), ==, 64);
+  g_assert_cmpint (gdk_paintable_get_intrinsic_height (GDK_PAINTABLE (paintable)), ==, 32);
+
+  g_signal_connect (paintable, "invalidate-size", G_CALLBACK (count_cb), &n_size);
+  g_signal_connect (paintable, "invalidate-contents", G_CALLBACK (count_cb), &n_contents);
+
+  mks_shm_publisher_publish (publisher, frame, 64 * 4, 64, 32, PIXMAN_x8r8g8b8,
+                             &(cairo_rectangle_int_t) { 0, 0, 8, 8 });
+
+  while (n_contents == 0)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_cmpuint (n_size, ==, 0);
+
+  mks_shm_publisher_publish (publisher, frame, 32 * 4, 32, 16, PIXMAN_x8r8g8b8, NULL);
+
+  while (n_size == 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpint (gdk_paintable_get_intrinsic_width (GDK_PAINTABLE (paintable)), ==, 32);
+  g_assert_cmpint (gdk_paintable_get_intrinsic_height (GDK_PAINTABLE (paintable)), ==, 16);
+}
+
+static void
+test_shared_paintable_unsealed (void)
+{
+  g_autoptr(MksSharedPaintable) paintable = NULL;
+  g_autoptr(GError) error = NULL;
+  int fd;
+
+  fd = memfd_create ("test", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  g_assert_cmpint (fd, >, -1);
+  g_assert_cmpint (ftruncate (fd, MKS_SHM_SIZE), ==, 0);
+
+  paintable = mks_shared_paintable_new (fd, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+  g_assert_null (paintable);
+
+  close (fd);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  g_test_add_func ("/Mks/ShmPublisher/publish", test_shm_publisher_publish);
+  g_test_add_func ("/Mks/SharedPaintable/follow", test_shared_paintable_follow);
+  g_test_add_func ("/Mks/SharedPaintable/unsealed", test_shared_paintable_unsealed);
+  return g_test_run ();
+}